@@ -0,0 +1,262 @@
+// Benchmark firmware, built instead of the monitor with
+//   mbed compile -m NUCLEO_F439ZI -t GCC_ARM --app-config mbed_app_benchmark.json
+// It prints one JSON object per line, for example
+//   {"name":"format_sprintf","value":4210,"unit":"cycles"}
+// followed by {"name":"done"}, so results can be diffed between releases.
+
+#ifdef BENCHMARK_BUILD
+
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "instrumentation.h"
+#include "number_format.h"
+#include "pc_serial_com.h"
+#include "sampler.h"
+#include "sensor_units.h"
+
+#if !INSTRUMENTATION_ENABLED
+#error "The benchmark needs the cycle counter of the instrumentation module"
+#endif
+
+//=====[Declaration of private defines]========================================
+
+#define BENCHMARK_CONVERSION_ITERATIONS 10000
+#define BENCHMARK_FORMAT_ITERATIONS     1000
+#define BENCHMARK_POLLING_READS         10000
+#define BENCHMARK_STABLE_READS          10
+#define BENCHMARK_DMA_DURATION_MS       2000
+#define BENCHMARK_UART_DURATION_MS      3000
+
+#define BENCHMARK_RESULTS_MAX           16
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct {
+    const char* name;
+    uint32_t value;
+    const char* unit;
+} benchmarkResult_t;
+
+//=====[Declaration and initialization of private global variables]============
+
+// Results are kept until the UART benchmark is over, so that printing them
+// does not disturb any measurement
+static benchmarkResult_t results[BENCHMARK_RESULTS_MAX];
+static int resultCount = 0;
+
+// Keeps the compiler from folding the benchmarked conversions away
+static volatile uint16_t benchmarkReading = 31000;
+static volatile int32_t benchmarkSink;
+static volatile float benchmarkFloatSink;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void benchmarkResultAdd(const char* name, uint32_t value, const char* unit);
+static void benchmarkResultsPrint();
+static void benchmarkPolling();
+static void benchmarkDma();
+static void benchmarkConversions();
+static void benchmarkFormatting();
+static void benchmarkUart();
+static float benchmarkReadStableAnalog(AnalogIn& sensor);
+
+//=====[Implementations of public functions]===================================
+
+int main() {
+    instrumentationInit();
+    pcSerialComInit();
+
+    // Polling has to come first: the sampler takes over the ADC for good
+    benchmarkPolling();
+    benchmarkDma();
+    benchmarkConversions();
+    benchmarkFormatting();
+    benchmarkUart();
+
+    benchmarkResultsPrint();
+    while (true) {
+        ThisThread::sleep_for(1s);
+    }
+}
+
+//=====[Implementations of private functions]==================================
+
+static void benchmarkResultAdd(const char* name, uint32_t value, const char* unit) {
+    if (resultCount < BENCHMARK_RESULTS_MAX) {
+        results[resultCount].name = name;
+        results[resultCount].value = value;
+        results[resultCount].unit = unit;
+        resultCount++;
+    }
+}
+
+static void benchmarkResultsPrint() {
+    char str[100];
+    for (int i = 0; i < resultCount; ++i) {
+        char* cursor = numberFormatAppendString(str, "{\"name\":\"");
+        cursor = numberFormatAppendString(cursor, results[i].name);
+        cursor = numberFormatAppendString(cursor, "\",\"value\":");
+        cursor = numberFormatAppendUnsigned(cursor, results[i].value);
+        cursor = numberFormatAppendString(cursor, ",\"unit\":\"");
+        cursor = numberFormatAppendString(cursor, results[i].unit);
+        numberFormatAppendString(cursor, "\"}\r\n");
+        pcSerialComStringWrite(str);
+    }
+    pcSerialComStringWrite("{\"name\":\"done\"}\r\n");
+}
+
+// Samples per second of the original blocking readStableAnalog() and of
+// back-to-back AnalogIn reads, on the LM35 input
+static void benchmarkPolling() {
+    AnalogIn lm35(A1);
+    Timer timer;
+
+    timer.start();
+    benchmarkFloatSink = benchmarkReadStableAnalog(lm35);
+    uint32_t stableUs = (uint32_t)timer.elapsed_time().count();
+    benchmarkResultAdd("read_stable_analog", 1000000UL / stableUs, "readings/s");
+
+    timer.reset();
+    for (int i = 0; i < BENCHMARK_POLLING_READS; ++i) {
+        benchmarkSink = lm35.read_u16();
+    }
+    uint32_t pollingUs = (uint32_t)timer.elapsed_time().count();
+    benchmarkResultAdd("analogin_polling",
+                       (uint32_t)((uint64_t)BENCHMARK_POLLING_READS * 1000000 / pollingUs),
+                       "samples/s");
+}
+
+// Conversions per second delivered by the timer-triggered DMA sampler, and
+// the CPU time it leaves to everything else
+static void benchmarkDma() {
+    samplerSnapshot_t first;
+    samplerSnapshot_t last;
+
+    samplerInit();
+    ThisThread::sleep_for(100ms);  // Let the first half-buffers complete
+
+    mbed_stats_cpu_t statsBefore;
+    mbed_stats_cpu_get(&statsBefore);
+    samplerSnapshotRead(&first);
+    ThisThread::sleep_for(std::chrono::milliseconds(BENCHMARK_DMA_DURATION_MS));
+    samplerSnapshotRead(&last);
+    mbed_stats_cpu_t statsAfter;
+    mbed_stats_cpu_get(&statsAfter);
+
+    uint32_t samples = (last.sequence - first.sequence) * SAMPLER_SCANS_PER_HALF *
+                       SENSOR_SCAN_CHANNEL_COUNT;
+    benchmarkResultAdd("dma_sampling", samples * 1000 / BENCHMARK_DMA_DURATION_MS,
+                       "samples/s");
+
+    us_timestamp_t uptime = statsAfter.uptime - statsBefore.uptime;
+    us_timestamp_t idle = statsAfter.idle_time - statsBefore.idle_time;
+    benchmarkResultAdd("dma_sampling_cpu_idle", (uint32_t)(idle * 10000 / uptime),
+                       "hundredths_percent");
+}
+
+// Cycles per call of the original float conversions and of the fixed-point
+// ones that replaced them
+static void benchmarkConversions() {
+    uint32_t start = instrumentationCycles();
+    for (int i = 0; i < BENCHMARK_CONVERSION_ITERATIONS; ++i) {
+        float reading = benchmarkReading / 65535.0f;
+        float celsius = reading * 330.0f;
+        benchmarkFloatSink = celsius * 9.0f / 5.0f + 32.0f;
+    }
+    uint32_t floatCycles = instrumentationCycles() - start;
+    benchmarkResultAdd("lm35_fahrenheit_float",
+                       floatCycles / BENCHMARK_CONVERSION_ITERATIONS, "cycles");
+
+    start = instrumentationCycles();
+    for (int i = 0; i < BENCHMARK_CONVERSION_ITERATIONS; ++i) {
+        benchmarkSink = celsiusToFahrenheit(
+            analogReadingScaledWithTheLM35Formula(benchmarkReading));
+    }
+    uint32_t fixedCycles = instrumentationCycles() - start;
+    benchmarkResultAdd("lm35_fahrenheit_fixed",
+                       fixedCycles / BENCHMARK_CONVERSION_ITERATIONS, "cycles");
+}
+
+// Cycles to build the status line of the original firmware with sprintf()
+// and with the number_format helpers
+static void benchmarkFormatting() {
+    char str[100];
+    float gas = 0.12f;
+    float lm35 = 23.40f;
+    float potentiometer = 0.50f;
+
+    uint32_t start = instrumentationCycles();
+    for (int i = 0; i < BENCHMARK_FORMAT_ITERATIONS; ++i) {
+        sprintf(str, "Gas: %.2f, LM35: %.2f C, Potentiometer: %.2f\r\n",
+                gas, lm35, potentiometer);
+    }
+    uint32_t sprintfCycles = instrumentationCycles() - start;
+    benchmarkResultAdd("format_sprintf", sprintfCycles / BENCHMARK_FORMAT_ITERATIONS,
+                       "cycles");
+
+    start = instrumentationCycles();
+    for (int i = 0; i < BENCHMARK_FORMAT_ITERATIONS; ++i) {
+        char* cursor = numberFormatAppendString(str, "Gas: ");
+        cursor = numberFormatAppendHundredths(cursor, 12);
+        cursor = numberFormatAppendString(cursor, ", LM35: ");
+        cursor = numberFormatAppendHundredths(cursor, 2340);
+        cursor = numberFormatAppendString(cursor, " C, Potentiometer: ");
+        cursor = numberFormatAppendHundredths(cursor, 50);
+        numberFormatAppendString(cursor, "\r\n");
+    }
+    uint32_t formatCycles = instrumentationCycles() - start;
+    benchmarkResultAdd("format_number_format", formatCycles / BENCHMARK_FORMAT_ITERATIONS,
+                       "cycles");
+    benchmarkResultAdd("format_line_length", strlen(str), "bytes");
+}
+
+// Cost of queueing a status line, and bytes per second drained to the UART
+// while writers keep the TX buffer topped up
+static void benchmarkUart() {
+    static const char line[] = "Gas: 0.12, LM35: 23.40 C, Potentiometer: 0.50\r\n";
+    const uint32_t lineLength = sizeof(line) - 1;
+
+    uint32_t writes = 0;
+    uint32_t writeCycles = 0;
+    uint32_t droppedBefore = pcSerialComTxDroppedBytes();
+    Timer timer;
+    timer.start();
+
+    while (timer.elapsed_time() < std::chrono::milliseconds(BENCHMARK_UART_DURATION_MS)) {
+        if (pcSerialComTxSpace() < lineLength) {
+            ThisThread::yield();
+            continue;
+        }
+        uint32_t start = instrumentationCycles();
+        pcSerialComStringWrite(line);
+        writeCycles += instrumentationCycles() - start;
+        writes++;
+    }
+
+    // Bytes still queued were not sent within the measurement
+    uint32_t elapsedUs = (uint32_t)timer.elapsed_time().count();
+    uint32_t sent = writes * lineLength - (pcSerialComTxDroppedBytes() - droppedBefore) -
+                    (PC_SERIAL_COM_TX_BUFFER_SIZE - pcSerialComTxSpace());
+    benchmarkResultAdd("uart_write_line", writes > 0 ? writeCycles / writes : 0, "cycles");
+    benchmarkResultAdd("uart_throughput",
+                       (uint32_t)((uint64_t)sent * 1000000 / elapsedUs), "bytes/s");
+
+    while (pcSerialComTxSpace() < PC_SERIAL_COM_TX_BUFFER_SIZE) {
+        ThisThread::sleep_for(10ms);  // Results start on an empty buffer
+    }
+}
+
+// The averaging of the original firmware, kept here as the baseline
+static float benchmarkReadStableAnalog(AnalogIn& sensor) {
+    float reading = 0;
+    for (int i = 0; i < BENCHMARK_STABLE_READS; ++i) {
+        reading += sensor.read();
+        ThisThread::sleep_for(10ms);
+    }
+    return reading / BENCHMARK_STABLE_READS;
+}
+
+#endif // BENCHMARK_BUILD
@@ -0,0 +1,126 @@
+// Bootloader, built on its own and flashed once at 0x08000000 with
+//   mbed compile -m NUCLEO_F439ZI -t GCC_ARM --app-config mbed_app_bootloader.json
+//     --source bootloader --source modules/firmware_image --source mbed-os
+// It installs an image the firmware_update module staged in bank 2, then
+// starts the monitor at FIRMWARE_IMAGE_APP_ADDRESS. Boards flashed before
+// the bootloader existed need it and the monitor flashed once by hand.
+
+#ifdef BOOTLOADER_BUILD
+
+//=====[Libraries]=============================================================
+
+#include <string.h>
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "firmware_image.h"
+
+//=====[Declaration of private defines]========================================
+
+#define BOOTLOADER_COPY_SIZE        1024
+#define BOOTLOADER_SRAM_START       0x20000000
+#define BOOTLOADER_SRAM_END         0x20030000   // 192 KB
+#define BOOTLOADER_BLINK_PERIOD     100ms
+
+static_assert(FIRMWARE_IMAGE_SIZE_MAX <= FIRMWARE_IMAGE_APP_SIZE,
+              "A staged image must fit where the monitor runs");
+
+//=====[Declaration and initialization of private global variables]============
+
+static FlashIAP flashIap;
+static uint8_t copyBuffer[BOOTLOADER_COPY_SIZE];
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static bool bootloaderInstall(const firmwareImageHeader_t* header);
+static bool bootloaderApplicationValid();
+static void bootloaderWatchdogRefresh();
+
+//=====[Main function, the program entry point after power on or reset]=======
+
+int main() {
+    const firmwareImageHeader_t* header =
+        (const firmwareImageHeader_t*)FIRMWARE_IMAGE_STAGING_ADDRESS;
+
+    // A reset or power loss while copying leaves installed as erased, so the
+    // copy simply starts over on the next boot
+    if (firmwareImageHeaderValid(header) &&
+        header->installed == FIRMWARE_IMAGE_NOT_INSTALLED &&
+        firmwareImageStagedValid(header) && flashIap.init() == 0) {
+        if (bootloaderInstall(header)) {
+            uint32_t installed = 0;
+            flashIap.program(&installed, (uint32_t)&header->installed, sizeof(installed));
+        }
+        flashIap.deinit();
+    }
+
+    if (bootloaderApplicationValid()) {
+        mbed_start_application(FIRMWARE_IMAGE_APP_ADDRESS);
+    }
+
+    // Nothing to start: a half-copied image that no longer checks out, or a
+    // board with only the bootloader. Blink until an image is flashed.
+    DigitalOut led(LED1);
+    while (true) {
+        led = !led;
+        bootloaderWatchdogRefresh();
+        ThisThread::sleep_for(BOOTLOADER_BLINK_PERIOD);
+    }
+}
+
+//=====[Implementations of private functions]==================================
+
+// Erases only the sectors the image needs, copies it through RAM and checks
+// the copy against the image CRC
+static bool bootloaderInstall(const firmwareImageHeader_t* header) {
+    uint32_t address = FIRMWARE_IMAGE_APP_ADDRESS;
+    uint32_t end = FIRMWARE_IMAGE_APP_ADDRESS + header->imageSize;
+    while (address < end) {
+        uint32_t sectorSize = flashIap.get_sector_size(address);
+        bootloaderWatchdogRefresh();
+        if (sectorSize == MBED_FLASH_INVALID_SIZE ||
+            flashIap.erase(address, sectorSize) != 0) {
+            return false;
+        }
+        address += sectorSize;
+    }
+
+    const uint8_t* image = firmwareImageStaged(header);
+    uint32_t pageSize = flashIap.get_page_size();
+    for (uint32_t offset = 0; offset < header->imageSize; offset += BOOTLOADER_COPY_SIZE) {
+        uint32_t length = header->imageSize - offset;
+        if (length > BOOTLOADER_COPY_SIZE) {
+            length = BOOTLOADER_COPY_SIZE;
+        }
+        memcpy(copyBuffer, &image[offset], length);
+        uint32_t padded = (length + pageSize - 1) / pageSize * pageSize;
+        memset(&copyBuffer[length], flashIap.get_erase_value(), padded - length);
+        bootloaderWatchdogRefresh();
+        if (flashIap.program(copyBuffer, FIRMWARE_IMAGE_APP_ADDRESS + offset, padded) != 0) {
+            return false;
+        }
+    }
+
+    return firmwareImageCrc32(0, (const uint8_t*)FIRMWARE_IMAGE_APP_ADDRESS,
+                              header->imageSize) == header->imageCrc32;
+}
+
+// An erased or half-written bank 1 has no stack pointer into SRAM and no
+// reset handler inside the monitor's area
+static bool bootloaderApplicationValid() {
+    const uint32_t* vectors = (const uint32_t*)FIRMWARE_IMAGE_APP_ADDRESS;
+    uint32_t stackPointer = vectors[0];
+    uint32_t resetHandler = vectors[1];
+    return stackPointer > BOOTLOADER_SRAM_START && stackPointer <= BOOTLOADER_SRAM_END &&
+           resetHandler > FIRMWARE_IMAGE_APP_ADDRESS &&
+           resetHandler < FIRMWARE_IMAGE_APP_ADDRESS + FIRMWARE_IMAGE_APP_SIZE;
+}
+
+// The monitor's watchdog stops at the reset into the bootloader, unless the
+// option bytes start it in hardware; refreshing an idle one does nothing
+static void bootloaderWatchdogRefresh() {
+    IWDG->KR = 0xAAAA;
+}
+
+#endif // BOOTLOADER_BUILD
@@ -0,0 +1,457 @@
+//=====[Libraries]=============================================================
+
+#include "collector_frames.h"
+
+#include <ctype.h>
+#include <string.h>
+
+#include "frame_codec.h"
+#include "sampler.h"
+
+//=====[Declaration of private defines]========================================
+
+#define COLLECTOR_SCAN_PERIOD_US    (1000000 / SAMPLER_SCAN_RATE_HZ)
+
+//=====[Declaration of private data types]=====================================
+
+typedef enum {
+    COLLECTOR_FRAME_VALID,
+    COLLECTOR_FRAME_MALFORMED,
+    COLLECTOR_FRAME_CRC_ERROR,
+} collectorFrameCheck_t;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static collectorFrameCheck_t collectorFrameVerify(const uint8_t* frame, size_t length,
+                                                  telemetryFrameHeader_t* header);
+static void collectorSamplesDecode(collectorStore_t* store, collectorSource_t* source,
+                                   uint16_t sourceId, const telemetryFrameHeader_t* header,
+                                   const uint8_t* payload, int64_t receiveUs);
+static void collectorStatusDecode(collectorStore_t* store, collectorSource_t* source,
+                                  uint16_t sourceId, const telemetryFrameHeader_t* header,
+                                  const uint8_t* payload, int64_t receiveUs);
+static void collectorEventDecode(collectorStore_t* store, collectorSource_t* source,
+                                 uint16_t sourceId, const telemetryFrameHeader_t* header,
+                                 const uint8_t* payload, int64_t receiveUs);
+static void collectorTimeDecode(collectorSource_t* source, const uint8_t* payload);
+static void collectorSequenceTrack(collectorSource_t* source, bool* started, uint32_t* next,
+                                   uint32_t sequence, uint32_t length,
+                                   std::atomic<uint64_t>* dropped);
+static int64_t collectorWallUs(const collectorSource_t* source, uint32_t timestampUs);
+static void collectorColumnName(char* name, size_t size, const char* channelName);
+static int collectorLatencyBucket(int64_t us);
+static int64_t collectorLatencyBucketUpperUs(int bucket);
+
+//=====[Implementations of public functions]===================================
+
+bool collectorStoreOpen(collectorStore_t* store, const char* directory, uint64_t capacity) {
+    char name[COLLECTOR_STORE_NAME_LENGTH];
+
+    collectorTableInit(&store->samples, "samples", capacity);
+    collectorTableColumnAdd(&store->samples, "source", COLLECTOR_COLUMN_U16);
+    collectorTableColumnAdd(&store->samples, "block", COLLECTOR_COLUMN_U32);
+    collectorTableColumnAdd(&store->samples, "wall_us", COLLECTOR_COLUMN_I64);
+    collectorTableColumnAdd(&store->samples, "receive_us", COLLECTOR_COLUMN_I64);
+    for (int i = 0; i < SENSOR_SCAN_CHANNEL_COUNT; ++i) {
+        collectorColumnName(name, sizeof(name), sensorChannels[i].name);
+        collectorTableColumnAdd(&store->samples, name, COLLECTOR_COLUMN_U16);
+    }
+
+    // A STATUS frame comes every snapshot period, so far fewer rows do
+    collectorTableInit(&store->status, "status", capacity / SAMPLER_SCANS_PER_HALF);
+    collectorTableColumnAdd(&store->status, "source", COLLECTOR_COLUMN_U16);
+    collectorTableColumnAdd(&store->status, "block", COLLECTOR_COLUMN_U32);
+    collectorTableColumnAdd(&store->status, "wall_us", COLLECTOR_COLUMN_I64);
+    collectorTableColumnAdd(&store->status, "receive_us", COLLECTOR_COLUMN_I64);
+    collectorTableColumnAdd(&store->status, "alarms", COLLECTOR_COLUMN_U8);
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; ++i) {
+        collectorColumnName(name, sizeof(name), sensorChannels[i].name);
+        collectorTableColumnAdd(&store->status, name, COLLECTOR_COLUMN_U16);
+    }
+
+    collectorTableInit(&store->events, "events", capacity / SAMPLER_SCANS_PER_HALF);
+    collectorTableColumnAdd(&store->events, "source", COLLECTOR_COLUMN_U16);
+    collectorTableColumnAdd(&store->events, "sequence", COLLECTOR_COLUMN_U32);
+    collectorTableColumnAdd(&store->events, "wall_us", COLLECTOR_COLUMN_I64);
+    collectorTableColumnAdd(&store->events, "receive_us", COLLECTOR_COLUMN_I64);
+    collectorTableColumnAdd(&store->events, "frame", COLLECTOR_COLUMN_U8);
+    collectorTableColumnAdd(&store->events, "code", COLLECTOR_COLUMN_U8);
+    collectorTableColumnAdd(&store->events, "channel", COLLECTOR_COLUMN_U8);
+    collectorTableColumnAdd(&store->events, "reason", COLLECTOR_COLUMN_U8);
+
+    return collectorTableOpen(&store->samples, directory) &&
+           collectorTableOpen(&store->status, directory) &&
+           collectorTableOpen(&store->events, directory);
+}
+
+void collectorStoreClose(collectorStore_t* store, FILE* manifest) {
+    collectorTableClose(&store->samples);
+    collectorTableClose(&store->status);
+    collectorTableClose(&store->events);
+    if (manifest != nullptr) {
+        collectorTableManifestWrite(&store->samples, manifest);
+        collectorTableManifestWrite(&store->status, manifest);
+        collectorTableManifestWrite(&store->events, manifest);
+    }
+}
+
+void collectorSourceInit(collectorSource_t* source, const char* name) {
+    snprintf(source->name, sizeof(source->name), "%s", name);
+    source->counters.frames = 0;
+    source->counters.bytes = 0;
+    source->counters.scans = 0;
+    source->counters.droppedBlocks = 0;
+    source->counters.droppedEvents = 0;
+    source->counters.reordered = 0;
+    source->counters.restarts = 0;
+    source->counters.crcErrors = 0;
+    source->counters.malformed = 0;
+    source->counters.mismatched = 0;
+    source->counters.hostDropped = 0;
+    source->counters.timeExchanges = 0;
+    for (int i = 0; i < COLLECTOR_LATENCY_BUCKETS; ++i) {
+        source->latency.counts[i] = 0;
+    }
+    source->latency.early = 0;
+    source->latency.maxUs = 0;
+    source->samplesStarted = false;
+    source->nextBlock = 0;
+    source->eventsStarted = false;
+    source->nextEvent = 0;
+    source->mappingValid = false;
+}
+
+// A raw frame with a valid CRC and this protocol version, its header copied
+// out; for the I/O thread, which answers clock exchanges itself
+bool collectorFrameCheck(const uint8_t* frame, size_t length,
+                         telemetryFrameHeader_t* header) {
+    return collectorFrameVerify(frame, length, header) == COLLECTOR_FRAME_VALID;
+}
+
+// Counts a raw frame against its source and stores what it carries.
+// receiveUs is the collector's wall clock when it came in.
+void collectorFrameDecode(collectorStore_t* store, collectorSource_t* source,
+                          uint16_t sourceId, const uint8_t* frame, size_t length,
+                          int64_t receiveUs) {
+    telemetryFrameHeader_t header;
+    switch (collectorFrameVerify(frame, length, &header)) {
+    case COLLECTOR_FRAME_VALID:
+        break;
+    case COLLECTOR_FRAME_MALFORMED:
+        source->counters.malformed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    case COLLECTOR_FRAME_CRC_ERROR:
+        source->counters.crcErrors.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    source->counters.frames.fetch_add(1, std::memory_order_relaxed);
+
+    const uint8_t* payload = &frame[sizeof(header)];
+    size_t payloadLength = length - sizeof(header) - COLLECTOR_FRAME_CRC_SIZE;
+    bool layout = header.channelCount ==
+                  telemetryFrameChannelCount((telemetryFrameType_t)header.type);
+
+    switch (header.type) {
+    case TELEMETRY_FRAME_SAMPLES:
+        if (!layout) {
+            source->counters.mismatched.fetch_add(1, std::memory_order_relaxed);
+        } else if (header.count == 0 ||
+                   payloadLength != header.count * SENSOR_SCAN_CHANNEL_COUNT * sizeof(uint16_t)) {
+            source->counters.malformed.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            collectorSamplesDecode(store, source, sourceId, &header, payload, receiveUs);
+        }
+        break;
+    case TELEMETRY_FRAME_STATUS:
+        if (!layout) {
+            source->counters.mismatched.fetch_add(1, std::memory_order_relaxed);
+        } else if (payloadLength != sizeof(telemetryFrameStatus_t) +
+                                    SENSOR_CHANNEL_COUNT * sizeof(uint16_t)) {
+            source->counters.malformed.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            collectorStatusDecode(store, source, sourceId, &header, payload, receiveUs);
+        }
+        break;
+    case TELEMETRY_FRAME_ALARM_EVENT:
+    case TELEMETRY_FRAME_RATE:
+        // Both payloads are four bytes, checked by the static asserts
+        if (payloadLength != sizeof(telemetryFrameAlarmEvent_t)) {
+            source->counters.malformed.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            collectorEventDecode(store, source, sourceId, &header, payload, receiveUs);
+        }
+        break;
+    case TELEMETRY_FRAME_TIME:
+        if (payloadLength != sizeof(telemetryFrameTime_t)) {
+            source->counters.malformed.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            collectorTimeDecode(source, payload);
+        }
+        break;
+    default:
+        // Health, captures, log pages and update steps are counted only
+        break;
+    }
+}
+
+// Header, payload and CRC, as the firmware sends them over UDP; returns the
+// frame length. frame must hold COLLECTOR_FRAME_SIZE_MAX bytes.
+size_t collectorFrameWrite(uint8_t* frame, telemetryFrameType_t type, uint8_t count,
+                           uint32_t sequence, uint32_t timestampUs,
+                           const void* payload, size_t payloadLength) {
+    telemetryFrameHeader_t header = { (uint8_t)type, TELEMETRY_FRAME_VERSION,
+                                      telemetryFrameChannelCount(type), count,
+                                      sequence, timestampUs };
+    memcpy(frame, &header, sizeof(header));
+    memcpy(&frame[sizeof(header)], payload, payloadLength);
+    size_t length = sizeof(header) + payloadLength;
+    uint16_t crc = frameCodecCrc16(FRAME_CODEC_CRC16_INIT, frame, length);
+    frame[length++] = (uint8_t)crc;
+    frame[length++] = (uint8_t)(crc >> 8);
+    return length;
+}
+
+void collectorLatencyAdd(collectorLatency_t* latency, int64_t us) {
+    if (us < 0) {
+        latency->early.fetch_add(1, std::memory_order_relaxed);
+        us = 0;
+    }
+    latency->counts[collectorLatencyBucket(us)].fetch_add(1, std::memory_order_relaxed);
+    if (us > latency->maxUs.load(std::memory_order_relaxed)) {
+        latency->maxUs.store(us, std::memory_order_relaxed);  // Only the owner writes
+    }
+}
+
+void collectorLatencySummaryClear(collectorLatencySummary_t* summary) {
+    memset(summary, 0, sizeof(*summary));
+}
+
+void collectorLatencySummaryAdd(collectorLatencySummary_t* summary,
+                                const collectorLatency_t* latency) {
+    for (int i = 0; i < COLLECTOR_LATENCY_BUCKETS; ++i) {
+        uint64_t count = latency->counts[i].load(std::memory_order_relaxed);
+        summary->counts[i] += count;
+        summary->total += count;
+    }
+    summary->early += latency->early.load(std::memory_order_relaxed);
+    int64_t maxUs = latency->maxUs.load(std::memory_order_relaxed);
+    if (maxUs > summary->maxUs) {
+        summary->maxUs = maxUs;
+    }
+}
+
+// Upper bound of the bucket holding the given share of latencies, in tenths
+// of a percent; 0 without any
+int64_t collectorLatencyPercentileUs(const collectorLatencySummary_t* summary,
+                                     uint32_t perMille) {
+    if (summary->total == 0) {
+        return 0;
+    }
+    uint64_t rank = (summary->total * perMille + 999) / 1000;
+    uint64_t seen = 0;
+    for (int i = 0; i < COLLECTOR_LATENCY_BUCKETS; ++i) {
+        seen += summary->counts[i];
+        if (seen >= rank && seen > 0) {
+            int64_t upperUs = collectorLatencyBucketUpperUs(i);
+            return upperUs < summary->maxUs ? upperUs : summary->maxUs;
+        }
+    }
+    return summary->maxUs;
+}
+
+//=====[Implementations of private functions]==================================
+
+static collectorFrameCheck_t collectorFrameVerify(const uint8_t* frame, size_t length,
+                                                  telemetryFrameHeader_t* header) {
+    if (length < sizeof(*header) + COLLECTOR_FRAME_CRC_SIZE) {
+        return COLLECTOR_FRAME_MALFORMED;
+    }
+    size_t covered = length - COLLECTOR_FRAME_CRC_SIZE;
+    uint16_t crc = (uint16_t)(frame[covered] | (frame[covered + 1] << 8));
+    if (frameCodecCrc16(FRAME_CODEC_CRC16_INIT, frame, covered) != crc) {
+        return COLLECTOR_FRAME_CRC_ERROR;
+    }
+    memcpy(header, frame, sizeof(*header));
+    return header->version == TELEMETRY_FRAME_VERSION ? COLLECTOR_FRAME_VALID
+                                                      : COLLECTOR_FRAME_MALFORMED;
+}
+
+// One row per scan. The header stamps the newest scan, the others were
+// taken a scan period apart before it; across a burst gap in the low power
+// and adaptive modes they were not, and their wall times come out early.
+static void collectorSamplesDecode(collectorStore_t* store, collectorSource_t* source,
+                                   uint16_t sourceId, const telemetryFrameHeader_t* header,
+                                   const uint8_t* payload, int64_t receiveUs) {
+    uint32_t blocks = (header->count + SAMPLER_SCANS_PER_HALF - 1) / SAMPLER_SCANS_PER_HALF;
+    collectorSequenceTrack(source, &source->samplesStarted, &source->nextBlock,
+                           header->sequence, blocks, &source->counters.droppedBlocks);
+    source->counters.scans.fetch_add(header->count, std::memory_order_relaxed);
+
+    int64_t newestUs = collectorWallUs(source, header->timestampUs);
+    if (source->mappingValid) {
+        collectorLatencyAdd(&source->latency, receiveUs - newestUs);
+    }
+
+    collectorTable_t* table = &store->samples;
+    uint64_t row = collectorTableReserve(table, header->count);
+    if (row == COLLECTOR_STORE_ROW_NONE) {
+        return;
+    }
+    for (uint32_t i = 0; i < header->count; ++i, ++row) {
+        collectorTableU16Set(table, COLLECTOR_SAMPLES_SOURCE, row, sourceId);
+        collectorTableU32Set(table, COLLECTOR_SAMPLES_BLOCK, row,
+                             header->sequence + i / SAMPLER_SCANS_PER_HALF);
+        collectorTableI64Set(table, COLLECTOR_SAMPLES_WALL_US, row,
+                             source->mappingValid
+                             ? newestUs - (int64_t)(header->count - 1 - i) *
+                                          COLLECTOR_SCAN_PERIOD_US
+                             : 0);
+        collectorTableI64Set(table, COLLECTOR_SAMPLES_RECEIVE_US, row, receiveUs);
+        for (int channel = 0; channel < SENSOR_SCAN_CHANNEL_COUNT; ++channel) {
+            uint16_t reading;
+            memcpy(&reading, &payload[(i * SENSOR_SCAN_CHANNEL_COUNT + channel) *
+                                      sizeof(reading)], sizeof(reading));
+            collectorTableU16Set(table, COLLECTOR_SAMPLES_READING + channel, row, reading);
+        }
+    }
+}
+
+static void collectorStatusDecode(collectorStore_t* store, collectorSource_t* source,
+                                  uint16_t sourceId, const telemetryFrameHeader_t* header,
+                                  const uint8_t* payload, int64_t receiveUs) {
+    collectorTable_t* table = &store->status;
+    uint64_t row = collectorTableReserve(table, 1);
+    if (row == COLLECTOR_STORE_ROW_NONE) {
+        return;
+    }
+    telemetryFrameStatus_t status;
+    memcpy(&status, payload, sizeof(status));
+    collectorTableU16Set(table, COLLECTOR_STATUS_SOURCE, row, sourceId);
+    collectorTableU32Set(table, COLLECTOR_STATUS_BLOCK, row, header->sequence);
+    collectorTableI64Set(table, COLLECTOR_STATUS_WALL_US, row,
+                         collectorWallUs(source, header->timestampUs));
+    collectorTableI64Set(table, COLLECTOR_STATUS_RECEIVE_US, row, receiveUs);
+    collectorTableU8Set(table, COLLECTOR_STATUS_ALARMS, row, status.alarms);
+    for (int channel = 0; channel < SENSOR_CHANNEL_COUNT; ++channel) {
+        uint16_t average;
+        memcpy(&average, &payload[sizeof(status) + channel * sizeof(average)],
+               sizeof(average));
+        collectorTableU16Set(table, COLLECTOR_STATUS_AVERAGE + channel, row, average);
+    }
+}
+
+// Alarm and rate events share the board's event counter
+static void collectorEventDecode(collectorStore_t* store, collectorSource_t* source,
+                                 uint16_t sourceId, const telemetryFrameHeader_t* header,
+                                 const uint8_t* payload, int64_t receiveUs) {
+    collectorSequenceTrack(source, &source->eventsStarted, &source->nextEvent,
+                           header->sequence, 1, &source->counters.droppedEvents);
+
+    uint8_t code;
+    uint8_t channel;
+    uint8_t reason = 0;
+    if (header->type == TELEMETRY_FRAME_RATE) {
+        telemetryFrameRate_t rate;
+        memcpy(&rate, payload, sizeof(rate));
+        code = rate.mode;
+        channel = rate.channel;
+        reason = rate.reason;
+    } else {
+        telemetryFrameAlarmEvent_t event;
+        memcpy(&event, payload, sizeof(event));
+        code = event.eventType;
+        channel = event.channel;
+    }
+
+    collectorTable_t* table = &store->events;
+    uint64_t row = collectorTableReserve(table, 1);
+    if (row == COLLECTOR_STORE_ROW_NONE) {
+        return;
+    }
+    collectorTableU16Set(table, COLLECTOR_EVENTS_SOURCE, row, sourceId);
+    collectorTableU32Set(table, COLLECTOR_EVENTS_SEQUENCE, row, header->sequence);
+    collectorTableI64Set(table, COLLECTOR_EVENTS_WALL_US, row,
+                         collectorWallUs(source, header->timestampUs));
+    collectorTableI64Set(table, COLLECTOR_EVENTS_RECEIVE_US, row, receiveUs);
+    collectorTableU8Set(table, COLLECTOR_EVENTS_FRAME, row, header->type);
+    collectorTableU8Set(table, COLLECTOR_EVENTS_CODE, row, code);
+    collectorTableU8Set(table, COLLECTOR_EVENTS_CHANNEL, row, channel);
+    collectorTableU8Set(table, COLLECTOR_EVENTS_REASON, row, reason);
+}
+
+// A board whose wall clock is not set sends source 0; its frames get no wall
+// times and no latency until it is
+static void collectorTimeDecode(collectorSource_t* source, const uint8_t* payload) {
+    telemetryFrameTime_t time;
+    memcpy(&time, payload, sizeof(time));
+    source->mappingValid = time.source != 0;
+    source->mapping.localUs = time.localUs;
+    source->mapping.wallUs = time.wallUs;
+    source->mapping.driftPpb = time.driftPpb;
+}
+
+// A frame ahead of the expected sequence counts the ones skipped as lost; a
+// frame behind it came late, unless it is far behind or starts over at 0
+static void collectorSequenceTrack(collectorSource_t* source, bool* started, uint32_t* next,
+                                   uint32_t sequence, uint32_t length,
+                                   std::atomic<uint64_t>* dropped) {
+    int32_t ahead = (int32_t)(sequence - *next);
+    if (*started) {
+        if (ahead > 0) {
+            dropped->fetch_add((uint32_t)ahead, std::memory_order_relaxed);
+        } else if (ahead < 0 && (ahead <= -COLLECTOR_SEQUENCE_RESTART || sequence == 0)) {
+            source->counters.restarts.fetch_add(1, std::memory_order_relaxed);
+        } else if (ahead < 0) {
+            source->counters.reordered.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+    *started = true;
+    *next = sequence + length;
+}
+
+// Header timestamps are the low 32 bits of the board clock; they wrap every
+// 71 minutes, so they are taken as the nearest 64-bit time to the mapping's
+static int64_t collectorWallUs(const collectorSource_t* source, uint32_t timestampUs) {
+    if (!source->mappingValid) {
+        return 0;
+    }
+    int32_t sinceUs = (int32_t)(timestampUs - (uint32_t)source->mapping.localUs);
+    return timeSyncMappingWallUs(&source->mapping, source->mapping.localUs + sinceUs);
+}
+
+// Channel names as column names: lower case, letters and digits only
+static void collectorColumnName(char* name, size_t size, const char* channelName) {
+    size_t length = 0;
+    for (; *channelName != '\0' && length + 1 < size; ++channelName) {
+        if (isalnum((unsigned char)*channelName)) {
+            name[length++] = (char)tolower((unsigned char)*channelName);
+        }
+    }
+    name[length] = '\0';
+}
+
+static int collectorLatencyBucket(int64_t us) {
+    if (us < COLLECTOR_LATENCY_EXACT_US) {
+        return (int)us;
+    }
+    int exponent = 63 - __builtin_clzll((uint64_t)us);
+    if (exponent >= 40) {
+        return COLLECTOR_LATENCY_BUCKETS - 1;
+    }
+    int sub = (int)(us >> (exponent - COLLECTOR_LATENCY_SUB_BITS)) &
+              ((1 << COLLECTOR_LATENCY_SUB_BITS) - 1);
+    return COLLECTOR_LATENCY_EXACT_US +
+           ((exponent - COLLECTOR_LATENCY_EXACT_BITS) << COLLECTOR_LATENCY_SUB_BITS) + sub;
+}
+
+static int64_t collectorLatencyBucketUpperUs(int bucket) {
+    if (bucket < COLLECTOR_LATENCY_EXACT_US) {
+        return bucket;
+    }
+    int index = bucket - COLLECTOR_LATENCY_EXACT_US;
+    int exponent = (index >> COLLECTOR_LATENCY_SUB_BITS) + COLLECTOR_LATENCY_EXACT_BITS;
+    int sub = index & ((1 << COLLECTOR_LATENCY_SUB_BITS) - 1);
+    return ((int64_t)((1 << COLLECTOR_LATENCY_SUB_BITS) + sub + 1)
+            << (exponent - COLLECTOR_LATENCY_SUB_BITS)) - 1;
+}
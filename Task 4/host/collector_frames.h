@@ -0,0 +1,148 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _COLLECTOR_FRAMES_H_
+#define _COLLECTOR_FRAMES_H_
+
+//=====[Libraries]=============================================================
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include "collector_store.h"
+#include "telemetry_frames.h"
+#include "time_sync.h"
+
+//=====[Declaration of public defines]=========================================
+
+// Largest raw frame taken, well above a batched SAMPLES datagram of 782
+// bytes and a LOG_PAGE frame
+#define COLLECTOR_FRAME_SIZE_MAX        2048
+#define COLLECTOR_FRAME_CRC_SIZE        2
+
+#define COLLECTOR_SOURCE_NAME_LENGTH    64
+
+// A sequence this far behind the expected one means the board restarted,
+// not that the frame came late
+#define COLLECTOR_SEQUENCE_RESTART      4096
+
+// Latency buckets: exact microseconds below 64, then 16 per power of two up
+// to 2^40 us, so percentiles are within 1/16 of the value
+#define COLLECTOR_LATENCY_EXACT_US      64
+#define COLLECTOR_LATENCY_EXACT_BITS    6
+#define COLLECTOR_LATENCY_SUB_BITS      4
+#define COLLECTOR_LATENCY_BUCKETS       (COLLECTOR_LATENCY_EXACT_US + \
+                                         (40 - COLLECTOR_LATENCY_EXACT_BITS) * \
+                                         (1 << COLLECTOR_LATENCY_SUB_BITS))
+
+//=====[Declaration of public data types]======================================
+
+// From the ADC sample of the newest scan in a SAMPLES frame, on the board's
+// wall clock, to its arrival at the collector. Written by the decoder that
+// owns the source, read by the reports.
+typedef struct {
+    std::atomic<uint64_t> counts[COLLECTOR_LATENCY_BUCKETS];
+    std::atomic<uint64_t> early;    // Arrived before it was sampled: clocks apart
+    std::atomic<int64_t> maxUs;
+} collectorLatency_t;
+
+// Latencies of one or more sources added up, for percentiles
+typedef struct {
+    uint64_t counts[COLLECTOR_LATENCY_BUCKETS];
+    uint64_t total;
+    uint64_t early;
+    int64_t maxUs;
+} collectorLatencySummary_t;
+
+typedef struct {
+    std::atomic<uint64_t> frames;         // Valid frames of any type
+    std::atomic<uint64_t> bytes;          // Received, valid or not
+    std::atomic<uint64_t> scans;
+    std::atomic<uint64_t> droppedBlocks;  // Gaps in the SAMPLES block sequence
+    std::atomic<uint64_t> droppedEvents;  // Gaps in the ALARM_EVENT and RATE one
+    std::atomic<uint64_t> reordered;      // Arrived behind a later frame
+    std::atomic<uint64_t> restarts;       // Sequences started over
+    std::atomic<uint64_t> crcErrors;
+    std::atomic<uint64_t> malformed;      // Bad COBS, length or version
+    std::atomic<uint64_t> mismatched;     // Channel layout of another build
+    std::atomic<uint64_t> hostDropped;    // No room in a decoder queue
+    std::atomic<uint64_t> timeExchanges;  // TIME_REQUEST datagrams answered
+} collectorCounters_t;
+
+// One board: a UDP sender address or a serial port
+typedef struct {
+    char name[COLLECTOR_SOURCE_NAME_LENGTH];
+    collectorCounters_t counters;
+    collectorLatency_t latency;
+
+    // Only touched by the decoder thread that owns the source
+    bool samplesStarted;
+    uint32_t nextBlock;
+    bool eventsStarted;
+    uint32_t nextEvent;
+    bool mappingValid;
+    timeSyncMapping_t mapping;      // From the latest TIME frame
+} collectorSource_t;
+
+// Column indexes, in the order collectorStoreOpen() adds them. Readings
+// and averages take one column per channel from the first.
+typedef enum {
+    COLLECTOR_SAMPLES_SOURCE,
+    COLLECTOR_SAMPLES_BLOCK,        // Sampler half-buffer the scan came in
+    COLLECTOR_SAMPLES_WALL_US,      // Board wall clock at the scan, 0 if unset
+    COLLECTOR_SAMPLES_RECEIVE_US,   // Collector wall clock at arrival
+    COLLECTOR_SAMPLES_READING,
+} collectorSamplesColumn_t;
+
+typedef enum {
+    COLLECTOR_STATUS_SOURCE,
+    COLLECTOR_STATUS_BLOCK,
+    COLLECTOR_STATUS_WALL_US,
+    COLLECTOR_STATUS_RECEIVE_US,
+    COLLECTOR_STATUS_ALARMS,
+    COLLECTOR_STATUS_AVERAGE,
+} collectorStatusColumn_t;
+
+typedef enum {
+    COLLECTOR_EVENTS_SOURCE,
+    COLLECTOR_EVENTS_SEQUENCE,
+    COLLECTOR_EVENTS_WALL_US,
+    COLLECTOR_EVENTS_RECEIVE_US,
+    COLLECTOR_EVENTS_FRAME,         // ALARM_EVENT or RATE
+    COLLECTOR_EVENTS_CODE,          // alarmEventType_t, or samplerMode_t for RATE
+    COLLECTOR_EVENTS_CHANNEL,
+    COLLECTOR_EVENTS_REASON,        // alarmRateReason_t for RATE, 0 otherwise
+} collectorEventsColumn_t;
+
+typedef struct {
+    collectorTable_t samples;       // One row per scan
+    collectorTable_t status;        // One row per STATUS frame
+    collectorTable_t events;        // One row per ALARM_EVENT or RATE frame
+} collectorStore_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+bool collectorStoreOpen(collectorStore_t* store, const char* directory, uint64_t capacity);
+void collectorStoreClose(collectorStore_t* store, FILE* manifest);
+
+void collectorSourceInit(collectorSource_t* source, const char* name);
+bool collectorFrameCheck(const uint8_t* frame, size_t length,
+                         telemetryFrameHeader_t* header);
+void collectorFrameDecode(collectorStore_t* store, collectorSource_t* source,
+                          uint16_t sourceId, const uint8_t* frame, size_t length,
+                          int64_t receiveUs);
+size_t collectorFrameWrite(uint8_t* frame, telemetryFrameType_t type, uint8_t count,
+                           uint32_t sequence, uint32_t timestampUs,
+                           const void* payload, size_t payloadLength);
+
+void collectorLatencyAdd(collectorLatency_t* latency, int64_t us);
+void collectorLatencySummaryClear(collectorLatencySummary_t* summary);
+void collectorLatencySummaryAdd(collectorLatencySummary_t* summary,
+                                const collectorLatency_t* latency);
+int64_t collectorLatencyPercentileUs(const collectorLatencySummary_t* summary,
+                                     uint32_t perMille);
+
+//=====[#include guards - end]=================================================
+
+#endif // _COLLECTOR_FRAMES_H_
@@ -0,0 +1,138 @@
+//=====[Libraries]=============================================================
+
+#include "collector_store.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+//=====[Implementations of public functions]===================================
+
+void collectorTableInit(collectorTable_t* table, const char* name, uint64_t capacity) {
+    snprintf(table->name, sizeof(table->name), "%s", name);
+    table->columnCount = 0;
+    table->capacity = capacity;
+    table->reserved = 0;
+    table->full = UINT64_MAX;
+    table->rejected = 0;
+}
+
+// Returns the column index for the row setters, or -1 once the table is full
+int collectorTableColumnAdd(collectorTable_t* table, const char* name,
+                            collectorColumnType_t type) {
+    if (table->columnCount == COLLECTOR_STORE_COLUMNS_MAX) {
+        return -1;
+    }
+    collectorColumn_t* column = &table->columns[table->columnCount];
+    snprintf(column->name, sizeof(column->name), "%s", name);
+    column->type = type;
+    column->fd = -1;
+    column->base = nullptr;
+    return table->columnCount++;
+}
+
+// Creates the column files; existing ones are overwritten
+bool collectorTableOpen(collectorTable_t* table, const char* directory) {
+    for (int i = 0; i < table->columnCount; ++i) {
+        collectorColumn_t* column = &table->columns[i];
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/%s.%s.%s", directory, table->name, column->name,
+                 collectorColumnTypeName(column->type));
+        size_t size = table->capacity * collectorColumnWidth(column->type);
+
+        column->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (column->fd < 0 || ftruncate(column->fd, (off_t)size) != 0) {
+            fprintf(stderr, "cannot create %s: %s\n", path, strerror(errno));
+            return false;
+        }
+        void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, column->fd, 0);
+        if (base == MAP_FAILED) {
+            fprintf(stderr, "cannot map %s: %s\n", path, strerror(errno));
+            return false;
+        }
+        column->base = (uint8_t*)base;
+    }
+    return true;
+}
+
+// First of rows consecutive rows for the caller alone, or ROW_NONE when
+// they do not fit. Reservations past the first failure all fail too, so
+// every row below it has a writer.
+uint64_t collectorTableReserve(collectorTable_t* table, uint32_t rows) {
+    uint64_t first = table->reserved.fetch_add(rows, std::memory_order_relaxed);
+    if (first + rows <= table->capacity) {
+        return first;
+    }
+    uint64_t full = table->full.load(std::memory_order_relaxed);
+    while (first < full &&
+           !table->full.compare_exchange_weak(full, first, std::memory_order_relaxed)) {
+    }
+    table->rejected.fetch_add(rows, std::memory_order_relaxed);
+    return COLLECTOR_STORE_ROW_NONE;
+}
+
+uint64_t collectorTableRows(const collectorTable_t* table) {
+    uint64_t reserved = table->reserved.load(std::memory_order_relaxed);
+    uint64_t full = table->full.load(std::memory_order_relaxed);
+    return reserved < full ? reserved : full;
+}
+
+// Only once every writer has finished
+void collectorTableClose(collectorTable_t* table) {
+    uint64_t rows = collectorTableRows(table);
+    for (int i = 0; i < table->columnCount; ++i) {
+        collectorColumn_t* column = &table->columns[i];
+        size_t width = collectorColumnWidth(column->type);
+        if (column->base != nullptr) {
+            munmap(column->base, table->capacity * width);
+            column->base = nullptr;
+        }
+        if (column->fd >= 0) {
+            if (ftruncate(column->fd, (off_t)(rows * width)) != 0) {
+                fprintf(stderr, "cannot truncate %s.%s: %s\n", table->name, column->name,
+                        strerror(errno));
+            }
+            close(column->fd);
+            column->fd = -1;
+        }
+    }
+}
+
+void collectorTableManifestWrite(const collectorTable_t* table, FILE* manifest) {
+    fprintf(manifest, "table %s rows %llu rejected %llu\n", table->name,
+            (unsigned long long)collectorTableRows(table),
+            (unsigned long long)table->rejected.load(std::memory_order_relaxed));
+    for (int i = 0; i < table->columnCount; ++i) {
+        fprintf(manifest, "column %s %s %s\n", table->name, table->columns[i].name,
+                collectorColumnTypeName(table->columns[i].type));
+    }
+}
+
+size_t collectorColumnWidth(collectorColumnType_t type) {
+    switch (type) {
+    case COLLECTOR_COLUMN_U8:
+        return 1;
+    case COLLECTOR_COLUMN_U16:
+        return 2;
+    case COLLECTOR_COLUMN_U32:
+        return 4;
+    case COLLECTOR_COLUMN_I64:
+        return 8;
+    }
+    return 0;
+}
+
+const char* collectorColumnTypeName(collectorColumnType_t type) {
+    switch (type) {
+    case COLLECTOR_COLUMN_U8:
+        return "u8";
+    case COLLECTOR_COLUMN_U16:
+        return "u16";
+    case COLLECTOR_COLUMN_U32:
+        return "u32";
+    case COLLECTOR_COLUMN_I64:
+        return "i64";
+    }
+    return "";
+}
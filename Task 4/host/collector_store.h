@@ -0,0 +1,92 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _COLLECTOR_STORE_H_
+#define _COLLECTOR_STORE_H_
+
+//=====[Libraries]=============================================================
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+
+//=====[Declaration of public defines]=========================================
+
+#define COLLECTOR_STORE_COLUMNS_MAX     48
+#define COLLECTOR_STORE_NAME_LENGTH     32
+#define COLLECTOR_STORE_ROW_NONE        UINT64_MAX  // Reservation that did not fit
+
+//=====[Declaration of public data types]======================================
+
+typedef enum {
+    COLLECTOR_COLUMN_U8,
+    COLLECTOR_COLUMN_U16,
+    COLLECTOR_COLUMN_U32,
+    COLLECTOR_COLUMN_I64,
+} collectorColumnType_t;
+
+typedef struct {
+    char name[COLLECTOR_STORE_NAME_LENGTH];
+    collectorColumnType_t type;
+    int fd;
+    uint8_t* base;              // Mapped over the whole capacity
+} collectorColumn_t;
+
+// One table of fixed-width columns, each a flat little-endian array in a
+// file of its own, <table>.<column>.<type>, so analysis tools can map a
+// column and read it without parsing. The files start sparse at the full
+// capacity; writers reserve rows with one atomic add and fill them in
+// place, and closing cuts the files to the rows written.
+typedef struct {
+    char name[COLLECTOR_STORE_NAME_LENGTH];
+    collectorColumn_t columns[COLLECTOR_STORE_COLUMNS_MAX];
+    int columnCount;
+    uint64_t capacity;
+    std::atomic<uint64_t> reserved;
+    std::atomic<uint64_t> full;     // First reservation that did not fit
+    std::atomic<uint64_t> rejected; // Rows lost to a full table
+} collectorTable_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void collectorTableInit(collectorTable_t* table, const char* name, uint64_t capacity);
+int collectorTableColumnAdd(collectorTable_t* table, const char* name,
+                            collectorColumnType_t type);
+bool collectorTableOpen(collectorTable_t* table, const char* directory);
+uint64_t collectorTableReserve(collectorTable_t* table, uint32_t rows);
+uint64_t collectorTableRows(const collectorTable_t* table);
+void collectorTableClose(collectorTable_t* table);
+void collectorTableManifestWrite(const collectorTable_t* table, FILE* manifest);
+
+size_t collectorColumnWidth(collectorColumnType_t type);
+const char* collectorColumnTypeName(collectorColumnType_t type);
+
+//=====[Implementations of public functions]===================================
+
+// Row values, for rows returned by collectorTableReserve(); the host is
+// little-endian like the files
+inline void collectorTableU8Set(collectorTable_t* table, int column, uint64_t row,
+                                uint8_t value) {
+    table->columns[column].base[row] = value;
+}
+
+inline void collectorTableU16Set(collectorTable_t* table, int column, uint64_t row,
+                                 uint16_t value) {
+    memcpy(&table->columns[column].base[row * sizeof(value)], &value, sizeof(value));
+}
+
+inline void collectorTableU32Set(collectorTable_t* table, int column, uint64_t row,
+                                 uint32_t value) {
+    memcpy(&table->columns[column].base[row * sizeof(value)], &value, sizeof(value));
+}
+
+inline void collectorTableI64Set(collectorTable_t* table, int column, uint64_t row,
+                                 int64_t value) {
+    memcpy(&table->columns[column].base[row * sizeof(value)], &value, sizeof(value));
+}
+
+//=====[#include guards - end]=================================================
+
+#endif // _COLLECTOR_STORE_H_
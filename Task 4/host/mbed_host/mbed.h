@@ -0,0 +1,100 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _MBED_HOST_H_
+#define _MBED_HOST_H_
+
+// Just enough of Mbed OS to run the serial port module on the host under a
+// test: the UART keeps its interrupt handlers for the test to call and
+// records what it sends, the RTOS parts do nothing on a single thread.
+
+//=====[Libraries]=============================================================
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+
+//=====[Declaration of public defines]=========================================
+
+#define USBTX   0
+#define USBRX   1
+
+//=====[Declaration of public data types]======================================
+
+class SerialBase {
+public:
+    enum IrqType {
+        RxIrq = 0,
+        TxIrq,
+        IrqCnt
+    };
+};
+
+// Handlers attached by the module and the bytes written, for the test
+typedef struct {
+    void (*handlers[SerialBase::IrqCnt])();
+    void (*byteWritten)(uint8_t byte);
+} mbedHostSerial_t;
+
+extern mbedHostSerial_t mbedHostSerial;
+
+class UnbufferedSerial : public SerialBase {
+public:
+    UnbufferedSerial(int, int, int) {}
+    void attach(void (*handler)(), IrqType type = RxIrq) {
+        mbedHostSerial.handlers[type] = handler;
+    }
+    ssize_t write(const void* buffer, size_t length) {
+        for (size_t i = 0; i < length; ++i) {
+            mbedHostSerial.byteWritten(((const uint8_t*)buffer)[i]);
+        }
+        return (ssize_t)length;
+    }
+    ssize_t read(void*, size_t) {
+        return 0;
+    }
+    bool readable() {
+        return false;
+    }
+};
+
+class Mutex {
+public:
+    void lock() {}
+    void unlock() {}
+};
+
+namespace Kernel {
+inline uint64_t get_ms_count() {
+    return 0;
+}
+}
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+inline void core_util_critical_section_enter() {}
+inline void core_util_critical_section_exit() {}
+
+inline uint32_t core_util_atomic_load_u32(const volatile uint32_t* value) {
+    return *value;
+}
+
+inline void core_util_atomic_store_u32(volatile uint32_t* value, uint32_t desired) {
+    *value = desired;
+}
+
+inline bool core_util_atomic_cas_u32(volatile uint32_t* value, uint32_t* expected,
+                                     uint32_t desired) {
+    if (*value != *expected) {
+        *expected = *value;
+        return false;
+    }
+    *value = desired;
+    return true;
+}
+
+inline void thread_sleep_for(uint32_t) {}
+
+//=====[#include guards - end]=================================================
+
+#endif // _MBED_HOST_H_
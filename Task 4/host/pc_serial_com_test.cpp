@@ -0,0 +1,158 @@
+// Runs the serial port module's TX ring on the host with telemetry-like COBS
+// frames, full of '\n' bytes, written faster than the UART sends them, so
+// that DROP_OLDEST keeps discarding while a frame is on the wire. Every
+// frame the receiver splits off at a delimiter must either decode to one
+// that was written, or be the start of one cut short; two frames run
+// together, or a frame with bytes missing inside, fail the test.
+
+//=====[Libraries]=============================================================
+
+#include <stdio.h>
+#include <string.h>
+
+#include <random>
+#include <vector>
+
+#include "mbed.h"
+#include "frame_codec.h"
+#include "pc_serial_com.h"
+
+//=====[Declaration of private defines]========================================
+
+#define TEST_FRAMES             5000
+#define TEST_PAYLOAD_MAX        200
+#define TEST_SEQUENCE_SIZE      4
+#define TEST_CRC_SIZE           2
+#define TEST_SENDS_PER_WRITE    60   // At most, bytes sent between two writes
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct {
+    std::vector<std::vector<uint8_t>> written;  // Encoded, without delimiter
+    std::vector<uint8_t> chunk;                  // Received since the last delimiter
+    long nextFrame;                              // Oldest written frame still due
+    uint32_t intact;
+    uint32_t truncated;
+    uint32_t broken;
+} testReceiver_t;
+
+//=====[Declaration and initialization of public global objects]===============
+
+mbedHostSerial_t mbedHostSerial;
+
+//=====[Declaration and initialization of private global variables]============
+
+static testReceiver_t receiver;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void testByteReceived(uint8_t byte);
+static void testChunkCheck();
+static void testTxInterrupts(int count);
+
+//=====[Implementations of public functions]===================================
+
+int main() {
+    mbedHostSerial.byteWritten = testByteReceived;
+    receiver.nextFrame = 0;
+    receiver.intact = 0;
+    receiver.truncated = 0;
+    receiver.broken = 0;
+    pcSerialComInit();
+    pcSerialComTxOverflowSet(PC_SERIAL_COM_TX_DROP_OLDEST);
+    pcSerialComTxCoalesceSet(false);
+
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int> payloadLength(0, TEST_PAYLOAD_MAX);
+    std::uniform_int_distribution<int> byteValue(0, 255);
+    std::uniform_int_distribution<int> sends(0, TEST_SENDS_PER_WRITE);
+
+    for (uint32_t sequence = 0; sequence < TEST_FRAMES; ++sequence) {
+        uint8_t frame[TEST_SEQUENCE_SIZE + TEST_PAYLOAD_MAX + TEST_CRC_SIZE];
+        size_t length = 0;
+        for (int i = 0; i < TEST_SEQUENCE_SIZE; ++i) {
+            frame[length++] = (uint8_t)(sequence >> (8 * i));
+        }
+        int payload = payloadLength(random);
+        for (int i = 0; i < payload; ++i) {
+            // Plenty of the bytes a line scan would stop at
+            int value = byteValue(random);
+            frame[length++] = value < 64 ? '\n' : (value < 96 ? 0 : (uint8_t)value);
+        }
+        uint16_t crc = frameCodecCrc16(FRAME_CODEC_CRC16_INIT, frame, length);
+        frame[length++] = (uint8_t)(crc & 0xFF);
+        frame[length++] = (uint8_t)(crc >> 8);
+
+        uint8_t encoded[FRAME_CODEC_ENCODED_SIZE(sizeof(frame))];
+        size_t encodedLength = frameCodecEncode(frame, length, encoded);
+        receiver.written.push_back(
+            std::vector<uint8_t>(encoded, encoded + encodedLength - 1));
+        pcSerialComFrameWrite(encoded, encodedLength);
+        testTxInterrupts(sends(random));
+    }
+    testTxInterrupts(-1);
+
+    printf("%u frames written, %u bytes dropped: %u intact, %u cut short, %u broken\n",
+           (unsigned)TEST_FRAMES, (unsigned)pcSerialComTxDroppedBytes(),
+           (unsigned)receiver.intact, (unsigned)receiver.truncated,
+           (unsigned)receiver.broken);
+    if (receiver.broken > 0 || receiver.intact == 0 || receiver.truncated == 0 ||
+        !receiver.chunk.empty()) {
+        printf("FAIL\n");
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
+
+//=====[Implementations of private functions]==================================
+
+static void testByteReceived(uint8_t byte) {
+    if (byte == FRAME_CODEC_DELIMITER) {
+        testChunkCheck();
+        receiver.chunk.clear();
+    } else {
+        receiver.chunk.push_back(byte);
+    }
+}
+
+// Frames arrive in order, some dropped, so each chunk is matched against the
+// frames written after the last one matched
+static void testChunkCheck() {
+    const std::vector<uint8_t>& chunk = receiver.chunk;
+    long count = (long)receiver.written.size();
+    for (long i = receiver.nextFrame; i < count && !chunk.empty(); ++i) {
+        const std::vector<uint8_t>& frame = receiver.written[i];
+        if (chunk == frame) {
+            uint8_t decoded[TEST_SEQUENCE_SIZE + TEST_PAYLOAD_MAX + TEST_CRC_SIZE];
+            size_t length = frameCodecDecode(chunk.data(), chunk.size(), decoded);
+            uint16_t crc = frameCodecCrc16(FRAME_CODEC_CRC16_INIT, decoded,
+                                           length - TEST_CRC_SIZE);
+            if (length > TEST_CRC_SIZE && decoded[length - 2] == (uint8_t)(crc & 0xFF) &&
+                decoded[length - 1] == (uint8_t)(crc >> 8)) {
+                receiver.intact++;
+            } else {
+                receiver.broken++;
+            }
+            receiver.nextFrame = i + 1;
+            return;
+        }
+        if (chunk.size() < frame.size() &&
+            memcmp(chunk.data(), frame.data(), chunk.size()) == 0) {
+            receiver.truncated++;
+            receiver.nextFrame = i + 1;
+            return;
+        }
+    }
+    receiver.broken++;
+}
+
+// Lets the UART take count more bytes, or all of them when count is negative
+static void testTxInterrupts(int count) {
+    while (count != 0 && mbedHostSerial.handlers[SerialBase::TxIrq] != nullptr) {
+        mbedHostSerial.handlers[SerialBase::TxIrq]();
+        if (count > 0) {
+            count--;
+        }
+    }
+}
@@ -0,0 +1,351 @@
+// Runs the firmware signal path (supply correction, filters, alarm state
+// machines, the gas watchdog and sensor health checks) on simulated or recorded sensor data
+// under a virtual clock, as fast as the host allows, and reports alarm
+// transitions, health flag changes and processing cost. With --adaptive it
+// samples like the adaptive power mode, in bursts while every channel is
+// quiet.
+
+//=====[Libraries]=============================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+
+#include "pipeline.h"
+#include "sampler.h"
+#include "sim_source.h"
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct {
+    const char* scenario;
+    const char* tracePath;
+    uint32_t seconds;
+    uint32_t seed;
+    bool quiet;
+    bool adaptive;
+} simOptions_t;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static bool simOptionsParse(int argc, char** argv, simOptions_t* options);
+static void simUsagePrint(const char* program);
+static void simEventPrint(uint64_t timeUs, sensorChannel_t channel,
+                          alarmEngineEvent_t event, bool rateTripped, uint16_t average);
+static void simTrendEventPrint(uint64_t timeUs, sensorChannel_t channel,
+                               trendEvent_t event, const trendEstimate_t* estimate);
+static void simHealthPrint(uint64_t timeUs, sensorChannel_t channel, uint8_t flags);
+static void simRatePrint(uint64_t timeUs, bool burst, rateControlActivity_t activity,
+                         sensorChannel_t channel);
+
+//=====[Implementations of public functions]===================================
+
+int main(int argc, char** argv) {
+    simOptions_t options;
+    if (!simOptionsParse(argc, argv, &options)) {
+        simUsagePrint(argv[0]);
+        return 2;
+    }
+
+    simSource_t source;
+    bool opened = options.tracePath != nullptr
+                  ? simSourceTraceOpen(&source, options.tracePath)
+                  : simSourceScenarioOpen(&source, options.scenario, options.seconds,
+                                          options.seed);
+    if (!opened) {
+        fprintf(stderr, "cannot open %s\n", options.tracePath != nullptr
+                                            ? options.tracePath : options.scenario);
+        return 1;
+    }
+
+    pipelineCalibration_t calibration;
+    pipelineFilters_t filters;
+    pipelineAlarms_t alarms;
+    static pipelineTrends_t trends;  // Windows too large for the stack
+    pipelineHealth_t health;
+    pipelineRates_t rates;
+    pipelineCalibrationInit(&calibration);
+    pipelineFiltersInit(&filters);
+    pipelineAlarmsInit(&alarms);
+    pipelineTrendsInit(&trends);
+    pipelineHealthInit(&health);
+    pipelineRatesInit(&rates);
+
+    // The virtual clock advances one scan period per scan read
+    const uint64_t scanPeriodUs = 1000000 / SAMPLER_SCAN_RATE_HZ;
+    uint64_t nowUs = 0;
+    uint16_t block[SAMPLER_SCANS_PER_HALF * SENSOR_SCAN_CHANNEL_COUNT];
+    uint16_t corrected[SAMPLER_SCANS_PER_HALF * SENSOR_SCAN_CHANNEL_COUNT];
+    uint16_t vrefint[SAMPLER_SCANS_PER_HALF];
+    uint64_t blocks = 0;
+    uint64_t transitions[SENSOR_CHANNEL_COUNT] = {};
+    uint64_t preAlarms[SENSOR_CHANNEL_COUNT] = {};
+    uint64_t faults[SENSOR_CHANNEL_COUNT] = {};
+    uint8_t healthFlags[SENSOR_CHANNEL_COUNT] = {};
+    bool burst = false;
+    uint64_t rateSwitches = 0;
+    bool watchdogArmed = true;  // Gas analog watchdog, armed as alarmInit() leaves it
+    filterRun_t watchdogRun;
+    filterRunReset(&watchdogRun);
+    uint64_t fullRateUs = 0;
+    std::chrono::nanoseconds filterTime(0);
+    std::chrono::nanoseconds alarmTime(0);
+    auto wallStart = std::chrono::steady_clock::now();
+
+    while (true) {
+        // Between bursts the ADC stands still; its scans are never seen
+        uint64_t blockStartUs = nowUs;
+        if (burst) {
+            const int skippedScans = (SAMPLER_BURST_PERIOD_MS - SAMPLER_SNAPSHOT_PERIOD_MS) *
+                                     SAMPLER_SCAN_RATE_HZ / 1000;
+            int skipped = 0;
+            while (skipped < skippedScans &&
+                   simSourceScanRead(&source, nowUs, block, vrefint)) {
+                skipped++;
+                nowUs += scanPeriodUs;
+            }
+            if (skipped < skippedScans) {
+                break;
+            }
+        }
+
+        int scans = 0;
+        while (scans < SAMPLER_SCANS_PER_HALF &&
+               simSourceScanRead(&source, nowUs, &block[scans * SENSOR_SCAN_CHANNEL_COUNT],
+                                 &vrefint[scans])) {
+            scans++;
+            nowUs += scanPeriodUs;
+        }
+        if (scans < SAMPLER_SCANS_PER_HALF) {
+            break;  // Like the DMA, only whole half-buffers are processed
+        }
+
+        uint16_t averages[SENSOR_CHANNEL_COUNT] = {};  // SPI ADC heads are not simulated
+        uint16_t minimums[SENSOR_CHANNEL_COUNT] = {};
+        uint16_t maximums[SENSOR_CHANNEL_COUNT] = {};
+        uint8_t flags[SENSOR_CHANNEL_COUNT];
+        alarmEngineEvent_t events[SENSOR_CHANNEL_COUNT];
+        trendEstimate_t estimates[SENSOR_CHANNEL_COUNT];
+        trendEvent_t trendEvents[SENSOR_CHANNEL_COUNT];
+
+        uint32_t vrefintSum = 0;
+        for (int i = 0; i < SAMPLER_SCANS_PER_HALF; ++i) {
+            vrefintSum += vrefint[i];
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        pipelineCalibrationSupplyUpdate(&calibration, SIM_SOURCE_VREFINT_CAL,
+                                        vrefintSum / SAMPLER_SCANS_PER_HALF);
+        pipelineCalibrationBlock(&calibration, block, SAMPLER_SCANS_PER_HALF, corrected);
+        pipelineFiltersBlock(&filters, corrected, SAMPLER_SCANS_PER_HALF, averages);
+        pipelineRangesBlock(block, SENSOR_SCAN_CHANNEL_COUNT, SAMPLER_SCANS_PER_HALF,
+                            minimums, maximums);
+
+        // The watchdog sees each gas conversion as it is made, ahead of the
+        // snapshot, and hands its trip evidence to the alarm task
+        for (int i = 0; i < SAMPLER_SCANS_PER_HALF && watchdogArmed; ++i) {
+            uint64_t scanUs = nowUs - (SAMPLER_SCANS_PER_HALF - i) * scanPeriodUs;
+            uint16_t reading = corrected[i * SENSOR_SCAN_CHANNEL_COUNT + SENSOR_CHANNEL_GAS];
+            if (reading > alarms.configs[SENSOR_CHANNEL_GAS].tripReading &&
+                filterRunAdd(&watchdogRun, (uint32_t)scanUs, (uint32_t)scanPeriodUs,
+                             sensorChannels[SENSOR_CHANNEL_GAS].medianLength)) {
+                watchdogArmed = false;
+                alarmEngineEvent_t event = alarmEngineTripEvidence(
+                    &alarms.channels[SENSOR_CHANNEL_GAS], &alarms.configs[SENSOR_CHANNEL_GAS],
+                    (uint32_t)(scanUs / 1000));
+                if (event != ALARM_ENGINE_NO_CHANGE) {
+                    transitions[SENSOR_CHANNEL_GAS]++;
+                    if (!options.quiet) {
+                        simEventPrint(scanUs, SENSOR_CHANNEL_GAS, event, false, reading);
+                    }
+                }
+            }
+        }
+        auto filtered = std::chrono::steady_clock::now();
+        pipelineAlarmsUpdate(&alarms, averages, (uint32_t)(nowUs / 1000), events);
+        if (!watchdogArmed &&
+            alarms.channels[SENSOR_CHANNEL_GAS].state == ALARM_ENGINE_CLEAR) {
+            watchdogArmed = true;  // Once gas is fully clear, as the alarm task does
+            filterRunReset(&watchdogRun);
+        }
+        uint32_t periodMs = burst ? SAMPLER_BURST_PERIOD_MS : SAMPLER_SNAPSHOT_PERIOD_MS;
+        pipelineTrendsUpdate(&trends, averages, periodMs, estimates, trendEvents);
+        pipelineHealthUpdate(&health, averages, minimums, maximums, periodMs,
+                             (uint32_t)(nowUs / 1000), flags);
+        sensorChannel_t rateChannel;
+        rateControlActivity_t activity = pipelineRatesUpdate(&rates, averages,
+                                                             (uint32_t)(nowUs / 1000),
+                                                             &rateChannel);
+        auto updated = std::chrono::steady_clock::now();
+        filterTime += filtered - start;
+        alarmTime += updated - filtered;
+        blocks++;
+
+        if (!burst) {
+            fullRateUs += nowUs - blockStartUs;
+        }
+        bool nextBurst = options.adaptive && activity == RATE_CONTROL_QUIET &&
+                         !pipelineAlarmsPending(&alarms);
+        if (nextBurst != burst) {
+            burst = nextBurst;
+            rateSwitches++;
+            if (!options.quiet) {
+                simRatePrint(nowUs, burst, activity, rateChannel);
+            }
+        }
+
+        for (int i = 0; i < SENSOR_CHANNEL_COUNT; ++i) {
+            if (flags[i] != healthFlags[i]) {
+                if ((flags[i] & ~healthFlags[i]) & FAULT_DETECT_FAULTS) {
+                    faults[i]++;
+                }
+                healthFlags[i] = flags[i];
+                if (!options.quiet) {
+                    simHealthPrint(nowUs, (sensorChannel_t)i, flags[i]);
+                }
+            }
+            if (events[i] != ALARM_ENGINE_NO_CHANGE) {
+                transitions[i]++;
+                if (!options.quiet) {
+                    simEventPrint(nowUs, (sensorChannel_t)i, events[i],
+                                  alarms.channels[i].rateTripped, averages[i]);
+                }
+            }
+            if (trendEvents[i] != TREND_NO_CHANGE) {
+                if (trendEvents[i] == TREND_PRE_ALARM) {
+                    preAlarms[i]++;
+                }
+                if (!options.quiet) {
+                    simTrendEventPrint(nowUs, (sensorChannel_t)i, trendEvents[i],
+                                       &estimates[i]);
+                }
+            }
+        }
+    }
+    simSourceClose(&source);
+
+    double wallSeconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - wallStart).count();
+    double simulatedSeconds = nowUs / 1e6;
+
+    printf("simulated %.1f s in %.3f s (%.0fx real time), %llu blocks\n",
+           simulatedSeconds, wallSeconds,
+           wallSeconds > 0 ? simulatedSeconds / wallSeconds : 0.0,
+           (unsigned long long)blocks);
+    if (blocks > 0) {
+        printf("filters %.0f ns/block, alarms, trends and health %.0f ns/block\n",
+               (double)filterTime.count() / blocks, (double)alarmTime.count() / blocks);
+    }
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; ++i) {
+        if (sensorChannels[i].alarmEnabled) {
+            printf("%s: %llu transitions, %llu pre-alarms, %llu faults\n",
+                   sensorChannels[i].name, (unsigned long long)transitions[i],
+                   (unsigned long long)preAlarms[i], (unsigned long long)faults[i]);
+        }
+    }
+    if (options.adaptive) {
+        printf("rate: %llu switches, full rate %.1f%% of the time\n",
+               (unsigned long long)rateSwitches,
+               nowUs > 0 ? 100.0 * fullRateUs / nowUs : 0.0);
+    }
+    return 0;
+}
+
+//=====[Implementations of private functions]==================================
+
+static bool simOptionsParse(int argc, char** argv, simOptions_t* options) {
+    options->scenario = "idle";
+    options->tracePath = nullptr;
+    options->seconds = 600;
+    options->seed = 1;
+    options->quiet = false;
+    options->adaptive = false;
+
+    for (int i = 1; i < argc; ++i) {
+        bool hasValue = (i + 1 < argc);
+        if (strcmp(argv[i], "--scenario") == 0 && hasValue) {
+            options->scenario = argv[++i];
+        } else if (strcmp(argv[i], "--trace") == 0 && hasValue) {
+            options->tracePath = argv[++i];
+        } else if (strcmp(argv[i], "--seconds") == 0 && hasValue) {
+            options->seconds = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--seed") == 0 && hasValue) {
+            options->seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--quiet") == 0) {
+            options->quiet = true;
+        } else if (strcmp(argv[i], "--adaptive") == 0) {
+            options->adaptive = true;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void simUsagePrint(const char* program) {
+    fprintf(stderr,
+            "usage: %s [--scenario NAME | --trace FILE] [--seconds N] [--seed N] [--quiet]\n"
+            "       [--adaptive]\n"
+            "scenarios:\n", program);
+    simSourceScenariosPrint(stderr);
+}
+
+// A trip on the rate of rise alone is told apart, as the firmware reports it
+static void simEventPrint(uint64_t timeUs, sensorChannel_t channel,
+                          alarmEngineEvent_t event, bool rateTripped, uint16_t average) {
+    int32_t value = sensorChannelValue(channel, average);
+    const char* change = "cleared";
+    if (event == ALARM_ENGINE_TRIP) {
+        change = rateTripped ? "tripped rising fast" : "tripped";
+    }
+    printf("%10.3f s  %s %s at %d.%02d %s\n", timeUs / 1e6, sensorChannels[channel].name,
+           change,
+           (int)(value / 100), (int)abs(value % 100), sensorChannels[channel].unit);
+}
+
+static void simTrendEventPrint(uint64_t timeUs, sensorChannel_t channel,
+                               trendEvent_t event, const trendEstimate_t* estimate) {
+    int32_t value = sensorChannelValue(channel, estimate->mean);
+    if (event == TREND_PRE_ALARM) {
+        printf("%10.3f s  %s pre-alarm at mean %d.%02d %s, trip in %.1f s\n",
+               timeUs / 1e6, sensorChannels[channel].name, (int)(value / 100),
+               (int)abs(value % 100), sensorChannels[channel].unit,
+               estimate->timeToTripMs / 1e3);
+    } else {
+        printf("%10.3f s  %s pre-alarm cleared\n", timeUs / 1e6,
+               sensorChannels[channel].name);
+    }
+}
+
+// Flags as the firmware's "health" command lists them
+static void simHealthPrint(uint64_t timeUs, sensorChannel_t channel, uint8_t flags) {
+    static const char* const names[] = {
+        "rail low", "rail high", "stuck", "noisy", "implausible rate", "heater off",
+        "warming up",
+    };
+    printf("%10.3f s  %s health:", timeUs / 1e6, sensorChannels[channel].name);
+    if (flags == 0) {
+        printf(" ok");
+    }
+    for (size_t bit = 0; bit < sizeof(names) / sizeof(names[0]); ++bit) {
+        if (flags & (1U << bit)) {
+            printf(" %s", names[bit]);
+        }
+    }
+    printf("\n");
+}
+
+static void simRatePrint(uint64_t timeUs, bool burst, rateControlActivity_t activity,
+                         sensorChannel_t channel) {
+    if (burst) {
+        printf("%10.3f s  sampling in bursts\n", timeUs / 1e6);
+    } else if (activity == RATE_CONTROL_QUIET) {
+        printf("%10.3f s  sampling at full rate: alarm pending\n", timeUs / 1e6);
+    } else {
+        printf("%10.3f s  sampling at full rate: %s %s\n", timeUs / 1e6,
+               sensorChannels[channel].name,
+               activity == RATE_CONTROL_NEAR ? "near its threshold" : "changing quickly");
+    }
+}
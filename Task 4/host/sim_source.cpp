@@ -0,0 +1,203 @@
+//=====[Libraries]=============================================================
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim_source.h"
+#include "sampler.h"
+
+//=====[Declaration of private defines]========================================
+
+#define SIM_SOURCE_LINE_LENGTH      128
+
+//=====[Declaration and initialization of private global variables]============
+
+// Levels mirror the thresholds of the channel table: gas trips above 0.50
+// and LM35 above 24.00 °C. VDDA stays at 3.30 V unless a scenario sets it.
+static const simScenario_t scenarios[] = {
+    { "idle", "clean air at 22 C, nothing should trip",
+      { { 10, 1, {}, 0, 0 },
+        { 2200, 10, {}, 0, 0 },
+        { 50, 1, {}, 0, 0 } },
+      {} },
+    { "noisy-threshold", "LM35 hovering at 24 C with 0.4 C of noise",
+      { { 10, 1, {}, 0, 0 },
+        { 2400, 40, {}, 0, 0 },
+        { 50, 1, {}, 0, 0 } },
+      {} },
+    { "gas-leak", "gas rising to 0.80 from 10 s to 30 s, clearing from 60 s, "
+                  "with heater spikes",
+      { { 10, 2, { { 10000, 30000, 80 }, { 60000, 80000, 10 } }, 2, 95 },
+        { 2200, 10, {}, 0, 0 },
+        { 50, 1, {}, 0, 0 } },
+      {} },
+    { "heater-spikes", "clean air with four heater spikes per second",
+      { { 10, 2, {}, 4, 95 },
+        { 2200, 10, {}, 0, 0 },
+        { 50, 1, {}, 0, 0 } },
+      {} },
+    { "fast-temperature", "LM35 climbing 2 C/s from 10 s, below the threshold "
+                          "at first",
+      { { 10, 1, {}, 0, 0 },
+        { 2200, 10, { { 10000, 14000, 3000 }, { 40000, 50000, 2200 } }, 0, 0 },
+        { 50, 1, {}, 0, 0 } },
+      {} },
+    { "temperature-blip", "LM35 jumping from 22 C to 26 C at 10.8 s and back under "
+                          "the threshold before the rise is checked",
+      { { 10, 1, {}, 0, 0 },
+        { 2200, 10, { { 10784, 10984, 2600 }, { 10984, 11284, 2300 } }, 0, 0 },
+        { 50, 1, {}, 0, 0 } },
+      {} },
+    { "lm35-wire-break", "LM35 at 22 C until its line breaks at 60 s and the input "
+                         "reads 0 V",
+      { { 10, 1, {}, 0, 0 },
+        { 2200, 10, { { 60000, 60001, 0 } }, 0, 0 },
+        { 50, 1, {}, 0, 0 } },
+      {} },
+    { "supply-sag", "LM35 at 23 C while VDDA sags to 3.05 V from 60 s to 120 s, "
+                    "which reads 24.9 C uncorrected",
+      { { 10, 1, {}, 0, 0 },
+        { 2300, 10, {}, 0, 0 },
+        { 50, 1, {}, 0, 0 } },
+      { 330, 0, { { 60000, 120000, 305 } }, 0, 0 } },
+};
+
+#define SIM_SOURCE_SCENARIO_COUNT   (sizeof(scenarios) / sizeof(scenarios[0]))
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static int32_t simChannelValue(const simChannelModel_t* model, uint32_t timeMs);
+static bool simSourceTraceScanRead(simSource_t* source, uint16_t* scan);
+
+//=====[Implementations of public functions]===================================
+
+bool simSourceScenarioOpen(simSource_t* source, const char* name,
+                           uint32_t seconds, uint32_t seed) {
+    source->scenario = nullptr;
+    source->trace = nullptr;
+    for (size_t i = 0; i < SIM_SOURCE_SCENARIO_COUNT; ++i) {
+        if (strcmp(scenarios[i].name, name) == 0) {
+            source->scenario = &scenarios[i];
+        }
+    }
+    source->durationUs = (uint64_t)seconds * 1000000;
+    source->random.seed(seed);
+    return source->scenario != nullptr;
+}
+
+// A trace holds one scan per line, "gas,lm35,potentiometer" readings in the
+// read_u16() scale at the sampler scan rate. Lines starting with '#' and a
+// header line are skipped.
+bool simSourceTraceOpen(simSource_t* source, const char* path) {
+    source->scenario = nullptr;
+    source->trace = fopen(path, "r");
+    source->traceLine = 0;
+    return source->trace != nullptr;
+}
+
+// Fills one scan for the virtual time timeUs; false once the source is over.
+// Traces hold no VREFINT readings, so they report the nominal supply.
+bool simSourceScanRead(simSource_t* source, uint64_t timeUs, uint16_t* scan,
+                       uint16_t* vrefint) {
+    if (source->trace != nullptr) {
+        *vrefint = SIM_SOURCE_VREFINT_CAL;
+        return simSourceTraceScanRead(source, scan);
+    }
+    if (source->scenario == nullptr || timeUs >= source->durationUs) {
+        return false;
+    }
+
+    uint32_t timeMs = (uint32_t)(timeUs / 1000);
+    int32_t supply = simChannelValue(&source->scenario->supply, timeMs);
+    if (supply <= 0) {
+        supply = SIM_SOURCE_SUPPLY_NOMINAL;
+    }
+    *vrefint = (uint16_t)((SIM_SOURCE_VREFINT_CAL * SIM_SOURCE_SUPPLY_NOMINAL +
+                           supply / 2) / supply);
+
+    for (int i = 0; i < SENSOR_SCAN_CHANNEL_COUNT; ++i) {
+        const simChannelModel_t* model = &source->scenario->channels[i];
+        int32_t value = simChannelValue(model, timeMs);
+
+        if (model->noise > 0) {
+            std::normal_distribution<float> noise(0.0f, (float)model->noise);
+            value += (int32_t)noise(source->random);
+        }
+        if (model->spikesPerSecond > 0) {
+            std::uniform_int_distribution<uint32_t> dice(0, SAMPLER_SCAN_RATE_HZ - 1);
+            if (dice(source->random) < model->spikesPerSecond) {
+                value = model->spikeValue;
+            }
+        }
+        uint32_t reading = sensorChannelValueToReading((sensorChannel_t)i, value);
+        if (!sensorChannels[i].ratiometric) {
+            reading = reading * SIM_SOURCE_SUPPLY_NOMINAL / supply;
+        }
+        scan[i] = (uint16_t)(reading > UINT16_MAX ? UINT16_MAX : reading);
+    }
+    return true;
+}
+
+void simSourceClose(simSource_t* source) {
+    if (source->trace != nullptr) {
+        fclose(source->trace);
+        source->trace = nullptr;
+    }
+}
+
+void simSourceScenariosPrint(FILE* stream) {
+    for (size_t i = 0; i < SIM_SOURCE_SCENARIO_COUNT; ++i) {
+        fprintf(stream, "  %-18s %s\n", scenarios[i].name, scenarios[i].description);
+    }
+}
+
+//=====[Implementations of private functions]==================================
+
+static int32_t simChannelValue(const simChannelModel_t* model, uint32_t timeMs) {
+    int32_t value = model->level;
+    for (int i = 0; i < SIM_SOURCE_RAMPS_MAX; ++i) {
+        const simRamp_t* ramp = &model->ramps[i];
+        if (ramp->endMs == 0 || timeMs < ramp->startMs) {
+            break;
+        }
+        if (timeMs >= ramp->endMs) {
+            value = ramp->value;
+        } else {
+            value += (int32_t)((int64_t)(ramp->value - value) * (timeMs - ramp->startMs) /
+                               (ramp->endMs - ramp->startMs));
+            break;
+        }
+    }
+    return value;
+}
+
+static bool simSourceTraceScanRead(simSource_t* source, uint16_t* scan) {
+    char line[SIM_SOURCE_LINE_LENGTH];
+
+    while (fgets(line, sizeof(line), source->trace) != nullptr) {
+        source->traceLine++;
+        if (line[0] == '#') {
+            continue;
+        }
+
+        char* cursor = line;
+        int channel = 0;
+        for (; channel < SENSOR_SCAN_CHANNEL_COUNT; ++channel) {
+            char* end;
+            long reading = strtol(cursor, &end, 10);
+            if (end == cursor || reading < 0 || reading > 65535) {
+                break;
+            }
+            scan[channel] = (uint16_t)reading;
+            cursor = (*end == ',') ? end + 1 : end;
+        }
+        if (channel == SENSOR_SCAN_CHANNEL_COUNT) {
+            return true;
+        }
+        if (source->traceLine > 1) {  // Only the first line may be a header
+            fprintf(stderr, "trace line %u: expected %d readings\n",
+                    (unsigned)source->traceLine, SENSOR_SCAN_CHANNEL_COUNT);
+        }
+    }
+    return false;
+}
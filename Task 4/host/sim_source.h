@@ -0,0 +1,72 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _SIM_SOURCE_H_
+#define _SIM_SOURCE_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <random>
+
+#include "sensor_channels.h"
+
+//=====[Declaration of public defines]=========================================
+
+#define SIM_SOURCE_RAMPS_MAX        2
+
+// Simulated VDDA in hundredths of a volt when a scenario leaves it at 0, and
+// the factory VREFINT reading taken at it: 1.21 V of 3.30 V in 12 bits
+#define SIM_SOURCE_SUPPLY_NOMINAL   330
+#define SIM_SOURCE_VREFINT_CAL      1502
+
+//=====[Declaration of public data types]======================================
+
+// Moves the level linearly to value between startMs and endMs
+typedef struct {
+    uint32_t startMs;
+    uint32_t endMs;
+    int32_t value;
+} simRamp_t;
+
+// Synthetic signal of one channel, in hundredths of the channel unit
+typedef struct {
+    int32_t level;
+    int32_t noise;              // Standard deviation of gaussian noise
+    simRamp_t ramps[SIM_SOURCE_RAMPS_MAX];  // In time order, unused have endMs 0
+    uint32_t spikesPerSecond;   // Single-scan spikes, such as heater switching
+    int32_t spikeValue;
+} simChannelModel_t;
+
+typedef struct {
+    const char* name;
+    const char* description;
+    simChannelModel_t channels[SENSOR_SCAN_CHANNEL_COUNT];
+    simChannelModel_t supply;   // VDDA, scaling the readings of fixed voltages
+} simScenario_t;
+
+// Simulated ADC: one scan of read_u16() readings per call, together with the
+// ADC1 VREFINT reading, either generated from a scenario or replayed from a
+// recorded trace
+typedef struct {
+    const simScenario_t* scenario;
+    uint64_t durationUs;
+    std::mt19937 random;
+    FILE* trace;
+    uint32_t traceLine;
+} simSource_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+bool simSourceScenarioOpen(simSource_t* source, const char* name,
+                           uint32_t seconds, uint32_t seed);
+bool simSourceTraceOpen(simSource_t* source, const char* path);
+bool simSourceScanRead(simSource_t* source, uint64_t timeUs, uint16_t* scan,
+                       uint16_t* vrefint);
+void simSourceClose(simSource_t* source);
+void simSourceScenariosPrint(FILE* stream);
+
+//=====[#include guards - end]=================================================
+
+#endif // _SIM_SOURCE_H_
@@ -0,0 +1,526 @@
+// Plays a fleet of boards against telemetry_collector: each sends batched
+// SAMPLES datagrams at the sampler's rate from a UDP socket of its own,
+// STATUS, TIME and HEALTH frames every second, alarm events and clock
+// exchanges, like net_telemetry does. --drop skips frames on purpose, so the
+// losses the collector reports can be checked against the ones printed here,
+// and --fifo adds one board writing a COBS stream, like the serial port.
+
+//=====[Libraries]=============================================================
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <arpa/inet.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "alarm.h"
+#include "collector_frames.h"
+#include "frame_codec.h"
+#include "net_telemetry.h"
+#include "sampler.h"
+
+//=====[Declaration of private defines]========================================
+
+#define BENCH_BOARDS_MAX            16384
+#define BENCH_THREADS_MAX           64
+#define BENCH_STATUS_PERIOD_S       1.0
+#define BENCH_EVENT_PERIOD_S        5.0
+#define BENCH_TIME_SYNC_PERIOD_S    (NET_TELEMETRY_TIME_SYNC_PERIOD_MS / 1000.0)
+#define BENCH_TIME_WAIT_S           0.1     // As long as a board waits for the answer
+#define BENCH_IDLE_WAIT_S           0.002   // Longest sleep, to catch responses
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct {
+    const char* host;
+    uint16_t port;
+    int boards;
+    uint32_t seconds;
+    double speed;               // Scan rate as a multiple of the sampler's
+    double dropPercent;
+    int threads;
+    const char* fifoPath;
+    uint32_t seed;
+} benchOptions_t;
+
+typedef struct {
+    int fd;
+    bool serial;                // COBS stream into the FIFO
+    uint32_t blocksPerPacket;
+    int64_t clockOffsetUs;      // Board clock less the host's monotonic clock
+    uint32_t nextBlock;
+    uint32_t nextEvent;
+    uint32_t nextTimeRequest;
+    bool gasDetected;
+    double nextPacketS;
+    double nextStatusS;
+    double nextEventS;
+    double nextTimeSyncS;
+    bool timePending;
+    uint64_t pendingLocalUs;
+    double pendingS;
+
+    uint64_t packets;
+    uint64_t scans;
+    uint64_t bytes;
+    uint64_t skippedBlocks;
+    uint64_t skippedEvents;
+    uint64_t sendErrors;
+    uint64_t timeRequests;
+    uint64_t timeResponses;
+    uint64_t roundTripUsTotal;
+    uint64_t roundTripUsMax;
+} benchBoard_t;
+
+//=====[Declaration and initialization of private global variables]============
+
+static benchOptions_t options;
+static std::vector<benchBoard_t> boards;
+static double startS;
+static double stopS;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static bool benchOptionsParse(int argc, char** argv);
+static void benchUsagePrint(const char* program);
+static void benchBoardInit(benchBoard_t* board, std::mt19937* random, bool serial);
+static void benchTask(int first, int end, int step, uint32_t seed);
+static void benchSamplesSend(benchBoard_t* board, double dueS, bool mayDrop,
+                             std::mt19937* random);
+static void benchStatusSend(benchBoard_t* board);
+static void benchEventSend(benchBoard_t* board, bool mayDrop, std::mt19937* random);
+static void benchTimeRequestSend(benchBoard_t* board, double nowS);
+static void benchTimeResponseReceive(benchBoard_t* board, double nowS);
+static void benchFrameSend(benchBoard_t* board, const uint8_t* frame, size_t length);
+static uint64_t benchBoardLocalUs(const benchBoard_t* board);
+static uint64_t benchBoardLocalUsAt(const benchBoard_t* board, double sinceS);
+static int64_t benchNowWallUs();
+static double benchNowS();
+static void benchSleepUntil(double untilS);
+
+//=====[Implementations of public functions]===================================
+
+int main(int argc, char** argv) {
+    if (!benchOptionsParse(argc, argv)) {
+        benchUsagePrint(argv[0]);
+        return 2;
+    }
+
+    std::mt19937 random(options.seed);
+    struct sockaddr_in collector;
+    memset(&collector, 0, sizeof(collector));
+    collector.sin_family = AF_INET;
+    collector.sin_port = htons(options.port);
+    if (inet_pton(AF_INET, options.host, &collector.sin_addr) != 1) {
+        fprintf(stderr, "not an IPv4 address: %s\n", options.host);
+        return 2;
+    }
+
+    boards.resize(options.boards + (options.fifoPath != nullptr ? 1 : 0));
+    for (int i = 0; i < options.boards; ++i) {
+        benchBoardInit(&boards[i], &random, false);
+        boards[i].fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (boards[i].fd < 0 ||
+            connect(boards[i].fd, (struct sockaddr*)&collector, sizeof(collector)) != 0) {
+            fprintf(stderr, "cannot open the socket of board %d: %s\n", i, strerror(errno));
+            return 1;
+        }
+    }
+    if (options.fifoPath != nullptr) {
+        benchBoard_t* board = &boards[options.boards];
+        benchBoardInit(board, &random, true);
+        if (mkfifo(options.fifoPath, 0644) != 0 && errno != EEXIST) {
+            fprintf(stderr, "cannot create %s: %s\n", options.fifoPath, strerror(errno));
+            return 1;
+        }
+        printf("Waiting for a reader on %s\n", options.fifoPath);
+        fflush(stdout);
+        board->fd = open(options.fifoPath, O_WRONLY | O_CLOEXEC);
+        if (board->fd < 0) {
+            fprintf(stderr, "cannot open %s: %s\n", options.fifoPath, strerror(errno));
+            return 1;
+        }
+    }
+
+    printf("Sending as %d boards to %s:%u%s for %u s at %.2f times the scan rate, "
+           "%.2f%% of frames skipped\n", options.boards, options.host, options.port,
+           options.fifoPath != nullptr ? " and one to the FIFO" : "", options.seconds,
+           options.speed, options.dropPercent);
+    fflush(stdout);
+
+    startS = benchNowS();
+    stopS = startS + options.seconds;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < options.threads && i < options.boards; ++i) {
+        threads.emplace_back(benchTask, i, options.boards, options.threads,
+                             options.seed + 1 + i);
+    }
+    if (options.fifoPath != nullptr) {
+        // A blocking FIFO must not hold up the UDP boards
+        threads.emplace_back(benchTask, options.boards, options.boards + 1, 1,
+                             options.seed + 1 + options.threads);
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    double elapsedS = benchNowS() - startS;
+
+    benchBoard_t total;
+    memset(&total, 0, sizeof(total));
+    for (const benchBoard_t& board : boards) {
+        total.packets += board.packets;
+        total.scans += board.scans;
+        total.bytes += board.bytes;
+        total.skippedBlocks += board.skippedBlocks;
+        total.skippedEvents += board.skippedEvents;
+        total.sendErrors += board.sendErrors;
+        total.timeRequests += board.timeRequests;
+        total.timeResponses += board.timeResponses;
+        total.roundTripUsTotal += board.roundTripUsTotal;
+        if (board.roundTripUsMax > total.roundTripUsMax) {
+            total.roundTripUsMax = board.roundTripUsMax;
+        }
+        close(board.fd);
+    }
+
+    printf("sent %llu sample frames in %.1f s: %.0f frames/s, %.0f scans/s, %.2f MB/s, "
+           "%llu send errors\n",
+           (unsigned long long)total.packets, elapsedS, total.packets / elapsedS,
+           total.scans / elapsedS, total.bytes / elapsedS / 1e6,
+           (unsigned long long)total.sendErrors);
+    printf("skipped on purpose: %llu blocks, %llu events; the collector should report "
+           "as many dropped\n",
+           (unsigned long long)total.skippedBlocks, (unsigned long long)total.skippedEvents);
+    printf("clock exchanges: %llu of %llu answered", (unsigned long long)total.timeResponses,
+           (unsigned long long)total.timeRequests);
+    if (total.timeResponses > 0) {
+        printf(", round trip mean %.0f us, max %llu us",
+               (double)total.roundTripUsTotal / total.timeResponses,
+               (unsigned long long)total.roundTripUsMax);
+    }
+    printf("\n");
+    return 0;
+}
+
+//=====[Implementations of private functions]==================================
+
+static bool benchOptionsParse(int argc, char** argv) {
+    options.host = "127.0.0.1";
+    options.port = NET_TELEMETRY_PORT;
+    options.boards = 16;
+    options.seconds = 10;
+    options.speed = 1.0;
+    options.dropPercent = 0.0;
+    options.threads = 1;
+    options.fifoPath = nullptr;
+    options.seed = 1;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (strcmp(argv[i], "--host") == 0 && value != nullptr) {
+            options.host = argv[++i];
+        } else if (strcmp(argv[i], "--port") == 0 && value != nullptr) {
+            options.port = (uint16_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--boards") == 0 && value != nullptr) {
+            options.boards = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seconds") == 0 && value != nullptr) {
+            options.seconds = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--speed") == 0 && value != nullptr) {
+            options.speed = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--drop") == 0 && value != nullptr) {
+            options.dropPercent = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && value != nullptr) {
+            options.threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--fifo") == 0 && value != nullptr) {
+            options.fifoPath = argv[++i];
+        } else if (strcmp(argv[i], "--seed") == 0 && value != nullptr) {
+            options.seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else {
+            return false;
+        }
+    }
+    return options.boards >= 0 && options.boards <= BENCH_BOARDS_MAX &&
+           (options.boards > 0 || options.fifoPath != nullptr) && options.port != 0 &&
+           options.seconds > 0 && options.speed > 0 && options.dropPercent >= 0 &&
+           options.dropPercent < 100 && options.threads >= 1 &&
+           options.threads <= BENCH_THREADS_MAX;
+}
+
+static void benchUsagePrint(const char* program) {
+    fprintf(stderr,
+            "usage: %s [--host IP] [--port PORT] [--boards N] [--seconds N] [--speed X]\n"
+            "          [--drop PERCENT] [--threads N] [--fifo PATH] [--seed N]\n"
+            "  --boards   UDP boards, one socket each, 16 by default; raise ulimit -n\n"
+            "             for more than about a thousand\n"
+            "  --speed    scan rate as a multiple of %d Hz\n"
+            "  --drop     share of sample frames and events skipped, like lost datagrams\n"
+            "  --fifo     one more board writing a COBS stream to this FIFO; pass it to\n"
+            "             the collector with --serial\n",
+            program, SAMPLER_SCAN_RATE_HZ);
+}
+
+// Boards start at random points of their periods, so the fleet's frames
+// spread out instead of arriving together
+static void benchBoardInit(benchBoard_t* board, std::mt19937* random, bool serial) {
+    memset(board, 0, sizeof(*board));
+    std::uniform_real_distribution<double> phase(0.0, 1.0);
+    board->fd = -1;
+    board->serial = serial;
+    board->blocksPerPacket = serial ? 1 : NET_TELEMETRY_BLOCKS_PER_PACKET;
+    board->clockOffsetUs = (int64_t)((*random)() % 4000000000U);
+    board->nextPacketS = phase(*random) * board->blocksPerPacket * SAMPLER_SCANS_PER_HALF /
+                         (SAMPLER_SCAN_RATE_HZ * options.speed);
+    board->nextStatusS = 0.0;
+    board->nextEventS = phase(*random) * BENCH_EVENT_PERIOD_S;
+    board->nextTimeSyncS = phase(*random);
+}
+
+// Sends for every step-th board from first to end until the time is up. The
+// first and last frames of each sequence are never skipped, so every skipped
+// one shows up as a gap.
+static void benchTask(int first, int end, int step, uint32_t seed) {
+    std::mt19937 random(seed);
+    double packetPeriodS = (double)NET_TELEMETRY_BLOCKS_PER_PACKET * SAMPLER_SCANS_PER_HALF /
+                           (SAMPLER_SCAN_RATE_HZ * options.speed);
+
+    while (true) {
+        double nowS = benchNowS();
+        if (nowS >= stopS) {
+            break;
+        }
+        double sinceS = nowS - startS;
+        double wakeS = sinceS + BENCH_IDLE_WAIT_S;
+        for (int i = first; i < end; i += step) {
+            benchBoard_t* board = &boards[i];
+            double periodS = packetPeriodS * board->blocksPerPacket /
+                             NET_TELEMETRY_BLOCKS_PER_PACKET;
+            if (board->timePending) {
+                benchTimeResponseReceive(board, sinceS);
+            }
+            if (sinceS >= board->nextStatusS) {
+                benchStatusSend(board);
+                board->nextStatusS += BENCH_STATUS_PERIOD_S;
+            }
+            if (!board->serial && !board->timePending && sinceS >= board->nextTimeSyncS) {
+                benchTimeRequestSend(board, sinceS);
+                board->nextTimeSyncS += BENCH_TIME_SYNC_PERIOD_S;
+            }
+            if (sinceS >= board->nextEventS) {
+                benchEventSend(board, true, &random);
+                board->nextEventS += BENCH_EVENT_PERIOD_S;
+            }
+            while (sinceS >= board->nextPacketS) {
+                benchSamplesSend(board, board->nextPacketS, true, &random);
+                board->nextPacketS += periodS;
+            }
+            if (board->nextPacketS < wakeS) {
+                wakeS = board->nextPacketS;
+            }
+        }
+        benchSleepUntil(startS + wakeS);
+    }
+
+    for (int i = first; i < end; i += step) {
+        benchSamplesSend(&boards[i], benchNowS() - startS, false, &random);
+        benchEventSend(&boards[i], false, &random);
+    }
+}
+
+// The scans of a packet end when it is due, as the board sends it right
+// after the last half-buffer fills; a thread running late sends it later,
+// which shows as latency
+static void benchSamplesSend(benchBoard_t* board, double dueS, bool mayDrop,
+                             std::mt19937* random) {
+    uint32_t blocks = board->blocksPerPacket;
+    uint32_t sequence = board->nextBlock;
+    board->nextBlock += blocks;
+    std::uniform_real_distribution<double> chance(0.0, 100.0);
+    if (mayDrop && sequence != 0 && chance(*random) < options.dropPercent) {
+        board->skippedBlocks += blocks;
+        return;
+    }
+
+    uint16_t readings[NET_TELEMETRY_BLOCKS_PER_PACKET * SAMPLER_SCANS_PER_HALF *
+                      SENSOR_SCAN_CHANNEL_COUNT];
+    uint32_t scans = blocks * SAMPLER_SCANS_PER_HALF;
+    uint32_t firstScan = sequence * SAMPLER_SCANS_PER_HALF;
+    for (uint32_t scan = 0; scan < scans; ++scan) {
+        for (int channel = 0; channel < SENSOR_SCAN_CHANNEL_COUNT; ++channel) {
+            // A slow sawtooth per channel, distinct enough to spot in the
+            // stored columns
+            readings[scan * SENSOR_SCAN_CHANNEL_COUNT + channel] =
+                (uint16_t)((firstScan + scan) * (channel + 1) * 16 + channel * 8000);
+        }
+    }
+
+    uint8_t frame[COLLECTOR_FRAME_SIZE_MAX];
+    size_t length = collectorFrameWrite(frame, TELEMETRY_FRAME_SAMPLES, (uint8_t)scans,
+                                        sequence, (uint32_t)benchBoardLocalUsAt(board, dueS),
+                                        readings, scans * SENSOR_SCAN_CHANNEL_COUNT *
+                                                  sizeof(uint16_t));
+    benchFrameSend(board, frame, length);
+    board->packets++;
+    board->scans += scans;
+}
+
+// TIME first, so the collector has the mapping for the STATUS frame. The
+// simulated board runs on the host clock, which makes the mapping exact and
+// the measured latency the collector's own plus the network's.
+static void benchStatusSend(benchBoard_t* board) {
+    uint8_t frame[COLLECTOR_FRAME_SIZE_MAX];
+    uint64_t localUs = benchBoardLocalUs(board);
+    int64_t wallUs = benchNowWallUs();
+    uint32_t block = board->nextBlock;
+
+    telemetryFrameTime_t time = { localUs, wallUs, 0, 2, { 0, 0, 0 } };
+    size_t length = collectorFrameWrite(frame, TELEMETRY_FRAME_TIME, 1, block,
+                                        (uint32_t)localUs, &time, sizeof(time));
+    benchFrameSend(board, frame, length);
+
+    uint8_t status[sizeof(telemetryFrameStatus_t) + SENSOR_CHANNEL_COUNT * sizeof(uint16_t)];
+    memset(status, 0, sizeof(status));
+    status[0] = board->gasDetected ? 1 : 0;
+    for (int channel = 0; channel < SENSOR_CHANNEL_COUNT; ++channel) {
+        uint16_t average = (uint16_t)(block * (channel + 1) + channel * 8000);
+        memcpy(&status[sizeof(telemetryFrameStatus_t) + channel * sizeof(average)], &average,
+               sizeof(average));
+    }
+    length = collectorFrameWrite(frame, TELEMETRY_FRAME_STATUS, 1, block, (uint32_t)localUs,
+                                 status, sizeof(status));
+    benchFrameSend(board, frame, length);
+
+    uint8_t health[SENSOR_CHANNEL_COUNT];
+    memset(health, 0, sizeof(health));
+    length = collectorFrameWrite(frame, TELEMETRY_FRAME_HEALTH, 1, block, (uint32_t)localUs,
+                                 health, sizeof(health));
+    benchFrameSend(board, frame, length);
+}
+
+// Gas detected and cleared in turn
+static void benchEventSend(benchBoard_t* board, bool mayDrop, std::mt19937* random) {
+    uint32_t sequence = board->nextEvent++;
+    board->gasDetected = !board->gasDetected;
+    std::uniform_real_distribution<double> chance(0.0, 100.0);
+    if (mayDrop && sequence != 0 && chance(*random) < options.dropPercent) {
+        board->skippedEvents++;
+        return;
+    }
+
+    uint8_t frame[COLLECTOR_FRAME_SIZE_MAX];
+    telemetryFrameAlarmEvent_t event = {
+        (uint8_t)(board->gasDetected ? ALARM_EVENT_GAS_DETECTED : ALARM_EVENT_GAS_CLEARED),
+        0, { 0, 0 } };
+    size_t length = collectorFrameWrite(frame, TELEMETRY_FRAME_ALARM_EVENT, 1, sequence,
+                                        (uint32_t)benchBoardLocalUs(board), &event,
+                                        sizeof(event));
+    benchFrameSend(board, frame, length);
+}
+
+static void benchTimeRequestSend(benchBoard_t* board, double nowS) {
+    uint8_t frame[COLLECTOR_FRAME_SIZE_MAX];
+    board->pendingLocalUs = benchBoardLocalUs(board);
+    telemetryFrameTimeRequest_t request = { board->pendingLocalUs };
+    size_t length = collectorFrameWrite(frame, TELEMETRY_FRAME_TIME_REQUEST, 1,
+                                        board->nextTimeRequest, (uint32_t)board->pendingLocalUs,
+                                        &request, sizeof(request));
+    benchFrameSend(board, frame, length);
+    board->timeRequests++;
+    board->timePending = true;
+    board->pendingS = nowS;
+}
+
+// Round trip less the collector's turnaround, as the board's clock filter
+// takes it; a response that misses the wait is given up on
+static void benchTimeResponseReceive(benchBoard_t* board, double nowS) {
+    uint8_t frame[COLLECTOR_FRAME_SIZE_MAX];
+    while (true) {
+        ssize_t length = recv(board->fd, frame, sizeof(frame), MSG_DONTWAIT);
+        if (length <= 0) {
+            break;
+        }
+        uint64_t responseLocalUs = benchBoardLocalUs(board);
+        telemetryFrameHeader_t header;
+        telemetryFrameTimeResponse_t response;
+        if (!collectorFrameCheck(frame, (size_t)length, &header) ||
+            header.type != TELEMETRY_FRAME_TIME_RESPONSE ||
+            header.sequence != board->nextTimeRequest ||
+            (size_t)length != sizeof(header) + sizeof(response) + COLLECTOR_FRAME_CRC_SIZE) {
+            continue;   // Stale or foreign
+        }
+        memcpy(&response, &frame[sizeof(header)], sizeof(response));
+        if (response.requestLocalUs != board->pendingLocalUs) {
+            continue;
+        }
+        int64_t roundTripUs = (int64_t)(responseLocalUs - response.requestLocalUs) -
+                              (response.transmitWallUs - response.receiveWallUs);
+        uint64_t delayUs = roundTripUs > 0 ? (uint64_t)roundTripUs : 0;
+        board->timeResponses++;
+        board->roundTripUsTotal += delayUs;
+        if (delayUs > board->roundTripUsMax) {
+            board->roundTripUsMax = delayUs;
+        }
+        board->timePending = false;
+        board->nextTimeRequest++;
+        return;
+    }
+    if (nowS - board->pendingS >= BENCH_TIME_WAIT_S) {
+        board->timePending = false;
+        board->nextTimeRequest++;
+    }
+}
+
+static void benchFrameSend(benchBoard_t* board, const uint8_t* frame, size_t length) {
+    if (board->serial) {
+        uint8_t encoded[FRAME_CODEC_ENCODED_SIZE(COLLECTOR_FRAME_SIZE_MAX)];
+        length = frameCodecEncode(frame, length, encoded);
+        if (write(board->fd, encoded, length) != (ssize_t)length) {
+            board->sendErrors++;
+            return;
+        }
+    } else if (send(board->fd, frame, length, 0) != (ssize_t)length) {
+        board->sendErrors++;
+        return;
+    }
+    board->bytes += length;
+}
+
+static uint64_t benchBoardLocalUs(const benchBoard_t* board) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)((int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000 +
+                      board->clockOffsetUs);
+}
+
+// Board clock at a time since the start
+static uint64_t benchBoardLocalUsAt(const benchBoard_t* board, double sinceS) {
+    return (uint64_t)((int64_t)((startS + sinceS) * 1e6) + board->clockOffsetUs);
+}
+
+static int64_t benchNowWallUs() {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static double benchNowS() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void benchSleepUntil(double untilS) {
+    struct timespec until;
+    until.tv_sec = (time_t)untilS;
+    until.tv_nsec = (long)((untilS - until.tv_sec) * 1e9);
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, nullptr);
+}
@@ -0,0 +1,892 @@
+// Receives binary telemetry from many boards at once, over UDP and serial
+// ports, and stores it as memory-mapped column files (see collector_store.h)
+// while reporting throughput, lost frames and the latency from ADC sample to
+// arrival. One thread waits on every input with epoll, answers clock
+// exchanges at once and hands raw frames in batches to decoder threads;
+// each source always goes to the same decoder, which keeps its sequence
+// checks in order without locks.
+
+//=====[Libraries]=============================================================
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <arpa/inet.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "collector_frames.h"
+#include "frame_codec.h"
+#include "net_telemetry.h"
+#include "sampler.h"
+
+//=====[Declaration of private defines]========================================
+
+#define COLLECTOR_SOURCES_MAX       4096    // Fits the u16 source columns
+#define COLLECTOR_SERIALS_MAX       64
+#define COLLECTOR_DECODERS_MAX      64
+#define COLLECTOR_CAPACITY_DEFAULT  (1ULL << 27)   // Scans, 37 hours of one board
+#define COLLECTOR_REPORT_DEFAULT_S  5
+#define COLLECTOR_SUMMARY_SOURCES   32      // Worst sources in the final table
+
+// UDP datagrams taken per recvmmsg() call, and calls per wakeup before the
+// serial ports get their turn
+#define COLLECTOR_RECEIVE_BATCH     64
+#define COLLECTOR_RECEIVE_ROUNDS    16
+#define COLLECTOR_SOCKET_BUFFER     (8 * 1024 * 1024)
+
+// Frames go to a decoder in batches of about this many bytes; a decoder that
+// falls this many batches behind loses the frames that follow
+#define COLLECTOR_BATCH_BYTES       (64 * 1024)
+#define COLLECTOR_QUEUE_BATCHES     256
+
+#define COLLECTOR_SERIAL_READ_SIZE  4096
+#define COLLECTOR_ENCODED_SIZE_MAX  FRAME_CODEC_ENCODED_SIZE(COLLECTOR_FRAME_SIZE_MAX)
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct {
+    uint16_t udpPort;           // 0 without UDP
+    const char* serialPaths[COLLECTOR_SERIALS_MAX];
+    uint32_t serialBauds[COLLECTOR_SERIALS_MAX];
+    int serialCount;
+    const char* outDirectory;
+    int decoders;
+    uint64_t capacity;
+    uint32_t seconds;           // 0 until interrupted
+    uint32_t reportS;
+    bool quiet;
+} collectorOptions_t;
+
+// One frame in a batch: raw from UDP, or COBS without its delimiter from a
+// serial port
+typedef struct {
+    uint32_t sourceId;
+    uint32_t offset;
+    uint16_t length;
+    bool encoded;
+    int64_t receiveUs;
+} collectorChunk_t;
+
+typedef struct {
+    std::vector<uint8_t> bytes;
+    std::vector<collectorChunk_t> chunks;
+} collectorBatch_t;
+
+typedef struct {
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<collectorBatch_t*> queued;   // Waiting for the decoder
+    std::vector<collectorBatch_t*> spare;   // Decoded, for reuse
+    bool stopping;
+    collectorBatch_t* filling;              // I/O thread only
+    std::thread thread;
+} collectorDecoder_t;
+
+typedef struct {
+    int fd;
+    uint32_t sourceId;
+    std::vector<uint8_t> partial;   // Frame bytes before the next delimiter
+    bool skipping;                  // Overlong frame, dropped up to its end
+} collectorSerial_t;
+
+// Totals of one report, for the rates since the previous one
+typedef struct {
+    uint64_t frames;
+    uint64_t scans;
+    uint64_t bytes;
+    uint64_t droppedBlocks;
+    uint64_t droppedEvents;
+    uint64_t reordered;
+    uint64_t crcErrors;
+    uint64_t malformed;
+    uint64_t mismatched;
+    uint64_t hostDropped;
+    uint64_t timeExchanges;
+} collectorTotals_t;
+
+//=====[Declaration and initialization of private global variables]============
+
+static collectorStore_t store;
+static collectorSource_t* sources[COLLECTOR_SOURCES_MAX];
+static std::atomic<uint32_t> sourceCount(0);
+static std::atomic<uint64_t> sourcesRefused(0);     // Past COLLECTOR_SOURCES_MAX
+static std::unordered_map<uint64_t, uint32_t> udpSources;
+static collectorDecoder_t decoders[COLLECTOR_DECODERS_MAX];
+static int decoderCount = 0;
+static uint64_t socketDropped = 0;  // UDP datagrams the kernel had no room for
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static bool collectorOptionsParse(int argc, char** argv, collectorOptions_t* options);
+static void collectorUsagePrint(const char* program);
+static int collectorUdpOpen(uint16_t port);
+static int collectorSerialOpen(const char* path, uint32_t baud);
+static speed_t collectorBaud(uint32_t baud);
+static int64_t collectorSourceAdd(const char* name);
+static int64_t collectorUdpSource(const struct sockaddr_in* address);
+static void collectorUdpReceive(int fd);
+static void collectorTimeRequestAnswer(int fd, const struct sockaddr_in* address,
+                                       const uint8_t* frame, size_t length,
+                                       int64_t receiveUs, uint32_t sourceId);
+static bool collectorSerialReceive(collectorSerial_t* serial);
+static void collectorChunkPut(uint32_t sourceId, const uint8_t* frame, size_t length,
+                              bool encoded, int64_t receiveUs);
+static void collectorBatchesFlush();
+static void collectorDecoderTask(collectorDecoder_t* decoder);
+static void collectorTotalsGet(collectorTotals_t* totals,
+                               collectorLatencySummary_t* latency);
+static void collectorReportPrint(double elapsedS, double periodS,
+                                 const collectorTotals_t* totals,
+                                 const collectorTotals_t* previous,
+                                 const collectorLatencySummary_t* latency);
+static void collectorSummaryPrint(double elapsedS);
+static bool collectorManifestWrite(const char* directory);
+static int64_t collectorNowWallUs();
+static double collectorNowS();
+
+//=====[Implementations of public functions]===================================
+
+int main(int argc, char** argv) {
+    collectorOptions_t options;
+    if (!collectorOptionsParse(argc, argv, &options)) {
+        collectorUsagePrint(argv[0]);
+        return 2;
+    }
+    if (mkdir(options.outDirectory, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "cannot create %s: %s\n", options.outDirectory, strerror(errno));
+        return 1;
+    }
+    if (!collectorStoreOpen(&store, options.outDirectory, options.capacity)) {
+        return 1;
+    }
+
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event event;
+
+    // Signals arrive through the epoll loop, so it can close the store
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    int signalFd = signalfd(-1, &signals, SFD_CLOEXEC);
+    event.events = EPOLLIN;
+    event.data.u64 = UINT64_MAX;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, signalFd, &event);
+
+    int udpFd = -1;
+    if (options.udpPort != 0) {
+        udpFd = collectorUdpOpen(options.udpPort);
+        if (udpFd < 0) {
+            return 1;
+        }
+        event.events = EPOLLIN;
+        event.data.u64 = UINT64_MAX - 1;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, udpFd, &event);
+    }
+
+    collectorSerial_t serials[COLLECTOR_SERIALS_MAX];
+    int serialsOpen = 0;
+    for (int i = 0; i < options.serialCount; ++i) {
+        char name[COLLECTOR_SOURCE_NAME_LENGTH];
+        snprintf(name, sizeof(name), "serial:%s", options.serialPaths[i]);
+        serials[i].fd = collectorSerialOpen(options.serialPaths[i], options.serialBauds[i]);
+        serials[i].skipping = false;
+        int64_t sourceId = collectorSourceAdd(name);
+        if (serials[i].fd < 0 || sourceId < 0) {
+            return 1;
+        }
+        serials[i].sourceId = (uint32_t)sourceId;
+        event.events = EPOLLIN;
+        event.data.u64 = (uint64_t)i;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, serials[i].fd, &event);
+        serialsOpen++;
+    }
+
+    decoderCount = options.decoders;
+    for (int i = 0; i < decoderCount; ++i) {
+        collectorDecoder_t* decoder = &decoders[i];
+        decoder->stopping = false;
+        decoder->filling = nullptr;
+        for (int batch = 0; batch < COLLECTOR_QUEUE_BATCHES; ++batch) {
+            decoder->spare.push_back(new collectorBatch_t);
+        }
+        decoder->thread = std::thread(collectorDecoderTask, decoder);
+    }
+
+    if (!options.quiet) {
+        printf("Collecting");
+        if (udpFd >= 0) {
+            printf(" on UDP port %u", options.udpPort);
+        }
+        printf(" from %d serial port%s into %s with %d decoder%s\n", options.serialCount,
+               options.serialCount == 1 ? "" : "s", options.outDirectory, decoderCount,
+               decoderCount == 1 ? "" : "s");
+    }
+
+    double startS = collectorNowS();
+    double nextReportS = startS + options.reportS;
+    double previousReportS = startS;
+    collectorTotals_t previous;
+    memset(&previous, 0, sizeof(previous));
+    bool running = true;
+    while (running) {
+        double nowS = collectorNowS();
+        double untilS = nextReportS - nowS;
+        if (options.seconds != 0 && startS + options.seconds - nowS < untilS) {
+            untilS = startS + options.seconds - nowS;
+        }
+        int timeoutMs = untilS > 0 ? (int)(untilS * 1000) + 1 : 0;
+
+        struct epoll_event events[COLLECTOR_SERIALS_MAX + 2];
+        int ready = epoll_wait(epollFd, events, COLLECTOR_SERIALS_MAX + 2, timeoutMs);
+        for (int i = 0; i < ready; ++i) {
+            uint64_t key = events[i].data.u64;
+            if (key == UINT64_MAX) {
+                running = false;
+            } else if (key == UINT64_MAX - 1) {
+                collectorUdpReceive(udpFd);
+            } else if (!collectorSerialReceive(&serials[key])) {
+                // The port went away, or a FIFO lost its writer
+                epoll_ctl(epollFd, EPOLL_CTL_DEL, serials[key].fd, nullptr);
+                close(serials[key].fd);
+                serialsOpen--;
+                if (!options.quiet) {
+                    printf("%s closed\n", sources[serials[key].sourceId]->name);
+                }
+            }
+        }
+        collectorBatchesFlush();
+
+        nowS = collectorNowS();
+        if (nowS >= nextReportS) {
+            collectorTotals_t totals;
+            collectorLatencySummary_t latency;
+            collectorTotalsGet(&totals, &latency);
+            if (!options.quiet) {
+                collectorReportPrint(nowS - startS, nowS - previousReportS, &totals, &previous,
+                                     &latency);
+            }
+            previous = totals;
+            previousReportS = nowS;
+            nextReportS += options.reportS;
+        }
+        if ((options.seconds != 0 && nowS >= startS + options.seconds) ||
+            (udpFd < 0 && serialsOpen == 0)) {
+            running = false;
+        }
+    }
+
+    for (int i = 0; i < decoderCount; ++i) {
+        {
+            std::lock_guard<std::mutex> lock(decoders[i].mutex);
+            decoders[i].stopping = true;
+        }
+        decoders[i].ready.notify_one();
+        decoders[i].thread.join();
+    }
+
+    collectorSummaryPrint(collectorNowS() - startS);
+    bool written = collectorManifestWrite(options.outDirectory);
+    return written ? 0 : 1;
+}
+
+//=====[Implementations of private functions]==================================
+
+static bool collectorOptionsParse(int argc, char** argv, collectorOptions_t* options) {
+    unsigned cores = std::thread::hardware_concurrency();
+    options->udpPort = NET_TELEMETRY_PORT;
+    options->serialCount = 0;
+    options->outDirectory = "telemetry";
+    options->decoders = cores > 2 ? (int)std::min(cores - 1, 8u) : 1;
+    options->capacity = COLLECTOR_CAPACITY_DEFAULT;
+    options->seconds = 0;
+    options->reportS = COLLECTOR_REPORT_DEFAULT_S;
+    options->quiet = false;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (strcmp(argv[i], "--udp") == 0 && value != nullptr) {
+            long port = strtol(value, nullptr, 10);
+            if (port < 0 || port > 65535) {
+                return false;
+            }
+            options->udpPort = (uint16_t)port;
+            i++;
+        } else if (strcmp(argv[i], "--serial") == 0 && value != nullptr) {
+            if (options->serialCount == COLLECTOR_SERIALS_MAX) {
+                return false;
+            }
+            // PATH or PATH@BAUD; the monitor runs its console at 115200
+            char* at = strrchr(argv[i + 1], '@');
+            uint32_t baud = 115200;
+            if (at != nullptr) {
+                *at = '\0';
+                baud = (uint32_t)strtoul(at + 1, nullptr, 10);
+            }
+            if (collectorBaud(baud) == 0) {
+                return false;
+            }
+            options->serialPaths[options->serialCount] = argv[i + 1];
+            options->serialBauds[options->serialCount] = baud;
+            options->serialCount++;
+            i++;
+        } else if (strcmp(argv[i], "--out") == 0 && value != nullptr) {
+            options->outDirectory = argv[++i];
+        } else if (strcmp(argv[i], "--decoders") == 0 && value != nullptr) {
+            options->decoders = atoi(argv[++i]);
+            if (options->decoders < 1 || options->decoders > COLLECTOR_DECODERS_MAX) {
+                return false;
+            }
+        } else if (strcmp(argv[i], "--capacity") == 0 && value != nullptr) {
+            options->capacity = strtoull(argv[++i], nullptr, 10);
+            if (options->capacity < SAMPLER_SCANS_PER_HALF) {
+                return false;
+            }
+        } else if (strcmp(argv[i], "--seconds") == 0 && value != nullptr) {
+            options->seconds = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--report") == 0 && value != nullptr) {
+            options->reportS = (uint32_t)strtoul(argv[++i], nullptr, 10);
+            if (options->reportS == 0) {
+                return false;
+            }
+        } else if (strcmp(argv[i], "--quiet") == 0) {
+            options->quiet = true;
+        } else {
+            return false;
+        }
+    }
+    return options->udpPort != 0 || options->serialCount > 0;
+}
+
+static void collectorUsagePrint(const char* program) {
+    fprintf(stderr,
+            "usage: %s [--udp PORT] [--serial PATH[@BAUD]]... [--out DIR]\n"
+            "          [--decoders N] [--capacity SCANS] [--seconds N] [--report S] [--quiet]\n"
+            "  --udp       port the boards send to, %u by default, 0 for none\n"
+            "  --serial    port of a board in binary telemetry mode, 115200 baud by default;\n"
+            "              repeat for more boards\n"
+            "  --out       directory of the column files and manifest.txt, ./telemetry\n"
+            "  --capacity  scans the samples table holds, %llu by default\n"
+            "  --seconds   stop after this long instead of at Ctrl-C\n",
+            program, NET_TELEMETRY_PORT, (unsigned long long)COLLECTOR_CAPACITY_DEFAULT);
+}
+
+static int collectorUdpOpen(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        fprintf(stderr, "cannot open a UDP socket: %s\n", strerror(errno));
+        return -1;
+    }
+    // Room for bursts while the loop is busy; the kernel may cap it at
+    // net.core.rmem_max, and SO_RXQ_OVFL reports what still overflows
+    int size = COLLECTOR_SOCKET_BUFFER;
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+        fprintf(stderr, "cannot bind UDP port %u: %s\n", port, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Raw mode for a real port; FIFOs and recorded streams are read as they are
+static int collectorSerialOpen(const char* path, uint32_t baud) {
+    int fd = open(path, O_RDONLY | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        fprintf(stderr, "cannot open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    if (isatty(fd)) {
+        struct termios settings;
+        if (tcgetattr(fd, &settings) != 0) {
+            fprintf(stderr, "cannot configure %s: %s\n", path, strerror(errno));
+            close(fd);
+            return -1;
+        }
+        cfmakeraw(&settings);
+        cfsetispeed(&settings, collectorBaud(baud));
+        cfsetospeed(&settings, collectorBaud(baud));
+        settings.c_cflag |= CLOCAL | CREAD;
+        if (tcsetattr(fd, TCSANOW, &settings) != 0) {
+            fprintf(stderr, "cannot configure %s: %s\n", path, strerror(errno));
+            close(fd);
+            return -1;
+        }
+        tcflush(fd, TCIFLUSH);
+    }
+    return fd;
+}
+
+static speed_t collectorBaud(uint32_t baud) {
+    switch (baud) {
+    case 9600:
+        return B9600;
+    case 19200:
+        return B19200;
+    case 38400:
+        return B38400;
+    case 57600:
+        return B57600;
+    case 115200:
+        return B115200;
+    case 230400:
+        return B230400;
+    case 460800:
+        return B460800;
+    case 921600:
+        return B921600;
+    }
+    return 0;
+}
+
+// Called by the I/O thread only. A decoder sees the source once the I/O
+// thread hands it a frame, after the source is complete.
+static int64_t collectorSourceAdd(const char* name) {
+    uint32_t id = sourceCount.load(std::memory_order_relaxed);
+    if (id == COLLECTOR_SOURCES_MAX) {
+        sourcesRefused.fetch_add(1, std::memory_order_relaxed);
+        return -1;
+    }
+    collectorSource_t* source = new collectorSource_t;
+    collectorSourceInit(source, name);
+    sources[id] = source;
+    sourceCount.store(id + 1, std::memory_order_release);
+    return id;
+}
+
+// A board keeps its address and port until it restarts, so each pair is
+// one source; a restarted board comes back as a new one
+static int64_t collectorUdpSource(const struct sockaddr_in* address) {
+    uint64_t key = ((uint64_t)address->sin_addr.s_addr << 16) | address->sin_port;
+    auto found = udpSources.find(key);
+    if (found != udpSources.end()) {
+        return found->second;
+    }
+    char ip[INET_ADDRSTRLEN];
+    char name[COLLECTOR_SOURCE_NAME_LENGTH];
+    inet_ntop(AF_INET, &address->sin_addr, ip, sizeof(ip));
+    snprintf(name, sizeof(name), "udp:%s:%u", ip, ntohs(address->sin_port));
+    int64_t id = collectorSourceAdd(name);
+    if (id >= 0) {
+        udpSources[key] = (uint32_t)id;
+    }
+    return id;
+}
+
+// Drains the socket in batches; the arrival time is read once per batch,
+// right after it is taken
+static void collectorUdpReceive(int fd) {
+    static uint8_t buffers[COLLECTOR_RECEIVE_BATCH][COLLECTOR_FRAME_SIZE_MAX];
+    static uint8_t controls[COLLECTOR_RECEIVE_BATCH][CMSG_SPACE(sizeof(uint32_t))];
+    static struct sockaddr_in addresses[COLLECTOR_RECEIVE_BATCH];
+    static struct iovec vectors[COLLECTOR_RECEIVE_BATCH];
+    static struct mmsghdr messages[COLLECTOR_RECEIVE_BATCH];
+    static uint32_t overflowSeen = 0;
+
+    for (int round = 0; round < COLLECTOR_RECEIVE_ROUNDS; ++round) {
+        for (int i = 0; i < COLLECTOR_RECEIVE_BATCH; ++i) {
+            vectors[i].iov_base = buffers[i];
+            vectors[i].iov_len = sizeof(buffers[i]);
+            memset(&messages[i].msg_hdr, 0, sizeof(messages[i].msg_hdr));
+            messages[i].msg_hdr.msg_name = &addresses[i];
+            messages[i].msg_hdr.msg_namelen = sizeof(addresses[i]);
+            messages[i].msg_hdr.msg_iov = &vectors[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+            messages[i].msg_hdr.msg_control = controls[i];
+            messages[i].msg_hdr.msg_controllen = sizeof(controls[i]);
+        }
+        int received = recvmmsg(fd, messages, COLLECTOR_RECEIVE_BATCH, MSG_DONTWAIT, nullptr);
+        if (received <= 0) {
+            return;
+        }
+        int64_t receiveUs = collectorNowWallUs();
+
+        for (int i = 0; i < received; ++i) {
+            struct msghdr* header = &messages[i].msg_hdr;
+            for (struct cmsghdr* control = CMSG_FIRSTHDR(header); control != nullptr;
+                 control = CMSG_NXTHDR(header, control)) {
+                if (control->cmsg_level == SOL_SOCKET && control->cmsg_type == SO_RXQ_OVFL) {
+                    uint32_t overflow;
+                    memcpy(&overflow, CMSG_DATA(control), sizeof(overflow));
+                    socketDropped += overflow - overflowSeen;
+                    overflowSeen = overflow;
+                }
+            }
+
+            int64_t sourceId = collectorUdpSource(&addresses[i]);
+            if (sourceId < 0) {
+                continue;
+            }
+            size_t length = messages[i].msg_len;
+            if ((header->msg_flags & MSG_TRUNC) != 0) {
+                sources[sourceId]->counters.malformed.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            sources[sourceId]->counters.bytes.fetch_add(length, std::memory_order_relaxed);
+            if (length > sizeof(telemetryFrameHeader_t) &&
+                buffers[i][0] == TELEMETRY_FRAME_TIME_REQUEST) {
+                collectorTimeRequestAnswer(fd, &addresses[i], buffers[i], length, receiveUs,
+                                           (uint32_t)sourceId);
+            } else {
+                collectorChunkPut((uint32_t)sourceId, buffers[i], length, false, receiveUs);
+            }
+        }
+        if (received < COLLECTOR_RECEIVE_BATCH) {
+            return;
+        }
+    }
+}
+
+// The board measures the round trip less the time between the two stamps,
+// so the transmit stamp is taken as late as possible
+static void collectorTimeRequestAnswer(int fd, const struct sockaddr_in* address,
+                                       const uint8_t* frame, size_t length,
+                                       int64_t receiveUs, uint32_t sourceId) {
+    collectorCounters_t* counters = &sources[sourceId]->counters;
+    telemetryFrameHeader_t header;
+    telemetryFrameTimeResponse_t response;
+    if (!collectorFrameCheck(frame, length, &header) ||
+        length != sizeof(header) + sizeof(telemetryFrameTimeRequest_t) +
+                  COLLECTOR_FRAME_CRC_SIZE) {
+        counters->malformed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    counters->frames.fetch_add(1, std::memory_order_relaxed);
+    memcpy(&response.requestLocalUs, &frame[sizeof(header)], sizeof(response.requestLocalUs));
+    response.receiveWallUs = receiveUs;
+
+    uint8_t datagram[COLLECTOR_FRAME_SIZE_MAX];
+    response.transmitWallUs = collectorNowWallUs();
+    size_t responseLength = collectorFrameWrite(datagram, TELEMETRY_FRAME_TIME_RESPONSE, 1,
+                                                header.sequence, 0, &response,
+                                                sizeof(response));
+    if (sendto(fd, datagram, responseLength, MSG_DONTWAIT, (const struct sockaddr*)address,
+               sizeof(*address)) == (ssize_t)responseLength) {
+        counters->timeExchanges.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// Splits the stream at frame delimiters; false once the port is gone
+static bool collectorSerialReceive(collectorSerial_t* serial) {
+    uint8_t buffer[COLLECTOR_SERIAL_READ_SIZE];
+    collectorCounters_t* counters = &sources[serial->sourceId]->counters;
+
+    while (true) {
+        ssize_t length = read(serial->fd, buffer, sizeof(buffer));
+        if (length < 0) {
+            return errno == EAGAIN || errno == EINTR;
+        }
+        if (length == 0) {
+            return false;
+        }
+        int64_t receiveUs = collectorNowWallUs();
+        counters->bytes.fetch_add((uint64_t)length, std::memory_order_relaxed);
+
+        const uint8_t* start = buffer;
+        const uint8_t* end = buffer + length;
+        while (start < end) {
+            const uint8_t* delimiter = (const uint8_t*)memchr(start, FRAME_CODEC_DELIMITER,
+                                                              end - start);
+            const uint8_t* stop = delimiter != nullptr ? delimiter : end;
+            if (!serial->skipping) {
+                serial->partial.insert(serial->partial.end(), start, stop);
+                if (serial->partial.size() > COLLECTOR_ENCODED_SIZE_MAX) {
+                    // Text output, or noise; counted once its end comes
+                    serial->partial.clear();
+                    serial->skipping = true;
+                }
+            }
+            if (delimiter == nullptr) {
+                break;
+            }
+            if (serial->skipping) {
+                counters->malformed.fetch_add(1, std::memory_order_relaxed);
+            } else if (!serial->partial.empty()) {
+                collectorChunkPut(serial->sourceId, serial->partial.data(),
+                                  serial->partial.size(), true, receiveUs);
+            }
+            serial->partial.clear();
+            serial->skipping = false;
+            start = delimiter + 1;
+        }
+    }
+}
+
+// Appends a frame to the batch of the source's decoder. With every batch of
+// that decoder queued, the frame is lost and counted.
+static void collectorChunkPut(uint32_t sourceId, const uint8_t* frame, size_t length,
+                              bool encoded, int64_t receiveUs) {
+    collectorDecoder_t* decoder = &decoders[sourceId % decoderCount];
+    if (decoder->filling == nullptr) {
+        std::lock_guard<std::mutex> lock(decoder->mutex);
+        if (!decoder->spare.empty()) {
+            decoder->filling = decoder->spare.back();
+            decoder->spare.pop_back();
+        }
+    }
+    if (decoder->filling == nullptr) {
+        sources[sourceId]->counters.hostDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    collectorBatch_t* batch = decoder->filling;
+    collectorChunk_t chunk = { sourceId, (uint32_t)batch->bytes.size(), (uint16_t)length,
+                               encoded, receiveUs };
+    batch->bytes.insert(batch->bytes.end(), frame, frame + length);
+    batch->chunks.push_back(chunk);
+    if (batch->bytes.size() >= COLLECTOR_BATCH_BYTES) {
+        {
+            std::lock_guard<std::mutex> lock(decoder->mutex);
+            decoder->queued.push_back(batch);
+        }
+        decoder->ready.notify_one();
+        decoder->filling = nullptr;
+    }
+}
+
+// Hands over what each decoder has so far, so quiet periods add no latency
+static void collectorBatchesFlush() {
+    for (int i = 0; i < decoderCount; ++i) {
+        collectorDecoder_t* decoder = &decoders[i];
+        if (decoder->filling == nullptr || decoder->filling->chunks.empty()) {
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(decoder->mutex);
+            decoder->queued.push_back(decoder->filling);
+        }
+        decoder->ready.notify_one();
+        decoder->filling = nullptr;
+    }
+}
+
+static void collectorDecoderTask(collectorDecoder_t* decoder) {
+    uint8_t frame[COLLECTOR_ENCODED_SIZE_MAX];
+
+    while (true) {
+        collectorBatch_t* batch;
+        {
+            std::unique_lock<std::mutex> lock(decoder->mutex);
+            decoder->ready.wait(lock, [decoder] {
+                return !decoder->queued.empty() || decoder->stopping;
+            });
+            if (decoder->queued.empty()) {
+                return;
+            }
+            batch = decoder->queued.front();
+            decoder->queued.pop_front();
+        }
+
+        for (const collectorChunk_t& chunk : batch->chunks) {
+            collectorSource_t* source = sources[chunk.sourceId];
+            const uint8_t* bytes = &batch->bytes[chunk.offset];
+            size_t length = chunk.length;
+            if (chunk.encoded) {
+                length = frameCodecDecode(bytes, length, frame);
+                if (length == 0) {
+                    source->counters.malformed.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                bytes = frame;
+            }
+            collectorFrameDecode(&store, source, (uint16_t)chunk.sourceId, bytes, length,
+                                 chunk.receiveUs);
+        }
+
+        batch->bytes.clear();
+        batch->chunks.clear();
+        std::lock_guard<std::mutex> lock(decoder->mutex);
+        decoder->spare.push_back(batch);
+    }
+}
+
+static void collectorTotalsGet(collectorTotals_t* totals,
+                               collectorLatencySummary_t* latency) {
+    memset(totals, 0, sizeof(*totals));
+    collectorLatencySummaryClear(latency);
+    uint32_t count = sourceCount.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < count; ++i) {
+        const collectorCounters_t* counters = &sources[i]->counters;
+        totals->frames += counters->frames.load(std::memory_order_relaxed);
+        totals->scans += counters->scans.load(std::memory_order_relaxed);
+        totals->bytes += counters->bytes.load(std::memory_order_relaxed);
+        totals->droppedBlocks += counters->droppedBlocks.load(std::memory_order_relaxed);
+        totals->droppedEvents += counters->droppedEvents.load(std::memory_order_relaxed);
+        totals->reordered += counters->reordered.load(std::memory_order_relaxed);
+        totals->crcErrors += counters->crcErrors.load(std::memory_order_relaxed);
+        totals->malformed += counters->malformed.load(std::memory_order_relaxed);
+        totals->mismatched += counters->mismatched.load(std::memory_order_relaxed);
+        totals->hostDropped += counters->hostDropped.load(std::memory_order_relaxed);
+        totals->timeExchanges += counters->timeExchanges.load(std::memory_order_relaxed);
+        collectorLatencySummaryAdd(latency, &sources[i]->latency);
+    }
+}
+
+// Rates over the last period, losses and latency since the start
+static void collectorReportPrint(double elapsedS, double periodS,
+                                 const collectorTotals_t* totals,
+                                 const collectorTotals_t* previous,
+                                 const collectorLatencySummary_t* latency) {
+    printf("%7.1f s: %u sources, %.0f frames/s, %.0f scans/s, %.2f MB/s, "
+           "dropped %llu blocks and %llu events, %llu in the collector, %llu in the socket, "
+           "%llu CRC errors",
+           elapsedS, sourceCount.load(std::memory_order_relaxed),
+           (totals->frames - previous->frames) / periodS,
+           (totals->scans - previous->scans) / periodS,
+           (totals->bytes - previous->bytes) / periodS / 1e6,
+           (unsigned long long)totals->droppedBlocks,
+           (unsigned long long)totals->droppedEvents,
+           (unsigned long long)totals->hostDropped, (unsigned long long)socketDropped,
+           (unsigned long long)totals->crcErrors);
+    if (latency->total > 0) {
+        printf(", latency p50 %.2f p99 %.2f max %.2f ms",
+               collectorLatencyPercentileUs(latency, 500) / 1000.0,
+               collectorLatencyPercentileUs(latency, 990) / 1000.0, latency->maxUs / 1000.0);
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+// Totals, then the sources with the most losses
+static void collectorSummaryPrint(double elapsedS) {
+    collectorTotals_t totals;
+    collectorLatencySummary_t latency;
+    collectorTotalsGet(&totals, &latency);
+    uint32_t count = sourceCount.load(std::memory_order_acquire);
+
+    printf("%u sources in %.1f s: %llu frames, %llu scans, %llu MB\n", count, elapsedS,
+           (unsigned long long)totals.frames, (unsigned long long)totals.scans,
+           (unsigned long long)(totals.bytes / 1000000));
+    printf("dropped: %llu blocks, %llu events, %llu frames in the collector, "
+           "%llu datagrams in the socket\n",
+           (unsigned long long)totals.droppedBlocks, (unsigned long long)totals.droppedEvents,
+           (unsigned long long)totals.hostDropped, (unsigned long long)socketDropped);
+    printf("rejected: %llu CRC errors, %llu malformed, %llu of another channel layout, "
+           "%llu reordered, %llu sources past the limit\n",
+           (unsigned long long)totals.crcErrors, (unsigned long long)totals.malformed,
+           (unsigned long long)totals.mismatched, (unsigned long long)totals.reordered,
+           (unsigned long long)sourcesRefused.load(std::memory_order_relaxed));
+    printf("stored: %llu scans, %llu status and %llu event rows, %llu rows past capacity\n",
+           (unsigned long long)collectorTableRows(&store.samples),
+           (unsigned long long)collectorTableRows(&store.status),
+           (unsigned long long)collectorTableRows(&store.events),
+           (unsigned long long)(store.samples.rejected + store.status.rejected +
+                                store.events.rejected));
+    printf("clock exchanges answered: %llu\n", (unsigned long long)totals.timeExchanges);
+    if (latency.total > 0) {
+        printf("latency from sample to collector: p50 %.2f ms, p99 %.2f ms, "
+               "p99.9 %.2f ms, max %.2f ms over %llu frames",
+               collectorLatencyPercentileUs(&latency, 500) / 1000.0,
+               collectorLatencyPercentileUs(&latency, 990) / 1000.0,
+               collectorLatencyPercentileUs(&latency, 999) / 1000.0, latency.maxUs / 1000.0,
+               (unsigned long long)latency.total);
+        if (latency.early > 0) {
+            printf(", %llu before their sample time", (unsigned long long)latency.early);
+        }
+        printf("\n");
+    } else {
+        printf("latency from sample to collector: no board wall clock seen\n");
+    }
+    if (count == 0) {
+        return;
+    }
+
+    std::vector<uint32_t> order;
+    for (uint32_t i = 0; i < count; ++i) {
+        order.push_back(i);
+    }
+    auto losses = [](uint32_t id) {
+        const collectorCounters_t* counters = &sources[id]->counters;
+        return counters->droppedBlocks + counters->droppedEvents + counters->hostDropped +
+               counters->crcErrors + counters->malformed;
+    };
+    std::stable_sort(order.begin(), order.end(), [&losses](uint32_t a, uint32_t b) {
+        return losses(a) > losses(b);
+    });
+    if (count > COLLECTOR_SUMMARY_SOURCES) {
+        order.resize(COLLECTOR_SUMMARY_SOURCES);
+        printf("the %d sources with the most losses:\n", COLLECTOR_SUMMARY_SOURCES);
+    }
+    printf("%-5s %-28s %10s %12s %8s %7s %7s %6s %6s %9s %9s\n", "id", "source", "frames",
+           "scans", "blocks", "events", "host", "crc", "bad", "p99 ms", "max ms");
+    for (uint32_t id : order) {
+        const collectorSource_t* source = sources[id];
+        collectorLatencySummary_t sourceLatency;
+        collectorLatencySummaryClear(&sourceLatency);
+        collectorLatencySummaryAdd(&sourceLatency, &source->latency);
+        printf("%-5u %-28s %10llu %12llu %8llu %7llu %7llu %6llu %6llu %9.2f %9.2f\n", id,
+               source->name, (unsigned long long)source->counters.frames,
+               (unsigned long long)source->counters.scans,
+               (unsigned long long)source->counters.droppedBlocks,
+               (unsigned long long)source->counters.droppedEvents,
+               (unsigned long long)source->counters.hostDropped,
+               (unsigned long long)source->counters.crcErrors,
+               (unsigned long long)source->counters.malformed,
+               collectorLatencyPercentileUs(&sourceLatency, 990) / 1000.0,
+               sourceLatency.maxUs / 1000.0);
+    }
+}
+
+// The column layout and what the source ids stand for, written once the
+// files have their final length
+static bool collectorManifestWrite(const char* directory) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/manifest.txt", directory);
+    FILE* manifest = fopen(path, "w");
+    if (manifest == nullptr) {
+        fprintf(stderr, "cannot write %s: %s\n", path, strerror(errno));
+        collectorStoreClose(&store, nullptr);
+        return false;
+    }
+    fprintf(manifest,
+            "# Each column is a little-endian array of the table's rows in\n"
+            "# <table>.<column>.<type>; readings use the 0 to 65535 scale of the\n"
+            "# sampler, times are Unix microseconds, wall_us 0 where the board's\n"
+            "# clock was not set\n"
+            "version %d\n", TELEMETRY_FRAME_VERSION);
+    collectorStoreClose(&store, manifest);
+    uint32_t count = sourceCount.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < count; ++i) {
+        fprintf(manifest, "source %u %s\n", i, sources[i]->name);
+    }
+    return fclose(manifest) == 0;
+}
+
+static int64_t collectorNowWallUs() {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static double collectorNowS() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
@@ -1,276 +1,469 @@
 #include "mbed.h"
 
-// Define the PWM pin (D15 = PB_8 on NUCLEO-F439ZI, CN9 Pin 15)
-PwmOut buzzer(D9);
+#include "sampler.h"
+#include "alarm.h"
+#include "capture.h"
+#include "command_line.h"
+#include "config.h"
+#include "data_log.h"
+#include "diagnostics.h"
+#include "firmware_update.h"
+#include "instrumentation.h"
+#include "memory_plan.h"
+#include "net_telemetry.h"
+#include "number_format.h"
+#include "pc_serial_com.h"
+#include "power.h"
+#include "sensor_units.h"
+#include "spi_adc.h"
+#include "supervisor.h"
+#include "telemetry.h"
+#include "wall_clock.h"
+
+// Gas sensor (A3), LM35 (A1) and potentiometer (A0) are scanned by the sampler;
+// builds with SENSOR_SPI_GAS_HEADS add gas heads on an MCP3208 on SPI3
+
+// Buzzer (D9) and LED (LED1) play the alarm thread's annunciator patterns
+
+// Threads, highest priority first:
+//  - alarm evaluator (osPriorityRealtime, alarm module)
+//  - sampler (osPriorityHigh, sampler module)
+//  - SPI ADC reader (osPriorityAboveNormal, spi_adc module), with gas heads
+//  - command console (osPriorityNormal, this main thread)
+//  - telemetry formatter (osPriorityBelowNormal, telemetry module)
+//  - network telemetry (osPriorityBelowNormal, net_telemetry module)
+//  - flash data log (osPriorityLow, data_log module)
+//  - sensor diagnostics (osPriorityLow, diagnostics module)
+//  - firmware update flash writer (osPriorityLow, firmware_update module)
+// They share readings through the sampler snapshot and alarm events, never
+// through global variables.
+// Their stacks sit in CCM RAM as laid out by the memory_plan module; nothing
+// is allocated from the heap once main() has started them all.
+// The supervisor module resets the board through the hardware watchdog when
+// the sampler, alarm or console thread stops checking in.
+
+// Streaming modes; several can print at once, each at its own period
+typedef enum {
+    STREAM_POTENTIOMETER,        // stream potentiometer
+    STREAM_LM35,                 // stream lm35 raw
+    STREAM_LM35_CELSIUS,         // stream lm35 c
+    STREAM_LM35_FAHRENHEIT,      // stream lm35 f
+    STREAM_BOTH_CELSIUS,         // stream both c
+    STREAM_BOTH_FAHRENHEIT,      // stream both f
+    STREAM_COUNT,
+} stream_t;
+
+typedef struct {
+    bool active;
+    uint32_t periodMs;
+    uint64_t nextPrintMs;
+} streamState_t;
+
+#define CONSOLE_UPDATE_PERIOD_MS    10
+#define CONSOLE_UPDATE_PERIOD_LOW_MS 250  // Fewer wake-ups in low-power mode
+#define STREAM_PERIOD_DEFAULT_MS    200
+#define STREAM_PERIOD_MIN_MS        50
+#define STREAM_PERIOD_MAX_MS        5000
 
-// Gas sensor input pin (A3)
-AnalogIn gasSensor(A3);
+// Global variables
+streamState_t streams[STREAM_COUNT];
 
-// LM35 temperature sensor input pin (A1)
-AnalogIn lm35(A1);  // 
+// Function prototypes
+bool helpCommand(int argc, char** argv);
+bool streamCommand(int argc, char** argv);
+bool stopCommand(int argc, char** argv);
+bool powerCommand(int argc, char** argv);
+bool telemetryCommand(int argc, char** argv);
+bool captureCommand(int argc, char** argv);
+bool logCommand(int argc, char** argv);
+bool netCommand(int argc, char** argv);
+bool statsCommand(int argc, char** argv);
+bool tasksCommand(int argc, char** argv);
+bool trendCommand(int argc, char** argv);
+bool memoryCommand(int argc, char** argv);
+bool healthCommand(int argc, char** argv);
+bool periodParse(const char* text, uint32_t* periodMs);
+void streamStart(stream_t stream, uint32_t periodMs);
+void streamPeriodSet(stream_t stream, uint32_t periodMs);
+void streamsStop();
+void streamsUpdate();
+void streamLinePrint(stream_t stream, const samplerSnapshot_t* snapshot);
+
+// Console commands, in the order help lists them
+const commandLineCommand_t commands[] = {
+    { "help", "", "list the commands", helpCommand },
+    { "stream", "potentiometer|lm35|both [raw|c|f] [period]",
+      "print readings every period (such as 50ms or 2s, default 200ms)", streamCommand },
+    { "stop", "", "stop all streams, as Ctrl-C does", stopCommand },
+    { "power", "[low|adaptive|full]", "switch power mode (the user button also leaves "
+      "low power), or show time and estimated current draw per sampling mode",
+      powerCommand },
+    { "telemetry", "text|binary", "switch between status lines and binary frames "
+      "of raw samples", telemetryCommand },
+    { "capture", "", "dump the raw scans captured around the last alarm, in binary",
+      captureCommand },
+    { "log", "", "dump the readings logged to flash, in binary", logCommand },
+    { "net", "", "network telemetry link and packet counts", netCommand },
+    { "stats", "[reset]", "timing of each processing stage", statsCommand },
+    { "tasks", "", "watchdog heartbeats and missed deadlines of each thread",
+      tasksCommand },
+    { "trend", "", "mean, deviation, slope and time to trip of each alarm channel",
+      trendCommand },
+    { "memory", "", "CCM RAM layout, peak stack use of each thread and heap use",
+      memoryCommand },
+    { "health", "", "sensor faults the diagnostics flag on each channel",
+      healthCommand },
+    { "time", "[set <unix seconds>]", "show the wall clock and its synchronization, "
+      "or set it where there is no collector", wallClockCommand },
+    { "config", "[save|defaults]", "show, store or reset the settings", configCommand },
+    { "set", "<channel>.<field>|status|burst <value>",
+      "change a setting at once, such as 'set gas.threshold 0.45'", configSetCommand },
+    { "calibrate", "[<channel> <known value>|<channel> clear]",
+      "show the supply and calibration, or add a point at what the channel reads now",
+      configCalibrateCommand },
+    { "update", "[begin <size> <crc32>|data <hex>|finish|apply]",
+      "stage a firmware image in flash bank 2; apply installs it", firmwareUpdateCommand },
+};
+
+// The benchmark firmware (benchmark/benchmark.cpp) has its own main()
+#ifndef BENCHMARK_BUILD
+int main() {
+    instrumentationInit(); // Start the cycle counter before anything is timed
+    pcSerialComInit();    // Start the buffered serial terminal output
+    configInit();         // Load the stored settings before anything uses them
+    wallClockInit();      // Resume the wall clock from the RTC
+    samplerInit();        // Start continuous DMA sampling of all sensors
+    captureInit();        // Record raw scans for the pre-trigger window
+    alarmInit();          // Start the interrupt-driven alarm thread
+    firmwareUpdateBootReadyMark(); // Sampling and alarms are live: boot is done
+    diagnosticsInit();    // Check the sensors behind the alarms in the background
+    telemetryInit();      // Start the periodic status printing thread
+    dataLogInit();        // Resume the flash log after the newest page
+    firmwareUpdateInit(); // Accept firmware images into flash bank 2
+    netTelemetryInit();   // Bring up Ethernet and stream UDP datagrams
+    powerInit();          // Start in full power mode
+    supervisorInit();     // Reset the board if a thread stalls from here on
+    memoryPlanInit();     // Heap use from here on is reported as growth
+
+    for (int i = 0; i < STREAM_COUNT; ++i) {
+        streams[i].active = false;
+        streams[i].periodMs = STREAM_PERIOD_DEFAULT_MS;
+        streams[i].nextPrintMs = 0;
+    }
 
-// Potentiometer input pin (A0)
-AnalogIn potentiometer(A0);
+    if (supervisorWatchdogReset()) {
+        pcSerialComStringWrite("Restarted by the watchdog\r\n");
+    }
+    commandLineHelpWrite();
+    commandLineInit(commands, sizeof(commands) / sizeof(commands[0]), streamsStop);
 
-// Define the LED for debugging
-DigitalOut led(LED1);  // Onboard LED (LD2)
+    // Cycles start at fixed intervals, however long the previous one took
+    uint64_t cycleDeadlineMs = Kernel::get_ms_count();
+    while (true) {
+        INSTRUMENTATION_BEGIN(INSTRUMENTATION_STAGE_CONSOLE);
+        commandLineUpdate(); // Run the commands typed since the last cycle
+        INSTRUMENTATION_END(INSTRUMENTATION_STAGE_CONSOLE);
+        INSTRUMENTATION_BEGIN(INSTRUMENTATION_STAGE_STREAMS);
+        streamsUpdate(); // Print the streams that are due
+        INSTRUMENTATION_END(INSTRUMENTATION_STAGE_STREAMS);
+        powerUpdate();   // Leave low-power mode on a button press
+        supervisorCheckIn(SUPERVISOR_TASK_CONSOLE);
+        supervisorPeriodWait(SUPERVISOR_TASK_CONSOLE, &cycleDeadlineMs,
+                             powerModeGet() != POWER_MODE_FULL
+                             ? CONSOLE_UPDATE_PERIOD_LOW_MS : CONSOLE_UPDATE_PERIOD_MS);
+    }
+}
+#endif
 
-// Serial communication setup (for UART)
-UnbufferedSerial uartUsb(USBTX, USBRX, 115200);
+bool helpCommand(int argc, char** argv) {
+    commandLineHelpWrite();
+    return true;
+}
 
-// Global variables
-float lm35Reading = 0.0;
-float lm35TempC = 0.0;
-float lm35TempF = 0.0;
-float potentiometerReading = 0.0;
-float potentiometerScaledToC = 0.0;
-float potentiometerScaledToF = 0.0;
-bool gasDetected = false;
-bool tempExceeded = false;
+// "stream lm35 f 2s": the unit defaults to Celsius, the period to the last
+// one used by the stream
+bool streamCommand(int argc, char** argv) {
+    if (argc < 2 || argc > 4) {
+        return false;
+    }
 
-// Function prototypes
-void pcSerialComStringWrite(const char* str);
-char pcSerialComCharRead();
-float analogReadingScaledWithTheLM35Formula(float analogReading);
-float celsiusToFahrenheit(float tempInCelsiusDegrees);
-float potentiometerScaledToCelsius(float analogValue);
-float potentiometerScaledToFahrenheit(float analogValue);
-void availableCommands();
-void uartTask();
-void checkSensors();
-float readStableAnalog(AnalogIn &sensor);
+    bool potentiometer = commandLineMatch(argv[1], "potentiometer");
+    bool lm35 = commandLineMatch(argv[1], "lm35");
+    bool both = commandLineMatch(argv[1], "both");
+    if (!potentiometer && !lm35 && !both) {
+        return false;
+    }
 
-int main() {
-    buzzer.period_ms(2);  // 500 Hz (period = 1/500 = 0.002 seconds = 2 ms)
-    buzzer.write(0.0f);   // Start with the buzzer off
+    bool raw = potentiometer;
+    bool fahrenheit = false;
+    uint32_t periodMs = 0;
+    for (int i = 2; i < argc; ++i) {
+        if (commandLineMatch(argv[i], "raw") && !both) {
+            raw = true;
+        } else if (commandLineMatch(argv[i], "c") && !potentiometer) {
+            fahrenheit = false;
+        } else if (commandLineMatch(argv[i], "f") && !potentiometer) {
+            fahrenheit = true;
+        } else if (!periodParse(argv[i], &periodMs)) {
+            return false;
+        }
+    }
 
-    availableCommands();  // Display available commands in the serial terminal
-    while (true) {
-        checkSensors();  // Continuously check gas, temperature, and potentiometer
-        uartTask();      // Handle UART commands
-        ThisThread::sleep_for(200ms);  // Control loop frequency
+    stream_t stream;
+    if (potentiometer) {
+        stream = STREAM_POTENTIOMETER;
+    } else if (lm35) {
+        stream = raw ? STREAM_LM35 :
+                 (fahrenheit ? STREAM_LM35_FAHRENHEIT : STREAM_LM35_CELSIUS);
+    } else {
+        stream = fahrenheit ? STREAM_BOTH_FAHRENHEIT : STREAM_BOTH_CELSIUS;
     }
+    streamStart(stream, periodMs);
+    return true;
 }
 
-// Sends a string to the serial terminal
-void pcSerialComStringWrite(const char* str) {
-    uartUsb.write(str, strlen(str));
+bool stopCommand(int argc, char** argv) {
+    if (argc != 1) {
+        return false;
+    }
+    streamsStop();
+    return true;
 }
 
+bool powerCommand(int argc, char** argv) {
+    if (argc == 1) {
+        powerReportWrite();
+    } else if (argc == 2 && commandLineMatch(argv[1], "low")) {
+        pcSerialComStringWrite("Low-power mode: press the user button to leave\r\n");
+        powerModeSet(POWER_MODE_LOW);
+    } else if (argc == 2 && commandLineMatch(argv[1], "adaptive")) {
+        pcSerialComStringWrite("Adaptive mode: full rate only while readings move or near "
+                               "a threshold; press the user button to leave\r\n");
+        powerModeSet(POWER_MODE_ADAPTIVE);
+    } else if (argc == 2 && commandLineMatch(argv[1], "full")) {
+        powerModeSet(POWER_MODE_FULL);
+        pcSerialComStringWrite("Full power mode\r\n");
+    } else {
+        return false;
+    }
+    return true;
+}
 
-// Reads a character from the serial terminal
-char pcSerialComCharRead() {
-    char receivedChar = '\0';
-    if (uartUsb.readable()) {
-        uartUsb.read(&receivedChar, 1);
+// Binary frames use most of the link, so streams stop while they run
+bool telemetryCommand(int argc, char** argv) {
+    if (argc != 2) {
+        return false;
+    }
+    if (commandLineMatch(argv[1], "text")) {
+        telemetryFormatSet(TELEMETRY_FORMAT_TEXT);
+        pcSerialComStringWrite("Text telemetry\r\n");
+    } else if (commandLineMatch(argv[1], "binary")) {
+        streamsStop();
+        pcSerialComStringWrite("Binary telemetry: 'telemetry text' returns to text\r\n");
+        telemetryFormatSet(TELEMETRY_FORMAT_BINARY);
+    } else {
+        return false;
     }
-    return receivedChar;
+    return true;
 }
 
-// Shows available commands in the serial terminal
-void availableCommands() {
-    pcSerialComStringWrite("\r\nPress the following keys to continuously ");
-    pcSerialComStringWrite("print the readings until 'q' is pressed:\r\n");
-    pcSerialComStringWrite(" - 'a' the reading at the analog pin A0 (potentiometer)\r\n");
-    pcSerialComStringWrite(" - 'b' the reading at the analog pin A1 (LM35)\r\n");
-    pcSerialComStringWrite(" - 'c' the temperature in Celsius from LM35\r\n");
-    pcSerialComStringWrite(" - 'd' the temperature in Fahrenheit from LM35\r\n");
-    pcSerialComStringWrite(" - 'e' both LM35 in Celsius and potentiometer value in Celsius\r\n");
-    pcSerialComStringWrite(" - 'f' both LM35 in Fahrenheit and potentiometer value in Fahrenheit\r\n");
-    pcSerialComStringWrite("\r\nWARNING: Press 'q' or 'Q' to stop.\r\n");
+bool captureCommand(int argc, char** argv) {
+    if (argc != 1) {
+        return false;
+    }
+    if (!telemetryCaptureDump()) {
+        pcSerialComStringWrite(captureStateGet() == CAPTURE_ARMED ?
+                               "No capture: no alarm since the last dump\r\n" :
+                               "Capture still recording post-trigger scans\r\n");
+    }
+    return true;
 }
 
-// Check gas sensor, temperature, and potentiometer continuously, and print readings
-void checkSensors() {
-    static bool lastGasDetected = false;
-    static bool lastTempExceeded = false;
-    static uint32_t lastPrintTime = 0;
-    char str[100] = "";
+bool logCommand(int argc, char** argv) {
+    if (argc != 1) {
+        return false;
+    }
+    if (telemetryLogDump() == 0) {
+        pcSerialComStringWrite("Data log is empty\r\n");
+    }
+    return true;
+}
 
-    // Read all sensors with stable readings
-    float gasReading = readStableAnalog(gasSensor);
-    lm35Reading = readStableAnalog(lm35);
-    lm35TempC = analogReadingScaledWithTheLM35Formula(lm35Reading);
-    lm35TempF = celsiusToFahrenheit(lm35TempC);
-    potentiometerReading = readStableAnalog(potentiometer);
-
-    // Check gas sensor
-    if (gasReading > 0.5f) {  // Gas detected (adjust threshold as needed)
-        gasDetected = true;
-        if (!lastGasDetected) {  // State change: gas newly detected
-            pcSerialComStringWrite("Gas detected!\r\n");
-            lastGasDetected = true;
-        }
-    } else {
-        gasDetected = false;
-        if (lastGasDetected) {  // State change: gas no longer detected
-            pcSerialComStringWrite("Gas no longer detected.\r\n");
-            lastGasDetected = false;
-        }
+bool netCommand(int argc, char** argv) {
+    if (argc != 1) {
+        return false;
     }
+    netTelemetryReportWrite();
+    return true;
+}
 
-    // Check temperature
-    if (lm35TempC > 24.0f) {
-        tempExceeded = true;
-        if (!lastTempExceeded) {  // State change: temp newly exceeded
-            pcSerialComStringWrite("ALERT: LM35 temperature exceeds 24°C!\r\n");
-            lastTempExceeded = true;
-        }
+bool statsCommand(int argc, char** argv) {
+    if (argc == 1) {
+        instrumentationReportWrite();
+    } else if (argc == 2 && commandLineMatch(argv[1], "reset")) {
+        instrumentationReset();
     } else {
-        tempExceeded = false;
-        if (lastTempExceeded) {  // State change: temp no longer exceeded
-            pcSerialComStringWrite("LM35 temperature below 24°C.\r\n");
-            lastTempExceeded = false;
-        }
+        return false;
     }
+    return true;
+}
 
-    // Print all sensor readings every 1 second
-    uint32_t currentTime = us_ticker_read() / 1000;  // Get current time in milliseconds
-    if (currentTime - lastPrintTime >= 1000) {       // Print every 1000 ms (1 second)
-        sprintf(str, "Gas: %.2f, LM35: %.2f C, Potentiometer: %.2f\r\n",
-                gasReading, lm35TempC, potentiometerReading);
-        pcSerialComStringWrite(str);
-        lastPrintTime = currentTime;
+bool trendCommand(int argc, char** argv) {
+    if (argc != 1) {
+        return false;
     }
+    alarmTrendReportWrite();
+    return true;
+}
 
-    // Control buzzer and LED, and print alarm source
-    if (gasDetected || tempExceeded) {
-        buzzer.write(0.5f);  // Turn buzzer on
-        led = !led;          // Toggle LED to indicate alert
-        // Print alarm source(s)
-        if (gasDetected) {
-            pcSerialComStringWrite("Gas Alarm\r\n");
-        }
-        if (tempExceeded) {
-            pcSerialComStringWrite("Temperature Alarm\r\n");
-        }
-    } else {
-        buzzer.write(0.0f);  // Turn buzzer off
-        led = 0;             // Turn LED off
+bool memoryCommand(int argc, char** argv) {
+    if (argc != 1) {
+        return false;
     }
+    memoryPlanReportWrite();
+    return true;
 }
 
-// Main loop for UART handling based on user input
-void uartTask() {
-    char receivedChar = '\0';
-    char str[100] = "";
-    receivedChar = pcSerialComCharRead();
-
-    if (receivedChar != '\0') {
-        switch (receivedChar) {
-        case 'a':
-        case 'A':
-            while (!(receivedChar == 'q' || receivedChar == 'Q')) {
-                potentiometerReading = potentiometer.read();
-                sprintf(str, "Potentiometer reading: %.2f\r\n", potentiometerReading);
-                pcSerialComStringWrite(str);
-                ThisThread::sleep_for(200ms);
-                receivedChar = pcSerialComCharRead();
-            }
-            break;
-
-        case 'b':
-        case 'B':
-            while (!(receivedChar == 'q' || receivedChar == 'Q')) {
-                lm35Reading = lm35.read();
-                sprintf(str, "LM35 reading: %.2f\r\n", lm35Reading);
-                pcSerialComStringWrite(str);
-                ThisThread::sleep_for(200ms);
-                receivedChar = pcSerialComCharRead();
-            }
-            break;
-
-        case 'c':
-        case 'C':
-            while (!(receivedChar == 'q' || receivedChar == 'Q')) {
-                lm35Reading = lm35.read();
-                lm35TempC = analogReadingScaledWithTheLM35Formula(lm35Reading);
-                sprintf(str, "LM35: %.2f °C\r\n", lm35TempC);
-                pcSerialComStringWrite(str);
-                ThisThread::sleep_for(200ms);
-                receivedChar = pcSerialComCharRead();
-            }
-            break;
-
-        case 'd':
-        case 'D':
-            while (!(receivedChar == 'q' || receivedChar == 'Q')) {
-                lm35Reading = lm35.read();
-                lm35TempC = analogReadingScaledWithTheLM35Formula(lm35Reading);
-                lm35TempF = celsiusToFahrenheit(lm35TempC);
-                sprintf(str, "LM35: %.2f °F\r\n", lm35TempF);
-                pcSerialComStringWrite(str);
-                ThisThread::sleep_for(200ms);
-                receivedChar = pcSerialComCharRead();
-            }
-            break;
-
-        case 'e':
-        case 'E':
-            while (!(receivedChar == 'q' || receivedChar == 'Q')) {
-                potentiometerReading = potentiometer.read();
-                potentiometerScaledToC = potentiometerScaledToCelsius(potentiometerReading);
-                lm35Reading = lm35.read();
-                lm35TempC = analogReadingScaledWithTheLM35Formula(lm35Reading);
-                sprintf(str, "LM35: %.2f °C, Potentiometer scaled to °C: %.2f\r\n",
-                        lm35TempC, potentiometerScaledToC);
-                pcSerialComStringWrite(str);
-                ThisThread::sleep_for(200ms);
-                receivedChar = pcSerialComCharRead();
-            }
-            break;
-
-        case 'f':
-        case 'F':
-            while (!(receivedChar == 'q' || receivedChar == 'Q')) {
-                potentiometerReading = potentiometer.read();
-                potentiometerScaledToF = potentiometerScaledToFahrenheit(potentiometerReading);
-
-                lm35Reading = lm35.read();
-                lm35TempC = analogReadingScaledWithTheLM35Formula(lm35Reading);
-                lm35TempF = celsiusToFahrenheit(lm35TempC);
-
-                sprintf(str, "LM35: %.2f °F, Potentiometer scaled to °F: %.2f\r\n",
-                        lm35TempF, potentiometerScaledToF);
-                pcSerialComStringWrite(str);
-                ThisThread::sleep_for(200ms);
-                receivedChar = pcSerialComCharRead();
-            }
-            break;
-
-        default:
-            break;
-        }
+bool healthCommand(int argc, char** argv) {
+    if (argc != 1) {
+        return false;
+    }
+    diagnosticsReportWrite();
+    return true;
+}
+
+bool tasksCommand(int argc, char** argv) {
+    if (argc != 1) {
+        return false;
     }
+    supervisorReportWrite();
+#if SENSOR_SPI_CHANNEL_COUNT > 0
+    char str[48] = "";
+    char* cursor = numberFormatAppendString(str, "SPI ADC: blocks missed ");
+    cursor = numberFormatAppendUnsigned(cursor, spiAdcOverruns());
+    numberFormatAppendString(cursor, "\r\n");
+    pcSerialComStringWrite(str);
+#endif
+    return true;
 }
 
-// Stable analog reading function
-float readStableAnalog(AnalogIn &sensor) {
-    // Read multiple times to stabilize the value
-    float reading = 0;
-    for (int i = 0; i < 10; ++i) {
-        reading += sensor.read();
-        ThisThread::sleep_for(10ms);  // Add small delay between readings
+// Reads "50ms", "2s" or a bare number of milliseconds
+bool periodParse(const char* text, uint32_t* periodMs) {
+    char digits[12];
+    size_t length = strlen(text);
+    uint32_t multiplier = 1;
+
+    if (length > 2 && commandLineMatch(&text[length - 2], "ms")) {
+        length -= 2;
+    } else if (length > 1 && (text[length - 1] == 's' || text[length - 1] == 'S')) {
+        length -= 1;
+        multiplier = 1000;
     }
-    return reading / 10.0f;  // Average to stabilize
+    if (length >= sizeof(digits)) {
+        return false;
+    }
+    memcpy(digits, text, length);
+    digits[length] = '\0';
+
+    uint32_t value;
+    if (!numberFormatParseUnsigned(digits, &value) || value > UINT32_MAX / multiplier) {
+        return false;
+    }
+    *periodMs = value * multiplier;
+    return true;
 }
 
-// LM35 formula conversion to Celsius
-float analogReadingScaledWithTheLM35Formula(float analogReading) {
-    return analogReading * 330.0f;  // LM35 gives 10mV/°C and the ADC maps it to 0-3.3V
+// Starts a stream, or changes its period if it already runs; a period of 0
+// keeps the current one
+void streamStart(stream_t stream, uint32_t periodMs) {
+    if (periodMs != 0) {
+        streamPeriodSet(stream, periodMs);
+    }
+    streams[stream].active = true;
+    streams[stream].nextPrintMs = Kernel::get_ms_count();  // Print right away
 }
 
-// Celsius to Fahrenheit conversion
-float celsiusToFahrenheit(float tempInCelsiusDegrees) {
-    return tempInCelsiusDegrees * 9.0f / 5.0f + 32.0f;
+void streamPeriodSet(stream_t stream, uint32_t periodMs) {
+    if (periodMs < STREAM_PERIOD_MIN_MS) {
+        periodMs = STREAM_PERIOD_MIN_MS;
+    }
+    if (periodMs > STREAM_PERIOD_MAX_MS) {
+        periodMs = STREAM_PERIOD_MAX_MS;
+    }
+    streams[stream].periodMs = periodMs;
 }
 
-// Potentiometer scaling to Celsius (example: 0V to 30°C)
-float potentiometerScaledToCelsius(float analogValue) {
-    return analogValue * 330.0f;  // Assuming the potentiometer range is 0-3V and maps to 0-30°C
+void streamsStop() {
+    for (int i = 0; i < STREAM_COUNT; ++i) {
+        streams[i].active = false;
+    }
 }
 
-// Potentiometer scaling to Fahrenheit
-float potentiometerScaledToFahrenheit(float analogValue) {
-    return potentiometerScaledToCelsius(analogValue) * 9.0f / 5.0f + 32.0f;
-}
\ No newline at end of file
+// Prints every active stream whose period has elapsed, from one snapshot
+void streamsUpdate() {
+    uint64_t nowMs = Kernel::get_ms_count();
+    samplerSnapshot_t snapshot;
+    samplerSnapshotRead(&snapshot);
+
+    for (int i = 0; i < STREAM_COUNT; ++i) {
+        if (streams[i].active && nowMs >= streams[i].nextPrintMs) {
+            streamLinePrint((stream_t)i, &snapshot);
+            streams[i].nextPrintMs = nowMs + streams[i].periodMs;
+        }
+    }
+}
+
+void streamLinePrint(stream_t stream, const samplerSnapshot_t* snapshot) {
+    char str[100] = "";
+    char* cursor = str;
+    uint16_t lm35Reading = snapshot->average[SENSOR_CHANNEL_LM35];
+    uint16_t potentiometerReading = snapshot->average[SENSOR_CHANNEL_POTENTIOMETER];
+    int32_t lm35TempC = analogReadingScaledWithTheLM35Formula(lm35Reading);
+
+    switch (stream) {
+    case STREAM_POTENTIOMETER:
+        cursor = numberFormatAppendString(cursor, "Potentiometer reading: ");
+        cursor = numberFormatAppendHundredths(cursor,
+                     analogReadingToHundredths(potentiometerReading));
+        break;
+
+    case STREAM_LM35:
+        cursor = numberFormatAppendString(cursor, "LM35 reading: ");
+        cursor = numberFormatAppendHundredths(cursor,
+                     analogReadingToHundredths(lm35Reading));
+        break;
+
+    case STREAM_LM35_CELSIUS:
+        cursor = numberFormatAppendString(cursor, "LM35: ");
+        cursor = numberFormatAppendHundredths(cursor, lm35TempC);
+        cursor = numberFormatAppendString(cursor, " °C");
+        break;
+
+    case STREAM_LM35_FAHRENHEIT:
+        cursor = numberFormatAppendString(cursor, "LM35: ");
+        cursor = numberFormatAppendHundredths(cursor, celsiusToFahrenheit(lm35TempC));
+        cursor = numberFormatAppendString(cursor, " °F");
+        break;
+
+    case STREAM_BOTH_CELSIUS:
+        cursor = numberFormatAppendString(cursor, "LM35: ");
+        cursor = numberFormatAppendHundredths(cursor, lm35TempC);
+        cursor = numberFormatAppendString(cursor, " °C, Potentiometer scaled to °C: ");
+        cursor = numberFormatAppendHundredths(cursor,
+                     potentiometerScaledToCelsius(potentiometerReading));
+        break;
+
+    case STREAM_BOTH_FAHRENHEIT:
+        cursor = numberFormatAppendString(cursor, "LM35: ");
+        cursor = numberFormatAppendHundredths(cursor, celsiusToFahrenheit(lm35TempC));
+        cursor = numberFormatAppendString(cursor, " °F, Potentiometer scaled to °F: ");
+        cursor = numberFormatAppendHundredths(cursor,
+                     potentiometerScaledToFahrenheit(potentiometerReading));
+        break;
+
+    default:
+        break;
+    }
+    numberFormatAppendString(cursor, "\r\n");
+    pcSerialComStringWrite(str);
+}
@@ -0,0 +1,459 @@
+//=====[Libraries]=============================================================
+
+#include <string.h>
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "alarm.h"
+#include "alarm_engine.h"
+#include "annunciator.h"
+#include "pipeline.h"
+#include "capture.h"
+#include "config.h"
+#include "instrumentation.h"
+#include "memory_plan.h"
+#include "number_format.h"
+#include "pc_serial_com.h"
+#include "power.h"
+#include "sampler.h"
+#include "sensor_channels.h"
+#include "supervisor.h"
+#include "trend.h"
+
+//=====[Declaration of private defines]========================================
+
+#define ALARM_FLAG_GAS_WATCHDOG     (1UL << 0)
+#define ALARM_FLAG_SNAPSHOT         (1UL << 1)
+
+#define ALARM_EVENT_QUEUE_LENGTH    8
+#define ALARM_EVENT_CALLBACKS_MAX   1  // Network telemetry
+
+//=====[Declaration and initialization of private global variables]============
+
+// Highest priority thread: only preempted by interrupts
+static Thread alarmThread(osPriorityRealtime,
+                          memoryPlanStackSize(MEMORY_PLAN_STACK_ALARM),
+                          memoryPlanStackMemory(MEMORY_PLAN_STACK_ALARM),
+                          memoryPlanStackName(MEMORY_PLAN_STACK_ALARM));
+static EventFlags alarmFlags;
+
+// State changes for the telemetry thread; dropped if it falls behind
+static Mail<alarmEvent_t, ALARM_EVENT_QUEUE_LENGTH> alarmEvents;
+
+// Listeners told of each state change as it happens, from the alarm thread
+static void (*eventCallbacks[ALARM_EVENT_CALLBACKS_MAX])(const alarmEvent_t* event);
+static volatile uint32_t eventCallbackCount = 0;
+
+// One state machine per alarm-enabled channel, thresholds from the table
+static pipelineAlarms_t alarms;
+
+// Sliding-window trend per channel, and its latest estimates for the console,
+// copied in and out with interrupts briefly disabled
+static pipelineTrends_t trends;
+static trendEstimate_t trendEstimates[SENSOR_CHANNEL_COUNT];
+static volatile uint32_t preAlarmChannels = 0;  // Bit per channel
+
+static volatile uint32_t trippedChannels = 0;  // Bit per channel
+static volatile bool gasDetected = false;     // Some gas head tripped
+static volatile bool tempExceeded = false;    // Some temperature channel tripped
+static bool gasWatchdogFired = false;
+static bool anyPending = false;  // Some engine is not clear
+
+// Which channels need full-rate sampling, and the sampler mode last reported
+static pipelineRates_t rates;
+static rateControlActivity_t rateActivity = RATE_CONTROL_QUIET;
+static sensorChannel_t rateChannel = (sensorChannel_t)0;
+static samplerMode_t reportedMode = SAMPLER_MODE_CONTINUOUS;
+static uint32_t configApplied = 0;  // Settings generation of the engines
+
+static volatile uint32_t gasWatchdogTime = 0;
+static volatile uint32_t gasWatchdogCycles = 0;
+static volatile uint32_t gasLatencyMaxUs = 0;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void alarmTask();
+static void alarmGasWatchdogIsr();
+static void alarmSnapshotReady();
+static void alarmEngineEventHandle(sensorChannel_t channel,
+                                   alarmEngineEvent_t event);
+static void alarmTrendsUpdate(const uint16_t* averages);
+static void alarmPendingUpdate();
+static void alarmRateUpdate(const uint16_t* averages);
+static void alarmRateEventPut(samplerMode_t mode);
+static void alarmConfigApply();
+static bool alarmKindActive(uint32_t channels, sensorKind_t kind);
+static void alarmOutputsUpdate();
+static void alarmEventPut(alarmEventType_t type, sensorChannel_t channel,
+                          alarmRateReason_t reason);
+
+//=====[Implementations of public functions]===================================
+
+// Starts the alarm thread; the sampler must already be running
+void alarmInit() {
+    annunciatorInit();
+
+    pipelineAlarmsInit(&alarms);
+    pipelineTrendsInit(&trends);
+    pipelineRatesInit(&rates);
+
+    alarmThread.start(alarmTask);
+
+    samplerHalfBufferAttach(alarmSnapshotReady);
+    samplerWatchdogAttach(SENSOR_CHANNEL_GAS,
+                          sensorChannelTripReading<SENSOR_CHANNEL_GAS>(),
+                          alarmGasWatchdogIsr);
+}
+
+bool alarmGasDetected() {
+    return gasDetected;
+}
+
+bool alarmTempExceeded() {
+    return tempExceeded;
+}
+
+// Some channel is trending towards its threshold
+bool alarmPreAlarmActive() {
+    return preAlarmChannels != 0;
+}
+
+// Worst time measured from a gas watchdog interrupt to the buzzer turning on
+uint32_t alarmGasLatencyMaxUs() {
+    return gasLatencyMaxUs;
+}
+
+// Waits up to timeoutMs for the next alarm state change
+bool alarmEventGet(alarmEvent_t* event, uint32_t timeoutMs) {
+    alarmEvent_t* mail = alarmEvents.try_get_for(std::chrono::milliseconds(timeoutMs));
+    if (mail == nullptr) {
+        return false;
+    }
+    *event = *mail;
+    alarmEvents.free(mail);
+    return true;
+}
+
+// Registers a function called with every state change, for consumers that
+// cannot share the queue. It runs in the alarm thread ahead of the outputs
+// update, so it must only copy the event and return.
+void alarmEventAttach(void (*callback)(const alarmEvent_t* event)) {
+    if (eventCallbackCount < ALARM_EVENT_CALLBACKS_MAX) {
+        eventCallbacks[eventCallbackCount] = callback;
+        core_util_atomic_store_u32(&eventCallbackCount, eventCallbackCount + 1);
+    }
+}
+
+// "LM35: mean 23.10 C, deviation 0.02, slope 0.60/min, trips in 85 s" for
+// every channel with a trend window
+void alarmTrendReportWrite() {
+    trendEstimate_t estimates[SENSOR_CHANNEL_COUNT];
+    core_util_critical_section_enter();
+    memcpy(estimates, trendEstimates, sizeof(estimates));
+    core_util_critical_section_exit();
+
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; ++i) {
+        sensorChannel_t channel = (sensorChannel_t)i;
+        const trendEstimate_t* estimate = &estimates[i];
+        if (trends.configs[i].windowLength == 0) {
+            continue;
+        }
+
+        char str[120] = "";
+        char* cursor = numberFormatAppendString(str, sensorChannels[i].name);
+        if (!estimate->valid) {
+            numberFormatAppendString(cursor, ": trend window filling\r\n");
+            pcSerialComStringWrite(str);
+            continue;
+        }
+        cursor = numberFormatAppendString(cursor, ": mean ");
+        cursor = numberFormatAppendHundredths(cursor,
+                                              sensorChannelValue(channel, estimate->mean));
+        if (sensorChannels[i].unit[0] != '\0') {
+            cursor = numberFormatAppendString(cursor, " ");
+            cursor = numberFormatAppendString(cursor, sensorChannels[i].unit);
+        }
+        cursor = numberFormatAppendString(cursor, ", deviation ");
+        cursor = numberFormatAppendHundredths(cursor, (int32_t)(
+            ((uint32_t)estimate->deviation * sensorChannels[i].scaleQ16 + (1UL << 15)) >> 16));
+        cursor = numberFormatAppendString(cursor, ", slope ");
+        cursor = numberFormatAppendHundredths(cursor, (int32_t)(
+            (int64_t)estimate->slopePerMinute * sensorChannels[i].scaleQ16 / 65536));
+        cursor = numberFormatAppendString(cursor, "/min");
+        if (estimate->timeToTripMs != TREND_TIME_NEVER) {
+            cursor = numberFormatAppendString(cursor, ", trips in ");
+            cursor = numberFormatAppendUnsigned(cursor, estimate->timeToTripMs / 1000);
+            cursor = numberFormatAppendString(cursor, " s");
+        }
+        if (preAlarmChannels & (1UL << i)) {
+            cursor = numberFormatAppendString(cursor, " (pre-alarm)");
+        }
+        numberFormatAppendString(cursor, "\r\n");
+        pcSerialComStringWrite(str);
+    }
+}
+
+//=====[Implementations of private functions]==================================
+
+static void alarmTask() {
+    while (true) {
+        uint32_t flags = alarmFlags.wait_any(ALARM_FLAG_GAS_WATCHDOG | ALARM_FLAG_SNAPSHOT);
+        supervisorCheckIn(SUPERVISOR_TASK_ALARM);
+
+        // A run of conversions above the threshold, long enough to pass the
+        // median filter, is trip evidence for the gas engine, which trips at
+        // once when the channel has no dwell
+        if ((flags & ALARM_FLAG_GAS_WATCHDOG) && !gasWatchdogFired) {
+            gasWatchdogFired = true;
+            alarmEngineEvent_t event = alarmEngineTripEvidence(
+                &alarms.channels[SENSOR_CHANNEL_GAS],
+                &alarms.configs[SENSOR_CHANNEL_GAS], (uint32_t)Kernel::get_ms_count());
+            alarmEngineEventHandle(SENSOR_CHANNEL_GAS, event);
+            if (event == ALARM_ENGINE_TRIP) {
+                instrumentationStageRecord(INSTRUMENTATION_STAGE_GAS_LATENCY,
+                                           instrumentationCycles() - gasWatchdogCycles);
+                uint32_t latency = us_ticker_read() - gasWatchdogTime;
+                if (latency > gasLatencyMaxUs) {
+                    gasLatencyMaxUs = latency;
+                }
+            }
+            alarmPendingUpdate();
+        }
+
+        // Every filtered snapshot steps the state machines of all alarms
+        if (flags & ALARM_FLAG_SNAPSHOT) {
+            INSTRUMENTATION_BEGIN(INSTRUMENTATION_STAGE_ALARM_UPDATE);
+            if (configGeneration() != configApplied) {
+                alarmConfigApply();
+            }
+            samplerSnapshot_t snapshot;
+            samplerSnapshotRead(&snapshot);
+            alarmEngineEvent_t events[SENSOR_CHANNEL_COUNT];
+            pipelineAlarmsUpdate(&alarms, snapshot.average,
+                                 (uint32_t)Kernel::get_ms_count(), events);
+            for (int i = 0; i < SENSOR_CHANNEL_COUNT; ++i) {
+                alarmEngineEventHandle((sensorChannel_t)i, events[i]);
+            }
+            alarmTrendsUpdate(snapshot.average);
+
+            // The watchdog fires once; listen again when gas is fully clear
+            if (gasWatchdogFired &&
+                alarms.channels[SENSOR_CHANNEL_GAS].state == ALARM_ENGINE_CLEAR) {
+                gasWatchdogFired = false;
+                samplerWatchdogArm();
+            }
+            alarmPendingUpdate();
+            alarmRateUpdate(snapshot.average);
+            INSTRUMENTATION_END(INSTRUMENTATION_STAGE_ALARM_UPDATE);
+        }
+    }
+}
+
+// Mirrors a state machine transition into the alarm flags and event queue
+static void alarmEngineEventHandle(sensorChannel_t channel,
+                                   alarmEngineEvent_t event) {
+    if (event == ALARM_ENGINE_NO_CHANGE) {
+        return;
+    }
+
+    bool tripped = (event == ALARM_ENGINE_TRIP);
+    if (tripped) {
+        captureTrigger();  // Keep the waveform around the transition
+        trippedChannels |= (1UL << channel);
+    } else {
+        trippedChannels &= ~(1UL << channel);
+    }
+
+    // A rise fast enough trips below the threshold, so that one does not
+    // read as exceeded
+    alarmEventType_t tempTrip = alarms.channels[channel].rateTripped
+                                ? ALARM_EVENT_TEMP_RISING_FAST : ALARM_EVENT_TEMP_EXCEEDED;
+    switch (sensorChannels[channel].kind) {
+    case SENSOR_KIND_GAS:
+        gasDetected = alarmKindActive(trippedChannels, SENSOR_KIND_GAS);
+        alarmEventPut(tripped ? ALARM_EVENT_GAS_DETECTED : ALARM_EVENT_GAS_CLEARED,
+                      channel, ALARM_RATE_REASON_NONE);
+        break;
+    case SENSOR_KIND_TEMPERATURE:
+        tempExceeded = alarmKindActive(trippedChannels, SENSOR_KIND_TEMPERATURE);
+        alarmEventPut(tripped ? tempTrip : ALARM_EVENT_TEMP_CLEARED, channel,
+                      ALARM_RATE_REASON_NONE);
+        break;
+    default:
+        break;
+    }
+    alarmOutputsUpdate();
+}
+
+// Steps the trends and reports pre-alarms as events; the annunciator only
+// shows a pre-alarm while no alarm sounds
+static void alarmTrendsUpdate(const uint16_t* averages) {
+    trendEstimate_t estimates[SENSOR_CHANNEL_COUNT];
+    trendEvent_t events[SENSOR_CHANNEL_COUNT];
+    pipelineTrendsUpdate(&trends, averages, samplerSnapshotPeriodMs(), estimates,
+                         events);
+
+    core_util_critical_section_enter();
+    memcpy(trendEstimates, estimates, sizeof(trendEstimates));
+    core_util_critical_section_exit();
+
+    bool changed = false;
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; ++i) {
+        if (events[i] == TREND_NO_CHANGE) {
+            continue;
+        }
+        bool preAlarm = (events[i] == TREND_PRE_ALARM);
+        if (preAlarm) {
+            preAlarmChannels |= (1UL << i);
+        } else {
+            preAlarmChannels &= ~(1UL << i);
+        }
+        switch (sensorChannels[i].kind) {
+        case SENSOR_KIND_GAS:
+            alarmEventPut(preAlarm ? ALARM_EVENT_GAS_PRE_ALARM
+                                   : ALARM_EVENT_GAS_PRE_ALARM_CLEARED,
+                          (sensorChannel_t)i, ALARM_RATE_REASON_NONE);
+            break;
+        case SENSOR_KIND_TEMPERATURE:
+            alarmEventPut(preAlarm ? ALARM_EVENT_TEMP_PRE_ALARM
+                                   : ALARM_EVENT_TEMP_PRE_ALARM_CLEARED,
+                          (sensorChannel_t)i, ALARM_RATE_REASON_NONE);
+            break;
+        default:
+            break;
+        }
+        changed = true;
+    }
+    if (changed) {
+        alarmOutputsUpdate();
+    }
+}
+
+// Low-power modes sample continuously while anything is not clear
+static void alarmPendingUpdate() {
+    bool pending = pipelineAlarmsPending(&alarms);
+    if (pending != anyPending) {
+        anyPending = pending;
+        powerAlarmPendingSet(pending);
+    }
+}
+
+// Adaptive mode samples continuously while any channel is active. Whatever
+// switched the sampler, here or from the console, is reported once the next
+// snapshot is in.
+static void alarmRateUpdate(const uint16_t* averages) {
+    sensorChannel_t channel;
+    rateControlActivity_t activity = pipelineRatesUpdate(&rates, averages,
+                                                         (uint32_t)Kernel::get_ms_count(),
+                                                         &channel);
+    if ((activity != RATE_CONTROL_QUIET) != (rateActivity != RATE_CONTROL_QUIET)) {
+        powerActivitySet(activity != RATE_CONTROL_QUIET);
+    }
+    rateActivity = activity;
+    if (activity != RATE_CONTROL_QUIET) {
+        rateChannel = channel;
+    }
+
+    samplerMode_t mode = samplerModeGet();
+    if (mode != reportedMode) {
+        reportedMode = mode;
+        alarmRateEventPut(mode);
+    }
+}
+
+// Names the likeliest cause: the power mode, then a channel's activity, then
+// an alarm that is not clear
+static void alarmRateEventPut(samplerMode_t mode) {
+    powerMode_t powerMode = powerModeGet();
+    alarmRateReason_t reason = ALARM_RATE_REASON_POWER_MODE;
+    sensorChannel_t channel = (sensorChannel_t)0;
+
+    if (mode == SAMPLER_MODE_BURST) {
+        if (powerMode == POWER_MODE_ADAPTIVE) {
+            reason = ALARM_RATE_REASON_QUIET;
+        }
+    } else if (powerMode != POWER_MODE_FULL) {
+        if (powerMode == POWER_MODE_ADAPTIVE && rateActivity != RATE_CONTROL_QUIET) {
+            reason = rateActivity == RATE_CONTROL_NEAR ? ALARM_RATE_REASON_NEAR
+                                                       : ALARM_RATE_REASON_CHANGING;
+            channel = rateChannel;
+        } else if (anyPending) {
+            reason = ALARM_RATE_REASON_ALARM;
+            for (int i = 0; i < SENSOR_CHANNEL_COUNT; ++i) {
+                if (alarms.channels[i].state != ALARM_ENGINE_CLEAR) {
+                    channel = (sensorChannel_t)i;
+                    break;
+                }
+            }
+        }
+    }
+    alarmEventPut(mode == SAMPLER_MODE_BURST ? ALARM_EVENT_RATE_REDUCED
+                                             : ALARM_EVENT_RATE_FULL,
+                  channel, reason);
+}
+
+// Takes new thresholds, dwell times and rate trips; the gas watchdog follows
+// the new gas trip level
+static void alarmConfigApply() {
+    configSettings_t settings;
+    configApplied = configGeneration();
+    configGet(&settings);
+    pipelineAlarmsConfigure(&alarms, settings.channels);
+    pipelineTrendsConfigure(&trends, settings.channels);
+    pipelineRatesConfigure(&rates, settings.channels);
+    samplerWatchdogThresholdSet(alarms.configs[SENSOR_CHANNEL_GAS].tripReading);
+}
+
+static bool alarmKindActive(uint32_t channels, sensorKind_t kind) {
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; ++i) {
+        if ((channels & (1UL << i)) && sensorChannels[i].kind == kind) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Selects the annunciator pattern for the active alarms; the annunciator
+// only touches the buzzer and LED when the pattern or its step changes
+static void alarmOutputsUpdate() {
+    INSTRUMENTATION_BEGIN(INSTRUMENTATION_STAGE_ALARM_OUTPUTS);
+    annunciatorPattern_t pattern = ANNUNCIATOR_PATTERN_OFF;
+    if (gasDetected && tempExceeded) {
+        pattern = ANNUNCIATOR_PATTERN_BOTH;
+    } else if (gasDetected) {
+        pattern = ANNUNCIATOR_PATTERN_GAS;
+    } else if (tempExceeded) {
+        pattern = ANNUNCIATOR_PATTERN_TEMPERATURE;
+    } else if (preAlarmChannels != 0) {
+        pattern = ANNUNCIATOR_PATTERN_PRE_ALARM;
+    }
+    annunciatorPatternSet(pattern);
+    INSTRUMENTATION_END(INSTRUMENTATION_STAGE_ALARM_OUTPUTS);
+}
+
+static void alarmEventPut(alarmEventType_t type, sensorChannel_t channel,
+                          alarmRateReason_t reason) {
+    alarmEvent_t event = { type, (uint8_t)channel, (uint8_t)reason, Kernel::get_ms_count() };
+
+    alarmEvent_t* mail = alarmEvents.try_alloc();
+    if (mail != nullptr) {
+        *mail = event;
+        alarmEvents.put(mail);
+    }
+
+    uint32_t callbackCount = core_util_atomic_load_u32(&eventCallbackCount);
+    for (uint32_t i = 0; i < callbackCount; ++i) {
+        eventCallbacks[i](&event);
+    }
+}
+
+static void alarmGasWatchdogIsr() {
+    gasWatchdogTime = us_ticker_read();
+    gasWatchdogCycles = instrumentationCycles();
+    alarmFlags.set(ALARM_FLAG_GAS_WATCHDOG);
+}
+
+static void alarmSnapshotReady() {
+    alarmFlags.set(ALARM_FLAG_SNAPSHOT);
+}
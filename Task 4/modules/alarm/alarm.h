@@ -0,0 +1,60 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _ALARM_H_
+#define _ALARM_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+//=====[Declaration of public data types]======================================
+
+// Gas events come from any gas head and temperature events from any
+// temperature channel; the event names the channel
+typedef enum {
+    ALARM_EVENT_GAS_DETECTED,
+    ALARM_EVENT_GAS_CLEARED,
+    ALARM_EVENT_TEMP_EXCEEDED,
+    ALARM_EVENT_TEMP_CLEARED,
+    ALARM_EVENT_GAS_PRE_ALARM,          // Gas trending to its threshold
+    ALARM_EVENT_GAS_PRE_ALARM_CLEARED,
+    ALARM_EVENT_TEMP_PRE_ALARM,         // Temperature trending to its threshold
+    ALARM_EVENT_TEMP_PRE_ALARM_CLEARED,
+    ALARM_EVENT_RATE_FULL,              // Sampler switched to continuous
+    ALARM_EVENT_RATE_REDUCED,           // Sampler switched to bursts
+    ALARM_EVENT_TEMP_RISING_FAST,       // Temperature tripped on its rate of rise
+                                        // while still below its threshold
+} alarmEventType_t;
+
+// Why the sampler switched, for the rate events
+typedef enum {
+    ALARM_RATE_REASON_NONE,         // Not a rate event
+    ALARM_RATE_REASON_POWER_MODE,   // The power mode changed
+    ALARM_RATE_REASON_QUIET,        // Every channel is quiet again
+    ALARM_RATE_REASON_NEAR,         // The channel nears its threshold
+    ALARM_RATE_REASON_CHANGING,     // The channel changes quickly
+    ALARM_RATE_REASON_ALARM,        // The channel's alarm is not clear
+} alarmRateReason_t;
+
+typedef struct {
+    alarmEventType_t type;
+    uint8_t channel;  // sensorChannel_t of the engine or trend that changed,
+                      // or behind a rate event's reason
+    uint8_t reason;   // alarmRateReason_t
+    uint64_t timeMs;  // Kernel::get_ms_count() when the state changed
+} alarmEvent_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void alarmInit();
+bool alarmGasDetected();
+bool alarmTempExceeded();
+bool alarmPreAlarmActive();
+uint32_t alarmGasLatencyMaxUs();
+bool alarmEventGet(alarmEvent_t* event, uint32_t timeoutMs);
+void alarmEventAttach(void (*callback)(const alarmEvent_t* event));
+void alarmTrendReportWrite();
+
+//=====[#include guards - end]=================================================
+
+#endif // _ALARM_H_
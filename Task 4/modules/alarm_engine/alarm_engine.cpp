@@ -0,0 +1,162 @@
+//=====[Libraries]=============================================================
+
+#include "alarm_engine.h"
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static alarmEngineEvent_t alarmEngineEnter(alarmEngineChannel_t* channel,
+                                           alarmEngineState_t state,
+                                           uint32_t nowMs);
+static alarmEngineEvent_t alarmEngineRateTrip(alarmEngineChannel_t* channel,
+                                              const alarmEngineConfig_t* config,
+                                              uint16_t reading, uint32_t nowMs);
+static bool alarmEngineRisingTooFast(alarmEngineChannel_t* channel,
+                                     const alarmEngineConfig_t* config,
+                                     uint16_t reading, uint32_t nowMs);
+
+//=====[Implementations of public functions]===================================
+
+void alarmEngineInit(alarmEngineChannel_t* channel) {
+    channel->state = ALARM_ENGINE_CLEAR;
+    channel->stateSinceMs = 0;
+    channel->primed = false;
+    channel->rateReading = 0;
+    channel->rateSinceMs = 0;
+    channel->rateTripped = false;
+}
+
+// Runs the state machine for one filtered sample
+alarmEngineEvent_t alarmEngineUpdate(alarmEngineChannel_t* channel,
+                                     const alarmEngineConfig_t* config,
+                                     uint16_t reading, uint32_t nowMs) {
+    bool risingTooFast = alarmEngineRisingTooFast(channel, config, reading, nowMs);
+    uint32_t inStateMs = nowMs - channel->stateSinceMs;
+
+    switch (channel->state) {
+    case ALARM_ENGINE_CLEAR:
+        if (risingTooFast) {
+            return alarmEngineRateTrip(channel, config, reading, nowMs);
+        }
+        if (reading > config->tripReading) {
+            if (config->tripDwellMs == 0) {
+                return alarmEngineEnter(channel, ALARM_ENGINE_TRIPPED, nowMs);
+            }
+            return alarmEngineEnter(channel, ALARM_ENGINE_ARMED, nowMs);
+        }
+        break;
+
+    case ALARM_ENGINE_ARMED:
+        if (risingTooFast) {
+            return alarmEngineRateTrip(channel, config, reading, nowMs);
+        }
+        if (reading <= config->tripReading) {
+            return alarmEngineEnter(channel, ALARM_ENGINE_CLEAR, nowMs);
+        }
+        if (inStateMs >= config->tripDwellMs) {
+            return alarmEngineEnter(channel, ALARM_ENGINE_TRIPPED, nowMs);
+        }
+        break;
+
+    case ALARM_ENGINE_TRIPPED:
+        if (reading <= config->clearReading) {
+            if (config->clearDwellMs == 0) {
+                return alarmEngineEnter(channel, ALARM_ENGINE_CLEAR, nowMs);
+            }
+            return alarmEngineEnter(channel, ALARM_ENGINE_CLEARING, nowMs);
+        }
+        break;
+
+    case ALARM_ENGINE_CLEARING:
+        if (reading > config->clearReading) {
+            return alarmEngineEnter(channel, ALARM_ENGINE_TRIPPED, nowMs);
+        }
+        if (inStateMs >= config->clearDwellMs) {
+            return alarmEngineEnter(channel, ALARM_ENGINE_CLEAR, nowMs);
+        }
+        break;
+
+    default:
+        break;
+    }
+    return ALARM_ENGINE_NO_CHANGE;
+}
+
+// A reading above the trip threshold seen outside the filtered stream, such
+// as an ADC analog watchdog interrupt
+alarmEngineEvent_t alarmEngineTripEvidence(alarmEngineChannel_t* channel,
+                                           const alarmEngineConfig_t* config,
+                                           uint32_t nowMs) {
+    switch (channel->state) {
+    case ALARM_ENGINE_CLEAR:
+        if (config->tripDwellMs == 0) {
+            return alarmEngineEnter(channel, ALARM_ENGINE_TRIPPED, nowMs);
+        }
+        return alarmEngineEnter(channel, ALARM_ENGINE_ARMED, nowMs);
+
+    case ALARM_ENGINE_CLEARING:
+        return alarmEngineEnter(channel, ALARM_ENGINE_TRIPPED, nowMs);
+
+    default:
+        return ALARM_ENGINE_NO_CHANGE;
+    }
+}
+
+// True while the alarm outputs must be on, including the clear dwell
+bool alarmEngineActive(const alarmEngineChannel_t* channel) {
+    return channel->state == ALARM_ENGINE_TRIPPED ||
+           channel->state == ALARM_ENGINE_CLEARING;
+}
+
+//=====[Implementations of private functions]==================================
+
+static alarmEngineEvent_t alarmEngineEnter(alarmEngineChannel_t* channel,
+                                           alarmEngineState_t state,
+                                           uint32_t nowMs) {
+    bool wasActive = alarmEngineActive(channel);
+    channel->state = state;
+    channel->stateSinceMs = nowMs;
+    if (state == ALARM_ENGINE_TRIPPED) {
+        channel->rateTripped = false;
+    }
+    bool isActive = alarmEngineActive(channel);
+
+    if (isActive && !wasActive) {
+        return ALARM_ENGINE_TRIP;
+    }
+    if (!isActive && wasActive) {
+        return ALARM_ENGINE_RELEASE;
+    }
+    return ALARM_ENGINE_NO_CHANGE;
+}
+
+// Trips on the rise alone, from CLEAR or ARMED; the channel records whether
+// the reading was still at or below the threshold
+static alarmEngineEvent_t alarmEngineRateTrip(alarmEngineChannel_t* channel,
+                                              const alarmEngineConfig_t* config,
+                                              uint16_t reading, uint32_t nowMs) {
+    alarmEngineEvent_t event = alarmEngineEnter(channel, ALARM_ENGINE_TRIPPED, nowMs);
+    channel->rateTripped = reading <= config->tripReading;
+    return event;
+}
+
+static bool alarmEngineRisingTooFast(alarmEngineChannel_t* channel,
+                                     const alarmEngineConfig_t* config,
+                                     uint16_t reading, uint32_t nowMs) {
+    uint32_t elapsedMs = nowMs - channel->rateSinceMs;
+    if (channel->primed && (elapsedMs == 0 || elapsedMs < config->rateWindowMs)) {
+        return false;
+    }
+
+    bool tooFast = false;
+    if (config->rateTripPerSecond > 0 && channel->primed &&
+        reading > channel->rateReading) {
+        // Compare rise * 1000 against rate * elapsed to avoid a division
+        uint64_t rise = (uint64_t)(reading - channel->rateReading) * 1000;
+        tooFast = rise > (uint64_t)config->rateTripPerSecond * elapsedMs;
+    }
+
+    channel->primed = true;
+    channel->rateReading = reading;
+    channel->rateSinceMs = nowMs;
+    return tooFast;
+}
@@ -0,0 +1,63 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _ALARM_ENGINE_H_
+#define _ALARM_ENGINE_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+//=====[Declaration of public data types]======================================
+
+//  CLEAR --above trip--> ARMED --tripDwellMs--> TRIPPED
+//  TRIPPED --at/below clear--> CLEARING --clearDwellMs--> CLEAR
+// Falling back across the threshold during a dwell cancels it. A rise faster
+// than the rate limit trips at once from CLEAR or ARMED, below the threshold
+// too; the channel then records that the rise alone tripped it.
+typedef enum {
+    ALARM_ENGINE_CLEAR,
+    ALARM_ENGINE_ARMED,
+    ALARM_ENGINE_TRIPPED,
+    ALARM_ENGINE_CLEARING,
+} alarmEngineState_t;
+
+typedef enum {
+    ALARM_ENGINE_NO_CHANGE,
+    ALARM_ENGINE_TRIP,
+    ALARM_ENGINE_RELEASE,
+} alarmEngineEvent_t;
+
+// Readings use the 0 to 65535 scale of the sampler snapshot
+typedef struct {
+    uint16_t tripReading;       // Above this the alarm is armed
+    uint16_t clearReading;      // At or below this a tripped alarm is clearing
+    uint32_t tripDwellMs;
+    uint32_t clearDwellMs;
+    uint32_t rateTripPerSecond; // Reading rise per second that trips, 0 disables
+    uint32_t rateWindowMs;      // Rise measured over at least this long, so
+                                // that sample noise does not read as a slope
+} alarmEngineConfig_t;
+
+typedef struct {
+    alarmEngineState_t state;
+    uint32_t stateSinceMs;
+    bool primed;                // rateReading is valid
+    uint16_t rateReading;       // Start of the current rate window
+    uint32_t rateSinceMs;
+    bool rateTripped;           // Tripped on its rate of rise below tripReading
+} alarmEngineChannel_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void alarmEngineInit(alarmEngineChannel_t* channel);
+alarmEngineEvent_t alarmEngineUpdate(alarmEngineChannel_t* channel,
+                                     const alarmEngineConfig_t* config,
+                                     uint16_t reading, uint32_t nowMs);
+alarmEngineEvent_t alarmEngineTripEvidence(alarmEngineChannel_t* channel,
+                                           const alarmEngineConfig_t* config,
+                                           uint32_t nowMs);
+bool alarmEngineActive(const alarmEngineChannel_t* channel);
+
+//=====[#include guards - end]=================================================
+
+#endif // _ALARM_ENGINE_H_
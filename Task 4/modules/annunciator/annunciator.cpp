@@ -0,0 +1,120 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "annunciator.h"
+
+//=====[Declaration of private defines]========================================
+
+#define ANNUNCIATOR_STEPS_MAX       4
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct {
+    uint16_t tonePeriodUs;  // Buzzer PWM period, 0 for silence
+    bool ledOn;
+    uint16_t durationMs;
+} annunciatorStep_t;
+
+typedef struct {
+    uint8_t stepCount;
+    annunciatorStep_t steps[ANNUNCIATOR_STEPS_MAX];
+} annunciatorPatternSteps_t;
+
+//=====[Declaration and initialization of public global objects]===============
+
+// Define the PWM pin (D15 = PB_8 on NUCLEO-F439ZI, CN9 Pin 15)
+PwmOut buzzer(D9);
+
+// Define the LED for debugging
+DigitalOut led(LED1);  // Onboard LED (LD2)
+
+//=====[Declaration and initialization of private global variables]============
+
+// Indexed by annunciatorPattern_t; distinguishable by ear and by eye
+static const annunciatorPatternSteps_t annunciatorPatterns[ANNUNCIATOR_PATTERN_COUNT] = {
+    { 0, { } },                                                     // OFF
+    { 2, { { 2000, true, 200 }, { 0, false, 200 } } },              // GAS
+    { 4, { { 1000, true, 150 }, { 0, false, 150 },
+           { 1000, true, 150 }, { 0, false, 1050 } } },             // TEMPERATURE
+    { 2, { { 2000, true, 250 }, { 1000, false, 250 } } },           // BOTH
+    { 2, { { 0, true, 100 }, { 0, false, 1900 } } },                // PRE_ALARM
+};
+
+// Steps the pattern in interrupt context; detached while off so the MCU can
+// deep sleep
+static Timeout stepTimeout;
+
+static volatile annunciatorPattern_t pattern = ANNUNCIATOR_PATTERN_OFF;
+static uint32_t step = 0;
+static bool buzzerResumed = false;  // Silent patterns leave it suspended
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void annunciatorStepApply();
+static void annunciatorStepIsr();
+
+//=====[Implementations of public functions]===================================
+
+void annunciatorInit() {
+    buzzer.pulsewidth_us(0);  // Start with the buzzer off
+    buzzer.suspend();         // Releases its deep sleep lock while silent
+    led = OFF;
+}
+
+// Switches to the pattern at its first step right away; the timer plays the
+// rest, so callers do no further peripheral I/O
+void annunciatorPatternSet(annunciatorPattern_t newPattern) {
+    core_util_critical_section_enter();
+    if (newPattern != pattern) {
+        stepTimeout.detach();
+        pattern = newPattern;
+        step = 0;
+        annunciatorStepApply();
+    }
+    core_util_critical_section_exit();
+}
+
+annunciatorPattern_t annunciatorPatternGet() {
+    return pattern;
+}
+
+//=====[Implementations of private functions]==================================
+
+// Drives the outputs for the current step and times the next one. Called
+// with interrupts disabled or from the timeout interrupt.
+static void annunciatorStepApply() {
+    if (pattern == ANNUNCIATOR_PATTERN_OFF) {
+        if (buzzerResumed) {
+            buzzer.pulsewidth_us(0);
+            buzzer.suspend();
+            buzzerResumed = false;
+        }
+        led = OFF;
+        return;
+    }
+
+    const annunciatorStep_t* current = &annunciatorPatterns[pattern].steps[step];
+    if (current->tonePeriodUs == 0) {
+        if (buzzerResumed) {
+            buzzer.pulsewidth_us(0);
+        }
+    } else {
+        if (!buzzerResumed) {
+            buzzer.resume();
+            buzzerResumed = true;
+        }
+        buzzer.period_us(current->tonePeriodUs);
+        buzzer.pulsewidth_us(current->tonePeriodUs / 2);
+    }
+    led = current->ledOn ? ON : OFF;
+
+    stepTimeout.attach(annunciatorStepIsr,
+                       std::chrono::milliseconds(current->durationMs));
+}
+
+static void annunciatorStepIsr() {
+    step = (step + 1) % annunciatorPatterns[pattern].stepCount;
+    annunciatorStepApply();
+}
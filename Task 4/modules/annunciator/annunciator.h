@@ -0,0 +1,27 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _ANNUNCIATOR_H_
+#define _ANNUNCIATOR_H_
+
+//=====[Declaration of public data types]======================================
+
+// Each pattern is a cycle of buzzer tone and LED steps played from a
+// hardware timer interrupt; see annunciatorPatterns in annunciator.cpp
+typedef enum {
+    ANNUNCIATOR_PATTERN_OFF,
+    ANNUNCIATOR_PATTERN_GAS,          // Fast 500 Hz beeps
+    ANNUNCIATOR_PATTERN_TEMPERATURE,  // 1 kHz double beep every 1.5 s
+    ANNUNCIATOR_PATTERN_BOTH,         // Two-tone siren
+    ANNUNCIATOR_PATTERN_PRE_ALARM,    // Silent LED blink every 2 s
+    ANNUNCIATOR_PATTERN_COUNT,
+} annunciatorPattern_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void annunciatorInit();
+void annunciatorPatternSet(annunciatorPattern_t pattern);
+annunciatorPattern_t annunciatorPatternGet();
+
+//=====[#include guards - end]=================================================
+
+#endif // _ANNUNCIATOR_H_
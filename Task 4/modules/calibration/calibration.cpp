@@ -0,0 +1,177 @@
+//=====[Libraries]=============================================================
+
+#include "calibration.h"
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static int32_t calibrationLine(const calibrationPoints_t* points, int32_t input,
+                               bool inverse);
+static uint16_t calibrationClamp(int64_t reading);
+
+//=====[Implementations of public functions]===================================
+
+void calibrationPointsClear(calibrationPoints_t* points) {
+    points->count = 0;
+    for (unsigned i = 0; i < sizeof(points->reserved); ++i) {
+        points->reserved[i] = 0;
+    }
+    for (int i = 0; i < CALIBRATION_POINTS_MAX; ++i) {
+        points->points[i].measured = 0;
+        points->points[i].reference = 0;
+    }
+}
+
+// Both readings must rise from point to point, so the correction rises with
+// the reading and can be undone
+bool calibrationPointsValid(const calibrationPoints_t* points) {
+    if (points->count > CALIBRATION_POINTS_MAX) {
+        return false;
+    }
+    for (int i = 1; i < points->count; ++i) {
+        if (points->points[i].measured <= points->points[i - 1].measured ||
+            points->points[i].reference <= points->points[i - 1].reference) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Adds a point, replacing one taken at nearly the same reading; false, with
+// points unchanged, when all are taken or the point contradicts the others
+bool calibrationPointAdd(calibrationPoints_t* points, uint16_t measured,
+                         uint16_t reference) {
+    calibrationPoints_t updated = *points;
+    int index = 0;
+    bool replace = false;
+    for (; index < updated.count; ++index) {
+        int32_t distance = (int32_t)measured - updated.points[index].measured;
+        if (distance < CALIBRATION_POINT_SPACING_MIN &&
+            distance > -CALIBRATION_POINT_SPACING_MIN) {
+            replace = true;
+            break;
+        }
+        if (distance < 0) {
+            break;
+        }
+    }
+
+    if (!replace) {
+        if (updated.count == CALIBRATION_POINTS_MAX) {
+            return false;
+        }
+        for (int i = updated.count; i > index; --i) {
+            updated.points[i] = updated.points[i - 1];
+        }
+        updated.count++;
+    }
+    updated.points[index].measured = measured;
+    updated.points[index].reference = reference;
+
+    if (!calibrationPointsValid(&updated)) {
+        return false;
+    }
+    *points = updated;
+    return true;
+}
+
+// Supply-corrected reading to the reading the channel table expects
+uint16_t calibrationCorrect(const calibrationPoints_t* points, uint16_t measured) {
+    return calibrationClamp(calibrationLine(points, measured, false));
+}
+
+// The other way round: what the channel read before the user calibration
+uint16_t calibrationUncorrect(const calibrationPoints_t* points, uint16_t reference) {
+    return calibrationClamp(calibrationLine(points, reference, true));
+}
+
+// VDDA relative to the nominal supply, from a VREFINT reading and the
+// factory one taken at the nominal supply, both on the same scale. A fixed
+// input voltage reads lower as the supply rises, so multiplying its reading
+// by the gain gives what it would read at the nominal supply.
+uint32_t calibrationSupplyGainQ16(uint32_t vrefintCal, uint32_t vrefintReading) {
+    if (vrefintReading == 0) {
+        return CALIBRATION_GAIN_ONE_Q16;
+    }
+    uint32_t gain = (uint32_t)((((uint64_t)vrefintCal << 16) + vrefintReading / 2) /
+                               vrefintReading);
+    return gain < CALIBRATION_GAIN_MIN_Q16 ? CALIBRATION_GAIN_MIN_Q16
+           : (gain > CALIBRATION_GAIN_MAX_Q16 ? CALIBRATION_GAIN_MAX_Q16 : gain);
+}
+
+uint32_t calibrationSupplyMillivolts(uint32_t gainQ16) {
+    return (uint32_t)(((uint64_t)CALIBRATION_SUPPLY_NOMINAL_MV * gainQ16 + (1UL << 15)) >> 16);
+}
+
+// Die temperature in hundredths of °C from the internal sensor, between its
+// factory readings at 30 °C and 110 °C, taken at the nominal supply
+int32_t calibrationDieCentiCelsius(uint32_t tsCal30, uint32_t tsCal110,
+                                   uint32_t tsReading, uint32_t gainQ16) {
+    if (tsCal110 <= tsCal30) {
+        return 0;  // No factory calibration to go by
+    }
+    int32_t nominal = (int32_t)(((uint64_t)tsReading * gainQ16 + (1UL << 15)) >> 16);
+    return 3000 + (nominal - (int32_t)tsCal30) * 8000 / (int32_t)(tsCal110 - tsCal30);
+}
+
+// Samples supply gain and user calibration together over the raw reading
+// range; between the points the table is exact, at a user point it cuts the
+// corner within one segment
+void calibrationTableBuild(calibrationTable_t* table, const calibrationPoints_t* points,
+                           uint32_t gainQ16) {
+    for (int i = 0; i < CALIBRATION_TABLE_LENGTH; ++i) {
+        uint64_t raw = (uint64_t)i << CALIBRATION_TABLE_SHIFT;
+        int32_t supplied = (int32_t)((raw * gainQ16 + (1UL << 15)) >> 16);
+        table->readings[i] = calibrationClamp(calibrationLine(points, supplied, false));
+    }
+}
+
+// Raw reading at which the table reaches reading, for thresholds compared
+// to raw conversions, such as the ADC analog watchdog's
+uint16_t calibrationTableInverse(const calibrationTable_t* table, uint16_t reading) {
+    if (reading <= table->readings[0]) {
+        return 0;
+    }
+    for (int i = 0; i < CALIBRATION_TABLE_LENGTH - 1; ++i) {
+        int32_t low = table->readings[i];
+        int32_t high = table->readings[i + 1];
+        if (high > reading) {
+            int64_t raw = ((int64_t)i << CALIBRATION_TABLE_SHIFT) +
+                          (((int64_t)(reading - low) << CALIBRATION_TABLE_SHIFT) /
+                           (high - low));
+            return calibrationClamp(raw);
+        }
+    }
+    return UINT16_MAX;
+}
+
+//=====[Implementations of private functions]==================================
+
+// The user calibration from measured to reference readings, or back
+static int32_t calibrationLine(const calibrationPoints_t* points, int32_t input,
+                               bool inverse) {
+    const calibrationPoint_t* p = points->points;
+    if (points->count == 0) {
+        return input;
+    }
+    int32_t x0 = inverse ? p[0].reference : p[0].measured;
+    int32_t y0 = inverse ? p[0].measured : p[0].reference;
+    if (points->count == 1) {
+        return input + y0 - x0;
+    }
+
+    // The segment input falls on, or the outer one past either end
+    int segment = 0;
+    while (segment < points->count - 2 &&
+           input > (inverse ? p[segment + 1].reference : p[segment + 1].measured)) {
+        segment++;
+    }
+    x0 = inverse ? p[segment].reference : p[segment].measured;
+    y0 = inverse ? p[segment].measured : p[segment].reference;
+    int32_t x1 = inverse ? p[segment + 1].reference : p[segment + 1].measured;
+    int32_t y1 = inverse ? p[segment + 1].measured : p[segment + 1].reference;
+    return y0 + (int32_t)((int64_t)(input - x0) * (y1 - y0) / (x1 - x0));
+}
+
+static uint16_t calibrationClamp(int64_t reading) {
+    return reading < 0 ? 0 : (reading > UINT16_MAX ? UINT16_MAX : (uint16_t)reading);
+}
@@ -0,0 +1,89 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _CALIBRATION_H_
+#define _CALIBRATION_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+//=====[Declaration of public defines]=========================================
+
+// The channel table scales readings to a 3.30 V full scale, the supply the
+// factory calibration of VREFINT was measured at
+#define CALIBRATION_SUPPLY_NOMINAL_MV   3300
+#define CALIBRATION_GAIN_ONE_Q16        65536UL
+
+// Plausible supplies for the F439, 1.8 V to 3.6 V; outside, VREFINT itself
+// reads wrong and the gain is clamped
+#define CALIBRATION_GAIN_MIN_Q16        (CALIBRATION_GAIN_ONE_Q16 * 1800 / \
+                                         CALIBRATION_SUPPLY_NOMINAL_MV)
+#define CALIBRATION_GAIN_MAX_Q16        (CALIBRATION_GAIN_ONE_Q16 * 3600 / \
+                                         CALIBRATION_SUPPLY_NOMINAL_MV)
+
+#define CALIBRATION_POINTS_MAX          4
+#define CALIBRATION_POINT_SPACING_MIN   1024  // Closer points replace each other
+
+// Readings index the table by their top bits: 64 segments of 1024 readings,
+// 16 codes of the 12-bit ADC each
+#define CALIBRATION_TABLE_SHIFT         10
+#define CALIBRATION_TABLE_LENGTH        ((65536 >> CALIBRATION_TABLE_SHIFT) + 1)
+
+//=====[Declaration of public data types]======================================
+
+// A reading taken at a known value: measured is what the channel read,
+// corrected for the supply, and reference the reading the channel table
+// maps to the known value. Readings use the 0 to 65535 scale of the sampler.
+typedef struct {
+    uint16_t measured;
+    uint16_t reference;
+} calibrationPoint_t;
+
+// User calibration of one channel, stored with the settings. No point keeps
+// the table's scaling, one shifts it, more are joined by straight lines and
+// extended past the outer ones.
+typedef struct {
+    uint8_t count;
+    uint8_t reserved[3];
+    calibrationPoint_t points[CALIBRATION_POINTS_MAX];  // Ascending
+} calibrationPoints_t;
+
+// Raw supply-relative reading to the reading the channel table expects, at
+// one supply gain: entry i holds the result for raw reading i << SHIFT
+typedef struct {
+    uint16_t readings[CALIBRATION_TABLE_LENGTH];
+} calibrationTable_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void calibrationPointsClear(calibrationPoints_t* points);
+bool calibrationPointsValid(const calibrationPoints_t* points);
+bool calibrationPointAdd(calibrationPoints_t* points, uint16_t measured,
+                         uint16_t reference);
+uint16_t calibrationCorrect(const calibrationPoints_t* points, uint16_t measured);
+uint16_t calibrationUncorrect(const calibrationPoints_t* points, uint16_t reference);
+
+uint32_t calibrationSupplyGainQ16(uint32_t vrefintCal, uint32_t vrefintReading);
+uint32_t calibrationSupplyMillivolts(uint32_t gainQ16);
+int32_t calibrationDieCentiCelsius(uint32_t tsCal30, uint32_t tsCal110,
+                                   uint32_t tsReading, uint32_t gainQ16);
+
+void calibrationTableBuild(calibrationTable_t* table, const calibrationPoints_t* points,
+                           uint32_t gainQ16);
+uint16_t calibrationTableInverse(const calibrationTable_t* table, uint16_t reading);
+
+//=====[Implementations of public functions]===================================
+
+// The per-scan correction: one table lookup and a multiply-add, inline so
+// the sampler's loop over a half-buffer keeps it in registers
+inline uint16_t calibrationTableApply(const calibrationTable_t* table, uint16_t raw) {
+    uint32_t index = raw >> CALIBRATION_TABLE_SHIFT;
+    int32_t low = table->readings[index];
+    int32_t step = (int32_t)table->readings[index + 1] - low;
+    int32_t fraction = raw & ((1 << CALIBRATION_TABLE_SHIFT) - 1);
+    return (uint16_t)(low + ((step * fraction) >> CALIBRATION_TABLE_SHIFT));
+}
+
+//=====[#include guards - end]=================================================
+
+#endif // _CALIBRATION_H_
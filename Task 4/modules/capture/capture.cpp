@@ -0,0 +1,126 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "capture.h"
+#include "memory_plan.h"
+#include "sampler.h"
+
+//=====[Declaration of private defines]========================================
+
+#define CAPTURE_RING_LENGTH    (CAPTURE_RING_SCANS * SENSOR_SCAN_CHANNEL_COUNT)
+
+static_assert(CAPTURE_RING_SCANS % SAMPLER_SCANS_PER_HALF == 0,
+              "Half-buffers must not wrap around the ring");
+static_assert(CAPTURE_PRE_TRIGGER_SCANS + CAPTURE_POST_TRIGGER_SCANS +
+              SAMPLER_SCANS_PER_HALF <= CAPTURE_RING_SCANS,
+              "Capture window does not fit in the ring");
+
+//=====[Declaration and initialization of private global variables]============
+
+#if CAPTURE_USE_CCM_RAM
+static_assert(CAPTURE_RING_LENGTH * sizeof(uint16_t) == MEMORY_PLAN_CAPTURE_RING_BYTES,
+              "Capture ring must match its place in the memory plan");
+static uint16_t* const ring = (uint16_t*)CCMDATARAM_BASE;
+#else
+static uint16_t ring[CAPTURE_RING_LENGTH];
+#endif
+
+// The sampler thread writes the ring; any other thread reads it only while
+// the capture is frozen, when the writer leaves it alone
+static volatile uint32_t state = CAPTURE_ARMED;
+static volatile uint32_t writtenScans = 0;   // Since boot, runs freely
+static uint32_t armedScans = 0;              // writtenScans when last armed
+static uint32_t triggerScans = 0;            // writtenScans at the trigger
+static uint32_t triggerTimeMs = 0;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void captureRawBlockStore(const samplerRawBlock_t* block);
+
+//=====[Implementations of public functions]===================================
+
+void captureInit() {
+    samplerRawBlockAttach(captureRawBlockStore);
+}
+
+// Starts the post-trigger phase; ignored unless armed. Safe from any thread.
+void captureTrigger() {
+    core_util_critical_section_enter();
+    if (state == CAPTURE_ARMED) {
+        triggerScans = writtenScans;
+        triggerTimeMs = (uint32_t)Kernel::get_ms_count();
+        state = CAPTURE_TRIGGERED;
+    }
+    core_util_critical_section_exit();
+}
+
+captureState_t captureStateGet() {
+    return (captureState_t)core_util_atomic_load_u32(&state);
+}
+
+bool captureInfoGet(captureInfo_t* info) {
+    if (captureStateGet() != CAPTURE_FROZEN) {
+        return false;
+    }
+    uint32_t first = triggerScans - CAPTURE_PRE_TRIGGER_SCANS;
+    if (triggerScans - armedScans < CAPTURE_PRE_TRIGGER_SCANS) {
+        first = armedScans;  // Triggered before a full pre-trigger window
+    }
+    info->scanCount = writtenScans - first;
+    info->triggerIndex = triggerScans - first;
+    info->triggerTimeMs = triggerTimeMs;
+    return true;
+}
+
+// Copies up to count scans from index of the frozen capture and returns how
+// many were copied
+uint32_t captureScansRead(uint32_t index, uint32_t count, uint16_t* scans) {
+    captureInfo_t info;
+    if (!captureInfoGet(&info) || index >= info.scanCount) {
+        return 0;
+    }
+    if (count > info.scanCount - index) {
+        count = info.scanCount - index;
+    }
+
+    uint32_t scan = writtenScans - info.scanCount + index;
+    for (uint32_t i = 0; i < count; ++i, ++scan) {
+        const uint16_t* source =
+            &ring[(scan % CAPTURE_RING_SCANS) * SENSOR_SCAN_CHANNEL_COUNT];
+        for (int channel = 0; channel < SENSOR_SCAN_CHANNEL_COUNT; ++channel) {
+            *scans++ = source[channel];
+        }
+    }
+    return count;
+}
+
+// Discards the frozen capture and starts recording again
+void captureRearm() {
+    if (captureStateGet() == CAPTURE_FROZEN) {
+        armedScans = writtenScans;
+        core_util_atomic_store_u32(&state, CAPTURE_ARMED);
+    }
+}
+
+//=====[Implementations of private functions]==================================
+
+// Runs in the sampler thread for every half-buffer
+static void captureRawBlockStore(const samplerRawBlock_t* block) {
+    uint32_t currentState = core_util_atomic_load_u32(&state);
+    if (currentState == CAPTURE_FROZEN) {
+        return;
+    }
+
+    uint32_t scans = writtenScans;
+    memcpy(&ring[(scans % CAPTURE_RING_SCANS) * SENSOR_SCAN_CHANNEL_COUNT], block->samples,
+           block->scanCount * SENSOR_SCAN_CHANNEL_COUNT * sizeof(uint16_t));
+    scans += block->scanCount;
+    core_util_atomic_store_u32(&writtenScans, scans);
+
+    if (currentState == CAPTURE_TRIGGERED &&
+        scans - triggerScans >= CAPTURE_POST_TRIGGER_SCANS) {
+        core_util_atomic_store_u32(&state, CAPTURE_FROZEN);
+    }
+}
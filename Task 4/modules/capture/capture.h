@@ -0,0 +1,49 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _CAPTURE_H_
+#define _CAPTURE_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+//=====[Declaration of public defines]=========================================
+
+#define CAPTURE_RING_SCANS          8192  // 48 KB, about 8 s at the scan rate
+#define CAPTURE_PRE_TRIGGER_SCANS   4000
+#define CAPTURE_POST_TRIGGER_SCANS  2000
+
+// The ring sits at the start of the 64 KB core-coupled RAM, which the DMA
+// cannot reach, ahead of the thread stacks (see memory_plan.h); set to 0 to
+// place it in main SRAM instead
+#ifndef CAPTURE_USE_CCM_RAM
+#define CAPTURE_USE_CCM_RAM         1
+#endif
+
+//=====[Declaration of public data types]======================================
+
+typedef enum {
+    CAPTURE_ARMED,      // Recording, waiting for a trigger
+    CAPTURE_TRIGGERED,  // Recording the post-trigger scans
+    CAPTURE_FROZEN,     // Holding a capture until captureRearm()
+} captureState_t;
+
+// Describes the frozen capture
+typedef struct {
+    uint32_t scanCount;     // Scans held, pre- and post-trigger
+    uint32_t triggerIndex;  // Index of the first scan after the trigger
+    uint32_t triggerTimeMs; // Kernel::get_ms_count() at the trigger
+} captureInfo_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void captureInit();
+void captureTrigger();
+captureState_t captureStateGet();
+bool captureInfoGet(captureInfo_t* info);
+uint32_t captureScansRead(uint32_t index, uint32_t count, uint16_t* scans);
+void captureRearm();
+
+//=====[#include guards - end]=================================================
+
+#endif // _CAPTURE_H_
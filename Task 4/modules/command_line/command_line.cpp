@@ -0,0 +1,195 @@
+//=====[Libraries]=============================================================
+
+#include <ctype.h>
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "command_line.h"
+#include "number_format.h"
+#include "pc_serial_com.h"
+
+//=====[Declaration of private defines]========================================
+
+#define COMMAND_LINE_PROMPT         "> "
+
+#define COMMAND_LINE_CTRL_C         0x03
+#define COMMAND_LINE_DELETE         0x7F
+
+//=====[Declaration and initialization of private global variables]============
+
+static const commandLineCommand_t* commandTable = nullptr;
+static int commandTableCount = 0;
+static void (*interruptCallback)() = nullptr;
+
+// The line being typed; tokens point into it while a command runs
+static char line[COMMAND_LINE_LENGTH];
+static int lineLength = 0;
+static char lastChar = '\0';
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void commandLineCharProcess(char receivedChar);
+static void commandLineExecute();
+static int commandLineTokenize(char* text, char** tokens);
+static void commandLineUsageWrite(const commandLineCommand_t* command);
+static char* commandLineUsageAppend(char* cursor, const char* end, const char* text,
+                                    bool* truncated);
+
+//=====[Implementations of public functions]===================================
+
+// Uses the caller's table, which must outlive the console. Ctrl-C calls
+// interrupt at once, without waiting for Enter.
+void commandLineInit(const commandLineCommand_t* commands, int commandCount,
+                     void (*interrupt)()) {
+    commandTable = commands;
+    commandTableCount = commandCount;
+    interruptCallback = interrupt;
+    pcSerialComStringWrite(COMMAND_LINE_PROMPT);
+}
+
+// Edits the line with every character received since the last call and runs
+// it on Enter; never waits for input
+void commandLineUpdate() {
+    char receivedChar;
+    while ((receivedChar = pcSerialComCharRead()) != '\0') {
+        commandLineCharProcess(receivedChar);
+    }
+}
+
+void commandLineHelpWrite() {
+    pcSerialComStringWrite("Commands:\r\n");
+    for (int i = 0; i < commandTableCount; ++i) {
+        commandLineUsageWrite(&commandTable[i]);
+    }
+}
+
+// Case-insensitive comparison of a whole token
+bool commandLineMatch(const char* token, const char* name) {
+    while (*token != '\0' && *name != '\0') {
+        if (tolower((unsigned char)*token) != tolower((unsigned char)*name)) {
+            return false;
+        }
+        token++;
+        name++;
+    }
+    return *token == '\0' && *name == '\0';
+}
+
+//=====[Implementations of private functions]==================================
+
+static void commandLineCharProcess(char receivedChar) {
+    char echo[2] = { receivedChar, '\0' };
+
+    switch (receivedChar) {
+    case '\n':
+        if (lastChar == '\r') {
+            break;  // Second half of a CR LF line ending
+        }
+        // fall through
+    case '\r':
+        pcSerialComStringWrite("\r\n");
+        commandLineExecute();
+        pcSerialComStringWrite(COMMAND_LINE_PROMPT);
+        break;
+    case '\b':
+    case COMMAND_LINE_DELETE:
+        if (lineLength > 0) {
+            lineLength--;
+            pcSerialComStringWrite("\b \b");
+        }
+        break;
+    case COMMAND_LINE_CTRL_C:
+        lineLength = 0;
+        pcSerialComStringWrite("^C\r\n");
+        if (interruptCallback != nullptr) {
+            interruptCallback();
+        }
+        pcSerialComStringWrite(COMMAND_LINE_PROMPT);
+        break;
+    default:
+        if (isprint((unsigned char)receivedChar) &&
+            lineLength < COMMAND_LINE_LENGTH - 1) {
+            line[lineLength++] = receivedChar;
+            pcSerialComStringWrite(echo);
+        }
+        break;
+    }
+    lastChar = receivedChar;
+}
+
+static void commandLineExecute() {
+    line[lineLength] = '\0';
+    lineLength = 0;
+
+    char* tokens[COMMAND_LINE_TOKENS_MAX];
+    int count = commandLineTokenize(line, tokens);
+    if (count == 0) {
+        return;
+    }
+
+    for (int i = 0; i < commandTableCount; ++i) {
+        const commandLineCommand_t* command = &commandTable[i];
+        if (commandLineMatch(tokens[0], command->name)) {
+            if (!command->handler(count, tokens)) {
+                pcSerialComStringWrite("Usage: ");
+                commandLineUsageWrite(command);
+            }
+            return;
+        }
+    }
+    pcSerialComStringWrite("Unknown command, 'help' lists them\r\n");
+}
+
+// Splits the text in place at spaces; tokens beyond the maximum stay joined
+// to the last one
+static int commandLineTokenize(char* text, char** tokens) {
+    int count = 0;
+    while (*text != '\0' && count < COMMAND_LINE_TOKENS_MAX) {
+        while (*text == ' ') {
+            *text++ = '\0';
+        }
+        if (*text == '\0') {
+            break;
+        }
+        tokens[count++] = text;
+        while (*text != ' ' && *text != '\0') {
+            text++;
+        }
+    }
+    return count;
+}
+
+// A line too long for the buffer is cut short and marked, still ending the
+// line, instead of running past it
+static void commandLineUsageWrite(const commandLineCommand_t* command) {
+    char str[COMMAND_LINE_LENGTH * 2] = "";
+    const char* end = str + sizeof(str) - sizeof("...\r\n");
+    bool truncated = false;
+    char* cursor = commandLineUsageAppend(str, end, " ", &truncated);
+    cursor = commandLineUsageAppend(cursor, end, command->name, &truncated);
+    if (command->usage[0] != '\0') {
+        cursor = commandLineUsageAppend(cursor, end, " ", &truncated);
+        cursor = commandLineUsageAppend(cursor, end, command->usage, &truncated);
+    }
+    cursor = commandLineUsageAppend(cursor, end, " - ", &truncated);
+    cursor = commandLineUsageAppend(cursor, end, command->help, &truncated);
+    if (truncated) {
+        cursor = numberFormatAppendString(cursor, "...");
+    }
+    numberFormatAppendString(cursor, "\r\n");
+    pcSerialComStringWrite(str);
+}
+
+// Appends as much of text as fits before end and flags what did not
+static char* commandLineUsageAppend(char* cursor, const char* end, const char* text,
+                                    bool* truncated) {
+    while (*text != '\0' && cursor < end) {
+        *cursor++ = *text++;
+    }
+    *cursor = '\0';
+    if (*text != '\0') {
+        *truncated = true;
+    }
+    return cursor;
+}
@@ -0,0 +1,37 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _COMMAND_LINE_H_
+#define _COMMAND_LINE_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+//=====[Declaration of public defines]=========================================
+
+#define COMMAND_LINE_LENGTH         80
+#define COMMAND_LINE_TOKENS_MAX     8   // Command name included
+
+//=====[Declaration of public data types]======================================
+
+// One entry of the caller's command table. The handler gets the tokens of
+// the line, argv[0] being the command name, split in place in the line
+// buffer; it returns false when the arguments do not fit the usage.
+typedef struct {
+    const char* name;
+    const char* usage;      // Arguments, printed by help and on misuse
+    const char* help;       // One-line description
+    bool (*handler)(int argc, char** argv);
+} commandLineCommand_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void commandLineInit(const commandLineCommand_t* commands, int commandCount,
+                     void (*interrupt)());
+void commandLineUpdate();
+void commandLineHelpWrite();
+bool commandLineMatch(const char* token, const char* name);
+
+//=====[#include guards - end]=================================================
+
+#endif // _COMMAND_LINE_H_
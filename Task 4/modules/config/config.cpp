@@ -0,0 +1,426 @@
+//=====[Libraries]=============================================================
+
+#include <string.h>
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+#include "FlashIAPBlockDevice.h"
+#include "TDBStore.h"
+
+#include "config.h"
+#include "command_line.h"
+#include "filters.h"
+#include "number_format.h"
+#include "pc_serial_com.h"
+#include "sampler.h"
+#include "spi_adc.h"
+#include "telemetry.h"
+
+//=====[Declaration of private defines]========================================
+
+#define CONFIG_KEY                  "settings"
+
+#define CONFIG_IIR_SHIFT_MAX        8
+#define CONFIG_PERIOD_MIN_MS        100
+
+//=====[Declaration of private data types]=====================================
+
+typedef enum {
+    CONFIG_FIELD_THRESHOLD,
+    CONFIG_FIELD_HYSTERESIS,
+    CONFIG_FIELD_TRIP_DWELL,
+    CONFIG_FIELD_CLEAR_DWELL,
+    CONFIG_FIELD_RATE,
+    CONFIG_FIELD_OVERSAMPLING,
+    CONFIG_FIELD_MEDIAN,
+    CONFIG_FIELD_IIR,
+    CONFIG_FIELD_COUNT,
+} configField_t;
+
+//=====[Declaration and initialization of private global variables]============
+
+static FlashIAPBlockDevice flash(CONFIG_FLASH_ADDRESS, CONFIG_FLASH_SIZE);
+static TDBStore store(&flash);
+static bool storeReady = false;
+
+// Published like the sampler snapshot: a change is written to the buffer
+// readers are not using and then made current by incrementing generation,
+// so the sampling pipeline picks up every setting at once
+static configSettings_t settingsBuffers[2];
+static volatile uint32_t generation = 0;
+static Mutex configMutex;  // Serializes writers
+
+// Console names of the per-channel fields, indexed by configField_t
+static const char* const configFieldNames[CONFIG_FIELD_COUNT] = {
+    "threshold", "hysteresis", "tripdwell", "cleardwell",
+    "rate", "oversampling", "median", "iir",
+};
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void configDefaultsGet(configSettings_t* settings);
+static bool configValid(const configSettings_t* settings);
+static void configPublish(const configSettings_t* settings);
+static bool configFieldSet(sensorChannelSettings_t* channel, configField_t field,
+                           const char* text);
+static void configShow();
+static void configCalibrationWrite(int channel, const calibrationPoints_t* points);
+
+//=====[Implementations of public functions]===================================
+
+// Loads the stored settings, or keeps the channel table defaults if there
+// are none or they do not fit this firmware
+void configInit() {
+    configDefaultsGet(&settingsBuffers[0]);
+
+    storeReady = (store.init() == MBED_SUCCESS);
+    if (!storeReady) {
+        return;
+    }
+
+    configSettings_t stored;
+    size_t actualSize = 0;
+    if (store.get(CONFIG_KEY, &stored, sizeof(stored), &actualSize) == MBED_SUCCESS &&
+        actualSize == sizeof(stored) && stored.version == CONFIG_VERSION &&
+        configValid(&stored)) {
+        configPublish(&stored);
+    }
+}
+
+// Copies the current settings; safe from any thread
+void configGet(configSettings_t* settings) {
+    uint32_t current;
+    do {
+        current = core_util_atomic_load_u32(&generation);
+        *settings = settingsBuffers[current & 1];
+    } while (current != core_util_atomic_load_u32(&generation));
+}
+
+// Changes whenever new settings are published, so users can cheaply check
+// whether to reapply them
+uint32_t configGeneration() {
+    return core_util_atomic_load_u32(&generation);
+}
+
+// Validates and publishes new settings; they are lost at reset unless saved
+bool configSet(const configSettings_t* settings) {
+    if (!configValid(settings)) {
+        return false;
+    }
+    configPublish(settings);
+    return true;
+}
+
+// Stores the current settings. TDBStore writes the new copy before it
+// retires the old one, so a reset meanwhile keeps one or the other.
+bool configSave() {
+    if (!storeReady) {
+        return false;
+    }
+    configSettings_t settings;
+    configGet(&settings);
+    return store.set(CONFIG_KEY, &settings, sizeof(settings), 0) == MBED_SUCCESS;
+}
+
+// Returns to the channel table defaults, now and after the next reset
+void configDefaultsRestore() {
+    configSettings_t settings;
+    configDefaultsGet(&settings);
+    configPublish(&settings);
+    if (storeReady) {
+        store.remove(CONFIG_KEY);
+    }
+}
+
+// "config" shows the settings, "config save" stores them and "config
+// defaults" returns to the channel table
+bool configCommand(int argc, char** argv) {
+    if (argc == 1) {
+        configShow();
+    } else if (argc == 2 && commandLineMatch(argv[1], "save")) {
+        pcSerialComStringWrite(configSave() ? "Settings saved\r\n"
+                                            : "Settings could not be saved\r\n");
+    } else if (argc == 2 && commandLineMatch(argv[1], "defaults")) {
+        configDefaultsRestore();
+        pcSerialComStringWrite("Default settings restored\r\n");
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// "set gas.threshold 0.45", "set lm35.tripdwell 500", "set status 500"...
+// Applies the change at once; "config save" keeps it after a reset.
+bool configSetCommand(int argc, char** argv) {
+    if (argc != 3) {
+        return false;
+    }
+
+    configSettings_t settings;
+    configGet(&settings);
+
+    bool parsed = false;
+    uint32_t periodMs;
+    if (commandLineMatch(argv[1], "status") || commandLineMatch(argv[1], "burst")) {
+        if (!numberFormatParseUnsigned(argv[2], &periodMs) || periodMs > UINT16_MAX) {
+            return false;
+        }
+        if (commandLineMatch(argv[1], "status")) {
+            settings.statusPeriodMs = (uint16_t)periodMs;
+        } else {
+            settings.burstPeriodMs = (uint16_t)periodMs;
+        }
+        parsed = true;
+    }
+
+    char* field = strchr(argv[1], '.');
+    if (!parsed && field != nullptr) {
+        *field++ = '\0';
+        for (int i = 0; i < SENSOR_CHANNEL_COUNT && !parsed; ++i) {
+            if (!commandLineMatch(argv[1], sensorChannels[i].name)) {
+                continue;
+            }
+            for (int f = 0; f < CONFIG_FIELD_COUNT; ++f) {
+                if (commandLineMatch(field, configFieldNames[f])) {
+                    parsed = configFieldSet(&settings.channels[i], (configField_t)f,
+                                            argv[2]);
+                    break;
+                }
+            }
+        }
+    }
+
+    if (!parsed) {
+        return false;
+    }
+    if (!configSet(&settings)) {
+        pcSerialComStringWrite("Value out of range, settings unchanged\r\n");
+    } else {
+        configShow();
+    }
+    return true;
+}
+
+// "calibrate" shows the supply and the calibration of each scan channel.
+// "calibrate lm35 22.00", with the sensor at a known 22.00, adds a point at
+// what it reads now; up to four points correct offset, gain and bends.
+// "calibrate lm35 clear" drops them. "config save" keeps them.
+bool configCalibrateCommand(int argc, char** argv) {
+    samplerSnapshot_t snapshot;
+    samplerSnapshotRead(&snapshot);
+    configSettings_t settings;
+    configGet(&settings);
+
+    if (argc == 1) {
+        char str[80] = "";
+        char* cursor = numberFormatAppendString(str, "Supply ");
+        cursor = numberFormatAppendHundredths(cursor, (snapshot.supplyMillivolts + 5) / 10);
+        cursor = numberFormatAppendString(cursor, " V, die ");
+        cursor = numberFormatAppendHundredths(cursor, snapshot.dieCentiCelsius);
+        numberFormatAppendString(cursor, " C\r\n");
+        pcSerialComStringWrite(str);
+        for (int i = 0; i < SENSOR_SCAN_CHANNEL_COUNT; ++i) {
+            configCalibrationWrite(i, &settings.calibrations[i]);
+        }
+        return true;
+    }
+    if (argc != 3) {
+        return false;
+    }
+
+    int channel = 0;
+    while (channel < SENSOR_SCAN_CHANNEL_COUNT &&
+           !commandLineMatch(argv[1], sensorChannels[channel].name)) {
+        channel++;
+    }
+    if (channel == SENSOR_SCAN_CHANNEL_COUNT) {
+        return false;
+    }
+
+    calibrationPoints_t* points = &settings.calibrations[channel];
+    int32_t value;
+    if (commandLineMatch(argv[2], "clear")) {
+        calibrationPointsClear(points);
+    } else if (numberFormatParseHundredths(argv[2], &value)) {
+        // The snapshot is already corrected by the points so far
+        uint16_t measured = calibrationUncorrect(points, snapshot.average[channel]);
+        uint16_t reference = sensorChannelValueToReading((sensorChannel_t)channel, value);
+        if (!calibrationPointAdd(points, measured, reference)) {
+            pcSerialComStringWrite("Point contradicts the others or all are taken, "
+                                   "calibration unchanged\r\n");
+            return true;
+        }
+    } else {
+        return false;
+    }
+    configSet(&settings);
+    configCalibrationWrite(channel, points);
+    return true;
+}
+
+//=====[Implementations of private functions]==================================
+
+static void configDefaultsGet(configSettings_t* settings) {
+    settings->version = CONFIG_VERSION;
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; ++i) {
+        settings->channels[i] = sensorChannelDefaultSettings((sensorChannel_t)i);
+    }
+    settings->statusPeriodMs = TELEMETRY_PRINT_PERIOD_MS;
+    settings->burstPeriodMs = SAMPLER_BURST_PERIOD_MS;
+    for (int i = 0; i < SENSOR_SCAN_CHANNEL_COUNT; ++i) {
+        calibrationPointsClear(&settings->calibrations[i]);
+    }
+}
+
+// Limits of the filter stages and of each channel's converter; thresholds
+// are free
+static bool configValid(const configSettings_t* settings) {
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; ++i) {
+        const sensorChannelSettings_t* channel = &settings->channels[i];
+        uint32_t samplesPerBlock = sensorChannels[i].source == SENSOR_SOURCE_SPI_ADC
+                                       ? SPI_ADC_SAMPLES_PER_BLOCK
+                                       : SAMPLER_SCANS_PER_HALF;
+        if (channel->hysteresis < 0 || channel->rateTrip < 0 ||
+            channel->oversamplingLog2 >= 32 ||
+            (1UL << channel->oversamplingLog2) > samplesPerBlock ||
+            channel->medianLength > FILTER_MEDIAN_LENGTH_MAX ||
+            (channel->medianLength > 1 && channel->medianLength % 2 == 0) ||
+            channel->iirShift > CONFIG_IIR_SHIFT_MAX) {
+            return false;
+        }
+    }
+    for (int i = 0; i < SENSOR_SCAN_CHANNEL_COUNT; ++i) {
+        if (!calibrationPointsValid(&settings->calibrations[i])) {
+            return false;
+        }
+    }
+    return settings->statusPeriodMs >= CONFIG_PERIOD_MIN_MS &&
+           settings->burstPeriodMs >= CONFIG_PERIOD_MIN_MS;
+}
+
+static void configPublish(const configSettings_t* settings) {
+    configMutex.lock();
+    uint32_t next = generation + 1;
+    settingsBuffers[next & 1] = *settings;
+    settingsBuffers[next & 1].version = CONFIG_VERSION;
+    core_util_atomic_store_u32(&generation, next);
+    configMutex.unlock();
+}
+
+static bool configFieldSet(sensorChannelSettings_t* channel, configField_t field,
+                           const char* text) {
+    int32_t hundredths;
+    uint32_t value;
+
+    switch (field) {
+    case CONFIG_FIELD_THRESHOLD:
+    case CONFIG_FIELD_HYSTERESIS:
+    case CONFIG_FIELD_RATE:
+        if (!numberFormatParseHundredths(text, &hundredths)) {
+            return false;
+        }
+        if (field == CONFIG_FIELD_THRESHOLD) {
+            channel->tripThreshold = hundredths;
+        } else if (field == CONFIG_FIELD_HYSTERESIS) {
+            channel->hysteresis = hundredths;
+        } else {
+            channel->rateTrip = hundredths;
+        }
+        return true;
+    default:
+        break;
+    }
+
+    if (!numberFormatParseUnsigned(text, &value) || value > UINT16_MAX) {
+        return false;
+    }
+    switch (field) {
+    case CONFIG_FIELD_TRIP_DWELL:   channel->tripDwellMs = (uint16_t)value; break;
+    case CONFIG_FIELD_CLEAR_DWELL:  channel->clearDwellMs = (uint16_t)value; break;
+    case CONFIG_FIELD_OVERSAMPLING:
+    case CONFIG_FIELD_MEDIAN:
+    case CONFIG_FIELD_IIR:
+        if (value > UINT8_MAX) {
+            return false;
+        }
+        if (field == CONFIG_FIELD_OVERSAMPLING) {
+            channel->oversamplingLog2 = (uint8_t)value;
+        } else if (field == CONFIG_FIELD_MEDIAN) {
+            channel->medianLength = (uint8_t)value;
+        } else {
+            channel->iirShift = (uint8_t)value;
+        }
+        break;
+    default:
+        return false;
+    }
+    return true;
+}
+
+// "LM35: threshold 24.00, hysteresis 0.50, dwell 1000/3000 ms, rate 1.00/s,
+// oversampling 5, median 0, iir 2", then the periods
+static void configShow() {
+    configSettings_t settings;
+    configGet(&settings);
+
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; ++i) {
+        const sensorChannelSettings_t* channel = &settings.channels[i];
+        char str[160] = "";
+        char* cursor = numberFormatAppendString(str, sensorChannels[i].name);
+        if (sensorChannels[i].alarmEnabled) {
+            cursor = numberFormatAppendString(cursor, ": threshold ");
+            cursor = numberFormatAppendHundredths(cursor, channel->tripThreshold);
+            cursor = numberFormatAppendString(cursor, ", hysteresis ");
+            cursor = numberFormatAppendHundredths(cursor, channel->hysteresis);
+            cursor = numberFormatAppendString(cursor, ", dwell ");
+            cursor = numberFormatAppendUnsigned(cursor, channel->tripDwellMs);
+            cursor = numberFormatAppendString(cursor, "/");
+            cursor = numberFormatAppendUnsigned(cursor, channel->clearDwellMs);
+            cursor = numberFormatAppendString(cursor, " ms, rate ");
+            cursor = numberFormatAppendHundredths(cursor, channel->rateTrip);
+            cursor = numberFormatAppendString(cursor, "/s,");
+        } else {
+            cursor = numberFormatAppendString(cursor, ":");
+        }
+        cursor = numberFormatAppendString(cursor, " oversampling ");
+        cursor = numberFormatAppendUnsigned(cursor, channel->oversamplingLog2);
+        cursor = numberFormatAppendString(cursor, ", median ");
+        cursor = numberFormatAppendUnsigned(cursor, channel->medianLength);
+        cursor = numberFormatAppendString(cursor, ", iir ");
+        cursor = numberFormatAppendUnsigned(cursor, channel->iirShift);
+        numberFormatAppendString(cursor, "\r\n");
+        pcSerialComStringWrite(str);
+        if (i < SENSOR_SCAN_CHANNEL_COUNT && settings.calibrations[i].count > 0) {
+            configCalibrationWrite(i, &settings.calibrations[i]);
+        }
+    }
+
+    char str[80] = "";
+    char* cursor = numberFormatAppendString(str, "Status period ");
+    cursor = numberFormatAppendUnsigned(cursor, settings.statusPeriodMs);
+    cursor = numberFormatAppendString(cursor, " ms, burst period ");
+    cursor = numberFormatAppendUnsigned(cursor, settings.burstPeriodMs);
+    numberFormatAppendString(cursor, " ms\r\n");
+    pcSerialComStringWrite(str);
+}
+
+// "LM35 calibration: read 21.40 at 22.00, 79.10 at 80.00", in channel units
+static void configCalibrationWrite(int channel, const calibrationPoints_t* points) {
+    char str[160] = "";
+    char* cursor = numberFormatAppendString(str, sensorChannels[channel].name);
+    cursor = numberFormatAppendString(cursor, " calibration: ");
+    if (points->count == 0) {
+        cursor = numberFormatAppendString(cursor, "none, table scaling");
+    }
+    for (int i = 0; i < points->count; ++i) {
+        const calibrationPoint_t* point = &points->points[i];
+        cursor = numberFormatAppendString(cursor, i == 0 ? "read " : ", ");
+        cursor = numberFormatAppendHundredths(
+            cursor, sensorChannelValue((sensorChannel_t)channel, point->measured));
+        cursor = numberFormatAppendString(cursor, " at ");
+        cursor = numberFormatAppendHundredths(
+            cursor, sensorChannelValue((sensorChannel_t)channel, point->reference));
+    }
+    numberFormatAppendString(cursor, "\r\n");
+    pcSerialComStringWrite(str);
+}
@@ -0,0 +1,46 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _CONFIG_H_
+#define _CONFIG_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+#include "calibration.h"
+#include "sensor_channels.h"
+
+//=====[Declaration of public defines]=========================================
+
+// Sectors 22 and 23 (2 x 128 KB) of flash bank 2, one TDBStore area each
+#define CONFIG_FLASH_ADDRESS        0x081C0000
+#define CONFIG_FLASH_SIZE           (256 * 1024)
+
+#define CONFIG_VERSION              2  // Stored settings of another version are ignored
+
+//=====[Declaration of public data types]======================================
+
+// Everything that can be tuned per site without re-flashing
+typedef struct {
+    uint32_t version;
+    sensorChannelSettings_t channels[SENSOR_CHANNEL_COUNT];
+    uint16_t statusPeriodMs;    // Telemetry status print period
+    uint16_t burstPeriodMs;     // Between half-buffers in low-power mode
+    calibrationPoints_t calibrations[SENSOR_SCAN_CHANNEL_COUNT];  // ADC3 channels
+} configSettings_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void configInit();
+void configGet(configSettings_t* settings);
+uint32_t configGeneration();
+bool configSet(const configSettings_t* settings);
+bool configSave();
+void configDefaultsRestore();
+bool configCommand(int argc, char** argv);
+bool configSetCommand(int argc, char** argv);
+bool configCalibrateCommand(int argc, char** argv);
+
+//=====[#include guards - end]=================================================
+
+#endif // _CONFIG_H_
@@ -0,0 +1,220 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+#include "FlashIAPBlockDevice.h"
+
+#include "data_log.h"
+#include "alarm.h"
+#include "frame_codec.h"
+#include "memory_plan.h"
+#include "sampler.h"
+#include "supervisor.h"
+
+//=====[Declaration of private defines]========================================
+
+#define DATA_LOG_PAGE_COUNT         (DATA_LOG_FLASH_SIZE / DATA_LOG_PAGE_SIZE)
+
+#define DATA_LOG_FLAG_FLUSH         (1UL << 0)
+#define DATA_LOG_FLAG_FLUSHED       (1UL << 1)
+#define DATA_LOG_FLUSH_TIMEOUT_MS   3000  // A sector erase takes up to 2 s
+
+
+//=====[Declaration and initialization of private global variables]============
+
+static FlashIAPBlockDevice flash(DATA_LOG_FLASH_ADDRESS, DATA_LOG_FLASH_SIZE);
+
+// Below every other thread: only this thread waits for the flash
+static Thread dataLogThread(osPriorityLow,
+                            memoryPlanStackSize(MEMORY_PLAN_STACK_DATA_LOG),
+                            memoryPlanStackMemory(MEMORY_PLAN_STACK_DATA_LOG),
+                            memoryPlanStackName(MEMORY_PLAN_STACK_DATA_LOG));
+static EventFlags dataLogFlags;
+
+static bool flashReady = false;
+static uint16_t bootId = 0;
+static uint32_t nextSequence = 0;
+static volatile bool pagesWritten = false;  // At least one page in the log
+static volatile uint32_t lastSequence = 0;
+
+// Only the log thread touches the page being filled
+static dataLogPage_t batch;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void dataLogTask();
+static void dataLogScan();
+static void dataLogRecordAppend();
+static bool dataLogBatchWrite();
+static bool dataLogPageValid(const dataLogPage_t* page);
+static bd_addr_t dataLogPageAddress(uint32_t sequence);
+
+//=====[Implementations of public functions]===================================
+
+// Finds the end of the log and starts recording a snapshot every period
+void dataLogInit() {
+    flashReady = (flash.init() == 0);
+    if (flashReady) {
+        dataLogScan();
+    }
+    dataLogThread.start(dataLogTask);
+}
+
+// Writes the partial batch, waiting for the flash; false on timeout or error
+bool dataLogFlush() {
+    if (!flashReady) {
+        return false;
+    }
+    dataLogFlags.clear(DATA_LOG_FLAG_FLUSHED);
+    dataLogFlags.set(DATA_LOG_FLAG_FLUSH);
+    uint32_t flags = dataLogFlags.wait_any(DATA_LOG_FLAG_FLUSHED, DATA_LOG_FLUSH_TIMEOUT_MS);
+    return !(flags & osFlagsError);
+}
+
+// Sequence numbers of the oldest and newest pages that may still be held
+bool dataLogSequenceRange(uint32_t* first, uint32_t* last) {
+    if (!pagesWritten) {
+        return false;
+    }
+    *last = lastSequence;
+    *first = (*last >= DATA_LOG_PAGE_COUNT) ? *last - DATA_LOG_PAGE_COUNT + 1 : 0;
+    return true;
+}
+
+// Reads one page back; false if it was erased or never written. Safe from any
+// thread: the block device serializes access with the log thread.
+bool dataLogPageRead(uint32_t sequence, dataLogPage_t* page) {
+    if (!flashReady ||
+        flash.read(page, dataLogPageAddress(sequence), sizeof(*page)) != 0) {
+        return false;
+    }
+    return dataLogPageValid(page) && page->header.sequence == sequence;
+}
+
+//=====[Implementations of private functions]==================================
+
+static void dataLogTask() {
+    uint64_t nextRecordMs = Kernel::get_ms_count();
+
+    while (true) {
+        uint64_t nowMs = Kernel::get_ms_count();
+        uint32_t timeoutMs = nextRecordMs > nowMs ? (uint32_t)(nextRecordMs - nowMs) : 0;
+        uint32_t flags = dataLogFlags.wait_any(DATA_LOG_FLAG_FLUSH, timeoutMs);
+
+        if (!(flags & osFlagsError) && (flags & DATA_LOG_FLAG_FLUSH)) {
+            if (batch.header.recordCount > 0) {
+                dataLogBatchWrite();
+            }
+            dataLogFlags.set(DATA_LOG_FLAG_FLUSHED);
+            continue;
+        }
+
+        dataLogRecordAppend();
+        supervisorDeadlineNext(SUPERVISOR_TASK_DATA_LOG, &nextRecordMs,
+                               DATA_LOG_RECORD_PERIOD_MS, Kernel::get_ms_count());
+        if (batch.header.recordCount == DATA_LOG_RECORDS_PER_PAGE) {
+            dataLogBatchWrite();
+        }
+    }
+}
+
+// Reads every page header once at boot to find the newest page and boot
+static void dataLogScan() {
+    dataLogPageHeader_t header;
+    bool found = false;
+    uint32_t newest = 0;
+
+    for (uint32_t i = 0; i < DATA_LOG_PAGE_COUNT; ++i) {
+        if (flash.read(&header, (bd_addr_t)i * DATA_LOG_PAGE_SIZE, sizeof(header)) != 0 ||
+            header.magic != DATA_LOG_PAGE_MAGIC || header.version != DATA_LOG_VERSION) {
+            continue;
+        }
+        if (!found || header.sequence > newest) {
+            newest = header.sequence;
+            bootId = header.bootId + 1;
+            found = true;
+        }
+    }
+
+    if (found) {
+        lastSequence = newest;
+        pagesWritten = true;
+        nextSequence = newest + 1;
+    }
+}
+
+static void dataLogRecordAppend() {
+    samplerSnapshot_t snapshot;
+    samplerSnapshotRead(&snapshot);
+
+    dataLogRecord_t* record = &batch.records[batch.header.recordCount++];
+    record->uptimeMs = (uint32_t)Kernel::get_ms_count();
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; ++i) {
+        record->average[i] = snapshot.average[i];
+    }
+    record->alarms = (alarmGasDetected() ? 1U << 0 : 0) |
+                     (alarmTempExceeded() ? 1U << 1 : 0);
+    memset(record->reserved, 0, sizeof(record->reserved));
+}
+
+// Programs the batch as the next page, erasing the sector it starts first.
+// The batch is emptied even on failure, so a bad sector cannot stall the log.
+static bool dataLogBatchWrite() {
+    bool written = false;
+
+    if (flashReady) {
+        batch.header.magic = DATA_LOG_PAGE_MAGIC;
+        batch.header.sequence = nextSequence;
+        batch.header.bootId = bootId;
+        batch.header.version = DATA_LOG_VERSION;
+        batch.header.crc = frameCodecCrc16(FRAME_CODEC_CRC16_INIT,
+                                           (const uint8_t*)batch.records,
+                                           batch.header.recordCount * sizeof(dataLogRecord_t));
+        batch.header.reserved = 0;
+
+        // Pages ahead are erased, unless a reset interrupted the previous
+        // lap; the rest of such a sector is skipped, not erased under the
+        // pages just written to it
+        bd_addr_t address = dataLogPageAddress(nextSequence);
+        bd_size_t eraseSize = flash.get_erase_size(address);
+        dataLogPageHeader_t existing;
+        flash.read(&existing, address, sizeof(existing));
+        if (address % eraseSize != 0 && existing.magic != 0xFFFFFFFFUL) {
+            nextSequence += (eraseSize - address % eraseSize) / DATA_LOG_PAGE_SIZE;
+            batch.header.sequence = nextSequence;
+            address = dataLogPageAddress(nextSequence);
+            eraseSize = flash.get_erase_size(address);
+        }
+        bool eraseOk = true;
+        if (address % eraseSize == 0) {
+            eraseOk = (flash.erase(address, eraseSize) == 0);
+        }
+
+        // Unused records stay in the erased state
+        memset(&batch.records[batch.header.recordCount], 0xFF,
+               sizeof(batch.records) - batch.header.recordCount * sizeof(dataLogRecord_t));
+        if (eraseOk && flash.program(&batch, address, sizeof(batch)) == 0) {
+            lastSequence = nextSequence;
+            pagesWritten = true;
+            written = true;
+        }
+        nextSequence++;
+    }
+
+    batch.header.recordCount = 0;
+    return written;
+}
+
+static bool dataLogPageValid(const dataLogPage_t* page) {
+    return page->header.magic == DATA_LOG_PAGE_MAGIC &&
+           page->header.version == DATA_LOG_VERSION &&
+           page->header.recordCount <= DATA_LOG_RECORDS_PER_PAGE &&
+           page->header.crc == frameCodecCrc16(FRAME_CODEC_CRC16_INIT,
+                                               (const uint8_t*)page->records,
+                                               page->header.recordCount *
+                                               sizeof(dataLogRecord_t));
+}
+
+static bd_addr_t dataLogPageAddress(uint32_t sequence) {
+    return (bd_addr_t)(sequence % DATA_LOG_PAGE_COUNT) * DATA_LOG_PAGE_SIZE;
+}
@@ -0,0 +1,74 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _DATA_LOG_H_
+#define _DATA_LOG_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+#include "sensor_channels.h"
+
+//=====[Declaration of public defines]=========================================
+
+// Sectors 20 and 21 (2 x 128 KB) of flash bank 2. The firmware runs from
+// bank 1, so erasing and programming here never stalls instruction fetches.
+#define DATA_LOG_FLASH_ADDRESS      0x08180000
+#define DATA_LOG_FLASH_SIZE         (256 * 1024)
+
+#define DATA_LOG_PAGE_SIZE          256   // Batch written at once
+#define DATA_LOG_RECORD_PERIOD_MS   1000  // 20 records per page, 3 to 6 hours kept
+
+#define DATA_LOG_PAGE_MAGIC         0x31474F4CUL  // "LOG1" in memory order
+#define DATA_LOG_VERSION            1
+
+// Pads a record to a whole number of words for any channel count
+#define DATA_LOG_RECORD_RESERVED    (1 + 2 * ((SENSOR_CHANNEL_COUNT + 1) % 2))
+
+//=====[Declaration of public data types]======================================
+
+// One filtered snapshot; little-endian like the rest of the binary formats
+typedef struct {
+    uint32_t uptimeMs;      // Since the boot identified by the page
+    uint16_t average[SENSOR_CHANNEL_COUNT];
+    uint8_t alarms;         // Bit 0 gas detected, bit 1 temperature exceeded
+    uint8_t reserved[DATA_LOG_RECORD_RESERVED];
+} dataLogRecord_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t sequence;      // Page number since the log was created
+    uint16_t bootId;        // Incremented on every boot
+    uint8_t version;
+    uint8_t recordCount;
+    uint16_t crc;           // CRC-16/CCITT-FALSE of the records
+    uint16_t reserved;
+} dataLogPageHeader_t;
+
+#define DATA_LOG_RECORDS_PER_PAGE   ((DATA_LOG_PAGE_SIZE - sizeof(dataLogPageHeader_t)) / \
+                                     sizeof(dataLogRecord_t))
+
+// Pages are written in sequence order around the region; the sector ahead is
+// erased before the first page goes into it, so each sector is erased once
+// per lap and the oldest sector is the one lost.
+typedef struct {
+    dataLogPageHeader_t header;
+    dataLogRecord_t records[DATA_LOG_RECORDS_PER_PAGE];
+} dataLogPage_t;
+
+static_assert(sizeof(dataLogRecord_t) == sizeof(uint32_t) +
+              SENSOR_CHANNEL_COUNT * sizeof(uint16_t) + 1 + DATA_LOG_RECORD_RESERVED,
+              "Record must not be padded");
+static_assert(sizeof(dataLogPageHeader_t) == 16, "Header must not be padded");
+static_assert(sizeof(dataLogPage_t) <= DATA_LOG_PAGE_SIZE, "Page too large");
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void dataLogInit();
+bool dataLogFlush();
+bool dataLogSequenceRange(uint32_t* first, uint32_t* last);
+bool dataLogPageRead(uint32_t sequence, dataLogPage_t* page);
+
+//=====[#include guards - end]=================================================
+
+#endif // _DATA_LOG_H_
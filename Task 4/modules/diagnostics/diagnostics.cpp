@@ -0,0 +1,168 @@
+//=====[Libraries]=============================================================
+
+#include <string.h>
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "diagnostics.h"
+#include "memory_plan.h"
+#include "number_format.h"
+#include "pc_serial_com.h"
+#include "pipeline.h"
+#include "sampler.h"
+
+//=====[Declaration of private defines]========================================
+
+#define DIAGNOSTICS_FLAG_SNAPSHOT   (1UL << 0)
+
+//=====[Declaration and initialization of private global variables]============
+
+// Below everything but the idle thread: the checks only need to keep up on
+// average, as a lag of a few snapshots is folded into the next period
+static Thread diagnosticsThread(osPriorityLow,
+                                memoryPlanStackSize(MEMORY_PLAN_STACK_DIAGNOSTICS),
+                                memoryPlanStackMemory(MEMORY_PLAN_STACK_DIAGNOSTICS),
+                                memoryPlanStackName(MEMORY_PLAN_STACK_DIAGNOSTICS));
+static EventFlags diagnosticsFlags;
+
+static pipelineHealth_t health;
+
+// Published like the settings: readers copy the buffer generation selects
+static diagnosticsHealth_t healthBuffers[2];
+static volatile uint32_t generation = 0;
+static volatile uint32_t faultChannels = 0;  // Bit per channel
+
+// Indexed by flag bit, as the console and status lines name them
+static const char* const flagNames[] = {
+    "rail low", "rail high", "stuck", "noisy", "implausible rate", "heater off",
+    "warming up",
+};
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void diagnosticsTask();
+static void diagnosticsSnapshotReady();
+static void diagnosticsPublish(const uint8_t* flags, uint32_t sequence);
+
+//=====[Implementations of public functions]===================================
+
+// Starts the diagnostics thread; the sampler must already be running
+void diagnosticsInit() {
+    pipelineHealthInit(&health);
+    memset(healthBuffers, 0, sizeof(healthBuffers));
+
+    diagnosticsThread.start(diagnosticsTask);
+    samplerHalfBufferAttach(diagnosticsSnapshotReady);
+}
+
+// Copies the latest flags; safe from any thread
+void diagnosticsHealthGet(diagnosticsHealth_t* state) {
+    uint32_t current;
+    do {
+        current = core_util_atomic_load_u32(&generation);
+        *state = healthBuffers[current & 1];
+    } while (current != core_util_atomic_load_u32(&generation));
+}
+
+// Some channel has a fault flag up; warming up is not a fault
+bool diagnosticsFaultActive() {
+    return faultChannels != 0;
+}
+
+// "rail low, noisy", or "ok" without flags
+char* diagnosticsFlagsAppend(char* cursor, uint8_t flags) {
+    if (flags == 0) {
+        return numberFormatAppendString(cursor, "ok");
+    }
+    bool first = true;
+    for (size_t bit = 0; bit < sizeof(flagNames) / sizeof(flagNames[0]); ++bit) {
+        if (flags & (1U << bit)) {
+            if (!first) {
+                cursor = numberFormatAppendString(cursor, ", ");
+            }
+            cursor = numberFormatAppendString(cursor, flagNames[bit]);
+            first = false;
+        }
+    }
+    return cursor;
+}
+
+// "LM35: rail low" per channel, then "Checked up to snapshot 18532, 3 changes"
+void diagnosticsReportWrite() {
+    diagnosticsHealth_t state;
+    diagnosticsHealthGet(&state);
+
+    char str[100] = "";
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; ++i) {
+        str[0] = '\0';
+        char* cursor = numberFormatAppendString(str, sensorChannels[i].name);
+        cursor = numberFormatAppendString(cursor, ": ");
+        if (sensorKindHealth[sensorChannels[i].kind].enabled) {
+            cursor = diagnosticsFlagsAppend(cursor, state.flags[i]);
+        } else {
+            cursor = numberFormatAppendString(cursor, "not checked");
+        }
+        numberFormatAppendString(cursor, "\r\n");
+        pcSerialComStringWrite(str);
+    }
+
+    str[0] = '\0';
+    char* cursor = numberFormatAppendString(str, "Checked up to snapshot ");
+    cursor = numberFormatAppendUnsigned(cursor, state.sequence);
+    cursor = numberFormatAppendString(cursor, ", ");
+    cursor = numberFormatAppendUnsigned(cursor, state.changes);
+    numberFormatAppendString(cursor, " changes\r\n");
+    pcSerialComStringWrite(str);
+}
+
+//=====[Implementations of private functions]==================================
+
+static void diagnosticsTask() {
+    uint32_t checkedSequence = 0;
+
+    while (true) {
+        diagnosticsFlags.wait_any(DIAGNOSTICS_FLAG_SNAPSHOT);
+
+        samplerSnapshot_t snapshot;
+        samplerSnapshotRead(&snapshot);
+        uint32_t blocks = checkedSequence != 0 ? snapshot.sequence - checkedSequence : 1;
+        if (blocks == 0) {
+            continue;
+        }
+        checkedSequence = snapshot.sequence;
+
+        uint8_t flags[SENSOR_CHANNEL_COUNT];
+        pipelineHealthUpdate(&health, snapshot.average, snapshot.minimum,
+                             snapshot.maximum, blocks * samplerSnapshotPeriodMs(),
+                             (uint32_t)Kernel::get_ms_count(), flags);
+        diagnosticsPublish(flags, snapshot.sequence);
+    }
+}
+
+// Runs in the sampler thread
+static void diagnosticsSnapshotReady() {
+    diagnosticsFlags.set(DIAGNOSTICS_FLAG_SNAPSHOT);
+}
+
+// Only called from the diagnostics thread
+static void diagnosticsPublish(const uint8_t* flags, uint32_t sequence) {
+    const diagnosticsHealth_t* current = &healthBuffers[generation & 1];
+    uint32_t next = generation + 1;
+    diagnosticsHealth_t* state = &healthBuffers[next & 1];
+
+    uint32_t faults = 0;
+    state->changes = current->changes;
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; ++i) {
+        if (flags[i] != current->flags[i]) {
+            state->changes++;
+        }
+        if (flags[i] & FAULT_DETECT_FAULTS) {
+            faults |= 1UL << i;
+        }
+        state->flags[i] = flags[i];
+    }
+    state->sequence = sequence;
+    core_util_atomic_store_u32(&generation, next);
+    faultChannels = faults;
+}
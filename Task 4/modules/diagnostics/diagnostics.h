@@ -0,0 +1,32 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _DIAGNOSTICS_H_
+#define _DIAGNOSTICS_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+#include "fault_detect.h"
+#include "sensor_channels.h"
+
+//=====[Declaration of public data types]======================================
+
+// Health of every channel, FAULT_DETECT_* flags indexed like the table
+typedef struct {
+    uint8_t flags[SENSOR_CHANNEL_COUNT];
+    uint32_t sequence;      // Snapshot the flags were last checked on
+    uint32_t changes;       // Flag changes since boot
+} diagnosticsHealth_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void diagnosticsInit();
+void diagnosticsHealthGet(diagnosticsHealth_t* state);
+bool diagnosticsFaultActive();
+char* diagnosticsFlagsAppend(char* cursor, uint8_t flags);
+void diagnosticsReportWrite();
+
+//=====[#include guards - end]=================================================
+
+#endif // _DIAGNOSTICS_H_
@@ -0,0 +1,126 @@
+//=====[Libraries]=============================================================
+
+#include "fault_detect.h"
+
+//=====[Declaration and initialization of private global variables]============
+
+// Indexed by faultDetectCheck_t
+static const uint8_t faultDetectCheckFlags[FAULT_DETECT_CHECK_COUNT] = {
+    FAULT_DETECT_RAIL_LOW, FAULT_DETECT_RAIL_HIGH, FAULT_DETECT_NOISY,
+    FAULT_DETECT_RATE, FAULT_DETECT_HEATER,
+};
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void faultDetectChangeUpdate(faultDetectState_t* state, uint16_t average,
+                                    int64_t* mean, int64_t* variance);
+static bool faultDetectStuckUpdate(faultDetectState_t* state,
+                                   const faultDetectConfig_t* config,
+                                   const faultDetectBlock_t* block, uint32_t periodMs);
+
+//=====[Implementations of public functions]===================================
+
+void faultDetectInit(faultDetectState_t* state) {
+    for (int i = 0; i < FAULT_DETECT_CHECK_COUNT; ++i) {
+        state->evidenceMs[i] = 0;
+    }
+    state->primed = false;
+    state->previous = 0;
+    state->changeSum = 0;
+    state->changeSquaresSum = 0;
+    state->stuckReading = 0;
+    state->stuckForMs = 0;
+    state->flags = 0;
+}
+
+// Checks one snapshot, taken periodMs after the last, at nowMs since boot
+// and returns the channel's flags
+uint8_t faultDetectUpdate(faultDetectState_t* state, const faultDetectConfig_t* config,
+                          const faultDetectBlock_t* block, uint32_t periodMs,
+                          uint32_t nowMs) {
+    if (nowMs < config->warmupMs) {
+        faultDetectInit(state);
+        state->flags = FAULT_DETECT_WARMING_UP;
+        return state->flags;
+    }
+
+    bool evidence[FAULT_DETECT_CHECK_COUNT];
+    evidence[FAULT_DETECT_CHECK_RAIL_LOW] =
+        config->railLowReading != 0 && block->maximum <= config->railLowReading;
+    evidence[FAULT_DETECT_CHECK_RAIL_HIGH] =
+        config->railHighReading != 0 && block->minimum >= config->railHighReading;
+    evidence[FAULT_DETECT_CHECK_HEATER] =
+        config->heaterReading != 0 && block->average < config->heaterReading;
+
+    // A steady ramp moves the mean change, noise the scatter around it
+    int64_t mean;
+    int64_t variance;
+    faultDetectChangeUpdate(state, block->average, &mean, &variance);
+    int64_t noiseLimit = config->noiseReading;
+    evidence[FAULT_DETECT_CHECK_NOISY] =
+        config->noiseReading != 0 && variance > noiseLimit * noiseLimit;
+    evidence[FAULT_DETECT_CHECK_RATE] =
+        config->ratePerSecond != 0 &&
+        (mean < 0 ? -mean : mean) * 1000 > (int64_t)config->ratePerSecond * periodMs;
+
+    uint8_t flags = state->flags & ~FAULT_DETECT_STUCK;
+    for (int i = 0; i < FAULT_DETECT_CHECK_COUNT; ++i) {
+        uint32_t* evidenceMs = &state->evidenceMs[i];
+        if (evidence[i]) {
+            *evidenceMs = *evidenceMs + periodMs < config->dwellMs
+                          ? *evidenceMs + periodMs : config->dwellMs;
+            if (*evidenceMs >= config->dwellMs) {
+                flags |= faultDetectCheckFlags[i];
+            }
+        } else {
+            *evidenceMs = *evidenceMs > periodMs ? *evidenceMs - periodMs : 0;
+            if (*evidenceMs == 0) {
+                flags &= ~faultDetectCheckFlags[i];
+            }
+        }
+    }
+    flags &= ~FAULT_DETECT_WARMING_UP;
+
+    if (faultDetectStuckUpdate(state, config, block, periodMs)) {
+        flags |= FAULT_DETECT_STUCK;
+    }
+    state->flags = flags;
+    return flags;
+}
+
+//=====[Implementations of private functions]==================================
+
+// Exponentially weighted mean and variance of the change between snapshots
+static void faultDetectChangeUpdate(faultDetectState_t* state, uint16_t average,
+                                    int64_t* mean, int64_t* variance) {
+    const int64_t weight = 1 << FAULT_DETECT_SMOOTHING_SHIFT;
+    if (state->primed) {
+        int64_t change = (int64_t)average - (int64_t)state->previous;
+        state->changeSum += change - state->changeSum / weight;
+        state->changeSquaresSum += change * change - state->changeSquaresSum / weight;
+    }
+    state->previous = average;
+    state->primed = true;
+
+    *mean = state->changeSum / weight;
+    *variance = state->changeSquaresSum / weight - *mean * *mean;
+}
+
+// Raw readings that do not move by a single code for stuckMs. A sound
+// sensor's noise moves the ADC's lowest bits within seconds; a dead ADC
+// input, a shorted line or missing SPI blocks do not.
+static bool faultDetectStuckUpdate(faultDetectState_t* state,
+                                   const faultDetectConfig_t* config,
+                                   const faultDetectBlock_t* block, uint32_t periodMs) {
+    if (config->stuckMs == 0 || block->minimum != block->maximum) {
+        state->stuckForMs = 0;
+        return false;
+    }
+    if (state->stuckForMs == 0 || block->minimum != state->stuckReading) {
+        state->stuckReading = block->minimum;
+        state->stuckForMs = 0;
+    }
+    state->stuckForMs = state->stuckForMs + periodMs < config->stuckMs
+                        ? state->stuckForMs + periodMs : config->stuckMs;
+    return state->stuckForMs >= config->stuckMs;
+}
@@ -0,0 +1,82 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _FAULT_DETECT_H_
+#define _FAULT_DETECT_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+//=====[Declaration of public defines]=========================================
+
+#define FAULT_DETECT_SMOOTHING_SHIFT    4   // Change statistics weigh 1/16 per snapshot
+
+// Health flags of one channel, as HEALTH frames report them
+#define FAULT_DETECT_RAIL_LOW       (1U << 0)  // Stuck at the bottom of the range
+#define FAULT_DETECT_RAIL_HIGH      (1U << 1)  // Stuck at the top of the range
+#define FAULT_DETECT_STUCK          (1U << 2)  // Identical readings for too long
+#define FAULT_DETECT_NOISY          (1U << 3)  // Snapshots scatter far more than filtered
+                                               // readings of a sound sensor do
+#define FAULT_DETECT_RATE           (1U << 4)  // Moving faster than the quantity can
+#define FAULT_DETECT_HEATER         (1U << 5)  // MQ reading at its floor once warm
+#define FAULT_DETECT_WARMING_UP     (1U << 6)  // Not a fault: other checks wait
+#define FAULT_DETECT_FAULTS         (FAULT_DETECT_RAIL_LOW | FAULT_DETECT_RAIL_HIGH | \
+                                     FAULT_DETECT_STUCK | FAULT_DETECT_NOISY | \
+                                     FAULT_DETECT_RATE | FAULT_DETECT_HEATER)
+
+//=====[Declaration of public data types]======================================
+
+// Checks one channel against what a sound sensor can read. Every check but
+// the stuck one gathers evidence for dwellMs before raising its flag and
+// drops it once the evidence has drained away again, so a single odd block
+// does neither. Readings use the 0 to 65535 scale of the sampler snapshot.
+typedef struct {
+    uint16_t railLowReading;    // Whole blocks at or below this, 0 disables
+    uint16_t railHighReading;   // Whole blocks at or above this, 0 disables
+    uint16_t heaterReading;     // Averages below this once warm, 0 disables
+    uint16_t noiseReading;      // Standard deviation of the change between
+                                // snapshots above this, 0 disables
+    uint32_t ratePerSecond;     // Mean change per second above this, 0 disables
+    uint32_t stuckMs;           // Unchanging raw readings for this long, 0 disables
+    uint32_t warmupMs;          // Since boot, before any other check runs
+    uint32_t dwellMs;
+} faultDetectConfig_t;
+
+typedef enum {
+    FAULT_DETECT_CHECK_RAIL_LOW,
+    FAULT_DETECT_CHECK_RAIL_HIGH,
+    FAULT_DETECT_CHECK_NOISY,
+    FAULT_DETECT_CHECK_RATE,
+    FAULT_DETECT_CHECK_HEATER,
+    FAULT_DETECT_CHECK_COUNT,
+} faultDetectCheck_t;
+
+// One filtered snapshot of a channel and the range of the raw readings it
+// was filtered from
+typedef struct {
+    uint16_t average;
+    uint16_t minimum;
+    uint16_t maximum;
+} faultDetectBlock_t;
+
+typedef struct {
+    uint32_t evidenceMs[FAULT_DETECT_CHECK_COUNT];  // 0 up to dwellMs
+    bool primed;                // previous is valid
+    uint16_t previous;          // Average of the last snapshot
+    int64_t changeSum;          // Exponentially weighted change between
+    int64_t changeSquaresSum;   // snapshots and its square, scaled by 16
+    uint16_t stuckReading;
+    uint32_t stuckForMs;
+    uint8_t flags;
+} faultDetectState_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void faultDetectInit(faultDetectState_t* state);
+uint8_t faultDetectUpdate(faultDetectState_t* state, const faultDetectConfig_t* config,
+                          const faultDetectBlock_t* block, uint32_t periodMs,
+                          uint32_t nowMs);
+
+//=====[#include guards - end]=================================================
+
+#endif // _FAULT_DETECT_H_
@@ -0,0 +1,107 @@
+//=====[Libraries]=============================================================
+
+#include "filters.h"
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static uint16_t filterMedianPush(filterState_t* state, uint8_t length,
+                                 uint16_t sample);
+
+//=====[Implementations of public functions]===================================
+
+void filterInit(filterState_t* state) {
+    for (int i = 0; i < FILTER_MEDIAN_LENGTH_MAX; ++i) {
+        state->medianWindow[i] = 0;
+    }
+    state->medianNext = 0;
+    state->medianFill = 0;
+    state->iirPrimed = false;
+    state->iirState = 0;
+}
+
+// Filters count samples spaced stride apart (one channel of an interleaved
+// scan buffer) and returns the decimated output in the same 16-bit scale
+uint16_t filterBlockProcess(filterState_t* state, const filterConfig_t* config,
+                            const uint16_t* samples, int stride, int count) {
+    int decimation = 1 << config->decimationLog2;
+    int first = count - decimation;
+    uint32_t sum = 0;
+
+    for (int i = 0; i < count; ++i) {
+        uint16_t sample = samples[i * stride];
+        if (config->medianLength > 1) {
+            sample = filterMedianPush(state, config->medianLength, sample);
+        }
+        if (i >= first) {
+            sum += sample;
+        }
+    }
+
+    // Keep the fraction of the average so the IIR does not lose resolution
+    uint32_t average = (sum << FILTER_IIR_FRACTION_BITS) >> config->decimationLog2;
+
+    if (config->iirShift == 0) {
+        return average >> FILTER_IIR_FRACTION_BITS;
+    }
+
+    if (!state->iirPrimed) {
+        state->iirState = average;  // Start from the first block, not from zero
+        state->iirPrimed = true;
+    } else {
+        int32_t error = (int32_t)average - (int32_t)state->iirState;
+        state->iirState += error >> config->iirShift;
+    }
+    return state->iirState >> FILTER_IIR_FRACTION_BITS;
+}
+
+// Samples of a run past a threshold that carry the median filter's output
+// past it too; a single one when the median is disabled
+uint8_t filterMedianMajority(uint8_t medianLength) {
+    return medianLength > 1 ? medianLength / 2 + 1 : 1;
+}
+
+void filterRunReset(filterRun_t* run) {
+    run->lastUs = 0;
+    run->length = 0;
+}
+
+// Adds a sample past the threshold taken at timeUs and returns true once the
+// run is as long as the majority of a median of medianLength. A gap in the
+// samples, one that stayed within the threshold, starts a new run.
+bool filterRunAdd(filterRun_t* run, uint32_t timeUs, uint32_t periodUs,
+                  uint8_t medianLength) {
+    if (run->length == 0 || timeUs - run->lastUs > periodUs + periodUs / 2) {
+        run->length = 0;
+    }
+    run->lastUs = timeUs;
+    if (run->length < UINT8_MAX) {
+        run->length++;
+    }
+    return run->length >= filterMedianMajority(medianLength);
+}
+
+//=====[Implementations of private functions]==================================
+
+// Adds a sample to the sliding window and returns the window median
+static uint16_t filterMedianPush(filterState_t* state, uint8_t length,
+                                 uint16_t sample) {
+    state->medianWindow[state->medianNext] = sample;
+    state->medianNext = (state->medianNext + 1) % length;
+    if (state->medianFill < length) {
+        state->medianFill++;
+    }
+
+    // Insertion sort of at most FILTER_MEDIAN_LENGTH_MAX values
+    uint16_t sorted[FILTER_MEDIAN_LENGTH_MAX];
+    int fill = state->medianFill;
+    for (int i = 0; i < fill; ++i) {
+        uint16_t value = state->medianWindow[i];
+        int j = i;
+        while (j > 0 && sorted[j - 1] > value) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = value;
+    }
+    return sorted[fill / 2];
+}
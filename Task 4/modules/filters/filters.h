@@ -0,0 +1,56 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _FILTERS_H_
+#define _FILTERS_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+//=====[Declaration of public defines]=========================================
+
+#define FILTER_MEDIAN_LENGTH_MAX    5
+
+#define FILTER_IIR_FRACTION_BITS    8  // Extra resolution kept in the IIR state
+
+//=====[Declaration of public data types]======================================
+
+// Stages applied to one channel, in order: median-of-N spike rejection on
+// every sample, boxcar decimation of the last (1 << decimationLog2) samples of
+// a block, then an exponential IIR y += (x - y) >> iirShift on the result
+typedef struct {
+    uint8_t medianLength;   // 0 or 1 disables, odd up to FILTER_MEDIAN_LENGTH_MAX
+    uint8_t decimationLog2;
+    uint8_t iirShift;       // 0 disables
+} filterConfig_t;
+
+// Fixed-size state kept per channel between blocks
+typedef struct {
+    uint16_t medianWindow[FILTER_MEDIAN_LENGTH_MAX];
+    uint8_t medianNext;
+    uint8_t medianFill;
+    bool iirPrimed;
+    uint32_t iirState;      // Q16.FILTER_IIR_FRACTION_BITS
+} filterState_t;
+
+// Samples reported one at a time as they cross a threshold, such as the
+// conversions an ADC analog watchdog flags. A run only counts while each
+// sample follows the previous within one and a half sample periods.
+typedef struct {
+    uint32_t lastUs;
+    uint8_t length;
+} filterRun_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void filterInit(filterState_t* state);
+uint16_t filterBlockProcess(filterState_t* state, const filterConfig_t* config,
+                            const uint16_t* samples, int stride, int count);
+uint8_t filterMedianMajority(uint8_t medianLength);
+void filterRunReset(filterRun_t* run);
+bool filterRunAdd(filterRun_t* run, uint32_t timeUs, uint32_t periodUs,
+                  uint8_t medianLength);
+
+//=====[#include guards - end]=================================================
+
+#endif // _FILTERS_H_
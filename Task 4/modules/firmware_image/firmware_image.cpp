@@ -0,0 +1,58 @@
+//=====[Libraries]=============================================================
+
+#include "firmware_image.h"
+
+//=====[Declaration and initialization of private global variables]============
+
+// One entry per nibble: a sixteenth of the byte table's flash, twice the
+// lookups, still about 50 ms for a whole staged image on the F439
+static const uint32_t crc32Nibbles[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+
+//=====[Implementations of public functions]===================================
+
+uint32_t firmwareImageCrc32(uint32_t crc, const uint8_t* data, size_t length) {
+    crc = ~crc;
+    for (size_t i = 0; i < length; ++i) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ crc32Nibbles[crc & 0x0F];
+        crc = (crc >> 4) ^ crc32Nibbles[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+void firmwareImageHeaderBuild(firmwareImageHeader_t* header, uint32_t imageSize,
+                              uint32_t imageCrc32, uint32_t version) {
+    header->magic = FIRMWARE_IMAGE_MAGIC;
+    header->imageSize = imageSize;
+    header->imageCrc32 = imageCrc32;
+    header->version = version;
+    header->headerCrc32 = firmwareImageCrc32(0, (const uint8_t*)header,
+                                             offsetof(firmwareImageHeader_t, headerCrc32));
+    header->installed = FIRMWARE_IMAGE_NOT_INSTALLED;
+}
+
+// A complete header; says nothing of the image itself
+bool firmwareImageHeaderValid(const firmwareImageHeader_t* header) {
+    return header->magic == FIRMWARE_IMAGE_MAGIC &&
+           header->imageSize > 0 && header->imageSize <= FIRMWARE_IMAGE_SIZE_MAX &&
+           header->headerCrc32 ==
+           firmwareImageCrc32(0, (const uint8_t*)header,
+                              offsetof(firmwareImageHeader_t, headerCrc32));
+}
+
+// The image after a header read from the start of the staging area
+const uint8_t* firmwareImageStaged(const firmwareImageHeader_t* header) {
+    return (const uint8_t*)header + FIRMWARE_IMAGE_HEADER_SIZE;
+}
+
+// Header and image both intact, reading the staging area in place
+bool firmwareImageStagedValid(const firmwareImageHeader_t* header) {
+    return firmwareImageHeaderValid(header) &&
+           firmwareImageCrc32(0, firmwareImageStaged(header), header->imageSize) ==
+           header->imageCrc32;
+}
@@ -0,0 +1,62 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _FIRMWARE_IMAGE_H_
+#define _FIRMWARE_IMAGE_H_
+
+//=====[Libraries]=============================================================
+
+#include <stddef.h>
+#include <stdint.h>
+
+//=====[Declaration of public defines]=========================================
+
+// Flash layout of the F439's 2 MB, shared by the bootloader and the monitor.
+// Bank 1 holds the bootloader (sectors 0 and 1) and the running monitor
+// (sectors 2 to 11); bank 2 the staged image (sectors 12 to 19), then the
+// data log and the settings. Writing bank 2 never stalls code fetched from
+// bank 1, so an update streams in while the monitor samples and alarms.
+#define FIRMWARE_IMAGE_BOOTLOADER_ADDRESS   0x08000000
+#define FIRMWARE_IMAGE_BOOTLOADER_SIZE      (32 * 1024)
+#define FIRMWARE_IMAGE_APP_ADDRESS          0x08008000  // "target.mbed_app_start"
+#define FIRMWARE_IMAGE_APP_SIZE             (0x08100000 - FIRMWARE_IMAGE_APP_ADDRESS)
+#define FIRMWARE_IMAGE_STAGING_ADDRESS      0x08100000
+#define FIRMWARE_IMAGE_STAGING_SIZE         (512 * 1024)
+
+// The staged image follows its header, at the start of the staging area
+#define FIRMWARE_IMAGE_HEADER_SIZE          256
+#define FIRMWARE_IMAGE_SIZE_MAX             (FIRMWARE_IMAGE_STAGING_SIZE - \
+                                             FIRMWARE_IMAGE_HEADER_SIZE)
+
+#define FIRMWARE_IMAGE_MAGIC                0x31574D46UL  // "FMW1" in memory order
+#define FIRMWARE_IMAGE_NOT_INSTALLED        0xFFFFFFFFUL  // As erased
+
+//=====[Declaration of public data types]======================================
+
+// Written last, once the whole image is in flash and its CRC checked, so a
+// header only ever describes a complete image. The bootloader clears
+// installed after copying the image into bank 1; flash bits can go from 1
+// to 0 without an erase, so that needs no other sector.
+typedef struct {
+    uint32_t magic;
+    uint32_t imageSize;         // Bytes, at most FIRMWARE_IMAGE_SIZE_MAX
+    uint32_t imageCrc32;        // firmwareImageCrc32() of the image
+    uint32_t version;           // Chosen by whoever built the image
+    uint32_t headerCrc32;       // Of the fields above
+    uint32_t installed;         // FIRMWARE_IMAGE_NOT_INSTALLED, then 0
+} firmwareImageHeader_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// CRC-32 as zlib computes it (polynomial 0xEDB88320, reflected), chained
+// through crc, which starts at 0
+uint32_t firmwareImageCrc32(uint32_t crc, const uint8_t* data, size_t length);
+
+void firmwareImageHeaderBuild(firmwareImageHeader_t* header, uint32_t imageSize,
+                              uint32_t imageCrc32, uint32_t version);
+bool firmwareImageHeaderValid(const firmwareImageHeader_t* header);
+const uint8_t* firmwareImageStaged(const firmwareImageHeader_t* header);
+bool firmwareImageStagedValid(const firmwareImageHeader_t* header);
+
+//=====[#include guards - end]=================================================
+
+#endif // _FIRMWARE_IMAGE_H_
@@ -0,0 +1,480 @@
+//=====[Libraries]=============================================================
+
+#include <string.h>
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "firmware_update.h"
+#include "command_line.h"
+#include "data_log.h"
+#include "memory_plan.h"
+#include "number_format.h"
+#include "pc_serial_com.h"
+
+//=====[Declaration of private defines]========================================
+
+#define FIRMWARE_UPDATE_PAGE_MAX        16    // Largest flash program unit
+#define FIRMWARE_UPDATE_LINE_BYTES_MAX  32    // Per "update data" line
+#define FIRMWARE_UPDATE_RESET_WAIT      200ms // Lets the last output leave
+
+static_assert(FIRMWARE_IMAGE_STAGING_ADDRESS + FIRMWARE_IMAGE_STAGING_SIZE <=
+              DATA_LOG_FLASH_ADDRESS, "Staging area runs into the data log");
+#ifdef MBED_APP_START
+static_assert(MBED_APP_START == FIRMWARE_IMAGE_APP_ADDRESS,
+              "target.mbed_app_start must leave room for the bootloader");
+#endif
+static_assert(FIRMWARE_UPDATE_CHUNK_MAX % FIRMWARE_UPDATE_CHUNK_ALIGN == 0 &&
+              FIRMWARE_UPDATE_LINE_BYTES_MAX % FIRMWARE_UPDATE_CHUNK_ALIGN == 0,
+              "Full writes must keep the next one aligned");
+static_assert(sizeof("update data ") - 1 + 2 * FIRMWARE_UPDATE_LINE_BYTES_MAX <
+              COMMAND_LINE_LENGTH, "Full data lines must fit the console");
+static_assert(sizeof(firmwareImageHeader_t) <= FIRMWARE_IMAGE_HEADER_SIZE,
+              "Header does not fit before the image");
+
+//=====[Declaration of private data types]=====================================
+
+typedef enum {
+    FIRMWARE_UPDATE_JOB_ERASE,
+    FIRMWARE_UPDATE_JOB_WRITE,
+    FIRMWARE_UPDATE_JOB_VERIFY,
+    FIRMWARE_UPDATE_JOB_APPLY,
+} firmwareUpdateJobType_t;
+
+// Flash work for the update thread; data has room to pad a write to whole
+// program units
+typedef struct {
+    firmwareUpdateJobType_t type;
+    uint32_t offset;
+    uint32_t length;
+    uint8_t data[FIRMWARE_UPDATE_CHUNK_MAX + FIRMWARE_UPDATE_PAGE_MAX];
+} firmwareUpdateJob_t;
+
+//=====[Declaration and initialization of private global variables]============
+
+// Flash erases take seconds, so they run here rather than in the console or
+// network thread that received the step; bank 2 is written while sampling
+// and alarms keep running from bank 1
+static Thread updateThread(osPriorityLow,
+                           memoryPlanStackSize(MEMORY_PLAN_STACK_FIRMWARE_UPDATE),
+                           memoryPlanStackMemory(MEMORY_PLAN_STACK_FIRMWARE_UPDATE),
+                           memoryPlanStackName(MEMORY_PLAN_STACK_FIRMWARE_UPDATE));
+static Mail<firmwareUpdateJob_t, FIRMWARE_UPDATE_QUEUE_LENGTH> jobs;
+
+// FlashIAP serializes its users, so the data log and settings wait for an
+// erase here rather than collide with it
+static FlashIAP flashIap;
+static bool flashReady = false;
+
+// Steps arrive from the console and the network thread
+static Mutex updateMutex;
+static firmwareUpdateStatus_t status = { FIRMWARE_UPDATE_IDLE, FIRMWARE_UPDATE_ERROR_NONE,
+                                         0, 0, 0, 0 };
+
+static uint32_t bootReadyMs = 0;
+
+// Indexed by firmwareUpdateState_t and firmwareUpdateError_t
+static const char* const stateNames[] = {
+    "idle", "erasing", "receiving", "verifying", "staged", "failed",
+};
+static const char* const errorNames[] = {
+    "none", "not allowed now", "image too large", "data out of order", "busy",
+    "flash error", "CRC mismatch",
+};
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void firmwareUpdateTask();
+static bool firmwareUpdateErase(uint32_t imageSize);
+static bool firmwareUpdateProgram(uint32_t address, uint8_t* data, uint32_t length);
+static bool firmwareUpdateVerify(uint32_t imageSize, uint32_t imageCrc32, uint32_t version);
+static firmwareUpdateError_t firmwareUpdateJobPut(firmwareUpdateJobType_t type,
+                                                  uint32_t offset, const uint8_t* data,
+                                                  uint32_t length);
+static firmwareUpdateError_t firmwareUpdateResult(firmwareUpdateError_t error);
+static void firmwareUpdateStateSet(firmwareUpdateState_t from, firmwareUpdateState_t to,
+                                   firmwareUpdateError_t error);
+static void firmwareUpdateReportWrite();
+static bool firmwareUpdateHexParse(const char* text, uint32_t* value);
+static uint32_t firmwareUpdateHexBytesParse(const char* text, uint8_t* bytes,
+                                            uint32_t bytesMax);
+
+//=====[Implementations of public functions]===================================
+
+void firmwareUpdateInit() {
+    flashReady = (flashIap.init() == 0);
+    updateThread.start(firmwareUpdateTask);
+}
+
+// Erases room for an image of imageSize bytes and then accepts its data.
+// Anything staged before is lost, even if this update goes no further.
+firmwareUpdateError_t firmwareUpdateBegin(uint32_t imageSize, uint32_t imageCrc32,
+                                          uint32_t version) {
+    updateMutex.lock();
+    firmwareUpdateError_t error = FIRMWARE_UPDATE_ERROR_NONE;
+    if (!flashReady || status.state == FIRMWARE_UPDATE_ERASING ||
+        status.state == FIRMWARE_UPDATE_VERIFYING) {
+        error = FIRMWARE_UPDATE_ERROR_STATE;
+    } else if (imageSize == 0 || imageSize > FIRMWARE_IMAGE_SIZE_MAX) {
+        error = FIRMWARE_UPDATE_ERROR_SIZE;
+    } else {
+        error = firmwareUpdateJobPut(FIRMWARE_UPDATE_JOB_ERASE, 0, nullptr, imageSize);
+        if (error == FIRMWARE_UPDATE_ERROR_NONE) {
+            status = { FIRMWARE_UPDATE_ERASING, FIRMWARE_UPDATE_ERROR_NONE, 0,
+                       imageSize, imageCrc32, version };
+        }
+    }
+    updateMutex.unlock();
+    return firmwareUpdateResult(error);
+}
+
+// Queues length bytes at offset, which must be where the accepted data ends;
+// data that was accepted before is acknowledged again, so a sender that
+// missed the answer can simply repeat it
+firmwareUpdateError_t firmwareUpdateWrite(uint32_t offset, const uint8_t* data,
+                                          uint32_t length) {
+    updateMutex.lock();
+    firmwareUpdateError_t error = FIRMWARE_UPDATE_ERROR_NONE;
+    if (status.state == FIRMWARE_UPDATE_ERASING) {
+        error = FIRMWARE_UPDATE_ERROR_BUSY;
+    } else if (status.state != FIRMWARE_UPDATE_RECEIVING) {
+        error = FIRMWARE_UPDATE_ERROR_STATE;
+    } else if (offset < status.nextOffset && offset + length <= status.nextOffset) {
+        error = FIRMWARE_UPDATE_ERROR_NONE;
+    } else if (offset != status.nextOffset || offset % FIRMWARE_UPDATE_CHUNK_ALIGN != 0 ||
+               length == 0 || length > FIRMWARE_UPDATE_CHUNK_MAX ||
+               length > status.imageSize - offset) {
+        error = FIRMWARE_UPDATE_ERROR_OFFSET;
+    } else {
+        error = firmwareUpdateJobPut(FIRMWARE_UPDATE_JOB_WRITE, offset, data, length);
+        if (error == FIRMWARE_UPDATE_ERROR_NONE) {
+            status.nextOffset += length;
+        }
+    }
+    updateMutex.unlock();
+    return firmwareUpdateResult(error);
+}
+
+// Once every byte is queued: checks the whole staged image against its CRC
+// and, if it matches, writes the header that makes it installable
+firmwareUpdateError_t firmwareUpdateFinish() {
+    updateMutex.lock();
+    firmwareUpdateError_t error = FIRMWARE_UPDATE_ERROR_NONE;
+    if (status.state != FIRMWARE_UPDATE_RECEIVING) {
+        error = FIRMWARE_UPDATE_ERROR_STATE;
+    } else if (status.nextOffset != status.imageSize) {
+        error = FIRMWARE_UPDATE_ERROR_OFFSET;
+    } else {
+        error = firmwareUpdateJobPut(FIRMWARE_UPDATE_JOB_VERIFY, 0, nullptr, 0);
+        if (error == FIRMWARE_UPDATE_ERROR_NONE) {
+            status.state = FIRMWARE_UPDATE_VERIFYING;
+        }
+    }
+    updateMutex.unlock();
+    return firmwareUpdateResult(error);
+}
+
+// Flushes the data log and resets into the bootloader, which copies the
+// staged image over this firmware and starts it
+firmwareUpdateError_t firmwareUpdateApply() {
+    updateMutex.lock();
+    firmwareUpdateError_t error = status.state == FIRMWARE_UPDATE_STAGED
+        ? firmwareUpdateJobPut(FIRMWARE_UPDATE_JOB_APPLY, 0, nullptr, 0)
+        : FIRMWARE_UPDATE_ERROR_STATE;
+    updateMutex.unlock();
+    return firmwareUpdateResult(error);
+}
+
+void firmwareUpdateStatusGet(firmwareUpdateStatus_t* current) {
+    updateMutex.lock();
+    *current = status;
+    updateMutex.unlock();
+}
+
+// Called by main() once sampling runs and the alarm thread is armed
+void firmwareUpdateBootReadyMark() {
+    bootReadyMs = (uint32_t)Kernel::get_ms_count();
+    if (bootReadyMs > FIRMWARE_UPDATE_BOOT_BUDGET_MS) {
+        char str[80] = "";
+        char* cursor = numberFormatAppendString(str, "Boot took ");
+        cursor = numberFormatAppendUnsigned(cursor, bootReadyMs);
+        cursor = numberFormatAppendString(cursor, " ms, over its ");
+        cursor = numberFormatAppendUnsigned(cursor, FIRMWARE_UPDATE_BOOT_BUDGET_MS);
+        numberFormatAppendString(cursor, " ms budget\r\n");
+        pcSerialComStringWrite(str);
+    }
+}
+
+// "update" shows the progress; "update begin <size> <crc32 hex> [version]",
+// then "update data <up to 64 hex digits>" lines, "update finish" and
+// "update apply" stream an image over the console. The prompt after each
+// line tells the sender to go on; only failures print anything.
+bool firmwareUpdateCommand(int argc, char** argv) {
+    firmwareUpdateError_t error = FIRMWARE_UPDATE_ERROR_NONE;
+    uint32_t imageSize;
+    uint32_t imageCrc32;
+    uint32_t version = 0;
+
+    if (argc == 1) {
+        firmwareUpdateReportWrite();
+        return true;
+    } else if ((argc == 4 || argc == 5) && commandLineMatch(argv[1], "begin") &&
+               numberFormatParseUnsigned(argv[2], &imageSize) &&
+               firmwareUpdateHexParse(argv[3], &imageCrc32) &&
+               (argc == 4 || numberFormatParseUnsigned(argv[4], &version))) {
+        error = firmwareUpdateBegin(imageSize, imageCrc32, version);
+    } else if (argc == 3 && commandLineMatch(argv[1], "data")) {
+        uint8_t bytes[FIRMWARE_UPDATE_LINE_BYTES_MAX];
+        uint32_t length = firmwareUpdateHexBytesParse(argv[2], bytes, sizeof(bytes));
+        if (length == 0) {
+            return false;
+        }
+        firmwareUpdateStatus_t current;
+        firmwareUpdateStatusGet(&current);
+        error = firmwareUpdateWrite(current.nextOffset, bytes, length);
+    } else if (argc == 2 && commandLineMatch(argv[1], "finish")) {
+        error = firmwareUpdateFinish();
+    } else if (argc == 2 && commandLineMatch(argv[1], "apply")) {
+        error = firmwareUpdateApply();
+    } else {
+        return false;
+    }
+
+    if (error != FIRMWARE_UPDATE_ERROR_NONE) {
+        char str[60] = "";
+        char* cursor = numberFormatAppendString(str, "Update: ");
+        cursor = numberFormatAppendString(cursor, errorNames[error]);
+        numberFormatAppendString(cursor, "\r\n");
+        pcSerialComStringWrite(str);
+    }
+    return true;
+}
+
+//=====[Implementations of private functions]==================================
+
+static void firmwareUpdateTask() {
+    while (true) {
+        firmwareUpdateJob_t* job = jobs.try_get_for(Kernel::wait_for_u32_forever);
+        if (job == nullptr) {
+            continue;
+        }
+        firmwareUpdateStatus_t current;
+        firmwareUpdateStatusGet(&current);
+
+        switch (job->type) {
+        case FIRMWARE_UPDATE_JOB_ERASE:
+            if (firmwareUpdateErase(job->length)) {
+                firmwareUpdateStateSet(FIRMWARE_UPDATE_ERASING, FIRMWARE_UPDATE_RECEIVING,
+                                       FIRMWARE_UPDATE_ERROR_NONE);
+            } else {
+                firmwareUpdateStateSet(FIRMWARE_UPDATE_ERASING, FIRMWARE_UPDATE_FAILED,
+                                       FIRMWARE_UPDATE_ERROR_FLASH);
+            }
+            break;
+        case FIRMWARE_UPDATE_JOB_WRITE:
+            if (!firmwareUpdateProgram(FIRMWARE_IMAGE_STAGING_ADDRESS +
+                                       FIRMWARE_IMAGE_HEADER_SIZE + job->offset,
+                                       job->data, job->length)) {
+                firmwareUpdateStateSet(FIRMWARE_UPDATE_RECEIVING, FIRMWARE_UPDATE_FAILED,
+                                       FIRMWARE_UPDATE_ERROR_FLASH);
+            }
+            break;
+        case FIRMWARE_UPDATE_JOB_VERIFY:
+            if (firmwareUpdateVerify(current.imageSize, current.imageCrc32,
+                                     current.version)) {
+                firmwareUpdateStateSet(FIRMWARE_UPDATE_VERIFYING, FIRMWARE_UPDATE_STAGED,
+                                       FIRMWARE_UPDATE_ERROR_NONE);
+            }
+            break;
+        case FIRMWARE_UPDATE_JOB_APPLY:
+            dataLogFlush();
+            pcSerialComStringWrite("Restarting to install the staged firmware\r\n");
+            ThisThread::sleep_for(FIRMWARE_UPDATE_RESET_WAIT);
+            NVIC_SystemReset();
+            break;
+        }
+        jobs.free(job);
+    }
+}
+
+// Sector by sector, header sector first, so the data log and settings only
+// ever wait for one sector erase; the F439 sectors in bank 2 are 16 KB up to
+// 128 KB
+static bool firmwareUpdateErase(uint32_t imageSize) {
+    uint32_t address = FIRMWARE_IMAGE_STAGING_ADDRESS;
+    uint32_t end = FIRMWARE_IMAGE_STAGING_ADDRESS + FIRMWARE_IMAGE_HEADER_SIZE + imageSize;
+    while (address < end) {
+        uint32_t sectorSize = flashIap.get_sector_size(address);
+        if (sectorSize == MBED_FLASH_INVALID_SIZE ||
+            flashIap.erase(address, sectorSize) != 0) {
+            return false;
+        }
+        address += sectorSize;
+    }
+    return true;
+}
+
+// Pads length up to whole program units with erased bytes, then reads the
+// data back
+static bool firmwareUpdateProgram(uint32_t address, uint8_t* data, uint32_t length) {
+    uint32_t pageSize = flashIap.get_page_size();
+    if (pageSize == 0 || pageSize > FIRMWARE_UPDATE_PAGE_MAX) {
+        return false;
+    }
+    uint32_t padded = (length + pageSize - 1) / pageSize * pageSize;
+    memset(&data[length], flashIap.get_erase_value(), padded - length);
+    return flashIap.program(data, address, padded) == 0 &&
+           memcmp((const void*)address, data, length) == 0;
+}
+
+// The image is read in place, as the bootloader will read it
+static bool firmwareUpdateVerify(uint32_t imageSize, uint32_t imageCrc32, uint32_t version) {
+    const uint8_t* image = (const uint8_t*)(FIRMWARE_IMAGE_STAGING_ADDRESS +
+                                            FIRMWARE_IMAGE_HEADER_SIZE);
+    if (firmwareImageCrc32(0, image, imageSize) != imageCrc32) {
+        firmwareUpdateStateSet(FIRMWARE_UPDATE_VERIFYING, FIRMWARE_UPDATE_FAILED,
+                               FIRMWARE_UPDATE_ERROR_CRC);
+        return false;
+    }
+
+    uint8_t data[sizeof(firmwareImageHeader_t) + FIRMWARE_UPDATE_PAGE_MAX];
+    firmwareImageHeader_t header;
+    firmwareImageHeaderBuild(&header, imageSize, imageCrc32, version);
+    memcpy(data, &header, sizeof(header));
+    if (!firmwareUpdateProgram(FIRMWARE_IMAGE_STAGING_ADDRESS, data, sizeof(header)) ||
+        !firmwareImageStagedValid((const firmwareImageHeader_t*)
+                                  FIRMWARE_IMAGE_STAGING_ADDRESS)) {
+        firmwareUpdateStateSet(FIRMWARE_UPDATE_VERIFYING, FIRMWARE_UPDATE_FAILED,
+                               FIRMWARE_UPDATE_ERROR_FLASH);
+        return false;
+    }
+    return true;
+}
+
+// Called with the mutex held
+static firmwareUpdateError_t firmwareUpdateJobPut(firmwareUpdateJobType_t type,
+                                                  uint32_t offset, const uint8_t* data,
+                                                  uint32_t length) {
+    firmwareUpdateJob_t* job = jobs.try_alloc();
+    if (job == nullptr) {
+        return FIRMWARE_UPDATE_ERROR_BUSY;
+    }
+    job->type = type;
+    job->offset = offset;
+    job->length = length;
+    if (data != nullptr) {
+        memcpy(job->data, data, length);
+    }
+    jobs.put(job);
+    return FIRMWARE_UPDATE_ERROR_NONE;
+}
+
+// Keeps the last failure for the status; a busy queue is no failure
+static firmwareUpdateError_t firmwareUpdateResult(firmwareUpdateError_t error) {
+    if (error != FIRMWARE_UPDATE_ERROR_NONE && error != FIRMWARE_UPDATE_ERROR_BUSY) {
+        updateMutex.lock();
+        status.error = error;
+        updateMutex.unlock();
+    }
+    return error;
+}
+
+// Leaves the state alone if a new begin has moved it on meanwhile
+static void firmwareUpdateStateSet(firmwareUpdateState_t from, firmwareUpdateState_t to,
+                                   firmwareUpdateError_t error) {
+    updateMutex.lock();
+    if (status.state == from) {
+        status.state = to;
+        if (error != FIRMWARE_UPDATE_ERROR_NONE) {
+            status.error = error;
+        }
+    }
+    updateMutex.unlock();
+}
+
+// "Update: receiving, 40960 of 301234 B, version 7", then what the bootloader
+// last installed and "Boot: armed 38 ms after start, budget 100 ms"
+static void firmwareUpdateReportWrite() {
+    firmwareUpdateStatus_t current;
+    firmwareUpdateStatusGet(&current);
+
+    char str[100] = "";
+    char* cursor = numberFormatAppendString(str, "Update: ");
+    cursor = numberFormatAppendString(cursor, stateNames[current.state]);
+    if (current.state != FIRMWARE_UPDATE_IDLE) {
+        cursor = numberFormatAppendString(cursor, ", ");
+        cursor = numberFormatAppendUnsigned(cursor, current.nextOffset);
+        cursor = numberFormatAppendString(cursor, " of ");
+        cursor = numberFormatAppendUnsigned(cursor, current.imageSize);
+        cursor = numberFormatAppendString(cursor, " B, version ");
+        cursor = numberFormatAppendUnsigned(cursor, current.version);
+    }
+    if (current.state == FIRMWARE_UPDATE_FAILED) {
+        cursor = numberFormatAppendString(cursor, " (");
+        cursor = numberFormatAppendString(cursor, errorNames[current.error]);
+        cursor = numberFormatAppendString(cursor, ")");
+    }
+    numberFormatAppendString(cursor, "\r\n");
+    pcSerialComStringWrite(str);
+
+    // Only an image this module did not erase since boot tells what runs
+    const firmwareImageHeader_t* header =
+        (const firmwareImageHeader_t*)FIRMWARE_IMAGE_STAGING_ADDRESS;
+    if (current.state == FIRMWARE_UPDATE_IDLE && firmwareImageHeaderValid(header) &&
+        header->installed != FIRMWARE_IMAGE_NOT_INSTALLED) {
+        str[0] = '\0';
+        cursor = numberFormatAppendString(str, "Running version ");
+        cursor = numberFormatAppendUnsigned(cursor, header->version);
+        numberFormatAppendString(cursor, ", installed by the bootloader\r\n");
+        pcSerialComStringWrite(str);
+    }
+
+    str[0] = '\0';
+    cursor = numberFormatAppendString(str, "Boot: armed ");
+    cursor = numberFormatAppendUnsigned(cursor, bootReadyMs);
+    cursor = numberFormatAppendString(cursor, " ms after start, budget ");
+    cursor = numberFormatAppendUnsigned(cursor, FIRMWARE_UPDATE_BOOT_BUDGET_MS);
+    numberFormatAppendString(cursor, " ms\r\n");
+    pcSerialComStringWrite(str);
+}
+
+// Up to eight hex digits, such as a CRC-32 printed by a host tool
+static bool firmwareUpdateHexParse(const char* text, uint32_t* value) {
+    uint32_t result = 0;
+    int digits = 0;
+    for (; text[digits] != '\0'; ++digits) {
+        char c = text[digits];
+        uint32_t digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        } else {
+            return false;
+        }
+        if (digits == 8) {
+            return false;
+        }
+        result = (result << 4) | digit;
+    }
+    *value = result;
+    return digits > 0;
+}
+
+// Pairs of hex digits into bytes; 0 when malformed or longer than bytesMax
+static uint32_t firmwareUpdateHexBytesParse(const char* text, uint8_t* bytes,
+                                            uint32_t bytesMax) {
+    uint32_t length = 0;
+    while (text[0] != '\0') {
+        char pair[3] = { text[0], text[1], '\0' };
+        uint32_t value;
+        if (text[1] == '\0' || length == bytesMax || !firmwareUpdateHexParse(pair, &value)) {
+            return 0;
+        }
+        bytes[length++] = (uint8_t)value;
+        text += 2;
+    }
+    return length;
+}
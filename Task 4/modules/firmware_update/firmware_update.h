@@ -0,0 +1,80 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _FIRMWARE_UPDATE_H_
+#define _FIRMWARE_UPDATE_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+#include "firmware_image.h"
+
+//=====[Declaration of public defines]=========================================
+
+#define FIRMWARE_UPDATE_CHUNK_MAX       256  // Image bytes per write
+#define FIRMWARE_UPDATE_CHUNK_ALIGN     16   // Writes start at multiples of this
+#define FIRMWARE_UPDATE_QUEUE_LENGTH    4    // Writes waiting for the flash
+
+// From the RTOS starting until sampling runs and the alarm thread waits for
+// its first snapshot, which follows one snapshot period later
+#define FIRMWARE_UPDATE_BOOT_BUDGET_MS  100
+
+//=====[Declaration of public data types]======================================
+
+//  IDLE --begin--> ERASING --> RECEIVING --all bytes, finish--> VERIFYING
+//  VERIFYING --CRC matches--> STAGED --apply--> reset into the bootloader
+// A flash or CRC failure ends in FAILED; begin starts over from any state
+// but ERASING and VERIFYING.
+typedef enum {
+    FIRMWARE_UPDATE_IDLE,
+    FIRMWARE_UPDATE_ERASING,
+    FIRMWARE_UPDATE_RECEIVING,
+    FIRMWARE_UPDATE_VERIFYING,
+    FIRMWARE_UPDATE_STAGED,
+    FIRMWARE_UPDATE_FAILED,
+} firmwareUpdateState_t;
+
+typedef enum {
+    FIRMWARE_UPDATE_ERROR_NONE,
+    FIRMWARE_UPDATE_ERROR_STATE,    // Step not allowed in this state
+    FIRMWARE_UPDATE_ERROR_SIZE,     // Image too large for the staging area
+    FIRMWARE_UPDATE_ERROR_OFFSET,   // Data out of order or past the image
+    FIRMWARE_UPDATE_ERROR_BUSY,     // Write queue full; send the data again
+    FIRMWARE_UPDATE_ERROR_FLASH,    // Erase, program or read-back failed
+    FIRMWARE_UPDATE_ERROR_CRC,      // Staged image does not match its CRC
+} firmwareUpdateError_t;
+
+// Steps of an update, numbered as UPDATE frames carry them
+typedef enum {
+    FIRMWARE_UPDATE_STEP_BEGIN,
+    FIRMWARE_UPDATE_STEP_DATA,
+    FIRMWARE_UPDATE_STEP_FINISH,
+    FIRMWARE_UPDATE_STEP_APPLY,
+    FIRMWARE_UPDATE_STEP_STATUS,
+} firmwareUpdateStep_t;
+
+typedef struct {
+    firmwareUpdateState_t state;
+    firmwareUpdateError_t error;
+    uint32_t nextOffset;        // Image bytes accepted so far
+    uint32_t imageSize;
+    uint32_t imageCrc32;
+    uint32_t version;
+} firmwareUpdateStatus_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void firmwareUpdateInit();
+firmwareUpdateError_t firmwareUpdateBegin(uint32_t imageSize, uint32_t imageCrc32,
+                                          uint32_t version);
+firmwareUpdateError_t firmwareUpdateWrite(uint32_t offset, const uint8_t* data,
+                                          uint32_t length);
+firmwareUpdateError_t firmwareUpdateFinish();
+firmwareUpdateError_t firmwareUpdateApply();
+void firmwareUpdateStatusGet(firmwareUpdateStatus_t* status);
+void firmwareUpdateBootReadyMark();
+bool firmwareUpdateCommand(int argc, char** argv);
+
+//=====[#include guards - end]=================================================
+
+#endif // _FIRMWARE_UPDATE_H_
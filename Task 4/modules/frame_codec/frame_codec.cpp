@@ -0,0 +1,60 @@
+//=====[Libraries]=============================================================
+
+#include "frame_codec.h"
+
+//=====[Implementations of public functions]===================================
+
+uint16_t frameCodecCrc16(uint16_t crc, const uint8_t* data, size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+size_t frameCodecEncode(const uint8_t* data, size_t length, uint8_t* encoded) {
+    size_t codeIndex = 0;   // Where the length code of the current block goes
+    size_t out = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < length; ++i) {
+        if (data[i] != 0) {
+            encoded[out++] = data[i];
+            code++;
+        }
+        // A zero, or a full block of 254 non-zero bytes, closes the block
+        if (data[i] == 0 || code == 0xFF) {
+            encoded[codeIndex] = code;
+            codeIndex = out++;
+            code = 1;
+        }
+    }
+    encoded[codeIndex] = code;
+    encoded[out++] = FRAME_CODEC_DELIMITER;
+    return out;
+}
+
+size_t frameCodecDecode(const uint8_t* encoded, size_t length, uint8_t* data) {
+    size_t in = 0;
+    size_t out = 0;
+
+    while (in < length) {
+        uint8_t code = encoded[in++];
+        if (code == 0 || in + code - 1 > length) {
+            return 0;
+        }
+        for (uint8_t i = 1; i < code; ++i) {
+            if (encoded[in] == 0) {
+                return 0;
+            }
+            data[out++] = encoded[in++];
+        }
+        // A block shorter than 254 bytes stands for a zero, except the last
+        if (code != 0xFF && in < length) {
+            data[out++] = 0;
+        }
+    }
+    return out;
+}
@@ -0,0 +1,34 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _FRAME_CODEC_H_
+#define _FRAME_CODEC_H_
+
+//=====[Libraries]=============================================================
+
+#include <stddef.h>
+#include <stdint.h>
+
+//=====[Declaration of public defines]=========================================
+
+#define FRAME_CODEC_CRC16_INIT      0xFFFF
+#define FRAME_CODEC_DELIMITER       0x00
+
+// Bytes needed to encode a payload of length bytes, delimiter included
+#define FRAME_CODEC_ENCODED_SIZE(length)  ((length) + (length) / 254 + 2)
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// CRC-16/CCITT-FALSE (polynomial 0x1021), chained through crc
+uint16_t frameCodecCrc16(uint16_t crc, const uint8_t* data, size_t length);
+
+// Consistent Overhead Byte Stuffing: the encoded frame contains no zero byte
+// except the delimiter written at its end. Returns the encoded length.
+size_t frameCodecEncode(const uint8_t* data, size_t length, uint8_t* encoded);
+
+// Decodes one frame without its delimiter. Returns the decoded length, or 0
+// if the frame is malformed.
+size_t frameCodecDecode(const uint8_t* encoded, size_t length, uint8_t* data);
+
+//=====[#include guards - end]=================================================
+
+#endif // _FRAME_CODEC_H_
@@ -0,0 +1,139 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "instrumentation.h"
+#include "number_format.h"
+#include "pc_serial_com.h"
+
+#if INSTRUMENTATION_ENABLED
+
+//=====[Declaration of private defines]========================================
+
+// The longest report line, the wake-up histogram with every bin bound and
+// count at 10 digits; a stage line stays well under it
+#define INSTRUMENTATION_LINE_LENGTH (sizeof("Sampler wake-up (us):") - 1 + \
+                                     INSTRUMENTATION_HISTOGRAM_BINS * \
+                                     (sizeof(" >=4294967295:4294967295") - 1) + \
+                                     sizeof("\r\n"))
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct {
+    uint32_t count;
+    uint32_t minCycles;
+    uint32_t maxCycles;
+    uint64_t totalCycles;
+} instrumentationStats_t;
+
+//=====[Declaration and initialization of private global variables]============
+
+static instrumentationStats_t stageStats[INSTRUMENTATION_STAGE_COUNT];
+
+// Sampler wake-up latency, from the DMA interrupt to the start of filtering
+static uint32_t wakeLatencyHistogram[INSTRUMENTATION_HISTOGRAM_BINS];
+
+static const char* const stageNames[INSTRUMENTATION_STAGE_COUNT] = {
+    "Filter", "Raw block", "Alarm update", "Alarm outputs", "Gas latency",
+    "Console", "Streams", "Status", "UART write", "UART TX ISR",
+};
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static int32_t instrumentationCyclesToHundredthsUs(uint64_t cycles);
+
+//=====[Implementations of public functions]===================================
+
+// Starts the DWT cycle counter
+void instrumentationInit() {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    instrumentationReset();
+}
+
+void instrumentationStageRecord(instrumentationStage_t stage, uint32_t cycles) {
+    instrumentationStats_t* stats = &stageStats[stage];
+    if (cycles < stats->minCycles) {
+        stats->minCycles = cycles;
+    }
+    if (cycles > stats->maxCycles) {
+        stats->maxCycles = cycles;
+    }
+    stats->totalCycles += cycles;
+    stats->count++;
+}
+
+void instrumentationWakeLatencyRecord(uint32_t cycles) {
+    uint32_t us = cycles / (SystemCoreClock / 1000000);
+    int bin = 0;
+    while (bin < INSTRUMENTATION_HISTOGRAM_BINS - 1 && us >= (1UL << bin)) {
+        bin++;
+    }
+    wakeLatencyHistogram[bin]++;
+}
+
+// Prints min/mean/max per stage in microseconds and the wake-up histogram
+void instrumentationReportWrite() {
+    char str[INSTRUMENTATION_LINE_LENGTH];
+    for (int i = 0; i < INSTRUMENTATION_STAGE_COUNT; ++i) {
+        const instrumentationStats_t* stats = &stageStats[i];
+        if (stats->count == 0) {
+            continue;
+        }
+        char* cursor = numberFormatAppendString(str, stageNames[i]);
+        cursor = numberFormatAppendString(cursor, ": n=");
+        cursor = numberFormatAppendUnsigned(cursor, stats->count);
+        cursor = numberFormatAppendString(cursor, ", min ");
+        cursor = numberFormatAppendHundredths(cursor,
+                     instrumentationCyclesToHundredthsUs(stats->minCycles));
+        cursor = numberFormatAppendString(cursor, ", mean ");
+        cursor = numberFormatAppendHundredths(cursor,
+                     instrumentationCyclesToHundredthsUs(stats->totalCycles / stats->count));
+        cursor = numberFormatAppendString(cursor, ", max ");
+        cursor = numberFormatAppendHundredths(cursor,
+                     instrumentationCyclesToHundredthsUs(stats->maxCycles));
+        numberFormatAppendString(cursor, " us\r\n");
+        pcSerialComStringWrite(str);
+    }
+
+    char* cursor = numberFormatAppendString(str, "Sampler wake-up (us):");
+    for (int i = 0; i < INSTRUMENTATION_HISTOGRAM_BINS; ++i) {
+        cursor = numberFormatAppendString(cursor,
+                                          i < INSTRUMENTATION_HISTOGRAM_BINS - 1 ? " <" : " >=");
+        cursor = numberFormatAppendUnsigned(cursor,
+            1UL << (i < INSTRUMENTATION_HISTOGRAM_BINS - 1 ? i : i - 1));
+        cursor = numberFormatAppendString(cursor, ":");
+        cursor = numberFormatAppendUnsigned(cursor, wakeLatencyHistogram[i]);
+    }
+    numberFormatAppendString(cursor, "\r\n");
+    pcSerialComStringWrite(str);
+}
+
+// Concurrent records may survive a reset or be lost; both are harmless
+void instrumentationReset() {
+    for (int i = 0; i < INSTRUMENTATION_STAGE_COUNT; ++i) {
+        stageStats[i].count = 0;
+        stageStats[i].minCycles = UINT32_MAX;
+        stageStats[i].maxCycles = 0;
+        stageStats[i].totalCycles = 0;
+    }
+    for (int i = 0; i < INSTRUMENTATION_HISTOGRAM_BINS; ++i) {
+        wakeLatencyHistogram[i] = 0;
+    }
+}
+
+//=====[Implementations of private functions]==================================
+
+static int32_t instrumentationCyclesToHundredthsUs(uint64_t cycles) {
+    return (int32_t)(cycles * 100 / (SystemCoreClock / 1000000));
+}
+
+#else
+
+void instrumentationReportWrite() {
+    pcSerialComStringWrite("Instrumentation is compiled out\r\n");
+}
+
+#endif
@@ -0,0 +1,79 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _INSTRUMENTATION_H_
+#define _INSTRUMENTATION_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+//=====[Declaration of public defines]=========================================
+
+// Set to 0 to compile every probe out; the macros then expand to nothing
+#ifndef INSTRUMENTATION_ENABLED
+#define INSTRUMENTATION_ENABLED     1
+#endif
+
+#define INSTRUMENTATION_HISTOGRAM_BINS  12  // Under 1, 2, 4, ... 1024 us, more
+
+//=====[Declaration of public data types]======================================
+
+typedef enum {
+    INSTRUMENTATION_STAGE_FILTER,        // Sampler: filters of one half-buffer
+    INSTRUMENTATION_STAGE_RAW_BLOCK,     // Sampler: binary telemetry and capture
+    INSTRUMENTATION_STAGE_ALARM_UPDATE,  // Alarm: state machines of one snapshot
+    INSTRUMENTATION_STAGE_ALARM_OUTPUTS, // Alarm: buzzer PWM and LED writes
+    INSTRUMENTATION_STAGE_GAS_LATENCY,   // Gas watchdog interrupt to buzzer on
+    INSTRUMENTATION_STAGE_CONSOLE,       // Console: one received key
+    INSTRUMENTATION_STAGE_STREAMS,       // Console: due stream lines
+    INSTRUMENTATION_STAGE_STATUS,        // Telemetry: one status report
+    INSTRUMENTATION_STAGE_UART_WRITE,    // Copying one write into the TX ring
+    INSTRUMENTATION_STAGE_UART_TX_ISR,   // One TX interrupt
+    INSTRUMENTATION_STAGE_COUNT,
+} instrumentationStage_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+#if INSTRUMENTATION_ENABLED
+
+#include "cmsis.h"
+
+// Cycles of the core clock; wraps every 2^32 cycles (about 24 s at 180 MHz)
+// and stops while the core sleeps
+inline uint32_t instrumentationCycles() {
+    return DWT->CYCCNT;
+}
+
+void instrumentationInit();
+void instrumentationStageRecord(instrumentationStage_t stage, uint32_t cycles);
+void instrumentationWakeLatencyRecord(uint32_t cycles);
+void instrumentationReportWrite();
+void instrumentationReset();
+
+// Times the code between BEGIN and END of the same stage in one scope. Each
+// stage must only be recorded from one thread or interrupt.
+#define INSTRUMENTATION_BEGIN(stage) \
+    uint32_t instrumentationStart_##stage = instrumentationCycles()
+#define INSTRUMENTATION_END(stage) \
+    instrumentationStageRecord(stage, instrumentationCycles() - instrumentationStart_##stage)
+
+#else
+
+inline uint32_t instrumentationCycles() {
+    return 0;
+}
+
+inline void instrumentationInit() {}
+inline void instrumentationStageRecord(instrumentationStage_t, uint32_t) {}
+inline void instrumentationWakeLatencyRecord(uint32_t) {}
+void instrumentationReportWrite();
+inline void instrumentationReset() {}
+
+#define INSTRUMENTATION_BEGIN(stage)
+#define INSTRUMENTATION_END(stage)
+
+#endif
+
+//=====[#include guards - end]=================================================
+
+#endif // _INSTRUMENTATION_H_
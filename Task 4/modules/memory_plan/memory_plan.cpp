@@ -0,0 +1,100 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "memory_plan.h"
+#include "number_format.h"
+#include "pc_serial_com.h"
+
+//=====[Declaration of private defines]========================================
+
+#define MEMORY_PLAN_THREADS_MAX     16  // Ours plus main, idle, timer and Mbed's
+
+//=====[Declaration and initialization of private global variables]============
+
+// Heap statistics when the firmware finished starting; anything allocated
+// after that is reported, since a long-running allocator fragments
+static mbed_stats_heap_t bootHeap;
+static bool booted = false;
+
+//=====[Implementations of public functions]===================================
+
+// Memory for Thread's stack_mem argument; Thread then allocates nothing.
+// Safe during static initialization, as it only reads the constexpr plan.
+unsigned char* memoryPlanStackMemory(memoryPlanStack_t stack) {
+    return (unsigned char*)(CCMDATARAM_BASE + memoryPlanStackOffset(stack));
+}
+
+uint32_t memoryPlanStackSize(memoryPlanStack_t stack) {
+    return memoryPlanStacks[stack].size;
+}
+
+const char* memoryPlanStackName(memoryPlanStack_t stack) {
+    return memoryPlanStacks[stack].name;
+}
+
+// Takes the heap baseline; call once every module has started
+void memoryPlanInit() {
+    mbed_stats_heap_get(&bootHeap);
+    booted = true;
+}
+
+// Something allocated from the heap since memoryPlanInit() and still holds it
+bool memoryPlanHeapGrown() {
+    if (!booted) {
+        return false;
+    }
+    mbed_stats_heap_t heap;
+    mbed_stats_heap_get(&heap);
+    return heap.current_size > bootHeap.current_size;
+}
+
+// "CCM RAM: capture 49152 B, stacks 8704 B, free 7680 B", then
+// "alarm: stack 1024 B, peak 296 B" per thread and the heap use since boot
+void memoryPlanReportWrite() {
+    char str[100] = "";
+    uint32_t stacksBytes = memoryPlanStackOffset(MEMORY_PLAN_STACK_COUNT) -
+                           MEMORY_PLAN_CAPTURE_RING_BYTES;
+    char* cursor = numberFormatAppendString(str, "CCM RAM: capture ");
+    cursor = numberFormatAppendUnsigned(cursor, MEMORY_PLAN_CAPTURE_RING_BYTES);
+    cursor = numberFormatAppendString(cursor, " B, stacks ");
+    cursor = numberFormatAppendUnsigned(cursor, stacksBytes);
+    cursor = numberFormatAppendString(cursor, " B, free ");
+    cursor = numberFormatAppendUnsigned(cursor, MEMORY_PLAN_CCM_SIZE -
+                                        memoryPlanStackOffset(MEMORY_PLAN_STACK_COUNT));
+    numberFormatAppendString(cursor, " B\r\n");
+    pcSerialComStringWrite(str);
+
+    // The kernel knows every thread, including those Mbed starts itself
+    osThreadId_t threads[MEMORY_PLAN_THREADS_MAX];
+    uint32_t threadCount = osThreadEnumerate(threads, MEMORY_PLAN_THREADS_MAX);
+    for (uint32_t i = 0; i < threadCount; ++i) {
+        const char* name = osThreadGetName(threads[i]);
+        uint32_t size = osThreadGetStackSize(threads[i]);
+        uint32_t peak = size - osThreadGetStackSpace(threads[i]);
+
+        str[0] = '\0';
+        cursor = numberFormatAppendString(str, name != nullptr ? name : "(unnamed)");
+        cursor = numberFormatAppendString(cursor, ": stack ");
+        cursor = numberFormatAppendUnsigned(cursor, size);
+        cursor = numberFormatAppendString(cursor, " B, peak ");
+        cursor = numberFormatAppendUnsigned(cursor, peak);
+        numberFormatAppendString(cursor, " B\r\n");
+        pcSerialComStringWrite(str);
+    }
+
+    mbed_stats_heap_t heap;
+    mbed_stats_heap_get(&heap);
+    str[0] = '\0';
+    cursor = numberFormatAppendString(str, "Heap: ");
+    cursor = numberFormatAppendUnsigned(cursor, bootHeap.current_size);
+    cursor = numberFormatAppendString(cursor, " B at boot, now ");
+    cursor = numberFormatAppendUnsigned(cursor, heap.current_size);
+    cursor = numberFormatAppendString(cursor, " B, ");
+    cursor = numberFormatAppendUnsigned(cursor, heap.total_size - bootHeap.total_size);
+    cursor = numberFormatAppendString(cursor, " B allocated since, ");
+    cursor = numberFormatAppendUnsigned(cursor, heap.alloc_fail_cnt);
+    numberFormatAppendString(cursor, " failures\r\n");
+    pcSerialComStringWrite(str);
+}
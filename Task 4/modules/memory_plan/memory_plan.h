@@ -0,0 +1,96 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _MEMORY_PLAN_H_
+#define _MEMORY_PLAN_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+#include "capture.h"
+#include "sensor_channels.h"
+
+//=====[Declaration of public defines]=========================================
+
+// The 64 KB core-coupled RAM holds the capture ring, then every thread stack
+// but main's. Only the CPU reaches it, so nothing the DMA reads or writes may
+// live there; Mbed's linker script for the F439 places nothing in it.
+#define MEMORY_PLAN_CCM_SIZE            (64 * 1024)
+#define MEMORY_PLAN_STACK_ALIGNMENT     8   // Required by the Cortex-M ABI
+
+#if CAPTURE_USE_CCM_RAM
+#define MEMORY_PLAN_CAPTURE_RING_BYTES  (CAPTURE_RING_SCANS * SENSOR_SCAN_CHANNEL_COUNT * 2)
+#else
+#define MEMORY_PLAN_CAPTURE_RING_BYTES  0
+#endif
+
+// The static buffers of each module are listed per directory by the Mbed
+// build's memory map ("mbed compile --stats-depth 3"); the heap is only used
+// by Mbed itself while booting, and memoryPlanReportWrite() shows any growth.
+
+//=====[Declaration of public data types]======================================
+
+typedef enum {
+    MEMORY_PLAN_STACK_ALARM,
+    MEMORY_PLAN_STACK_SAMPLER,
+    MEMORY_PLAN_STACK_SPI_ADC,
+    MEMORY_PLAN_STACK_TELEMETRY,
+    MEMORY_PLAN_STACK_NET_TELEMETRY,
+    MEMORY_PLAN_STACK_DATA_LOG,
+    MEMORY_PLAN_STACK_DIAGNOSTICS,
+    MEMORY_PLAN_STACK_FIRMWARE_UPDATE,
+    MEMORY_PLAN_STACK_COUNT,
+} memoryPlanStack_t;
+
+typedef struct {
+    const char* name;       // Thread name, as the stack report prints it
+    uint32_t size;          // Bytes, a multiple of MEMORY_PLAN_STACK_ALIGNMENT
+} memoryPlanStackDescriptor_t;
+
+//=====[Declaration and initialization of public global variables]=============
+
+// Indexed by memoryPlanStack_t. Check the peaks in the "memory" report after
+// changing what a thread calls; an overflow is a fault, not a slowdown.
+constexpr memoryPlanStackDescriptor_t memoryPlanStacks[MEMORY_PLAN_STACK_COUNT] = {
+    { "alarm",           1024 },
+    { "sampler",         1024 },
+    { "spi_adc",         SENSOR_SPI_CHANNEL_COUNT > 0 ? 768 : 0 },
+    { "telemetry",       1024 },
+    { "net_telemetry",   2048 },  // Socket calls go deep into lwIP
+    { "data_log",        1024 },
+    { "diagnostics",     768 },
+    { "firmware_update", 1024 },
+};
+
+//=====[Implementations of public functions]===================================
+
+// Offset of a stack in CCM RAM; the stacks are laid out in table order
+constexpr uint32_t memoryPlanStackOffset(int stack) {
+    return stack == 0 ? MEMORY_PLAN_CAPTURE_RING_BYTES
+                      : memoryPlanStackOffset(stack - 1) + memoryPlanStacks[stack - 1].size;
+}
+
+constexpr bool memoryPlanStacksAligned(int stack = 0) {
+    return stack >= MEMORY_PLAN_STACK_COUNT ||
+           (memoryPlanStacks[stack].size % MEMORY_PLAN_STACK_ALIGNMENT == 0 &&
+            memoryPlanStacksAligned(stack + 1));
+}
+
+static_assert(MEMORY_PLAN_CAPTURE_RING_BYTES % MEMORY_PLAN_STACK_ALIGNMENT == 0,
+              "Stacks after the capture ring must stay aligned");
+static_assert(memoryPlanStacksAligned(), "Stack sizes must keep stacks aligned");
+static_assert(memoryPlanStackOffset(MEMORY_PLAN_STACK_COUNT) <= MEMORY_PLAN_CCM_SIZE,
+              "Capture ring and thread stacks do not fit in CCM RAM");
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+unsigned char* memoryPlanStackMemory(memoryPlanStack_t stack);
+uint32_t memoryPlanStackSize(memoryPlanStack_t stack);
+const char* memoryPlanStackName(memoryPlanStack_t stack);
+void memoryPlanInit();
+bool memoryPlanHeapGrown();
+void memoryPlanReportWrite();
+
+//=====[#include guards - end]=================================================
+
+#endif // _MEMORY_PLAN_H_
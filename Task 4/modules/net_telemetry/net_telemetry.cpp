@@ -0,0 +1,551 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+#include "EthernetInterface.h"
+
+#include "net_telemetry.h"
+#include "telemetry_frames.h"
+#include "alarm.h"
+#include "diagnostics.h"
+#include "firmware_update.h"
+#include "frame_codec.h"
+#include "memory_plan.h"
+#include "number_format.h"
+#include "pc_serial_com.h"
+#include "sampler.h"
+#include "sensor_channels.h"
+#include "wall_clock.h"
+
+//=====[Declaration of private defines]========================================
+
+
+#define NET_TELEMETRY_FLAG_EVENT    (1UL << 0)
+#define NET_TELEMETRY_FLAG_PACKET   (1UL << 1)
+#define NET_TELEMETRY_FLAG_RECEIVE  (1UL << 2)
+
+#define NET_TELEMETRY_PACKET_QUEUE_LENGTH   4  // About 0.5 s of samples
+#define NET_TELEMETRY_EVENT_QUEUE_LENGTH    8
+
+#define NET_TELEMETRY_RETRY_WAIT        5s    // Between connection attempts
+#define NET_TELEMETRY_SEND_TIMEOUT_MS   100   // Also the wait for a TIME_RESPONSE
+
+#define NET_TELEMETRY_CRC_SIZE      2
+
+#define NET_TELEMETRY_SCANS_PER_PACKET  (NET_TELEMETRY_BLOCKS_PER_PACKET * \
+                                         SAMPLER_SCANS_PER_HALF)
+#define NET_TELEMETRY_PACKET_SIZE_MAX   (sizeof(telemetryFrameHeader_t) + \
+                                         NET_TELEMETRY_SCANS_PER_PACKET * \
+                                         SENSOR_SCAN_CHANNEL_COUNT * sizeof(uint16_t) + \
+                                         NET_TELEMETRY_CRC_SIZE)
+#define NET_TELEMETRY_RECEIVE_SIZE_MAX  (sizeof(telemetryFrameHeader_t) + \
+                                         sizeof(telemetryFrameUpdate_t) + \
+                                         FIRMWARE_UPDATE_CHUNK_MAX + \
+                                         NET_TELEMETRY_CRC_SIZE)
+
+//=====[Declaration of private data types]=====================================
+
+// One datagram, built in place by the sampler callback and sent from the
+// same buffer by the network thread
+typedef struct {
+    uint32_t scanCount;
+    uint32_t sequence;      // Of the first block
+    uint8_t datagram[NET_TELEMETRY_PACKET_SIZE_MAX];
+} netTelemetryPacket_t;
+
+static_assert(NET_TELEMETRY_SCANS_PER_PACKET <= UINT8_MAX,
+              "Scan count must fit the frame header");
+
+//=====[Declaration and initialization of private global variables]============
+
+// Below the console, like the serial telemetry: a stalled network only ever
+// delays this thread
+static Thread netTelemetryThread(osPriorityBelowNormal,
+                                 memoryPlanStackSize(MEMORY_PLAN_STACK_NET_TELEMETRY),
+                                 memoryPlanStackMemory(MEMORY_PLAN_STACK_NET_TELEMETRY),
+                                 memoryPlanStackName(MEMORY_PLAN_STACK_NET_TELEMETRY));
+static EventFlags netTelemetryFlags;
+
+static EthernetInterface ethernet;
+static UDPSocket socket;
+static SocketAddress collector;
+
+// Alarm events have their own queue, drained before every sample packet
+static Mail<netTelemetryPacket_t, NET_TELEMETRY_PACKET_QUEUE_LENGTH> packets;
+static Mail<alarmEvent_t, NET_TELEMETRY_EVENT_QUEUE_LENGTH> events;
+
+// Only the sampler thread touches the packet being filled
+static netTelemetryPacket_t* filling = nullptr;
+
+// Only the network thread receives; one byte spare recognises longer datagrams
+static uint8_t received[NET_TELEMETRY_RECEIVE_SIZE_MAX + 1];
+
+static volatile bool connected = false;
+static uint32_t eventSequence = 0;
+static uint32_t timeSequence = 0;
+static uint64_t nextTimeSyncMs = 0;
+static uint32_t healthChangesSent = 0;
+
+static volatile uint32_t samplePackets = 0;
+static volatile uint32_t eventPackets = 0;
+static volatile uint32_t droppedBlocks = 0;
+static volatile uint32_t droppedEvents = 0;
+static volatile uint32_t sendErrors = 0;
+static volatile uint32_t timeRequests = 0;
+static volatile uint32_t timeResponses = 0;
+static volatile uint32_t updateSteps = 0;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void netTelemetryTask();
+static bool netTelemetryConnect();
+static void netTelemetryEventsSend();
+static void netTelemetryTimeSync();
+static bool netTelemetryTimeResponseReceive(uint32_t sequence, uint64_t requestLocalUs,
+                                            timeSyncExchange_t* exchange);
+static void netTelemetryReceive();
+static int netTelemetryDatagramCheck(const SocketAddress& sender, size_t length,
+                                     telemetryFrameHeader_t* header);
+static void netTelemetryUpdateHandle(const SocketAddress& sender,
+                                     const telemetryFrameHeader_t* header,
+                                     const uint8_t* payload, size_t length);
+static void netTelemetrySignal();
+static void netTelemetryTimeSend();
+static void netTelemetryHealthSend(bool changedOnly);
+static void netTelemetryDatagramSend(uint8_t* datagram, size_t length);
+static void netTelemetryDatagramSendTo(const SocketAddress& address, uint8_t* datagram,
+                                       size_t length);
+static void netTelemetryRawBlockBatch(const samplerRawBlock_t* block);
+static void netTelemetryAlarmEventQueue(const alarmEvent_t* event);
+static size_t netTelemetryHeaderWrite(uint8_t* datagram, telemetryFrameType_t type,
+                                      uint8_t count, uint32_t sequence,
+                                      uint32_t timestampUs);
+
+//=====[Implementations of public functions]===================================
+
+// Starts the network thread, which brings the link up with DHCP in the
+// background; samples and events are dropped until it is connected
+void netTelemetryInit() {
+    netTelemetryThread.start(netTelemetryTask);
+    samplerRawBlockAttach(netTelemetryRawBlockBatch);
+    alarmEventAttach(netTelemetryAlarmEventQueue);
+}
+
+void netTelemetryStatsGet(netTelemetryStats_t* stats) {
+    stats->connected = connected;
+    stats->samplePackets = samplePackets;
+    stats->eventPackets = eventPackets;
+    stats->droppedBlocks = droppedBlocks;
+    stats->droppedEvents = droppedEvents;
+    stats->sendErrors = sendErrors;
+    stats->timeRequests = timeRequests;
+    stats->timeResponses = timeResponses;
+    stats->updateSteps = updateSteps;
+}
+
+void netTelemetryReportWrite() {
+    netTelemetryStats_t stats;
+    netTelemetryStatsGet(&stats);
+
+    char str[160] = "";
+    char* cursor = numberFormatAppendString(str, "Network: ");
+    if (stats.connected) {
+        SocketAddress address;
+        ethernet.get_ip_address(&address);
+        cursor = numberFormatAppendString(cursor, address.get_ip_address());
+        cursor = numberFormatAppendString(cursor, " to " NET_TELEMETRY_HOST);
+    } else {
+        cursor = numberFormatAppendString(cursor, "not connected");
+    }
+    cursor = numberFormatAppendString(cursor, ", ");
+    cursor = numberFormatAppendUnsigned(cursor, stats.samplePackets);
+    cursor = numberFormatAppendString(cursor, " sample and ");
+    cursor = numberFormatAppendUnsigned(cursor, stats.eventPackets);
+    cursor = numberFormatAppendString(cursor, " event packets, dropped ");
+    cursor = numberFormatAppendUnsigned(cursor, stats.droppedBlocks);
+    cursor = numberFormatAppendString(cursor, " blocks and ");
+    cursor = numberFormatAppendUnsigned(cursor, stats.droppedEvents);
+    cursor = numberFormatAppendString(cursor, " events, ");
+    cursor = numberFormatAppendUnsigned(cursor, stats.sendErrors);
+    cursor = numberFormatAppendString(cursor, " send errors, ");
+    cursor = numberFormatAppendUnsigned(cursor, stats.timeResponses);
+    cursor = numberFormatAppendString(cursor, "/");
+    cursor = numberFormatAppendUnsigned(cursor, stats.timeRequests);
+    cursor = numberFormatAppendString(cursor, " clock exchanges, ");
+    cursor = numberFormatAppendUnsigned(cursor, stats.updateSteps);
+    numberFormatAppendString(cursor, " update steps\r\n");
+    pcSerialComStringWrite(str);
+}
+
+//=====[Implementations of private functions]==================================
+
+static void netTelemetryTask() {
+    while (true) {
+        if (!connected) {
+            if (!netTelemetryConnect()) {
+                ThisThread::sleep_for(NET_TELEMETRY_RETRY_WAIT);
+                continue;
+            }
+            connected = true;
+            nextTimeSyncMs = Kernel::get_ms_count();
+        }
+
+        uint64_t nowMs = Kernel::get_ms_count();
+        if (nowMs >= nextTimeSyncMs) {
+            netTelemetryTimeSync();
+            nextTimeSyncMs = nowMs + NET_TELEMETRY_TIME_SYNC_PERIOD_MS;
+            continue;
+        }
+        netTelemetryFlags.wait_any_for(NET_TELEMETRY_FLAG_EVENT | NET_TELEMETRY_FLAG_PACKET |
+                                       NET_TELEMETRY_FLAG_RECEIVE,
+                                       std::chrono::milliseconds(nextTimeSyncMs - nowMs));
+
+        netTelemetryReceive();
+        netTelemetryEventsSend();
+        netTelemetryHealthSend(true);
+        netTelemetryPacket_t* packet;
+        while (connected && (packet = packets.try_get()) != nullptr) {
+            size_t length = sizeof(telemetryFrameHeader_t) +
+                            packet->scanCount * SENSOR_SCAN_CHANNEL_COUNT * sizeof(uint16_t);
+            netTelemetryDatagramSend(packet->datagram, length);
+            packets.free(packet);
+            samplePackets++;
+            netTelemetryEventsSend();  // An event may have tripped meanwhile
+        }
+    }
+}
+
+static bool netTelemetryConnect() {
+    if (ethernet.connect() != NSAPI_ERROR_OK) {
+        return false;
+    }
+    if (!collector.set_ip_address(NET_TELEMETRY_HOST)) {
+        ethernet.disconnect();
+        return false;
+    }
+    collector.set_port(NET_TELEMETRY_PORT);
+
+    socket.open(&ethernet);
+    socket.set_timeout(NET_TELEMETRY_SEND_TIMEOUT_MS);
+    socket.sigio(netTelemetrySignal);
+    return true;
+}
+
+static void netTelemetryEventsSend() {
+    alarmEvent_t* event;
+    while (connected && (event = events.try_get()) != nullptr) {
+        // Alarm and rate events carry payloads of the same size
+        uint8_t datagram[sizeof(telemetryFrameHeader_t) +
+                         sizeof(telemetryFrameAlarmEvent_t) + NET_TELEMETRY_CRC_SIZE];
+        size_t length;
+        if (event->type == ALARM_EVENT_RATE_FULL || event->type == ALARM_EVENT_RATE_REDUCED) {
+            length = netTelemetryHeaderWrite(datagram, TELEMETRY_FRAME_RATE, 1,
+                                             eventSequence++, us_ticker_read());
+            telemetryFrameRate_t payload = {
+                (uint8_t)(event->type == ALARM_EVENT_RATE_FULL ? SAMPLER_MODE_CONTINUOUS
+                                                               : SAMPLER_MODE_BURST),
+                event->reason, event->channel, 0 };
+            memcpy(&datagram[length], &payload, sizeof(payload));
+            length += sizeof(payload);
+        } else {
+            length = netTelemetryHeaderWrite(datagram, TELEMETRY_FRAME_ALARM_EVENT, 1,
+                                             eventSequence++, us_ticker_read());
+            telemetryFrameAlarmEvent_t payload = { (uint8_t)event->type, event->channel,
+                                                   { 0, 0 } };
+            memcpy(&datagram[length], &payload, sizeof(payload));
+            length += sizeof(payload);
+        }
+        events.free(event);
+
+        netTelemetryDatagramSend(datagram, length);
+        eventPackets++;
+    }
+}
+
+// One NTP-like exchange with the collector. The board clock is read as
+// close to the socket calls as possible; the round trip also covers lwIP
+// and this thread's scheduling, which the clock filter mostly rejects.
+static void netTelemetryTimeSync() {
+    uint8_t datagram[sizeof(telemetryFrameHeader_t) +
+                     sizeof(telemetryFrameTimeRequest_t) + NET_TELEMETRY_CRC_SIZE];
+    uint32_t sequence = timeSequence++;
+    uint64_t requestLocalUs = wallClockLocalUs();
+    size_t length = netTelemetryHeaderWrite(datagram, TELEMETRY_FRAME_TIME_REQUEST, 1,
+                                            sequence, (uint32_t)requestLocalUs);
+    telemetryFrameTimeRequest_t request = { requestLocalUs };
+    memcpy(&datagram[length], &request, sizeof(request));
+    length += sizeof(request);
+    netTelemetryDatagramSend(datagram, length);
+    timeRequests++;
+
+    timeSyncExchange_t exchange;
+    if (connected && netTelemetryTimeResponseReceive(sequence, requestLocalUs, &exchange)) {
+        timeResponses++;
+        wallClockExchangeAdd(&exchange);
+    }
+    if (connected) {
+        netTelemetryTimeSend();
+    }
+    netTelemetryHealthSend(false);
+}
+
+// Waits up to the socket timeout for the response to this request; stale
+// responses are dropped, update steps answered on the way
+static bool netTelemetryTimeResponseReceive(uint32_t sequence, uint64_t requestLocalUs,
+                                            timeSyncExchange_t* exchange) {
+    SocketAddress sender;
+
+    while (true) {
+        nsapi_size_or_error_t length = socket.recvfrom(&sender, received, sizeof(received));
+        uint64_t responseLocalUs = wallClockLocalUs();
+        if (length < 0) {
+            return false;  // Timed out
+        }
+        telemetryFrameHeader_t header;
+        int payloadLength = netTelemetryDatagramCheck(sender, length, &header);
+        if (payloadLength < 0) {
+            continue;
+        }
+        if (header.type == TELEMETRY_FRAME_UPDATE) {
+            netTelemetryUpdateHandle(sender, &header, &received[sizeof(header)],
+                                     payloadLength);
+            continue;
+        }
+
+        telemetryFrameTimeResponse_t response;
+        memcpy(&response, &received[sizeof(header)], sizeof(response));
+        if (header.type != TELEMETRY_FRAME_TIME_RESPONSE ||
+            payloadLength != sizeof(response) || header.sequence != sequence ||
+            response.requestLocalUs != requestLocalUs) {
+            continue;
+        }
+        exchange->requestLocalUs = requestLocalUs;
+        exchange->receiveWallUs = response.receiveWallUs;
+        exchange->transmitWallUs = response.transmitWallUs;
+        exchange->responseLocalUs = responseLocalUs;
+        return true;
+    }
+}
+
+// Drains what the collector sent without waiting; only UPDATE datagrams are
+// expected outside a clock exchange
+static void netTelemetryReceive() {
+    if (!connected) {
+        return;
+    }
+    SocketAddress sender;
+    socket.set_blocking(false);
+    while (true) {
+        nsapi_size_or_error_t length = socket.recvfrom(&sender, received, sizeof(received));
+        if (length < 0) {
+            break;
+        }
+        telemetryFrameHeader_t header;
+        int payloadLength = netTelemetryDatagramCheck(sender, length, &header);
+        if (payloadLength >= 0 && header.type == TELEMETRY_FRAME_UPDATE) {
+            netTelemetryUpdateHandle(sender, &header, &received[sizeof(header)],
+                                     payloadLength);
+        }
+    }
+    socket.set_timeout(NET_TELEMETRY_SEND_TIMEOUT_MS);
+}
+
+// Length of the payload of a datagram from the collector with a good CRC
+// and this version, -1 for anything else
+static int netTelemetryDatagramCheck(const SocketAddress& sender, size_t length,
+                                     telemetryFrameHeader_t* header) {
+    if (length < sizeof(*header) + NET_TELEMETRY_CRC_SIZE ||
+        length > NET_TELEMETRY_RECEIVE_SIZE_MAX || sender.get_ip_address() == nullptr ||
+        strcmp(sender.get_ip_address(), collector.get_ip_address()) != 0) {
+        return -1;
+    }
+    uint16_t crc = frameCodecCrc16(FRAME_CODEC_CRC16_INIT, received,
+                                   length - NET_TELEMETRY_CRC_SIZE);
+    if (received[length - 2] != (uint8_t)(crc & 0xFF) ||
+        received[length - 1] != (uint8_t)(crc >> 8)) {
+        return -1;
+    }
+    memcpy(header, received, sizeof(*header));
+    if (header->version != TELEMETRY_FRAME_VERSION) {
+        return -1;
+    }
+    return (int)(length - sizeof(*header) - NET_TELEMETRY_CRC_SIZE);
+}
+
+// Runs one update step and answers it, to the port it came from, with the
+// step's outcome and where the next data goes
+static void netTelemetryUpdateHandle(const SocketAddress& sender,
+                                     const telemetryFrameHeader_t* header,
+                                     const uint8_t* payload, size_t length) {
+    telemetryFrameUpdate_t update;
+    if (length < sizeof(update)) {
+        return;
+    }
+    memcpy(&update, payload, sizeof(update));
+    if (update.length != length - sizeof(update)) {
+        return;
+    }
+
+    firmwareUpdateError_t error = FIRMWARE_UPDATE_ERROR_NONE;
+    switch (update.step) {
+    case FIRMWARE_UPDATE_STEP_BEGIN:
+        error = firmwareUpdateBegin(update.imageSize, update.imageCrc32, update.version);
+        break;
+    case FIRMWARE_UPDATE_STEP_DATA:
+        error = firmwareUpdateWrite(update.offset, &payload[sizeof(update)], update.length);
+        break;
+    case FIRMWARE_UPDATE_STEP_FINISH:
+        error = firmwareUpdateFinish();
+        break;
+    case FIRMWARE_UPDATE_STEP_APPLY:
+        error = firmwareUpdateApply();
+        break;
+    case FIRMWARE_UPDATE_STEP_STATUS:
+        break;
+    default:
+        error = FIRMWARE_UPDATE_ERROR_STATE;
+        break;
+    }
+    firmwareUpdateStatus_t status;
+    firmwareUpdateStatusGet(&status);
+    if (update.step == FIRMWARE_UPDATE_STEP_STATUS) {
+        error = status.error;
+    }
+
+    uint8_t datagram[sizeof(telemetryFrameHeader_t) +
+                     sizeof(telemetryFrameUpdateStatus_t) + NET_TELEMETRY_CRC_SIZE];
+    size_t datagramLength = netTelemetryHeaderWrite(datagram, TELEMETRY_FRAME_UPDATE_STATUS,
+                                                    1, header->sequence, us_ticker_read());
+    telemetryFrameUpdateStatus_t reply = { (uint8_t)status.state, (uint8_t)error, 0,
+                                           status.nextOffset, status.imageSize };
+    memcpy(&datagram[datagramLength], &reply, sizeof(reply));
+    datagramLength += sizeof(reply);
+    netTelemetryDatagramSendTo(sender, datagram, datagramLength);
+    updateSteps++;
+}
+
+// Runs in the network stack's context whenever the socket has news
+static void netTelemetrySignal() {
+    netTelemetryFlags.set(NET_TELEMETRY_FLAG_RECEIVE);
+}
+
+// Tells the collector how to turn this board's header timestamps into
+// wall-clock time
+static void netTelemetryTimeSend() {
+    wallClockState_t state;
+    wallClockGet(&state);
+
+    uint8_t datagram[sizeof(telemetryFrameHeader_t) +
+                     sizeof(telemetryFrameTime_t) + NET_TELEMETRY_CRC_SIZE];
+    uint64_t localUs = wallClockLocalUs();
+    size_t length = netTelemetryHeaderWrite(datagram, TELEMETRY_FRAME_TIME, 1,
+                                            timeSequence, (uint32_t)localUs);
+    telemetryFrameTime_t payload = { state.mapping.localUs, state.mapping.wallUs,
+                                     state.mapping.driftPpb, (uint8_t)state.source,
+                                     { 0, 0, 0 } };
+    memcpy(&datagram[length], &payload, sizeof(payload));
+    length += sizeof(payload);
+    netTelemetryDatagramSend(datagram, length);
+}
+
+// The diagnostics flags, unless changedOnly and none changed since the last
+static void netTelemetryHealthSend(bool changedOnly) {
+    diagnosticsHealth_t health;
+    diagnosticsHealthGet(&health);
+    if (!connected || (changedOnly && health.changes == healthChangesSent)) {
+        return;
+    }
+    healthChangesSent = health.changes;
+
+    uint8_t datagram[sizeof(telemetryFrameHeader_t) + sizeof(health.flags) +
+                     NET_TELEMETRY_CRC_SIZE];
+    size_t length = netTelemetryHeaderWrite(datagram, TELEMETRY_FRAME_HEALTH, 1,
+                                            health.sequence, us_ticker_read());
+    memcpy(&datagram[length], health.flags, sizeof(health.flags));
+    length += sizeof(health.flags);
+    netTelemetryDatagramSend(datagram, length);
+}
+
+static void netTelemetryDatagramSend(uint8_t* datagram, size_t length) {
+    netTelemetryDatagramSendTo(collector, datagram, length);
+}
+
+// Appends the CRC and sends the frame as one datagram, which delimits it, so
+// it is not COBS-encoded; datagram needs room for the CRC. A lost link makes
+// the thread reconnect.
+static void netTelemetryDatagramSendTo(const SocketAddress& address, uint8_t* datagram,
+                                       size_t length) {
+    uint16_t crc = frameCodecCrc16(FRAME_CODEC_CRC16_INIT, datagram, length);
+    datagram[length++] = (uint8_t)(crc & 0xFF);
+    datagram[length++] = (uint8_t)(crc >> 8);
+
+    nsapi_size_or_error_t result = socket.sendto(address, datagram, length);
+    if (result < 0) {
+        sendErrors++;
+        if (result == NSAPI_ERROR_NO_CONNECTION ||
+            ethernet.get_connection_status() == NSAPI_STATUS_DISCONNECTED) {
+            connected = false;
+            socket.close();
+            ethernet.disconnect();
+        }
+    }
+}
+
+// Runs in the sampler thread: copies the block straight into the datagram
+// and hands it over once it holds NET_TELEMETRY_BLOCKS_PER_PACKET blocks
+static void netTelemetryRawBlockBatch(const samplerRawBlock_t* block) {
+    if (filling == nullptr) {
+        filling = connected ? packets.try_alloc() : nullptr;
+        if (filling == nullptr) {
+            droppedBlocks++;
+            return;
+        }
+        filling->scanCount = 0;
+        filling->sequence = block->sequence;
+    }
+
+    size_t offset = sizeof(telemetryFrameHeader_t) +
+                    filling->scanCount * SENSOR_SCAN_CHANNEL_COUNT * sizeof(uint16_t);
+    uint32_t scanCount = block->scanCount;
+    if (filling->scanCount + scanCount > NET_TELEMETRY_SCANS_PER_PACKET) {
+        scanCount = NET_TELEMETRY_SCANS_PER_PACKET - filling->scanCount;
+    }
+    memcpy(&filling->datagram[offset], block->samples,
+           scanCount * SENSOR_SCAN_CHANNEL_COUNT * sizeof(uint16_t));
+    filling->scanCount += scanCount;
+
+    if (filling->scanCount == NET_TELEMETRY_SCANS_PER_PACKET) {
+        netTelemetryHeaderWrite(filling->datagram, TELEMETRY_FRAME_SAMPLES,
+                                (uint8_t)filling->scanCount, filling->sequence,
+                                block->timestampUs);
+        packets.put(filling);
+        filling = nullptr;
+        netTelemetryFlags.set(NET_TELEMETRY_FLAG_PACKET);
+    }
+}
+
+// Runs in the alarm thread
+static void netTelemetryAlarmEventQueue(const alarmEvent_t* event) {
+    alarmEvent_t* mail = connected ? events.try_alloc() : nullptr;
+    if (mail == nullptr) {
+        droppedEvents++;
+        return;
+    }
+    *mail = *event;
+    events.put(mail);
+    netTelemetryFlags.set(NET_TELEMETRY_FLAG_EVENT);
+}
+
+static size_t netTelemetryHeaderWrite(uint8_t* datagram, telemetryFrameType_t type,
+                                      uint8_t count, uint32_t sequence,
+                                      uint32_t timestampUs) {
+    telemetryFrameHeader_t header;
+    header.type = (uint8_t)type;
+    header.version = TELEMETRY_FRAME_VERSION;
+    header.channelCount = telemetryFrameChannelCount(type);
+    header.count = count;
+    header.sequence = sequence;
+    header.timestampUs = timestampUs;
+    memcpy(datagram, &header, sizeof(header));
+    return sizeof(header);
+}
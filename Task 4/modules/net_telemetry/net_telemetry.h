@@ -0,0 +1,55 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _NET_TELEMETRY_H_
+#define _NET_TELEMETRY_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+//=====[Declaration of public defines]=========================================
+
+// Collector that receives the datagrams; override at build time per fleet
+#ifndef NET_TELEMETRY_HOST
+#define NET_TELEMETRY_HOST          "192.168.1.100"
+#endif
+#ifndef NET_TELEMETRY_PORT
+#define NET_TELEMETRY_PORT          5005
+#endif
+
+// Half-buffers batched into one SAMPLES datagram: 128 scans, 782 bytes,
+// about 8 packets per second at the full scan rate
+#define NET_TELEMETRY_BLOCKS_PER_PACKET 4
+
+// Clock exchange with the collector (see telemetry_frames.h), each followed
+// by a TIME datagram with the resulting mapping and a HEALTH datagram, which
+// is also sent as soon as a flag changes
+#define NET_TELEMETRY_TIME_SYNC_PERIOD_MS   16000
+
+// UPDATE datagrams (see firmware_update.h) are only taken from the
+// collector's address; the CRC-16 and the image CRC-32 catch corruption, not
+// a forged sender, so keep the collector on a trusted network
+
+//=====[Declaration of public data types]======================================
+
+typedef struct {
+    bool connected;
+    uint32_t samplePackets;   // SAMPLES datagrams sent
+    uint32_t eventPackets;    // ALARM_EVENT datagrams sent
+    uint32_t droppedBlocks;   // Half-buffers lost to a full queue or no link
+    uint32_t droppedEvents;
+    uint32_t sendErrors;
+    uint32_t timeRequests;    // TIME_REQUEST datagrams sent
+    uint32_t timeResponses;   // Matching TIME_RESPONSE datagrams received
+    uint32_t updateSteps;     // UPDATE datagrams answered
+} netTelemetryStats_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void netTelemetryInit();
+void netTelemetryStatsGet(netTelemetryStats_t* stats);
+void netTelemetryReportWrite();
+
+//=====[#include guards - end]=================================================
+
+#endif // _NET_TELEMETRY_H_
@@ -0,0 +1,102 @@
+//=====[Libraries]=============================================================
+
+#include "number_format.h"
+
+//=====[Implementations of public functions]===================================
+
+char* numberFormatAppendString(char* cursor, const char* text) {
+    while (*text != '\0') {
+        *cursor++ = *text++;
+    }
+    *cursor = '\0';
+    return cursor;
+}
+
+char* numberFormatAppendUnsigned(char* cursor, uint32_t value) {
+    char digits[10];
+    int count = 0;
+    do {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while (value != 0);
+
+    while (count > 0) {
+        *cursor++ = digits[--count];
+    }
+    *cursor = '\0';
+    return cursor;
+}
+
+char* numberFormatAppendSigned(char* cursor, int32_t value) {
+    uint32_t magnitude = (uint32_t)value;
+    if (value < 0) {
+        *cursor++ = '-';
+        magnitude = 0U - magnitude;
+    }
+    return numberFormatAppendUnsigned(cursor, magnitude);
+}
+
+// Prints a value held in hundredths with two decimals, like "%.2f"
+char* numberFormatAppendHundredths(char* cursor, int32_t hundredths) {
+    uint32_t magnitude = (uint32_t)hundredths;
+    if (hundredths < 0) {
+        *cursor++ = '-';
+        magnitude = 0U - magnitude;
+    }
+    cursor = numberFormatAppendUnsigned(cursor, magnitude / 100);
+    *cursor++ = '.';
+    *cursor++ = '0' + (magnitude / 10) % 10;
+    *cursor++ = '0' + magnitude % 10;
+    *cursor = '\0';
+    return cursor;
+}
+
+bool numberFormatParseUnsigned(const char* text, uint32_t* value) {
+    uint32_t result = 0;
+    if (*text == '\0') {
+        return false;
+    }
+    for (; *text != '\0'; ++text) {
+        uint32_t digit = (uint32_t)(*text - '0');
+        if (*text < '0' || *text > '9' || result > (UINT32_MAX - digit) / 10) {
+            return false;
+        }
+        result = result * 10 + digit;
+    }
+    *value = result;
+    return true;
+}
+
+// Reads "-12", "24.5" or "0.05" as hundredths; more decimals are rejected
+bool numberFormatParseHundredths(const char* text, int32_t* hundredths) {
+    bool negative = (*text == '-');
+    if (negative) {
+        text++;
+    }
+
+    int32_t result = 0;
+    int decimals = -1;  // Digits seen after the point, -1 before it
+    bool digits = false;
+    for (; *text != '\0'; ++text) {
+        if (*text == '.' && decimals < 0) {
+            decimals = 0;
+        } else if (*text >= '0' && *text <= '9' && decimals < 2 &&
+                   result <= (INT32_MAX - 9) / 10 / 100) {
+            result = result * 10 + (*text - '0');
+            digits = true;
+            if (decimals >= 0) {
+                decimals++;
+            }
+        } else {
+            return false;
+        }
+    }
+    if (!digits) {
+        return false;
+    }
+    for (int i = (decimals < 0 ? 0 : decimals); i < 2; ++i) {
+        result *= 10;
+    }
+    *hundredths = negative ? -result : result;
+    return true;
+}
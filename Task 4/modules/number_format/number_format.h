@@ -0,0 +1,26 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _NUMBER_FORMAT_H_
+#define _NUMBER_FORMAT_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// Each function writes at the cursor, keeps the text null-terminated and
+// returns the new end, so a line is built by chaining calls without sprintf()
+char* numberFormatAppendString(char* cursor, const char* text);
+char* numberFormatAppendUnsigned(char* cursor, uint32_t value);
+char* numberFormatAppendSigned(char* cursor, int32_t value);
+char* numberFormatAppendHundredths(char* cursor, int32_t hundredths);
+
+// The reverse, for console input: the whole text must be a number, or false
+// is returned and the value left untouched
+bool numberFormatParseUnsigned(const char* text, uint32_t* value);
+bool numberFormatParseHundredths(const char* text, int32_t* hundredths);
+
+//=====[#include guards - end]=================================================
+
+#endif // _NUMBER_FORMAT_H_
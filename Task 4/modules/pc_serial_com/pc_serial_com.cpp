@@ -0,0 +1,348 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "pc_serial_com.h"
+#include "number_format.h"
+#include "instrumentation.h"
+
+//=====[Declaration of private defines]========================================
+
+#define PC_SERIAL_COM_TX_MASK           (PC_SERIAL_COM_TX_BUFFER_SIZE - 1)
+#define PC_SERIAL_COM_RX_MASK           (PC_SERIAL_COM_RX_BUFFER_SIZE - 1)
+
+#define PC_SERIAL_COM_TX_RECORDS        32  // Must be a power of two
+#define PC_SERIAL_COM_TX_RECORDS_MASK   (PC_SERIAL_COM_TX_RECORDS - 1)
+
+// Identical lines written within the window are counted instead of queued
+#define PC_SERIAL_COM_COALESCE_SLOTS        4
+#define PC_SERIAL_COM_COALESCE_WINDOW_MS    10000
+
+#define PC_SERIAL_COM_TX_OVERFLOW_DEFAULT   PC_SERIAL_COM_TX_DROP_OLDEST
+#define PC_SERIAL_COM_TX_COALESCE_DEFAULT   true
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct {
+    uint32_t hash;
+    uint64_t lastQueuedMs;
+    uint32_t repeats;
+} pcSerialComCoalesceSlot_t;
+
+//=====[Declaration and initialization of public global objects]===============
+
+// Serial communication setup (for UART)
+UnbufferedSerial uartUsb(USBTX, USBRX, PC_SERIAL_COM_BAUD_RATE);
+
+//=====[Declaration and initialization of private global variables]============
+
+// Single-producer/single-consumer ring: writers own txHead (serialized by
+// txWriteMutex), the TX interrupt owns txTail. Indexes run freely and are
+// masked on access.
+static char txBuffer[PC_SERIAL_COM_TX_BUFFER_SIZE];
+static volatile uint32_t txHead = 0;
+static volatile uint32_t txTail = 0;
+static volatile bool txActive = false;
+
+static Mutex txWriteMutex;
+
+// Where each queued line or frame ends, one per write, for DROP_OLDEST: a
+// frame may hold any byte but zero, '\n' included. Writers only. With more
+// records queued than slots the oldest two merge and are dropped together.
+static uint32_t txRecordEnds[PC_SERIAL_COM_TX_RECORDS];
+static uint32_t txRecordHead = 0;
+static uint32_t txRecordTail = 0;
+static uint32_t txRecordStart = 0;    // Of the oldest record
+
+static pcSerialComTxOverflow_t txOverflow = PC_SERIAL_COM_TX_OVERFLOW_DEFAULT;
+static bool txCoalesce = PC_SERIAL_COM_TX_COALESCE_DEFAULT;
+static pcSerialComCoalesceSlot_t coalesceSlots[PC_SERIAL_COM_COALESCE_SLOTS];
+static uint32_t coalesceNextSlot = 0;
+
+static uint32_t txDroppedBytes = 0;
+static uint32_t txCoalescedLines = 0;
+
+// Filled by the RX interrupt, which owns rxHead; the console owns rxTail.
+// Characters that arrive while it is full are dropped.
+static char rxBuffer[PC_SERIAL_COM_RX_BUFFER_SIZE];
+static volatile uint32_t rxHead = 0;
+static volatile uint32_t rxTail = 0;
+static volatile uint32_t rxDroppedBytes = 0;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void pcSerialComWrite(const char* data, size_t length, bool coalescable);
+static bool pcSerialComTxCoalesce(const char* str, size_t length,
+                                  uint32_t* repeats);
+static bool pcSerialComTxReserve(size_t length);
+static void pcSerialComTxEnqueue(const char* data, size_t length);
+static void pcSerialComTxStart();
+static void pcSerialComTxIsr();
+static void pcSerialComRxIsr();
+
+//=====[Implementations of public functions]===================================
+
+void pcSerialComInit() {
+    for (int i = 0; i < PC_SERIAL_COM_COALESCE_SLOTS; ++i) {
+        coalesceSlots[i].hash = 0;
+        coalesceSlots[i].repeats = 0;
+    }
+    pcSerialComRxEnable(true);
+}
+
+// Queues a string for the TX interrupt and returns without waiting for the UART
+void pcSerialComStringWrite(const char* str) {
+    pcSerialComWrite(str, strlen(str), false);
+}
+
+// Same, for status lines such as alarm notices: when coalescing is enabled an
+// unchanged line written again within the window is counted, not queued
+void pcSerialComRepeatedLineWrite(const char* str) {
+    pcSerialComWrite(str, strlen(str), true);
+}
+
+// Queues a binary frame, with its zero delimiter
+void pcSerialComFrameWrite(const uint8_t* frame, size_t length) {
+    pcSerialComWrite((const char*)frame, length, false);
+}
+
+// Takes the next received character, or '\0' when none is waiting. The RX
+// interrupt buffers input, so a pasted line survives the console sleeping.
+char pcSerialComCharRead() {
+    uint32_t tail = rxTail;
+    if (tail == core_util_atomic_load_u32(&rxHead)) {
+        return '\0';
+    }
+    char receivedChar = rxBuffer[tail & PC_SERIAL_COM_RX_MASK];
+    core_util_atomic_store_u32(&rxTail, tail + 1);
+    return receivedChar;
+}
+
+// The RX interrupt holds a deep sleep lock, since STOP mode halts the UART;
+// low-power mode turns it off and gives up console input
+void pcSerialComRxEnable(bool enabled) {
+    if (enabled) {
+        uartUsb.attach(pcSerialComRxIsr, SerialBase::RxIrq);
+    } else {
+        uartUsb.attach(nullptr, SerialBase::RxIrq);
+    }
+}
+
+void pcSerialComTxOverflowSet(pcSerialComTxOverflow_t policy) {
+    txWriteMutex.lock();
+    txOverflow = policy;
+    txWriteMutex.unlock();
+}
+
+void pcSerialComTxCoalesceSet(bool enabled) {
+    txWriteMutex.lock();
+    txCoalesce = enabled;
+    txWriteMutex.unlock();
+}
+
+// Free bytes in the TX buffer, for writers that pace themselves instead of
+// losing data to the overflow policy
+uint32_t pcSerialComTxSpace() {
+    return PC_SERIAL_COM_TX_BUFFER_SIZE - (txHead - txTail);
+}
+
+uint32_t pcSerialComTxDroppedBytes() {
+    return txDroppedBytes;
+}
+
+uint32_t pcSerialComTxCoalescedLines() {
+    return txCoalescedLines;
+}
+
+uint32_t pcSerialComRxDroppedBytes() {
+    return rxDroppedBytes;
+}
+
+//=====[Implementations of private functions]==================================
+
+// Copies the data into the TX ring and returns without waiting for the UART
+static void pcSerialComWrite(const char* data, size_t length, bool coalescable) {
+    char note[32] = "";
+    size_t bodyLength = length;
+    uint32_t repeats = 0;
+
+    txWriteMutex.lock();
+
+    if (coalescable && txCoalesce && pcSerialComTxCoalesce(data, length, &repeats)) {
+        txWriteMutex.unlock();
+        return;
+    }
+
+    // A line that was coalesced is queued once more with its repeat count
+    if (repeats > 0) {
+        bodyLength = length - 2;  // Without the "\r\n", which goes after the note
+        char* cursor = numberFormatAppendString(note, " (repeated ");
+        cursor = numberFormatAppendUnsigned(cursor, repeats);
+        numberFormatAppendString(cursor, " times)\r\n");
+    }
+
+    INSTRUMENTATION_BEGIN(INSTRUMENTATION_STAGE_UART_WRITE);
+    size_t noteLength = strlen(note);
+    if (pcSerialComTxReserve(bodyLength + noteLength)) {
+        pcSerialComTxEnqueue(data, bodyLength);
+        pcSerialComTxEnqueue(note, noteLength);
+        if (txRecordHead - txRecordTail == PC_SERIAL_COM_TX_RECORDS) {
+            txRecordTail++;
+        }
+        txRecordEnds[txRecordHead & PC_SERIAL_COM_TX_RECORDS_MASK] = txHead;
+        txRecordHead++;
+    } else {
+        txDroppedBytes += bodyLength + noteLength;
+    }
+    INSTRUMENTATION_END(INSTRUMENTATION_STAGE_UART_WRITE);
+
+    txWriteMutex.unlock();
+
+    pcSerialComTxStart();
+}
+
+// Returns true when the line repeats one queued less than a window ago and
+// must be dropped. Otherwise reports how many copies were dropped before it.
+static bool pcSerialComTxCoalesce(const char* str, size_t length,
+                                  uint32_t* repeats) {
+    if (length < 2 || str[length - 2] != '\r' || str[length - 1] != '\n') {
+        return false;  // Only whole lines are coalesced
+    }
+
+    uint32_t hash = 2166136261UL;  // FNV-1a
+    for (size_t i = 0; i < length; ++i) {
+        hash = (hash ^ (uint8_t)str[i]) * 16777619UL;
+    }
+
+    uint64_t nowMs = Kernel::get_ms_count();
+    for (int i = 0; i < PC_SERIAL_COM_COALESCE_SLOTS; ++i) {
+        pcSerialComCoalesceSlot_t* slot = &coalesceSlots[i];
+        if (slot->hash == hash) {
+            if (nowMs - slot->lastQueuedMs < PC_SERIAL_COM_COALESCE_WINDOW_MS) {
+                slot->repeats++;
+                txCoalescedLines++;
+                return true;
+            }
+            *repeats = slot->repeats;
+            slot->repeats = 0;
+            slot->lastQueuedMs = nowMs;
+            return false;
+        }
+    }
+
+    pcSerialComCoalesceSlot_t* slot = &coalesceSlots[coalesceNextSlot];
+    coalesceNextSlot = (coalesceNextSlot + 1) % PC_SERIAL_COM_COALESCE_SLOTS;
+    slot->hash = hash;
+    slot->lastQueuedMs = nowMs;
+    slot->repeats = 0;
+    return false;
+}
+
+// Makes room for length bytes according to the overflow policy
+static bool pcSerialComTxReserve(size_t length) {
+    if (length > PC_SERIAL_COM_TX_BUFFER_SIZE) {
+        return false;
+    }
+
+    while (PC_SERIAL_COM_TX_BUFFER_SIZE - (txHead - txTail) < length) {
+        if (txOverflow == PC_SERIAL_COM_TX_DROP_NEWEST) {
+            return false;
+        }
+
+        // Forget the records already sent. The TX interrupt may consume
+        // bytes meanwhile, in which case the compare-and-swap below fails
+        // and we retry.
+        uint32_t tail = txTail;
+        uint32_t end = txRecordEnds[txRecordTail & PC_SERIAL_COM_TX_RECORDS_MASK];
+        while ((int32_t)(end - tail) <= 0) {
+            txRecordStart = end;
+            txRecordTail++;
+            end = txRecordEnds[txRecordTail & PC_SERIAL_COM_TX_RECORDS_MASK];
+        }
+
+        // Discard the oldest record whole if none of it went out yet.
+        // Otherwise cut it short of its terminator, "\n" or the frame
+        // delimiter, which still ends it on the wire: only that record
+        // arrives broken, not the next one as well.
+        uint32_t newTail;
+        uint32_t newStart = end;
+        bool forget = true;
+        if (tail == txRecordStart) {
+            newTail = end;
+        } else if (tail != end - 1) {
+            newTail = end - 1;
+            forget = false;
+        } else {
+            // Only its terminator is left, so drop the next record but for
+            // its own, when they are the same byte; what was sent of the
+            // oldest and that terminator then make up the oldest record.
+            // Failing that the new string is dropped.
+            uint32_t nextEnd =
+                txRecordEnds[(txRecordTail + 1) & PC_SERIAL_COM_TX_RECORDS_MASK];
+            if (txRecordTail + 1 == txRecordHead ||
+                txBuffer[(end - 1) & PC_SERIAL_COM_TX_MASK] !=
+                txBuffer[(nextEnd - 1) & PC_SERIAL_COM_TX_MASK]) {
+                return false;
+            }
+            newTail = nextEnd - 1;
+            newStart = end - 1;
+        }
+        if (core_util_atomic_cas_u32(&txTail, &tail, newTail)) {
+            txDroppedBytes += newTail - tail;
+            if (forget) {
+                txRecordStart = newStart;
+                txRecordTail++;
+            }
+        }
+    }
+    return true;
+}
+
+static void pcSerialComTxEnqueue(const char* data, size_t length) {
+    uint32_t head = txHead;
+    for (size_t i = 0; i < length; ++i) {
+        txBuffer[(head + i) & PC_SERIAL_COM_TX_MASK] = data[i];
+    }
+    core_util_atomic_store_u32(&txHead, head + length);  // Publish after the data
+}
+
+// Enables the TX interrupt if it is not already draining the buffer
+static void pcSerialComTxStart() {
+    core_util_critical_section_enter();
+    if (!txActive && txHead != txTail) {
+        txActive = true;
+        uartUsb.attach(pcSerialComTxIsr, SerialBase::TxIrq);
+    }
+    core_util_critical_section_exit();
+}
+
+// Sends one byte each time the UART transmit register becomes empty
+static void pcSerialComTxIsr() {
+    INSTRUMENTATION_BEGIN(INSTRUMENTATION_STAGE_UART_TX_ISR);
+    uint32_t tail = txTail;
+    if (tail == txHead) {
+        uartUsb.attach(nullptr, SerialBase::TxIrq);
+        txActive = false;
+    } else {
+        char c = txBuffer[tail & PC_SERIAL_COM_TX_MASK];
+        uartUsb.write(&c, 1);
+        txTail = tail + 1;
+    }
+    INSTRUMENTATION_END(INSTRUMENTATION_STAGE_UART_TX_ISR);
+}
+
+// Moves every character the UART holds into the RX ring
+static void pcSerialComRxIsr() {
+    while (uartUsb.readable()) {
+        char c;
+        uartUsb.read(&c, 1);
+        uint32_t head = rxHead;
+        if (head - rxTail < PC_SERIAL_COM_RX_BUFFER_SIZE) {
+            rxBuffer[head & PC_SERIAL_COM_RX_MASK] = c;
+            rxHead = head + 1;
+        } else {
+            rxDroppedBytes++;
+        }
+    }
+}
@@ -0,0 +1,45 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _PC_SERIAL_COM_H_
+#define _PC_SERIAL_COM_H_
+
+//=====[Libraries]=============================================================
+
+#include <stddef.h>
+#include <stdint.h>
+
+//=====[Declaration of public defines]=========================================
+
+#define PC_SERIAL_COM_BAUD_RATE         115200
+#define PC_SERIAL_COM_TX_BUFFER_SIZE    1024  // Must be a power of two
+#define PC_SERIAL_COM_RX_BUFFER_SIZE    256   // Must be a power of two
+
+//=====[Declaration of public data types]======================================
+
+// What to discard when a new string does not fit in the TX buffer
+typedef enum {
+    PC_SERIAL_COM_TX_DROP_NEWEST,  // Discard the new string
+    PC_SERIAL_COM_TX_DROP_OLDEST,  // Discard whole queued lines and frames,
+                                   // oldest first; one being sent is cut
+                                   // short but keeps its terminator
+} pcSerialComTxOverflow_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void pcSerialComInit();
+void pcSerialComStringWrite(const char* str);
+void pcSerialComRepeatedLineWrite(const char* str);
+void pcSerialComFrameWrite(const uint8_t* frame, size_t length);
+char pcSerialComCharRead();
+void pcSerialComRxEnable(bool enabled);
+
+void pcSerialComTxOverflowSet(pcSerialComTxOverflow_t policy);
+void pcSerialComTxCoalesceSet(bool enabled);
+uint32_t pcSerialComTxSpace();
+uint32_t pcSerialComTxDroppedBytes();
+uint32_t pcSerialComTxCoalescedLines();
+uint32_t pcSerialComRxDroppedBytes();
+
+//=====[#include guards - end]=================================================
+
+#endif // _PC_SERIAL_COM_H_
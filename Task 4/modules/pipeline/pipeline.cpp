@@ -0,0 +1,307 @@
+//=====[Libraries]=============================================================
+
+#include <string.h>
+
+#include "pipeline.h"
+#include "sampler.h"
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void pipelineCalibrationTablesBuild(pipelineCalibration_t* calibration);
+static filterConfig_t pipelineFilterConfig(const sensorChannelSettings_t* settings);
+
+//=====[Implementations of public functions]===================================
+
+// No user calibration at the nominal supply, until the first update
+void pipelineCalibrationInit(pipelineCalibration_t* calibration) {
+    for (int i = 0; i < SENSOR_SCAN_CHANNEL_COUNT; ++i) {
+        calibrationPointsClear(&calibration->points[i]);
+    }
+    calibration->gainQ16 = 0;
+    calibration->tableGainQ16 = CALIBRATION_GAIN_ONE_Q16;
+    pipelineCalibrationTablesBuild(calibration);
+}
+
+// Takes new user calibration points, one set per scan channel
+void pipelineCalibrationConfigure(pipelineCalibration_t* calibration,
+                                  const calibrationPoints_t* points) {
+    if (memcmp(points, calibration->points, sizeof(calibration->points)) != 0) {
+        memcpy(calibration->points, points, sizeof(calibration->points));
+        pipelineCalibrationTablesBuild(calibration);
+    }
+}
+
+// Follows the supply from the average VREFINT reading of the last block,
+// on the scale of the factory reading vrefintCal
+void pipelineCalibrationSupplyUpdate(pipelineCalibration_t* calibration,
+                                     uint32_t vrefintCal, uint32_t vrefintReading) {
+    uint32_t gain = calibrationSupplyGainQ16(vrefintCal, vrefintReading);
+    if (calibration->gainQ16 == 0) {
+        calibration->gainQ16 = gain;
+    } else {
+        calibration->gainQ16 = (uint32_t)((int32_t)calibration->gainQ16 +
+                                          (((int32_t)gain - (int32_t)calibration->gainQ16) >>
+                                           PIPELINE_SUPPLY_SMOOTHING_SHIFT));
+    }
+
+    int32_t moved = (int32_t)calibration->gainQ16 - (int32_t)calibration->tableGainQ16;
+    if (moved > PIPELINE_SUPPLY_GAIN_STEP_Q16 || moved < -PIPELINE_SUPPLY_GAIN_STEP_Q16) {
+        calibration->tableGainQ16 = calibration->gainQ16;
+        pipelineCalibrationTablesBuild(calibration);
+    }
+}
+
+// Corrects scanCount interleaved ADC3 scans into corrected, laid out alike
+void pipelineCalibrationBlock(const pipelineCalibration_t* calibration,
+                              const uint16_t* scans, int scanCount, uint16_t* corrected) {
+    for (int scan = 0; scan < scanCount; ++scan) {
+        for (int i = 0; i < SENSOR_SCAN_CHANNEL_COUNT; ++i) {
+            corrected[i] = calibrationTableApply(&calibration->tables[i], scans[i]);
+        }
+        scans += SENSOR_SCAN_CHANNEL_COUNT;
+        corrected += SENSOR_SCAN_CHANNEL_COUNT;
+    }
+}
+
+void pipelineFiltersInit(pipelineFilters_t* filters) {
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; ++i) {
+        sensorChannelSettings_t settings = sensorChannelDefaultSettings((sensorChannel_t)i);
+        filters->configs[i] = pipelineFilterConfig(&settings);
+        filterInit(&filters->states[i]);
+    }
+}
+
+// Applies new filter settings between blocks. A channel whose stages change
+// starts over with empty history, the others keep filtering undisturbed.
+void pipelineFiltersConfigure(pipelineFilters_t* filters,
+                              const sensorChannelSettings_t* settings) {
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; ++i) {
+        filterConfig_t config = pipelineFilterConfig(&settings[i]);
+        if (memcmp(&config, &filters->configs[i], sizeof(config)) != 0) {
+            filters->configs[i] = config;
+            filterInit(&filters->states[i]);
+        }
+    }
+}
+
+// Filters scanCount interleaved ADC3 scans into one average per scan channel
+void pipelineFiltersBlock(pipelineFilters_t* filters, const uint16_t* scans,
+                          int scanCount, uint16_t* averages) {
+    for (int i = 0; i < SENSOR_SCAN_CHANNEL_COUNT; ++i) {
+        averages[i] = filterBlockProcess(&filters->states[i], &filters->configs[i],
+                                         &scans[i], SENSOR_SCAN_CHANNEL_COUNT, scanCount);
+    }
+}
+
+// The same for the SPI ADC channels, from sampleCount interleaved rounds of
+// conversions; averages is indexed like the channel table
+void pipelineFiltersSpiBlock(pipelineFilters_t* filters, const uint16_t* samples,
+                             int sampleCount, uint16_t* averages) {
+    for (int i = SENSOR_SCAN_CHANNEL_COUNT; i < SENSOR_CHANNEL_COUNT; ++i) {
+        averages[i] = filterBlockProcess(&filters->states[i], &filters->configs[i],
+                                         &samples[i - SENSOR_SCAN_CHANNEL_COUNT],
+                                         SENSOR_SPI_CHANNEL_COUNT, sampleCount);
+    }
+}
+
+// Lowest and highest raw reading of each of channelCount channels in
+// sampleCount interleaved rounds, for the health checks
+void pipelineRangesBlock(const uint16_t* samples, int channelCount, int sampleCount,
+                         uint16_t* minimums, uint16_t* maximums) {
+    for (int i = 0; i < channelCount; ++i) {
+        minimums[i] = samples[i];
+        maximums[i] = samples[i];
+    }
+    for (int scan = 1; scan < sampleCount; ++scan) {
+        const uint16_t* readings = &samples[scan * channelCount];
+        for (int i = 0; i < channelCount; ++i) {
+            if (readings[i] < minimums[i]) {
+                minimums[i] = readings[i];
+            } else if (readings[i] > maximums[i]) {
+                maximums[i] = readings[i];
+            }
+        }
+    }
+}
+
+void pipelineAlarmsInit(pipelineAlarms_t* alarms) {
+    sensorChannelSettings_t settings[SENSOR_CHANNEL_COUNT];
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; ++i) {
+        settings[i] = sensorChannelDefaultSettings((sensorChannel_t)i);
+        alarmEngineInit(&alarms->channels[i]);
+    }
+    pipelineAlarmsConfigure(alarms, settings);
+}
+
+// Applies new alarm settings between updates; the state machines carry on
+// and compare against the new thresholds from the next update
+void pipelineAlarmsConfigure(pipelineAlarms_t* alarms,
+                             const sensorChannelSettings_t* settings) {
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; ++i) {
+        sensorChannel_t channel = (sensorChannel_t)i;
+        alarms->configs[i].tripReading =
+            sensorChannelValueToReading(channel, settings[i].tripThreshold);
+        alarms->configs[i].clearReading = sensorChannelValueToReading(
+            channel, settings[i].tripThreshold - settings[i].hysteresis);
+        alarms->configs[i].tripDwellMs = settings[i].tripDwellMs;
+        alarms->configs[i].clearDwellMs = settings[i].clearDwellMs;
+        alarms->configs[i].rateTripPerSecond =
+            sensorChannelRateToReadings(channel, settings[i].rateTrip);
+        alarms->configs[i].rateWindowMs = PIPELINE_ALARM_RATE_WINDOW_MS;
+    }
+}
+
+// Steps every alarm-enabled channel and reports its transition in events
+void pipelineAlarmsUpdate(pipelineAlarms_t* alarms, const uint16_t* averages,
+                          uint32_t nowMs, alarmEngineEvent_t* events) {
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; ++i) {
+        events[i] = ALARM_ENGINE_NO_CHANGE;
+        if (sensorChannels[i].alarmEnabled) {
+            events[i] = alarmEngineUpdate(&alarms->channels[i], &alarms->configs[i],
+                                          averages[i], nowMs);
+        }
+    }
+}
+
+// True while any channel is not clear, dwell periods included
+bool pipelineAlarmsPending(const pipelineAlarms_t* alarms) {
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; ++i) {
+        if (alarms->channels[i].state != ALARM_ENGINE_CLEAR) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void pipelineTrendsInit(pipelineTrends_t* trends) {
+    sensorChannelSettings_t settings[SENSOR_CHANNEL_COUNT];
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; ++i) {
+        settings[i] = sensorChannelDefaultSettings((sensorChannel_t)i);
+        trends->configs[i].windowLength = sensorChannels[i].alarmEnabled
+                                          ? sensorChannels[i].trendWindow : 0;
+        trends->configs[i].horizonMs = sensorChannels[i].preAlarmHorizonS * 1000UL;
+        trends->configs[i].periodMs = SAMPLER_SNAPSHOT_PERIOD_MS;
+        trendInit(&trends->states[i]);
+    }
+    pipelineTrendsConfigure(trends, settings);
+}
+
+// Follows the alarm thresholds; the windows keep their history
+void pipelineTrendsConfigure(pipelineTrends_t* trends,
+                             const sensorChannelSettings_t* settings) {
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; ++i) {
+        trends->configs[i].tripReading =
+            sensorChannelValueToReading((sensorChannel_t)i, settings[i].tripThreshold);
+    }
+}
+
+// Adds one snapshot, taken periodMs after the last, to every channel's trend,
+// which samples them at the full snapshot rate whatever the sampling mode
+void pipelineTrendsUpdate(pipelineTrends_t* trends, const uint16_t* averages,
+                          uint32_t periodMs, trendEstimate_t* estimates,
+                          trendEvent_t* events) {
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; ++i) {
+        events[i] = trendUpdate(&trends->states[i], &trends->configs[i], averages[i],
+                                periodMs, &estimates[i]);
+    }
+}
+
+void pipelineRatesInit(pipelineRates_t* rates) {
+    sensorChannelSettings_t settings[SENSOR_CHANNEL_COUNT];
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; ++i) {
+        settings[i] = sensorChannelDefaultSettings((sensorChannel_t)i);
+        rateControlInit(&rates->states[i]);
+    }
+    pipelineRatesConfigure(rates, settings);
+}
+
+// Follows the alarm thresholds; the channels keep their activity
+void pipelineRatesConfigure(pipelineRates_t* rates, const sensorChannelSettings_t* settings) {
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; ++i) {
+        sensorChannel_t channel = (sensorChannel_t)i;
+        const sensorKindRate_t* limits = &sensorKindRate[sensorChannels[i].kind];
+        rateControlConfig_t* config = &rates->configs[i];
+        if (limits->enabled && sensorChannels[i].alarmEnabled) {
+            config->enabled = true;
+            config->nearReading = sensorChannelValueToReading(
+                channel, settings[i].tripThreshold - limits->nearMargin);
+            config->changePerSecond = sensorChannelRateToReadings(channel, limits->changeMax);
+            config->windowMs = PIPELINE_RATE_WINDOW_MS;
+            config->quietMs = limits->quietS * 1000UL;
+        } else {
+            *config = rateControlConfig_t{};
+        }
+    }
+}
+
+// Steps every channel and returns the strongest activity among them, with
+// the first channel showing it in channel
+rateControlActivity_t pipelineRatesUpdate(pipelineRates_t* rates, const uint16_t* averages,
+                                          uint32_t nowMs, sensorChannel_t* channel) {
+    rateControlActivity_t strongest = RATE_CONTROL_QUIET;
+    *channel = (sensorChannel_t)0;
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; ++i) {
+        rateControlActivity_t activity = rateControlUpdate(&rates->states[i],
+                                                           &rates->configs[i],
+                                                           averages[i], nowMs);
+        if (activity > strongest) {
+            strongest = activity;
+            *channel = (sensorChannel_t)i;
+        }
+    }
+    return strongest;
+}
+
+void pipelineHealthInit(pipelineHealth_t* health) {
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; ++i) {
+        sensorChannel_t channel = (sensorChannel_t)i;
+        const sensorKindHealth_t* limits = &sensorKindHealth[sensorChannels[i].kind];
+        faultDetectConfig_t* config = &health->configs[i];
+        if (limits->enabled) {
+            config->railLowReading = sensorChannelValueToReading(channel, limits->railLow);
+            config->railHighReading = sensorChannelValueToReading(channel, limits->railHigh);
+            config->heaterReading = sensorChannelValueToReading(channel, limits->heaterMin);
+            // A deviation scales like a rate
+            config->noiseReading =
+                (uint16_t)sensorChannelRateToReadings(channel, limits->noiseMax);
+            config->ratePerSecond = sensorChannelRateToReadings(channel, limits->rateMax);
+            config->stuckMs = limits->stuckS * 1000UL;
+            config->warmupMs = limits->warmupS * 1000UL;
+            config->dwellMs = limits->dwellMs;
+        } else {
+            *config = faultDetectConfig_t{};
+        }
+        faultDetectInit(&health->states[i]);
+    }
+}
+
+// Checks one snapshot, periodMs after the last checked, at nowMs since boot
+void pipelineHealthUpdate(pipelineHealth_t* health, const uint16_t* averages,
+                          const uint16_t* minimums, const uint16_t* maximums,
+                          uint32_t periodMs, uint32_t nowMs, uint8_t* flags) {
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; ++i) {
+        faultDetectBlock_t block = { averages[i], minimums[i], maximums[i] };
+        flags[i] = faultDetectUpdate(&health->states[i], &health->configs[i], &block,
+                                     periodMs, nowMs);
+    }
+}
+
+//=====[Implementations of private functions]==================================
+
+// Ratiometric inputs read the same at any supply, so only the user
+// calibration applies to them
+static void pipelineCalibrationTablesBuild(pipelineCalibration_t* calibration) {
+    for (int i = 0; i < SENSOR_SCAN_CHANNEL_COUNT; ++i) {
+        calibrationTableBuild(&calibration->tables[i], &calibration->points[i],
+                              sensorChannels[i].ratiometric ? CALIBRATION_GAIN_ONE_Q16
+                                                            : calibration->tableGainQ16);
+    }
+}
+
+static filterConfig_t pipelineFilterConfig(const sensorChannelSettings_t* settings) {
+    filterConfig_t config;
+    config.medianLength = settings->medianLength;
+    config.decimationLog2 = settings->oversamplingLog2;
+    config.iirShift = settings->iirShift;
+    return config;
+}
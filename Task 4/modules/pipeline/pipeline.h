@@ -0,0 +1,128 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _PIPELINE_H_
+#define _PIPELINE_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+#include "alarm_engine.h"
+#include "calibration.h"
+#include "fault_detect.h"
+#include "filters.h"
+#include "rate_control.h"
+#include "sensor_channels.h"
+#include "trend.h"
+
+//=====[Declaration of public defines]=========================================
+
+#define PIPELINE_ALARM_RATE_WINDOW_MS   1000
+#define PIPELINE_RATE_WINDOW_MS         1000
+
+// The supply gain follows VREFINT with a weight of 1/8 per half-buffer, and
+// the tables are only rebuilt once it moves by more than about 1 mV
+#define PIPELINE_SUPPLY_SMOOTHING_SHIFT 3
+#define PIPELINE_SUPPLY_GAIN_STEP_Q16   20
+
+//=====[Declaration of public data types]======================================
+
+// The signal path of every channel, configured from the channel table (or
+// settings changed at run time, one per channel) and free of any platform
+// dependency: the firmware feeds it from DMA and the
+// RTOS clock, the host simulation from traces and a virtual clock.
+
+// Calibration stage, run by the sampler on every scan before the filters:
+// corrects the ADC3 readings for the supply and the user calibration, so
+// that the channel table's scaling holds. The tables are rebuilt when
+// either changes, never per scan.
+typedef struct {
+    calibrationPoints_t points[SENSOR_SCAN_CHANNEL_COUNT];
+    calibrationTable_t tables[SENSOR_SCAN_CHANNEL_COUNT];
+    uint32_t gainQ16;           // Smoothed supply gain, 0 before the first update
+    uint32_t tableGainQ16;      // Supply gain the tables were built for
+} pipelineCalibration_t;
+
+// Filter stage, run by the sampler on every half-buffer
+typedef struct {
+    filterConfig_t configs[SENSOR_CHANNEL_COUNT];
+    filterState_t states[SENSOR_CHANNEL_COUNT];
+} pipelineFilters_t;
+
+// Alarm stage, run by the alarm thread on every filtered snapshot. Channels
+// without an alarm stay clear.
+typedef struct {
+    alarmEngineConfig_t configs[SENSOR_CHANNEL_COUNT];
+    alarmEngineChannel_t channels[SENSOR_CHANNEL_COUNT];
+} pipelineAlarms_t;
+
+// Trend stage, run by the alarm thread next to the alarms. It warns ahead of
+// the alarm thresholds; channels with no trend window never pre-alarm.
+typedef struct {
+    trendConfig_t configs[SENSOR_CHANNEL_COUNT];
+    trendState_t states[SENSOR_CHANNEL_COUNT];
+} pipelineTrends_t;
+
+// Rate stage, run by the alarm thread next to the alarms. It tells when some
+// channel needs full-rate sampling: margins come from the channel's kind,
+// thresholds from the alarm settings.
+typedef struct {
+    rateControlConfig_t configs[SENSOR_CHANNEL_COUNT];
+    rateControlState_t states[SENSOR_CHANNEL_COUNT];
+} pipelineRates_t;
+
+// Health stage, run by the diagnostics thread on filtered snapshots and the
+// range of the raw readings behind them. Limits come from the channel's kind;
+// channels of a kind without limits never raise a flag.
+typedef struct {
+    faultDetectConfig_t configs[SENSOR_CHANNEL_COUNT];
+    faultDetectState_t states[SENSOR_CHANNEL_COUNT];
+} pipelineHealth_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void pipelineCalibrationInit(pipelineCalibration_t* calibration);
+void pipelineCalibrationConfigure(pipelineCalibration_t* calibration,
+                                  const calibrationPoints_t* points);
+void pipelineCalibrationSupplyUpdate(pipelineCalibration_t* calibration,
+                                     uint32_t vrefintCal, uint32_t vrefintReading);
+void pipelineCalibrationBlock(const pipelineCalibration_t* calibration,
+                              const uint16_t* scans, int scanCount, uint16_t* corrected);
+
+void pipelineFiltersInit(pipelineFilters_t* filters);
+void pipelineFiltersConfigure(pipelineFilters_t* filters,
+                              const sensorChannelSettings_t* settings);
+void pipelineFiltersBlock(pipelineFilters_t* filters, const uint16_t* scans,
+                          int scanCount, uint16_t* averages);
+void pipelineFiltersSpiBlock(pipelineFilters_t* filters, const uint16_t* samples,
+                             int sampleCount, uint16_t* averages);
+void pipelineRangesBlock(const uint16_t* samples, int channelCount, int sampleCount,
+                         uint16_t* minimums, uint16_t* maximums);
+
+void pipelineAlarmsInit(pipelineAlarms_t* alarms);
+void pipelineAlarmsConfigure(pipelineAlarms_t* alarms,
+                             const sensorChannelSettings_t* settings);
+void pipelineAlarmsUpdate(pipelineAlarms_t* alarms, const uint16_t* averages,
+                          uint32_t nowMs, alarmEngineEvent_t* events);
+bool pipelineAlarmsPending(const pipelineAlarms_t* alarms);
+
+void pipelineTrendsInit(pipelineTrends_t* trends);
+void pipelineTrendsConfigure(pipelineTrends_t* trends,
+                             const sensorChannelSettings_t* settings);
+void pipelineTrendsUpdate(pipelineTrends_t* trends, const uint16_t* averages,
+                          uint32_t periodMs, trendEstimate_t* estimates,
+                          trendEvent_t* events);
+
+void pipelineRatesInit(pipelineRates_t* rates);
+void pipelineRatesConfigure(pipelineRates_t* rates, const sensorChannelSettings_t* settings);
+rateControlActivity_t pipelineRatesUpdate(pipelineRates_t* rates, const uint16_t* averages,
+                                          uint32_t nowMs, sensorChannel_t* channel);
+
+void pipelineHealthInit(pipelineHealth_t* health);
+void pipelineHealthUpdate(pipelineHealth_t* health, const uint16_t* averages,
+                          const uint16_t* minimums, const uint16_t* maximums,
+                          uint32_t periodMs, uint32_t nowMs, uint8_t* flags);
+
+//=====[#include guards - end]=================================================
+
+#endif // _PIPELINE_H_
@@ -0,0 +1,174 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "power.h"
+#include "sampler.h"
+#include "number_format.h"
+#include "pc_serial_com.h"
+
+//=====[Declaration of private defines]========================================
+
+// Typical STM32F439 supply currents at 180 MHz from the datasheet, used to
+// turn measured residency into a draw estimate. Calibrate them against an
+// ammeter across the IDD jumper (JP5) of the Nucleo board.
+#define POWER_RUN_CURRENT_UA          90000
+#define POWER_SLEEP_CURRENT_UA        40000
+#define POWER_DEEP_SLEEP_CURRENT_UA   300
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct {
+    us_timestamp_t uptimeUs;
+    us_timestamp_t sleepUs;
+    us_timestamp_t deepSleepUs;
+} powerResidency_t;
+
+//=====[Declaration and initialization of private global variables]============
+
+// Leaves low-power mode: console input is lost while the MCU is in STOP
+// mode, but the button's external interrupt still wakes it
+static InterruptIn userButton(BUTTON1);
+static volatile bool wakeRequested = false;
+
+static Mutex powerMutex;
+static powerMode_t powerMode = POWER_MODE_FULL;
+static bool alarmPending = false;
+static bool channelActive = false;
+
+// Time spent in each sampler mode, split by CPU state
+static powerResidency_t residency[SAMPLER_MODE_COUNT];
+static mbed_stats_cpu_t lastCpuStats;
+
+static const char* const samplerModeNames[SAMPLER_MODE_COUNT] = {
+    "Continuous sampling", "Burst sampling",
+};
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void powerSamplerModeUpdate();
+static void powerResidencyAccumulate();
+static void powerUserButtonIsr();
+
+//=====[Implementations of public functions]===================================
+
+// Starts in full power mode; the sampler must already be running
+void powerInit() {
+    mbed_stats_cpu_get(&lastCpuStats);
+    userButton.rise(powerUserButtonIsr);
+}
+
+// Returns to full power after a button press; called from the console loop
+void powerUpdate() {
+    if (wakeRequested && powerMode != POWER_MODE_FULL) {
+        powerModeSet(POWER_MODE_FULL);
+    }
+    wakeRequested = false;
+}
+
+void powerModeSet(powerMode_t mode) {
+    powerMutex.lock();
+    powerMode = mode;
+    powerSamplerModeUpdate();
+    pcSerialComRxEnable(mode == POWER_MODE_FULL);
+    powerMutex.unlock();
+}
+
+powerMode_t powerModeGet() {
+    return powerMode;
+}
+
+// Called from the alarm thread whenever any alarm leaves or returns to clear
+void powerAlarmPendingSet(bool pending) {
+    powerMutex.lock();
+    alarmPending = pending;
+    powerSamplerModeUpdate();
+    powerMutex.unlock();
+}
+
+// Called from the alarm thread whenever some channel starts or stops needing
+// full-rate sampling (see rate_control.h)
+void powerActivitySet(bool active) {
+    powerMutex.lock();
+    channelActive = active;
+    powerSamplerModeUpdate();
+    powerMutex.unlock();
+}
+
+// A low-power mode samples continuously for now, so telemetry follows at
+// its faster pace
+bool powerRateRaised() {
+    return powerMode != POWER_MODE_FULL && samplerModeGet() == SAMPLER_MODE_CONTINUOUS;
+}
+
+// Prints the measured residency of each sampler mode and the current it
+// implies, in mA
+void powerReportWrite() {
+    powerMutex.lock();
+    powerResidencyAccumulate();
+
+    for (int i = 0; i < SAMPLER_MODE_COUNT; ++i) {
+        const powerResidency_t* r = &residency[i];
+        if (r->uptimeUs == 0) {
+            continue;
+        }
+        us_timestamp_t runUs = r->uptimeUs - r->sleepUs - r->deepSleepUs;
+        uint64_t chargeUaUs = runUs * POWER_RUN_CURRENT_UA +
+                              r->sleepUs * POWER_SLEEP_CURRENT_UA +
+                              r->deepSleepUs * POWER_DEEP_SLEEP_CURRENT_UA;
+        int32_t currentHundredthsMa = (int32_t)(chargeUaUs / r->uptimeUs / 10);
+
+        char str[128] = "";
+        char* cursor = numberFormatAppendString(str, samplerModeNames[i]);
+        cursor = numberFormatAppendString(cursor, ": ");
+        cursor = numberFormatAppendUnsigned(cursor, (uint32_t)(r->uptimeUs / 1000000));
+        cursor = numberFormatAppendString(cursor, " s, run ");
+        cursor = numberFormatAppendHundredths(cursor,
+                     (int32_t)(runUs * 10000 / r->uptimeUs));
+        cursor = numberFormatAppendString(cursor, "%, sleep ");
+        cursor = numberFormatAppendHundredths(cursor,
+                     (int32_t)(r->sleepUs * 10000 / r->uptimeUs));
+        cursor = numberFormatAppendString(cursor, "%, deep sleep ");
+        cursor = numberFormatAppendHundredths(cursor,
+                     (int32_t)(r->deepSleepUs * 10000 / r->uptimeUs));
+        cursor = numberFormatAppendString(cursor, "%, about ");
+        cursor = numberFormatAppendHundredths(cursor, currentHundredthsMa);
+        numberFormatAppendString(cursor, " mA\r\n");
+        pcSerialComStringWrite(str);
+    }
+
+    powerMutex.unlock();
+}
+
+//=====[Implementations of private functions]==================================
+
+// Called with powerMutex held
+static void powerSamplerModeUpdate() {
+    samplerMode_t mode = SAMPLER_MODE_CONTINUOUS;
+    if ((powerMode == POWER_MODE_LOW && !alarmPending) ||
+        (powerMode == POWER_MODE_ADAPTIVE && !alarmPending && !channelActive)) {
+        mode = SAMPLER_MODE_BURST;
+    }
+
+    if (mode != samplerModeGet()) {
+        powerResidencyAccumulate();  // Close the period of the previous mode
+        samplerModeSet(mode);
+    }
+}
+
+// Called with powerMutex held
+static void powerResidencyAccumulate() {
+    mbed_stats_cpu_t cpuStats;
+    mbed_stats_cpu_get(&cpuStats);
+
+    powerResidency_t* r = &residency[samplerModeGet()];
+    r->uptimeUs += cpuStats.uptime - lastCpuStats.uptime;
+    r->sleepUs += cpuStats.sleep_time - lastCpuStats.sleep_time;
+    r->deepSleepUs += cpuStats.deep_sleep_time - lastCpuStats.deep_sleep_time;
+    lastCpuStats = cpuStats;
+}
+
+static void powerUserButtonIsr() {
+    wakeRequested = true;
+}
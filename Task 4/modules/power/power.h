@@ -0,0 +1,33 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _POWER_H_
+#define _POWER_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+//=====[Declaration of public data types]======================================
+
+typedef enum {
+    POWER_MODE_FULL,       // Continuous sampling at all times
+    POWER_MODE_LOW,        // Burst sampling, continuous only while an alarm
+                           // is pending or active
+    POWER_MODE_ADAPTIVE,   // As low, and continuous while some channel nears
+                           // its threshold or changes quickly
+} powerMode_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void powerInit();
+void powerUpdate();
+void powerModeSet(powerMode_t mode);
+powerMode_t powerModeGet();
+void powerAlarmPendingSet(bool pending);
+void powerActivitySet(bool active);
+bool powerRateRaised();
+void powerReportWrite();
+
+//=====[#include guards - end]=================================================
+
+#endif // _POWER_H_
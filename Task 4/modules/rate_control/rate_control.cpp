@@ -0,0 +1,60 @@
+//=====[Libraries]=============================================================
+
+#include "rate_control.h"
+
+//=====[Implementations of public functions]===================================
+
+void rateControlInit(rateControlState_t* state) {
+    state->activity = RATE_CONTROL_QUIET;
+    state->primed = false;
+    state->settled = false;
+    state->reference = 0;
+    state->referenceMs = 0;
+    state->changing = false;
+    state->activeMs = 0;
+}
+
+// Checks one snapshot average at nowMs since boot. Snapshots may come every
+// half-buffer or once per burst; the change is measured against the oldest
+// average of the window either way. The first window only rebases, since
+// the filters are still filling when sampling starts.
+rateControlActivity_t rateControlUpdate(rateControlState_t* state,
+                                        const rateControlConfig_t* config,
+                                        uint16_t average, uint32_t nowMs) {
+    if (!config->enabled) {
+        state->activity = RATE_CONTROL_QUIET;
+        return state->activity;
+    }
+
+    if (!state->primed) {
+        state->primed = true;
+        state->reference = average;
+        state->referenceMs = nowMs;
+    } else if (nowMs - state->referenceMs >= config->windowMs) {
+        uint32_t elapsedMs = nowMs - state->referenceMs;
+        int32_t change = (int32_t)average - (int32_t)state->reference;
+        uint32_t magnitude = (uint32_t)(change < 0 ? -change : change);
+        state->changing = state->settled && config->changePerSecond != 0 &&
+                          (uint64_t)magnitude * 1000 >
+                          (uint64_t)config->changePerSecond * elapsedMs;
+        state->settled = true;
+        state->reference = average;
+        state->referenceMs = nowMs;
+    }
+
+    rateControlActivity_t seen = RATE_CONTROL_QUIET;
+    if (average >= config->nearReading) {
+        seen = RATE_CONTROL_NEAR;
+    } else if (state->changing) {
+        seen = RATE_CONTROL_CHANGING;
+    }
+
+    if (seen != RATE_CONTROL_QUIET) {
+        state->activity = seen;
+        state->activeMs = nowMs;
+    } else if (state->activity != RATE_CONTROL_QUIET &&
+               nowMs - state->activeMs >= config->quietMs) {
+        state->activity = RATE_CONTROL_QUIET;
+    }
+    return state->activity;
+}
@@ -0,0 +1,51 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _RATE_CONTROL_H_
+#define _RATE_CONTROL_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+//=====[Declaration of public data types]======================================
+
+// What one channel asks of the sampling rate, strongest last
+typedef enum {
+    RATE_CONTROL_QUIET,         // Stable and far from the threshold: bursts do
+    RATE_CONTROL_CHANGING,      // Moving quickly either way
+    RATE_CONTROL_NEAR,          // Within its margin of the trip threshold
+} rateControlActivity_t;
+
+// Tells when a channel needs full-rate sampling. A channel becomes active as
+// soon as it nears its threshold or changes quickly, and only turns quiet
+// once it has shown neither for quietMs, so a reading hovering at the margin
+// does not flip the rate with every snapshot. Readings use the 0 to 65535
+// scale of the sampler snapshot.
+typedef struct {
+    bool enabled;
+    uint16_t nearReading;       // Averages at or above this are near
+    uint32_t changePerSecond;   // Faster than this either way, 0 disables
+    uint32_t windowMs;          // Changes are measured over at least this long
+    uint32_t quietMs;
+} rateControlConfig_t;
+
+typedef struct {
+    rateControlActivity_t activity;
+    bool primed;                // reference is valid
+    bool settled;               // A whole window has passed since priming
+    uint16_t reference;         // Average at the start of the change window
+    uint32_t referenceMs;
+    bool changing;              // Over the last whole window
+    uint32_t activeMs;          // When last near or changing
+} rateControlState_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void rateControlInit(rateControlState_t* state);
+rateControlActivity_t rateControlUpdate(rateControlState_t* state,
+                                        const rateControlConfig_t* config,
+                                        uint16_t average, uint32_t nowMs);
+
+//=====[#include guards - end]=================================================
+
+#endif // _RATE_CONTROL_H_
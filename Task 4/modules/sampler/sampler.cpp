@@ -0,0 +1,636 @@
+//=====[Libraries]=============================================================
+
+#include <string.h>
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "sampler.h"
+#include "config.h"
+#include "filters.h"
+#include "instrumentation.h"
+#include "memory_plan.h"
+#include "pipeline.h"
+#include "spi_adc.h"
+#include "supervisor.h"
+
+//=====[Declaration of private defines]========================================
+
+// Circular DMA buffer holding two halves of SAMPLER_SCANS_PER_HALF scans each
+#define SAMPLER_DMA_BUFFER_LENGTH   (2 * SAMPLER_SCANS_PER_HALF * SENSOR_SCAN_CHANNEL_COUNT)
+
+// ADC3 at PCLK2 / 4 = 22.5 MHz converts a channel in 480 + 12 cycles, about
+// 22 us, so even a full 16-rank scan ends well within a scan period and the
+// cycle time does not grow with the channel count
+#define SAMPLER_ADC_CLOCK_HZ        22500000
+#define SAMPLER_CONVERSION_CYCLES   (480 + 12)
+#define SAMPLER_SCAN_RANKS_MAX      16
+
+static_assert(SENSOR_SCAN_CHANNEL_COUNT <= SAMPLER_SCAN_RANKS_MAX,
+              "ADC3 scans at most 16 channels; put more on the SPI ADC");
+static_assert(SENSOR_SCAN_CHANNEL_COUNT * SAMPLER_CONVERSION_CYCLES *
+              SAMPLER_SCAN_RATE_HZ < SAMPLER_ADC_CLOCK_HZ,
+              "Scan does not fit in the scan period");
+
+// ADC1, on the same TIM2 trigger, converts the internal VREFINT and
+// temperature sensor inputs, which only it has, in every scan. It finishes
+// its two ranks before ADC3 its three, so when an ADC3 half-buffer
+// completes so has the matching ADC1 one; burst mode stops both alike.
+#define SAMPLER_SUPPLY_CHANNEL_COUNT    2   // VREFINT, then the temperature sensor
+#define SAMPLER_SUPPLY_BUFFER_LENGTH    (2 * SAMPLER_SCANS_PER_HALF * \
+                                         SAMPLER_SUPPLY_CHANNEL_COUNT)
+
+// Factory readings in system memory, 12-bit at VDDA = 3.3 V (RM0090)
+#define SAMPLER_VREFINT_CAL         (*(const uint16_t*)0x1FFF7A2A)  // At 30 °C
+#define SAMPLER_TS_CAL_30C          (*(const uint16_t*)0x1FFF7A2C)
+#define SAMPLER_TS_CAL_110C         (*(const uint16_t*)0x1FFF7A2E)
+
+#define SAMPLER_TIMER_CLOCK_HZ      1000000  // TIM2 counts in microseconds
+
+#define SAMPLER_WATCHDOG_RAW_SHIFT  4  // Watchdog compares raw 12-bit data
+
+#define SAMPLER_FLAG_FIRST_HALF     (1UL << 0)
+#define SAMPLER_FLAG_SECOND_HALF    (1UL << 1)
+
+
+#define SAMPLER_HALF_BUFFER_CALLBACKS_MAX 2  // Alarm, diagnostics
+#define SAMPLER_RAW_BLOCK_CALLBACKS_MAX 3  // Binary and network telemetry,
+                                           // capture
+
+// Readings of a channel in each block the filters process
+static constexpr int samplerSamplesPerBlock(sensorChannel_t channel) {
+    return sensorChannels[channel].source == SENSOR_SOURCE_ADC3
+           ? SAMPLER_SCANS_PER_HALF : SPI_ADC_SAMPLES_PER_BLOCK;
+}
+
+// Checked at compile time for every entry of the channel table
+static constexpr bool samplerFiltersFit(int channel) {
+    return channel >= SENSOR_CHANNEL_COUNT ||
+           ((1 << sensorChannels[channel].oversamplingLog2) <=
+            samplerSamplesPerBlock((sensorChannel_t)channel) &&
+            sensorChannels[channel].medianLength <= FILTER_MEDIAN_LENGTH_MAX &&
+            samplerFiltersFit(channel + 1));
+}
+
+static_assert(samplerFiltersFit(0),
+              "Channel filter settings exceed the sampler or filter limits");
+
+//=====[Declaration and initialization of private global variables]============
+
+static ADC_HandleTypeDef hadc3;
+static DMA_HandleTypeDef hdmaAdc3;
+static ADC_HandleTypeDef hadc1;
+static DMA_HandleTypeDef hdmaAdc1;
+static TIM_HandleTypeDef htim2;
+
+static uint16_t dmaBuffer[SAMPLER_DMA_BUFFER_LENGTH];
+static uint16_t supplyBuffer[SAMPLER_SUPPLY_BUFFER_LENGTH];
+
+// Only the sampler thread uses the corrected half-buffer and the tables
+static uint16_t corrected[SAMPLER_DMA_BUFFER_LENGTH / 2];
+static pipelineCalibration_t calibration;
+
+// Double-buffered snapshot: the sampler thread fills the slot readers are not
+// using and then publishes it by updating publishedSequence
+static samplerSnapshot_t snapshots[2];
+static volatile uint32_t publishedSequence = 0;
+
+// Averaging runs in a thread so the DMA interrupt only signals it
+static Thread samplerThread(osPriorityHigh,
+                            memoryPlanStackSize(MEMORY_PLAN_STACK_SAMPLER),
+                            memoryPlanStackMemory(MEMORY_PLAN_STACK_SAMPLER),
+                            memoryPlanStackName(MEMORY_PLAN_STACK_SAMPLER));
+static EventFlags samplerFlags;
+
+// Streaming filter stage between the DMA buffer and the snapshot
+static pipelineFilters_t filters;
+
+// In burst mode a low-power ticker restarts TIM2 and the half-buffer
+// interrupt stops it again. Deep sleep is locked while TIM2 runs, since
+// STOP mode halts the timer, ADC and DMA clocks.
+static volatile samplerMode_t samplerMode = SAMPLER_MODE_CONTINUOUS;
+static volatile bool timerRunning = false;
+static LowPowerTicker burstTicker;
+static volatile uint32_t burstPeriodMs = SAMPLER_BURST_PERIOD_MS;
+
+// Settings generation the filters and burst period were last updated from
+static uint32_t configApplied = 0;
+
+// us_ticker_read() and cycle counter of each DMA half, taken in the interrupt
+static volatile uint32_t halfTimestampUs[2];
+static volatile uint32_t halfCycles[2];
+
+static void (*halfBufferCallbacks[SAMPLER_HALF_BUFFER_CALLBACKS_MAX])();
+static volatile uint32_t halfBufferCallbackCount = 0;
+static void (*rawBlockCallbacks[SAMPLER_RAW_BLOCK_CALLBACKS_MAX])(
+    const samplerRawBlock_t* block);
+static volatile uint32_t rawBlockCallbackCount = 0;
+static void (*watchdogCallback)() = nullptr;
+
+// The watchdog compares raw conversions, so its threshold moves with the
+// calibration tables
+static sensorChannel_t watchdogChannel = SENSOR_CHANNEL_GAS;
+static volatile uint16_t watchdogThreshold = UINT16_MAX;
+
+// Conversions past the threshold so far, and the median length of the
+// channel they must outlast, from the settings of the current block
+static filterRun_t watchdogRun;
+static volatile uint8_t watchdogMedianLength = 0;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void samplerGpioInit();
+static void samplerAdcInit();
+static void samplerDmaInit();
+static void samplerSupplyAdcInit();
+static void samplerTimerInit();
+static void samplerTimerStart();
+static void samplerTimerStop();
+static void samplerBurstStart();
+static void samplerDmaIrqHandler();
+static void samplerAdcIrqHandler();
+static void samplerTask();
+static void samplerHalfBufferProcess(const uint16_t* half, const uint16_t* supplyHalf,
+                                     uint32_t timestampUs);
+static void samplerSupplyUpdate(const uint16_t* supplyHalf, samplerSnapshot_t* snapshot);
+static void samplerWatchdogThresholdWrite();
+static void samplerConfigApply();
+static void samplerSupervisionUpdate();
+
+//=====[Implementations of public functions]===================================
+
+// Starts the timer-triggered ADC3 and ADC1 scans into their circular DMA
+// buffers
+void samplerInit() {
+    pipelineCalibrationInit(&calibration);
+    pipelineFiltersInit(&filters);
+
+    samplerGpioInit();
+    samplerDmaInit();
+    samplerAdcInit();
+    samplerSupplyAdcInit();
+    samplerTimerInit();
+
+    samplerSupervisionUpdate();
+    spiAdcInit();
+    samplerThread.start(samplerTask);
+
+    HAL_ADC_Start_DMA(&hadc1, (uint32_t*)supplyBuffer, SAMPLER_SUPPLY_BUFFER_LENGTH);
+    HAL_ADC_Start_DMA(&hadc3, (uint32_t*)dmaBuffer, SAMPLER_DMA_BUFFER_LENGTH);
+    core_util_critical_section_enter();
+    samplerTimerStart();
+    core_util_critical_section_exit();
+}
+
+// Copies the latest averages without locking; safe from any thread
+void samplerSnapshotRead(samplerSnapshot_t* copy) {
+    uint32_t sequence;
+    do {
+        sequence = core_util_atomic_load_u32(&publishedSequence);
+        *copy = snapshots[sequence & 1];
+    } while (sequence != core_util_atomic_load_u32(&publishedSequence));
+}
+
+// Switches between continuous and burst sampling. Callers serialize (the power
+// module owns the mode); the DMA and ticker interrupts only read it. In
+// burst mode the scan in progress stops at the end of its half-buffer.
+void samplerModeSet(samplerMode_t mode) {
+    core_util_critical_section_enter();
+    bool changed = (mode != samplerMode);
+    samplerMode = mode;
+    if (mode == SAMPLER_MODE_CONTINUOUS) {
+        samplerTimerStart();
+    }
+    core_util_critical_section_exit();
+
+    if (!changed) {
+        return;
+    }
+
+    // Outside the critical section: the ticker takes its own locks
+    if (mode == SAMPLER_MODE_BURST) {
+        burstTicker.attach(samplerBurstStart, std::chrono::milliseconds(burstPeriodMs));
+    } else {
+        burstTicker.detach();
+    }
+    samplerSupervisionUpdate();
+}
+
+samplerMode_t samplerModeGet() {
+    return samplerMode;
+}
+
+// Time between snapshots in the current mode, rounded down to whole ms
+uint32_t samplerSnapshotPeriodMs() {
+    return samplerMode == SAMPLER_MODE_BURST ? burstPeriodMs : SAMPLER_SNAPSHOT_PERIOD_MS;
+}
+
+// Adds a callback run from the sampler thread after each snapshot update;
+// it should only signal a thread. Attach before sampling matters, like raw
+// block callbacks.
+void samplerHalfBufferAttach(void (*callback)()) {
+    if (halfBufferCallbackCount < SAMPLER_HALF_BUFFER_CALLBACKS_MAX) {
+        halfBufferCallbacks[halfBufferCallbackCount] = callback;
+        core_util_atomic_store_u32(&halfBufferCallbackCount, halfBufferCallbackCount + 1);
+    }
+}
+
+// Adds a callback run from the sampler thread with every raw half-buffer,
+// before the snapshot it produces is published. Call before sampling matters:
+// attaching is not synchronized with the sampler thread.
+void samplerRawBlockAttach(void (*callback)(const samplerRawBlock_t* block)) {
+    if (rawBlockCallbackCount < SAMPLER_RAW_BLOCK_CALLBACKS_MAX) {
+        rawBlockCallbacks[rawBlockCallbackCount] = callback;
+        core_util_atomic_store_u32(&rawBlockCallbackCount, rawBlockCallbackCount + 1);
+    }
+}
+
+// Calls back once consecutive conversions of the channel have exceeded the
+// threshold (read_u16() scale, corrected like the snapshot averages; the
+// sampler maps it back to raw conversions) for as many scans as the channel's
+// median filter needs to pass them, so a lone spike it rejects trips nothing.
+// The callback runs in interrupt context; after each event the watchdog stays
+// disarmed until samplerWatchdogArm(). Only ADC3 scan channels have one.
+void samplerWatchdogAttach(sensorChannel_t channel, uint16_t threshold,
+                           void (*callback)()) {
+    if (sensorChannels[channel].source != SENSOR_SOURCE_ADC3) {
+        return;
+    }
+    watchdogCallback = callback;
+    watchdogChannel = channel;
+    watchdogThreshold = threshold;
+    watchdogMedianLength = sensorChannels[channel].medianLength;
+    filterRunReset(&watchdogRun);
+
+    ADC_AnalogWDGConfTypeDef watchdogConfig = {0};
+    watchdogConfig.WatchdogMode = ADC_ANALOGWATCHDOG_SINGLE_REG;
+    watchdogConfig.HighThreshold =
+        calibrationTableInverse(&calibration.tables[channel], threshold) >>
+        SAMPLER_WATCHDOG_RAW_SHIFT;
+    watchdogConfig.LowThreshold = 0;
+    watchdogConfig.Channel = sensorChannels[channel].adcChannel;
+    watchdogConfig.ITMode = ENABLE;
+    HAL_ADC_AnalogWDGConfig(&hadc3, &watchdogConfig);
+}
+
+void samplerWatchdogArm() {
+    core_util_critical_section_enter();
+    filterRunReset(&watchdogRun);
+    core_util_critical_section_exit();
+    __HAL_ADC_CLEAR_FLAG(&hadc3, ADC_FLAG_AWD);
+    __HAL_ADC_ENABLE_IT(&hadc3, ADC_IT_AWD);
+}
+
+// Moves the watchdog threshold without touching its armed state, from the
+// next half-buffer on
+void samplerWatchdogThresholdSet(uint16_t threshold) {
+    watchdogThreshold = threshold;
+}
+
+//=====[Implementations of private functions]==================================
+
+static void samplerGpioInit() {
+    __HAL_RCC_GPIOA_CLK_ENABLE();
+    __HAL_RCC_GPIOC_CLK_ENABLE();
+    __HAL_RCC_GPIOF_CLK_ENABLE();
+
+    GPIO_InitTypeDef gpioInit = {0};
+    gpioInit.Mode = GPIO_MODE_ANALOG;
+    gpioInit.Pull = GPIO_NOPULL;
+    // GPIO ports are evenly spaced from GPIOA
+    for (int i = 0; i < SENSOR_SCAN_CHANNEL_COUNT; ++i) {
+        GPIO_TypeDef* port = (GPIO_TypeDef*)(GPIOA_BASE +
+            sensorChannels[i].gpioPort * (GPIOB_BASE - GPIOA_BASE));
+        gpioInit.Pin = 1U << sensorChannels[i].gpioPin;
+        HAL_GPIO_Init(port, &gpioInit);
+    }
+}
+
+static void samplerAdcInit() {
+    __HAL_RCC_ADC3_CLK_ENABLE();
+
+    hadc3.Instance = ADC3;
+    hadc3.Init.ClockPrescaler = ADC_CLOCKPRESCALER_PCLK_DIV4;
+    hadc3.Init.Resolution = ADC_RESOLUTION_12B;
+    hadc3.Init.ScanConvMode = ENABLE;
+    hadc3.Init.ContinuousConvMode = DISABLE;
+    hadc3.Init.DiscontinuousConvMode = DISABLE;
+    hadc3.Init.NbrOfDiscConversion = 0;
+    hadc3.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_RISING;
+    hadc3.Init.ExternalTrigConv = ADC_EXTERNALTRIGCONV_T2_TRGO;
+    hadc3.Init.DataAlign = ADC_DATAALIGN_LEFT;  // 16-bit scale, same as read_u16()
+    hadc3.Init.NbrOfConversion = SENSOR_SCAN_CHANNEL_COUNT;
+    hadc3.Init.DMAContinuousRequests = ENABLE;
+    hadc3.Init.EOCSelection = ADC_EOC_SEQ_CONV;
+    HAL_ADC_Init(&hadc3);
+
+    ADC_ChannelConfTypeDef channelConfig = {0};
+    channelConfig.SamplingTime = ADC_SAMPLETIME_480CYCLES;  // Sensors have high output impedance
+    for (int i = 0; i < SENSOR_SCAN_CHANNEL_COUNT; ++i) {
+        channelConfig.Channel = sensorChannels[i].adcChannel;
+        channelConfig.Rank = i + 1;
+        HAL_ADC_ConfigChannel(&hadc3, &channelConfig);
+    }
+
+    __HAL_LINKDMA(&hadc3, DMA_Handle, hdmaAdc3);
+
+    // Analog watchdog and overrun share the ADC interrupt, above the DMA one
+    NVIC_SetVector(ADC_IRQn, (uint32_t)&samplerAdcIrqHandler);
+    HAL_NVIC_SetPriority(ADC_IRQn, 0, 0);
+    HAL_NVIC_EnableIRQ(ADC_IRQn);
+}
+
+static void samplerDmaInit() {
+    __HAL_RCC_DMA2_CLK_ENABLE();
+
+    hdmaAdc3.Instance = DMA2_Stream1;
+    hdmaAdc3.Init.Channel = DMA_CHANNEL_2;
+    hdmaAdc3.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    hdmaAdc3.Init.PeriphInc = DMA_PINC_DISABLE;
+    hdmaAdc3.Init.MemInc = DMA_MINC_ENABLE;
+    hdmaAdc3.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+    hdmaAdc3.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+    hdmaAdc3.Init.Mode = DMA_CIRCULAR;
+    hdmaAdc3.Init.Priority = DMA_PRIORITY_HIGH;
+    hdmaAdc3.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    HAL_DMA_Init(&hdmaAdc3);
+
+    NVIC_SetVector(DMA2_Stream1_IRQn, (uint32_t)&samplerDmaIrqHandler);
+    HAL_NVIC_SetPriority(DMA2_Stream1_IRQn, 1, 0);
+    HAL_NVIC_EnableIRQ(DMA2_Stream1_IRQn);
+}
+
+// ADC1 and its DMA stream, which needs no interrupt: the ADC3 half-buffer
+// interrupts tell when its halves are complete
+static void samplerSupplyAdcInit() {
+    __HAL_RCC_ADC1_CLK_ENABLE();
+
+    hdmaAdc1.Instance = DMA2_Stream4;
+    hdmaAdc1.Init.Channel = DMA_CHANNEL_0;
+    hdmaAdc1.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    hdmaAdc1.Init.PeriphInc = DMA_PINC_DISABLE;
+    hdmaAdc1.Init.MemInc = DMA_MINC_ENABLE;
+    hdmaAdc1.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+    hdmaAdc1.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+    hdmaAdc1.Init.Mode = DMA_CIRCULAR;
+    hdmaAdc1.Init.Priority = DMA_PRIORITY_MEDIUM;
+    hdmaAdc1.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    HAL_DMA_Init(&hdmaAdc1);
+
+    hadc1.Instance = ADC1;
+    hadc1.Init = hadc3.Init;
+    hadc1.Init.DataAlign = ADC_DATAALIGN_RIGHT;  // 12-bit, like the factory readings
+    hadc1.Init.NbrOfConversion = SAMPLER_SUPPLY_CHANNEL_COUNT;
+    HAL_ADC_Init(&hadc1);
+
+    // Both inputs need at least 10 us of sampling
+    ADC_ChannelConfTypeDef channelConfig = {0};
+    channelConfig.SamplingTime = ADC_SAMPLETIME_480CYCLES;
+    channelConfig.Channel = ADC_CHANNEL_VREFINT;
+    channelConfig.Rank = 1;
+    HAL_ADC_ConfigChannel(&hadc1, &channelConfig);
+    channelConfig.Channel = ADC_CHANNEL_TEMPSENSOR;
+    channelConfig.Rank = 2;
+    HAL_ADC_ConfigChannel(&hadc1, &channelConfig);
+
+    __HAL_LINKDMA(&hadc1, DMA_Handle, hdmaAdc1);
+}
+
+// TIM2 update events trigger one scan of every channel at SAMPLER_SCAN_RATE_HZ
+static void samplerTimerInit() {
+    __HAL_RCC_TIM2_CLK_ENABLE();
+
+    // APB1 timers run at twice PCLK1 whenever the APB1 prescaler is not 1
+    uint32_t timerClock = HAL_RCC_GetPCLK1Freq();
+    if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_CFGR_PPRE1_DIV1) {
+        timerClock *= 2;
+    }
+
+    htim2.Instance = TIM2;
+    htim2.Init.Prescaler = timerClock / SAMPLER_TIMER_CLOCK_HZ - 1;
+    htim2.Init.CounterMode = TIM_COUNTERMODE_UP;
+    htim2.Init.Period = SAMPLER_TIMER_CLOCK_HZ / SAMPLER_SCAN_RATE_HZ - 1;
+    htim2.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+    HAL_TIM_Base_Init(&htim2);
+
+    TIM_MasterConfigTypeDef masterConfig = {0};
+    masterConfig.MasterOutputTrigger = TIM_TRGO_UPDATE;
+    masterConfig.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
+    HAL_TIMEx_MasterConfigSynchronization(&htim2, &masterConfig);
+}
+
+// Both run in a critical section or an interrupt
+static void samplerTimerStart() {
+    if (!timerRunning) {
+        timerRunning = true;
+        sleep_manager_lock_deep_sleep();
+        HAL_TIM_Base_Start(&htim2);
+    }
+}
+
+static void samplerTimerStop() {
+    if (timerRunning) {
+        HAL_TIM_Base_Stop(&htim2);
+        sleep_manager_unlock_deep_sleep();
+        timerRunning = false;
+    }
+}
+
+static void samplerBurstStart() {
+    core_util_critical_section_enter();
+    samplerTimerStart();
+    core_util_critical_section_exit();
+}
+
+static void samplerDmaIrqHandler() {
+    HAL_DMA_IRQHandler(&hdmaAdc3);
+}
+
+static void samplerAdcIrqHandler() {
+    // Each conversion past the threshold sets the flag again, so the run
+    // breaks when one in range leaves a scan period without an interrupt
+    if (__HAL_ADC_GET_FLAG(&hadc3, ADC_FLAG_AWD) &&
+        __HAL_ADC_GET_IT_SOURCE(&hadc3, ADC_IT_AWD)) {
+        __HAL_ADC_CLEAR_FLAG(&hadc3, ADC_FLAG_AWD);
+        if (filterRunAdd(&watchdogRun, us_ticker_read(), 1000000 / SAMPLER_SCAN_RATE_HZ,
+                         watchdogMedianLength)) {
+            __HAL_ADC_DISABLE_IT(&hadc3, ADC_IT_AWD);  // One event per arming
+            if (watchdogCallback != nullptr) {
+                watchdogCallback();
+            }
+        }
+    }
+
+    // An overrun stops the DMA requests, so restart the scan. Each ADC3 half
+    // is corrected with the supply half at the same index, so both restart
+    // together, with no trigger in between to put one a scan ahead.
+    if (__HAL_ADC_GET_FLAG(&hadc3, ADC_FLAG_OVR) ||
+        __HAL_ADC_GET_FLAG(&hadc1, ADC_FLAG_OVR)) {
+        if (timerRunning) {
+            HAL_TIM_Base_Stop(&htim2);
+        }
+        HAL_ADC_Stop_DMA(&hadc3);
+        HAL_ADC_Stop_DMA(&hadc1);
+        __HAL_ADC_CLEAR_FLAG(&hadc3, ADC_FLAG_OVR);
+        __HAL_ADC_CLEAR_FLAG(&hadc1, ADC_FLAG_OVR);
+        HAL_ADC_Start_DMA(&hadc1, (uint32_t*)supplyBuffer, SAMPLER_SUPPLY_BUFFER_LENGTH);
+        HAL_ADC_Start_DMA(&hadc3, (uint32_t*)dmaBuffer, SAMPLER_DMA_BUFFER_LENGTH);
+        if (timerRunning) {
+            HAL_TIM_Base_Start(&htim2);
+        }
+    }
+}
+
+static void samplerTask() {
+    while (true) {
+        uint32_t flags = samplerFlags.wait_any(SAMPLER_FLAG_FIRST_HALF |
+                                               SAMPLER_FLAG_SECOND_HALF);
+        if (flags & SAMPLER_FLAG_FIRST_HALF) {
+            instrumentationWakeLatencyRecord(instrumentationCycles() - halfCycles[0]);
+            samplerHalfBufferProcess(&dmaBuffer[0], &supplyBuffer[0], halfTimestampUs[0]);
+        }
+        if (flags & SAMPLER_FLAG_SECOND_HALF) {
+            instrumentationWakeLatencyRecord(instrumentationCycles() - halfCycles[1]);
+            samplerHalfBufferProcess(&dmaBuffer[SAMPLER_DMA_BUFFER_LENGTH / 2],
+                                     &supplyBuffer[SAMPLER_SUPPLY_BUFFER_LENGTH / 2],
+                                     halfTimestampUs[1]);
+        }
+        supervisorCheckIn(SUPERVISOR_TASK_SAMPLER);
+    }
+}
+
+// Filters one completed half-buffer into the shared snapshot. It must finish
+// before DMA wraps around to this half again (one half-buffer period).
+static void samplerHalfBufferProcess(const uint16_t* half, const uint16_t* supplyHalf,
+                                     uint32_t timestampUs) {
+    uint32_t sequence = publishedSequence + 1;
+    samplerSnapshot_t* snapshot = &snapshots[sequence & 1];
+
+    INSTRUMENTATION_BEGIN(INSTRUMENTATION_STAGE_RAW_BLOCK);
+    samplerRawBlock_t block = { half, SAMPLER_SCANS_PER_HALF, sequence, timestampUs };
+    uint32_t callbackCount = core_util_atomic_load_u32(&rawBlockCallbackCount);
+    for (uint32_t i = 0; i < callbackCount; ++i) {
+        rawBlockCallbacks[i](&block);
+    }
+    INSTRUMENTATION_END(INSTRUMENTATION_STAGE_RAW_BLOCK);
+
+    if (configGeneration() != configApplied) {
+        samplerConfigApply();
+    }
+
+    INSTRUMENTATION_BEGIN(INSTRUMENTATION_STAGE_FILTER);
+    samplerSupplyUpdate(supplyHalf, snapshot);
+    pipelineCalibrationBlock(&calibration, half, SAMPLER_SCANS_PER_HALF, corrected);
+    pipelineFiltersBlock(&filters, corrected, SAMPLER_SCANS_PER_HALF, snapshot->average);
+    pipelineRangesBlock(half, SENSOR_SCAN_CHANNEL_COUNT, SAMPLER_SCANS_PER_HALF,
+                        snapshot->minimum, snapshot->maximum);
+#if SENSOR_SPI_CHANNEL_COUNT > 0
+    // The SPI channels lag by one half-buffer: their block converted during
+    // the last one. Without a new block they keep their previous averages.
+    uint16_t spiSamples[SPI_ADC_BLOCK_LENGTH];
+    if (spiAdcBlockRead(spiSamples)) {
+        pipelineFiltersSpiBlock(&filters, spiSamples, SPI_ADC_SAMPLES_PER_BLOCK,
+                                snapshot->average);
+        pipelineRangesBlock(spiSamples, SENSOR_SPI_CHANNEL_COUNT, SPI_ADC_SAMPLES_PER_BLOCK,
+                            &snapshot->minimum[SENSOR_CHANNEL_SPI_FIRST],
+                            &snapshot->maximum[SENSOR_CHANNEL_SPI_FIRST]);
+    } else {
+        const samplerSnapshot_t* previous = &snapshots[publishedSequence & 1];
+        size_t spiSize = SENSOR_SPI_CHANNEL_COUNT * sizeof(uint16_t);
+        memcpy(&snapshot->average[SENSOR_CHANNEL_SPI_FIRST],
+               &previous->average[SENSOR_CHANNEL_SPI_FIRST], spiSize);
+        memcpy(&snapshot->minimum[SENSOR_CHANNEL_SPI_FIRST],
+               &previous->minimum[SENSOR_CHANNEL_SPI_FIRST], spiSize);
+        memcpy(&snapshot->maximum[SENSOR_CHANNEL_SPI_FIRST],
+               &previous->maximum[SENSOR_CHANNEL_SPI_FIRST], spiSize);
+    }
+    spiAdcBlockStart();
+#endif
+    INSTRUMENTATION_END(INSTRUMENTATION_STAGE_FILTER);
+    snapshot->sequence = sequence;
+    core_util_atomic_store_u32(&publishedSequence, sequence);
+
+    uint32_t halfBufferCount = core_util_atomic_load_u32(&halfBufferCallbackCount);
+    for (uint32_t i = 0; i < halfBufferCount; ++i) {
+        halfBufferCallbacks[i]();
+    }
+}
+
+// Takes new settings between two blocks, so every channel switches at the
+// same half-buffer
+static void samplerConfigApply() {
+    configSettings_t settings;
+    configApplied = configGeneration();
+    configGet(&settings);
+    pipelineFiltersConfigure(&filters, settings.channels);
+    pipelineCalibrationConfigure(&calibration, settings.calibrations);
+    watchdogMedianLength = settings.channels[watchdogChannel].medianLength;
+
+    if (settings.burstPeriodMs != burstPeriodMs) {
+        burstPeriodMs = settings.burstPeriodMs;
+        if (samplerMode == SAMPLER_MODE_BURST) {
+            burstTicker.attach(samplerBurstStart, std::chrono::milliseconds(burstPeriodMs));
+        }
+        samplerSupervisionUpdate();
+    }
+}
+
+// Averages the half-buffer's VREFINT and temperature conversions. A lag of
+// the supply tables by one block does not matter: the gain is smoothed over
+// many anyway. Also maps the watchdog threshold through the current tables.
+static void samplerSupplyUpdate(const uint16_t* supplyHalf, samplerSnapshot_t* snapshot) {
+    uint32_t vrefintSum = 0;
+    uint32_t temperatureSum = 0;
+    for (int scan = 0; scan < SAMPLER_SCANS_PER_HALF; ++scan) {
+        vrefintSum += supplyHalf[scan * SAMPLER_SUPPLY_CHANNEL_COUNT];
+        temperatureSum += supplyHalf[scan * SAMPLER_SUPPLY_CHANNEL_COUNT + 1];
+    }
+
+    pipelineCalibrationSupplyUpdate(&calibration, SAMPLER_VREFINT_CAL,
+                                    vrefintSum / SAMPLER_SCANS_PER_HALF);
+    samplerWatchdogThresholdWrite();
+    snapshot->supplyMillivolts = (uint16_t)calibrationSupplyMillivolts(calibration.gainQ16);
+    snapshot->dieCentiCelsius = (int16_t)calibrationDieCentiCelsius(
+        SAMPLER_TS_CAL_30C, SAMPLER_TS_CAL_110C, temperatureSum / SAMPLER_SCANS_PER_HALF,
+        calibration.gainQ16);
+}
+
+// The register may be written while the scan runs
+static void samplerWatchdogThresholdWrite() {
+    hadc3.Instance->HTR = calibrationTableInverse(&calibration.tables[watchdogChannel],
+                                                  watchdogThreshold) >>
+                          SAMPLER_WATCHDOG_RAW_SHIFT;
+}
+
+// The sampler thread and the alarm thread behind it each run once per
+// snapshot; missing two in a row means the pipeline has stalled
+static void samplerSupervisionUpdate() {
+    uint32_t timeoutMs = 2 * samplerSnapshotPeriodMs() + SUPERVISOR_PIPELINE_SLACK_MS;
+    supervisorTimeoutSet(SUPERVISOR_TASK_SAMPLER, timeoutMs);
+    supervisorTimeoutSet(SUPERVISOR_TASK_ALARM, timeoutMs);
+}
+
+// HAL DMA callbacks: the first half is complete while DMA fills the second.
+// A burst ends here, before the next trigger, so every burst fills exactly
+// one half-buffer.
+extern "C" void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef* hadc) {
+    if (hadc->Instance == ADC3) {
+        if (samplerMode == SAMPLER_MODE_BURST) {
+            samplerTimerStop();
+        }
+        halfTimestampUs[0] = us_ticker_read();
+        halfCycles[0] = instrumentationCycles();
+        samplerFlags.set(SAMPLER_FLAG_FIRST_HALF);
+    }
+}
+
+extern "C" void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef* hadc) {
+    if (hadc->Instance == ADC3) {
+        if (samplerMode == SAMPLER_MODE_BURST) {
+            samplerTimerStop();
+        }
+        halfTimestampUs[1] = us_ticker_read();
+        halfCycles[1] = instrumentationCycles();
+        samplerFlags.set(SAMPLER_FLAG_SECOND_HALF);
+    }
+}
@@ -0,0 +1,75 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _SAMPLER_H_
+#define _SAMPLER_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+#include "sensor_channels.h"
+
+//=====[Declaration of public defines]=========================================
+
+#define SAMPLER_SCAN_RATE_HZ        1000  // Scans of all channels per second
+#define SAMPLER_SCANS_PER_HALF      32    // Scans per DMA half-buffer
+#define SAMPLER_SNAPSHOT_PERIOD_MS  (SAMPLER_SCANS_PER_HALF * 1000 / SAMPLER_SCAN_RATE_HZ)
+#define SAMPLER_BURST_PERIOD_MS     1000  // One half-buffer per period in burst
+                                          // mode, by default (see config.h)
+
+//=====[Declaration of public data types]======================================
+
+typedef enum {
+    SAMPLER_MODE_CONTINUOUS,  // Scans back to back, deep sleep locked
+    SAMPLER_MODE_BURST,       // Scans one half-buffer per burst period and
+                              // lets the MCU deep sleep in between
+    SAMPLER_MODE_COUNT,
+} samplerMode_t;
+
+// Filtered averages of the last completed half-buffer, scaled like
+// AnalogIn::read_u16(); SPI ADC channels from the half-buffer before. ADC3
+// averages are corrected for the supply and the user calibration (see
+// pipeline.h), so the channel table's 3.30 V scaling holds. The lowest and
+// highest raw readings they were filtered from let the diagnostics tell a
+// dead input from a quiet one.
+typedef struct {
+    uint16_t average[SENSOR_CHANNEL_COUNT];
+    uint16_t minimum[SENSOR_CHANNEL_COUNT];
+    uint16_t maximum[SENSOR_CHANNEL_COUNT];
+    uint16_t supplyMillivolts;  // VDDA, from VREFINT
+    int16_t dieCentiCelsius;    // From the internal temperature sensor
+    uint32_t sequence;  // Incremented once per completed half-buffer
+} samplerSnapshot_t;
+
+// One completed half-buffer of raw conversions, before any correction or
+// filtering.
+// Only valid during the callback, which must return well within a
+// half-buffer period.
+typedef struct {
+    const uint16_t* samples;  // scanCount scans of SENSOR_SCAN_CHANNEL_COUNT
+                              // readings each, in table order
+    uint32_t scanCount;
+    uint32_t sequence;        // Of the snapshot filtered from this block
+    uint32_t timestampUs;     // us_ticker_read() when the last scan completed;
+                              // TIM2 paces the scans, so scan i completed
+                              // (scanCount - 1 - i) scan periods earlier
+} samplerRawBlock_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void samplerInit();
+void samplerSnapshotRead(samplerSnapshot_t* snapshot);
+void samplerModeSet(samplerMode_t mode);
+samplerMode_t samplerModeGet();
+uint32_t samplerSnapshotPeriodMs();
+
+void samplerHalfBufferAttach(void (*callback)());
+void samplerRawBlockAttach(void (*callback)(const samplerRawBlock_t* block));
+void samplerWatchdogAttach(sensorChannel_t channel, uint16_t threshold,
+                           void (*callback)());
+void samplerWatchdogArm();
+void samplerWatchdogThresholdSet(uint16_t threshold);
+
+//=====[#include guards - end]=================================================
+
+#endif // _SAMPLER_H_
@@ -0,0 +1,273 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _SENSOR_CHANNELS_H_
+#define _SENSOR_CHANNELS_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+//=====[Declaration of public defines]=========================================
+
+// Extra MQ gas heads on the inputs of an MCP3208 SPI ADC, 0 to 8; set it in
+// mbed_app.json macros for sites with more heads than the board has pins
+#ifndef SENSOR_SPI_GAS_HEADS
+#define SENSOR_SPI_GAS_HEADS        0
+#endif
+
+#define SENSOR_SCAN_CHANNEL_COUNT   3   // On the ADC3 scan, first in the table
+#define SENSOR_SPI_CHANNEL_COUNT    SENSOR_SPI_GAS_HEADS
+#define SENSOR_CHANNEL_COUNT        (SENSOR_SCAN_CHANNEL_COUNT + SENSOR_SPI_CHANNEL_COUNT)
+
+//=====[Declaration of public data types]======================================
+
+// Order of the table below: the ADC3 scan sequence, then the SPI ADC
+// channels (SENSOR_CHANNEL_SPI_FIRST onwards, indexed like the table)
+typedef enum {
+    SENSOR_CHANNEL_GAS,
+    SENSOR_CHANNEL_LM35,
+    SENSOR_CHANNEL_POTENTIOMETER,
+    SENSOR_CHANNEL_SPI_FIRST,
+} sensorChannel_t;
+
+typedef enum {
+    SENSOR_SOURCE_ADC3,         // adcChannel is the ADC3 input, sampled every scan
+    SENSOR_SOURCE_SPI_ADC,      // adcChannel is the MCP3208 input (see spi_adc.h)
+} sensorSource_t;
+
+// What an alarm on the channel means; it selects the events and annunciator
+// pattern, so several heads of one kind share them
+typedef enum {
+    SENSOR_KIND_GAS,
+    SENSOR_KIND_TEMPERATURE,
+    SENSOR_KIND_OTHER,
+    SENSOR_KIND_COUNT,
+} sensorKind_t;
+
+typedef enum {
+    SENSOR_GPIO_PORT_A,
+    SENSOR_GPIO_PORT_B,
+    SENSOR_GPIO_PORT_C,
+    SENSOR_GPIO_PORT_D,
+    SENSOR_GPIO_PORT_E,
+    SENSOR_GPIO_PORT_F,
+} sensorGpioPort_t;
+
+// Everything about one analog channel, fixed at compile time. Values are
+// integers in hundredths of the channel unit, readings use the 0 to 65535
+// range of AnalogIn::read_u16(), and value = (reading * scaleQ16 >> 16) + offset.
+typedef struct {
+    const char* name;
+    const char* unit;           // Printed after values, may be empty
+    sensorKind_t kind;
+    sensorSource_t source;
+    sensorGpioPort_t gpioPort;  // Analog pin of ADC3 channels
+    uint8_t gpioPin;
+    uint8_t adcChannel;         // Input of the source ADC
+    uint32_t scaleQ16;          // Hundredths of unit at full scale
+    int32_t offset;             // Hundredths of unit at a zero reading
+    bool ratiometric;           // Reads a fraction of VDDA, so no supply correction
+    bool alarmEnabled;
+    int32_t tripThreshold;      // Alarm trips above this value...
+    int32_t hysteresis;         // ...and clears at or below trip - hysteresis
+    uint16_t tripDwellMs;       // Time above trip before the alarm trips
+    uint16_t clearDwellMs;      // Time at or below clear before it clears
+    int32_t rateTrip;           // Rise in hundredths per second that trips, 0 disables
+    uint8_t oversamplingLog2;   // Averages the last (1 << this) scans
+    uint8_t medianLength;       // Median-of-N spike rejection, 0 disables
+    uint8_t iirShift;           // Exponential smoothing strength, 0 disables
+    uint16_t trendWindow;       // Snapshots fitted for the pre-alarm, 0 disables
+    uint16_t preAlarmHorizonS;  // Pre-alarm when the trend trips within this
+} sensorChannelDescriptor_t;
+
+// The alarm and filter parameters of a channel that may be changed at run
+// time (see config.h), in the units of the table
+typedef struct {
+    int32_t tripThreshold;
+    int32_t hysteresis;
+    uint16_t tripDwellMs;
+    uint16_t clearDwellMs;
+    int32_t rateTrip;
+    uint8_t oversamplingLog2;
+    uint8_t medianLength;
+    uint8_t iirShift;
+    uint8_t reserved;
+} sensorChannelSettings_t;
+
+// What a sound sensor of a kind can read, for the background diagnostics
+// (see diagnostics.h), in the units of the channel table. Fixed, unlike the
+// alarm settings: they describe the hardware, not the site.
+typedef struct {
+    bool enabled;
+    int32_t railLow;            // Whole blocks at or below mean an open or short
+    int32_t railHigh;           // Whole blocks at or above, likewise
+    int32_t heaterMin;          // Below this once warm, the MQ heater is off; 0 disables
+    int32_t noiseMax;           // Deviation of the change between snapshots
+    int32_t rateMax;            // Sustained change per second
+    uint16_t stuckS;            // Raw readings unchanged for this long
+    uint16_t warmupS;           // After boot, before the checks start
+    uint16_t dwellMs;           // Evidence needed to raise or drop a flag
+} sensorKindHealth_t;
+
+// When a channel of a kind needs full-rate sampling in the adaptive power
+// mode (see rate_control.h), in the units of the channel table. Only
+// channels with an alarm have a threshold to near.
+typedef struct {
+    bool enabled;
+    int32_t nearMargin;         // This far below the trip threshold or closer
+    int32_t changeMax;          // Change per second either way above this
+    uint16_t quietS;            // Neither for this long before bursts resume
+} sensorKindRate_t;
+
+//=====[Declaration and initialization of public global variables]=============
+
+// An MQ head on an SPI ADC input, alarmed like the on-board one. Its 12-bit
+// readings arrive left-aligned, four per half-buffer, hence the shorter
+// oversampling; the median stage still rejects heater spikes.
+#define SENSOR_SPI_GAS_HEAD(name, input) \
+    { name, "", SENSOR_KIND_GAS, SENSOR_SOURCE_SPI_ADC, SENSOR_GPIO_PORT_A, 0, input, \
+      100, 0, false, true, 50, 5, 0, 2000, 0, 2, 3, 0, 128, 20 }
+
+constexpr sensorChannelDescriptor_t sensorChannels[SENSOR_CHANNEL_COUNT] = {
+    // Gas sensor (A3 = PF_3, only routed to ADC3), normalized reading.
+    // The MQ heater picks up switching spikes, hence the median stage. Gas
+    // trips without dwell; it must stay clear for 2 s before releasing. A
+    // leak building up over the last 4 s warns 20 s ahead.
+    { "Gas", "", SENSOR_KIND_GAS, SENSOR_SOURCE_ADC3,
+      SENSOR_GPIO_PORT_F, 3, 9, 100, 0, false,
+      true, 50, 5, 0, 2000, 0, 5, 5, 0, 128, 20 },
+    // LM35 (A1 = PC_0), 10 mV/°C with a 3.3 V full scale. Temperature moves
+    // slowly, so smooth over about four half-buffers and require 1 s above
+    // the threshold, unless it climbs faster than 1 °C/s. The trend over 8 s
+    // warns a minute ahead.
+    { "LM35", "C", SENSOR_KIND_TEMPERATURE, SENSOR_SOURCE_ADC3,
+      SENSOR_GPIO_PORT_C, 0, 10, 33000, 0, false,
+      true, 2400, 50, 1000, 3000, 100, 5, 0, 2, 256, 60 },
+    // Potentiometer (A0 = PA_3), normalized reading. It divides the 3.3 V
+    // rail that also feeds VDDA, so it reads the same whatever the supply.
+    { "Potentiometer", "", SENSOR_KIND_OTHER, SENSOR_SOURCE_ADC3,
+      SENSOR_GPIO_PORT_A, 3, 3, 100, 0, true,
+      false, 0, 0, 0, 0, 0, 5, 0, 0, 0, 0 },
+#if SENSOR_SPI_GAS_HEADS > 0
+    SENSOR_SPI_GAS_HEAD("Gas1", 0),
+#endif
+#if SENSOR_SPI_GAS_HEADS > 1
+    SENSOR_SPI_GAS_HEAD("Gas2", 1),
+#endif
+#if SENSOR_SPI_GAS_HEADS > 2
+    SENSOR_SPI_GAS_HEAD("Gas3", 2),
+#endif
+#if SENSOR_SPI_GAS_HEADS > 3
+    SENSOR_SPI_GAS_HEAD("Gas4", 3),
+#endif
+#if SENSOR_SPI_GAS_HEADS > 4
+    SENSOR_SPI_GAS_HEAD("Gas5", 4),
+#endif
+#if SENSOR_SPI_GAS_HEADS > 5
+    SENSOR_SPI_GAS_HEAD("Gas6", 5),
+#endif
+#if SENSOR_SPI_GAS_HEADS > 6
+    SENSOR_SPI_GAS_HEAD("Gas7", 6),
+#endif
+#if SENSOR_SPI_GAS_HEADS > 7
+    SENSOR_SPI_GAS_HEAD("Gas8", 7),
+#endif
+};
+
+// Indexed by sensorKind_t. MQ heads need minutes on a cold heater before
+// their readings mean anything and rest well above their floor in clean air.
+// The LM35 reads 1.50 V at its 150 °C limit; far above that, or at 0 V, its
+// line is broken.
+constexpr sensorKindHealth_t sensorKindHealth[SENSOR_KIND_COUNT] = {
+    { true, 1, 99, 3, 5, 100, 60, 180, 5000 },          // Gas
+    { true, 100, 15000, 0, 50, 500, 600, 0, 5000 },     // Temperature
+    { false, 0, 0, 0, 0, 0, 0, 0, 0 },                  // Other
+};
+
+// Indexed by sensorKind_t. Clean air reads well below half the gas margin;
+// a room drifts far slower than 0.10 °C/s, a fire does not.
+constexpr sensorKindRate_t sensorKindRate[SENSOR_KIND_COUNT] = {
+    { true, 25, 5, 30 },        // Gas
+    { true, 150, 10, 30 },      // Temperature
+    { false, 0, 0, 0 },         // Other
+};
+
+//=====[Implementations of public functions]===================================
+
+// The scan channels come first and the SPI ADC ones after, as the sampler
+// lays out their readings
+constexpr bool sensorChannelTableOrdered(int channel = 0) {
+    return channel >= SENSOR_CHANNEL_COUNT ||
+           ((sensorChannels[channel].source == SENSOR_SOURCE_ADC3) ==
+            (channel < SENSOR_SCAN_CHANNEL_COUNT) &&
+            sensorChannelTableOrdered(channel + 1));
+}
+
+static_assert(sensorChannelTableOrdered(),
+              "Channel table must list the ADC3 scan channels, then the SPI ones");
+static_assert(SENSOR_SPI_GAS_HEADS <= 8, "The MCP3208 has eight inputs");
+static_assert(SENSOR_CHANNEL_COUNT <= 32, "Alarm channel masks are 32 bits");
+
+// Number of channels of a kind, such as the gas heads
+constexpr int sensorKindChannelCount(sensorKind_t kind, int channel = 0) {
+    return channel >= SENSOR_CHANNEL_COUNT ? 0 :
+           (sensorChannels[channel].kind == kind ? 1 : 0) +
+           sensorKindChannelCount(kind, channel + 1);
+}
+
+// Reading at which a channel reaches value, rounded down and clamped to 16 bits
+constexpr uint16_t sensorChannelValueToReading(sensorChannel_t channel,
+                                               int32_t value) {
+    int64_t reading = (int64_t)(value - sensorChannels[channel].offset) * 65536 /
+                      (int64_t)sensorChannels[channel].scaleQ16;
+    return reading < 0 ? 0 : (reading > 65535 ? 65535 : (uint16_t)reading);
+}
+
+// For loops over all channels; the table lookups fold once unrolled
+inline int32_t sensorChannelValue(sensorChannel_t channel, uint16_t reading) {
+    return (int32_t)(((uint32_t)reading * sensorChannels[channel].scaleQ16 +
+                      (1UL << 15)) >> 16) + sensorChannels[channel].offset;
+}
+
+template <sensorChannel_t Channel>
+inline int32_t sensorChannelConvert(uint16_t reading) {
+    return (int32_t)(((uint32_t)reading * sensorChannels[Channel].scaleQ16 +
+                      (1UL << 15)) >> 16) + sensorChannels[Channel].offset;
+}
+
+template <sensorChannel_t Channel>
+constexpr uint16_t sensorChannelTripReading() {
+    static_assert(sensorChannels[Channel].alarmEnabled, "Channel has no alarm");
+    return sensorChannelValueToReading(Channel, sensorChannels[Channel].tripThreshold);
+}
+
+template <sensorChannel_t Channel>
+constexpr uint16_t sensorChannelClearReading() {
+    static_assert(sensorChannels[Channel].alarmEnabled, "Channel has no alarm");
+    return sensorChannelValueToReading(Channel, sensorChannels[Channel].tripThreshold -
+                                                sensorChannels[Channel].hysteresis);
+}
+
+// Rise per second in readings equivalent to a rate trip, 0 when disabled
+constexpr uint32_t sensorChannelRateToReadings(sensorChannel_t channel,
+                                               int32_t rateTrip) {
+    return rateTrip <= 0 ? 0 :
+           (uint32_t)((int64_t)rateTrip * 65536 /
+                      (int64_t)sensorChannels[channel].scaleQ16);
+}
+
+constexpr uint32_t sensorChannelRateTripReadings(sensorChannel_t channel) {
+    return sensorChannelRateToReadings(channel, sensorChannels[channel].rateTrip);
+}
+
+// The table's parameters, used until a stored configuration replaces them
+constexpr sensorChannelSettings_t sensorChannelDefaultSettings(sensorChannel_t channel) {
+    return { sensorChannels[channel].tripThreshold, sensorChannels[channel].hysteresis,
+             sensorChannels[channel].tripDwellMs, sensorChannels[channel].clearDwellMs,
+             sensorChannels[channel].rateTrip, sensorChannels[channel].oversamplingLog2,
+             sensorChannels[channel].medianLength, sensorChannels[channel].iirShift, 0 };
+}
+
+//=====[#include guards - end]=================================================
+
+#endif // _SENSOR_CHANNELS_H_
@@ -0,0 +1,59 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _SENSOR_UNITS_H_
+#define _SENSOR_UNITS_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+#include "sensor_channels.h"
+
+//=====[Declaration of public defines]=========================================
+
+// Analog readings are in the 0 to 65535 range of AnalogIn::read_u16() and
+// results are integers in hundredths, so 2437 means 24.37. Sampler readings
+// are corrected to a 3.30 V full scale whatever the supply (see
+// calibration.h), which the factors below assume. Scale factors are
+// Q16 fixed-point: result = (reading * factor) >> 16.
+#define SENSOR_UNITS_HUNDREDTHS_Q16                 100    // Full scale reads 1.00
+#define SENSOR_UNITS_POTENTIOMETER_CENTI_CELSIUS_Q16 3300   // 10 °C/V: 3 V is 30 °C
+
+#define SENSOR_UNITS_NINE_FIFTHS_Q15    58982  // 9/5 in Q15, fits in 32 bits
+
+//=====[Implementations of public functions]===================================
+
+// Inline so that each conversion compiles to a multiply-add at the call site
+
+// Analog reading in hundredths of full scale (0 to 100): what AnalogIn::read() showed
+inline int32_t analogReadingToHundredths(uint16_t analogReading) {
+    return (int32_t)(((uint32_t)analogReading * SENSOR_UNITS_HUNDREDTHS_Q16 +
+                      (1UL << 15)) >> 16);
+}
+
+// LM35 formula conversion to hundredths of Celsius, from the channel table
+inline int32_t analogReadingScaledWithTheLM35Formula(uint16_t analogReading) {
+    return sensorChannelConvert<SENSOR_CHANNEL_LM35>(analogReading);
+}
+
+// Celsius to Fahrenheit conversion, both in hundredths
+inline int32_t celsiusToFahrenheit(int32_t tempInCelsiusHundredths) {
+    return ((tempInCelsiusHundredths * SENSOR_UNITS_NINE_FIFTHS_Q15 +
+             (1L << 14)) >> 15) + 3200;
+}
+
+// Potentiometer scaling to hundredths of Celsius (example: 0 V to 3 V is 0 to
+// 30 °C, so the 3.3 V full scale reads 33 °C)
+inline int32_t potentiometerScaledToCelsius(uint16_t analogValue) {
+    return (int32_t)(((uint32_t)analogValue * SENSOR_UNITS_POTENTIOMETER_CENTI_CELSIUS_Q16 +
+                      (1UL << 15)) >> 16);
+}
+
+// Potentiometer scaling to hundredths of Fahrenheit
+inline int32_t potentiometerScaledToFahrenheit(uint16_t analogValue) {
+    return celsiusToFahrenheit(potentiometerScaledToCelsius(analogValue));
+}
+
+//=====[#include guards - end]=================================================
+
+#endif // _SENSOR_UNITS_H_
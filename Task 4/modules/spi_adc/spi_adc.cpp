@@ -0,0 +1,141 @@
+//=====[Libraries]=============================================================
+
+#include <string.h>
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "spi_adc.h"
+#include "memory_plan.h"
+
+#if SENSOR_SPI_CHANNEL_COUNT > 0
+
+//=====[Declaration of private defines]========================================
+
+#define SPI_ADC_FLAG_START          (1UL << 0)
+#define SPI_ADC_FLAG_DONE           (1UL << 1)
+
+#define SPI_ADC_TRANSFER_LENGTH     3
+
+//=====[Declaration and initialization of private global variables]============
+
+static SPI spi(PC_12, PC_11, PC_10);
+static DigitalOut chipSelect(D10, 1);
+
+// Below the sampler, which starts each block, and above everything else
+static Thread spiAdcThread(osPriorityAboveNormal,
+                           memoryPlanStackSize(MEMORY_PLAN_STACK_SPI_ADC),
+                           memoryPlanStackMemory(MEMORY_PLAN_STACK_SPI_ADC),
+                           memoryPlanStackName(MEMORY_PLAN_STACK_SPI_ADC));
+static EventFlags spiAdcFlags;
+
+// The thread fills one block while the sampler reads the other; published by
+// incrementing completedBlocks
+static uint16_t blocks[2][SPI_ADC_BLOCK_LENGTH];
+static volatile uint32_t completedBlocks = 0;
+static uint32_t readBlocks = 0;             // Sampler thread only
+static volatile bool busy = false;
+static volatile uint32_t overruns = 0;      // Starts while still converting
+
+// Transfer buffers in SRAM: the thread stack is in CCM, which the DMA
+// controllers cannot reach
+static uint8_t command[SPI_ADC_TRANSFER_LENGTH];
+static uint8_t response[SPI_ADC_TRANSFER_LENGTH];
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void spiAdcTask();
+static uint16_t spiAdcConvert(uint8_t input);
+static void spiAdcTransferDone(int event);
+
+//=====[Implementations of public functions]===================================
+
+void spiAdcInit() {
+    spi.format(8, 0);
+    spi.frequency(SPI_ADC_FREQUENCY_HZ);
+    spi.set_dma_usage(DMA_USAGE_ALWAYS);
+    spiAdcThread.start(spiAdcTask);
+}
+
+// Starts a block of conversions, from the sampler thread once per half-buffer
+void spiAdcBlockStart() {
+    if (busy) {
+        overruns++;
+        return;
+    }
+    busy = true;
+    spiAdcFlags.set(SPI_ADC_FLAG_START);
+}
+
+// Copies the newest block if it has not been read yet: samples[k *
+// SENSOR_SPI_CHANNEL_COUNT + i] is round k of SPI channel i
+bool spiAdcBlockRead(uint16_t* samples) {
+    uint32_t completed = core_util_atomic_load_u32(&completedBlocks);
+    if (completed == readBlocks) {
+        return false;
+    }
+    memcpy(samples, blocks[completed & 1], sizeof(blocks[0]));
+    readBlocks = completed;
+    return true;
+}
+
+uint32_t spiAdcOverruns() {
+    return overruns;
+}
+
+//=====[Implementations of private functions]==================================
+
+static void spiAdcTask() {
+    while (true) {
+        spiAdcFlags.wait_any(SPI_ADC_FLAG_START);
+
+        uint32_t next = completedBlocks + 1;
+        uint16_t* block = blocks[next & 1];
+        for (int k = 0; k < SPI_ADC_SAMPLES_PER_BLOCK; ++k) {
+            for (int i = 0; i < SENSOR_SPI_CHANNEL_COUNT; ++i) {
+                block[k * SENSOR_SPI_CHANNEL_COUNT + i] = spiAdcConvert(
+                    sensorChannels[SENSOR_CHANNEL_SPI_FIRST + i].adcChannel);
+            }
+        }
+        core_util_atomic_store_u32(&completedBlocks, next);
+        busy = false;
+    }
+}
+
+// One single-ended conversion, moved in the background (by DMA, or by
+// interrupts where the target's SPI driver has no DMA path) while this thread
+// sleeps. The MCP3208 starts a conversion on every chip select, so each is a
+// transfer of its own.
+static uint16_t spiAdcConvert(uint8_t input) {
+    // Start bit, single-ended, then the input number over two bytes
+    command[0] = (uint8_t)(0x06 | (input >> 2));
+    command[1] = (uint8_t)((input & 0x03) << 6);
+    command[2] = 0;
+
+    chipSelect = 0;
+    spi.transfer(command, SPI_ADC_TRANSFER_LENGTH, response, SPI_ADC_TRANSFER_LENGTH,
+                 spiAdcTransferDone);
+    spiAdcFlags.wait_any(SPI_ADC_FLAG_DONE);
+    chipSelect = 1;
+
+    // 12 bits left-aligned to the read_u16() scale of the scan channels
+    uint16_t reading = ((uint16_t)(response[1] & 0x0F) << 8) | response[2];
+    return reading << 4;
+}
+
+static void spiAdcTransferDone(int event) {
+    spiAdcFlags.set(SPI_ADC_FLAG_DONE);
+}
+
+#else
+
+void spiAdcInit() {}
+void spiAdcBlockStart() {}
+bool spiAdcBlockRead(uint16_t* samples) {
+    return false;
+}
+uint32_t spiAdcOverruns() {
+    return 0;
+}
+
+#endif
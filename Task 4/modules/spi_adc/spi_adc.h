@@ -0,0 +1,36 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _SPI_ADC_H_
+#define _SPI_ADC_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+#include "sensor_channels.h"
+
+//=====[Declaration of public defines]=========================================
+
+// MCP3208 (8 inputs, 12 bits) on SPI3: PC_10 SCK, PC_11 MISO, PC_12 MOSI
+// (CN8 pins 6, 8 and 10) and D10 = PD_14 chip select. Not on the Arduino
+// SPI1 pins: D11 is PA_7, the Ethernet RMII CRS_DV through SB121.
+#define SPI_ADC_FREQUENCY_HZ        1000000  // Its limit at 2.7 V
+
+// Rounds of conversions of every SPI channel per half-buffer. At 24 clocks
+// each, eight heads take about 1 ms of DMA time out of the 32 ms period.
+#define SPI_ADC_SAMPLES_PER_BLOCK   4
+
+#define SPI_ADC_BLOCK_LENGTH        (SPI_ADC_SAMPLES_PER_BLOCK * SENSOR_SPI_CHANNEL_COUNT)
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// All of these do nothing, and read returns false, when the table has no SPI
+// ADC channels
+void spiAdcInit();
+void spiAdcBlockStart();
+bool spiAdcBlockRead(uint16_t* samples);
+uint32_t spiAdcOverruns();
+
+//=====[#include guards - end]=================================================
+
+#endif // _SPI_ADC_H_
@@ -0,0 +1,150 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "supervisor.h"
+#include "number_format.h"
+#include "pc_serial_com.h"
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct {
+    volatile uint32_t checkIns;
+    volatile uint32_t timeoutMs;    // 0 while not watched
+    volatile uint32_t overruns;     // Deadlines missed
+    uint64_t lastCheckInMs;         // Only touched by the task itself
+    uint32_t longestGapMs;
+} supervisorTaskState_t;
+
+//=====[Declaration and initialization of private global variables]============
+
+// Indexed by supervisorTask_t
+static const char* const supervisorTaskNames[SUPERVISOR_TASK_COUNT] = {
+    "Sampler", "Alarm", "Console", "Telemetry", "Data log",
+};
+
+static supervisorTaskState_t tasks[SUPERVISOR_TASK_COUNT];
+
+// The check runs from the low-power ticker, which also wakes the MCU from
+// deep sleep, where the independent watchdog keeps counting
+static LowPowerTicker checkTicker;
+static uint32_t lastCheckIns[SUPERVISOR_TASK_COUNT];
+static uint32_t silentMs[SUPERVISOR_TASK_COUNT];
+
+static bool watchdogReset = false;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void supervisorCheck();
+
+//=====[Implementations of public functions]===================================
+
+// Starts the independent watchdog; call once every watched task runs. It
+// cannot be stopped again short of a reset.
+void supervisorInit() {
+    watchdogReset = (ResetReason::get() == RESET_REASON_WATCHDOG);
+
+    tasks[SUPERVISOR_TASK_CONSOLE].timeoutMs = SUPERVISOR_CONSOLE_TIMEOUT_MS;
+    for (int i = 0; i < SUPERVISOR_TASK_COUNT; ++i) {
+        lastCheckIns[i] = tasks[i].checkIns;
+        silentMs[i] = 0;
+    }
+
+    Watchdog::get_instance().start(SUPERVISOR_WATCHDOG_TIMEOUT_MS);
+    checkTicker.attach(supervisorCheck,
+                       std::chrono::milliseconds(SUPERVISOR_CHECK_PERIOD_MS));
+}
+
+// Heartbeat of a task, from that task's own thread
+void supervisorCheckIn(supervisorTask_t task) {
+    supervisorTaskState_t* state = &tasks[task];
+    uint64_t nowMs = Kernel::get_ms_count();
+    if (state->lastCheckInMs != 0 && nowMs - state->lastCheckInMs > state->longestGapMs) {
+        state->longestGapMs = (uint32_t)(nowMs - state->lastCheckInMs);
+    }
+    state->lastCheckInMs = nowMs;
+    core_util_atomic_incr_u32(&state->checkIns, 1);
+}
+
+// Longest a task may go without checking in before the board resets, 0 to
+// stop watching it. Lengthen it before the task starts waiting longer.
+void supervisorTimeoutSet(supervisorTask_t task, uint32_t timeoutMs) {
+    core_util_atomic_store_u32(&tasks[task].timeoutMs, timeoutMs);
+}
+
+// Moves a periodic deadline on by one period, from the previous deadline
+// rather than from now so the rate does not drift. If that is already past,
+// it counts the periods missed as overruns, continues from the next period
+// boundary ahead and returns false.
+bool supervisorDeadlineNext(supervisorTask_t task, uint64_t* deadlineMs,
+                            uint32_t periodMs, uint64_t nowMs) {
+    *deadlineMs += periodMs;
+    if (*deadlineMs > nowMs) {
+        return true;
+    }
+    uint64_t missed = (nowMs - *deadlineMs) / periodMs + 1;
+    *deadlineMs += missed * periodMs;
+    core_util_atomic_incr_u32(&tasks[task].overruns, (uint32_t)missed);
+    return false;
+}
+
+// Sleeps until the next deadline of a fixed-rate loop
+void supervisorPeriodWait(supervisorTask_t task, uint64_t* deadlineMs,
+                          uint32_t periodMs) {
+    supervisorDeadlineNext(task, deadlineMs, periodMs, Kernel::get_ms_count());
+    ThisThread::sleep_until(Kernel::Clock::time_point(std::chrono::milliseconds(*deadlineMs)));
+}
+
+// True if this boot follows a watchdog reset
+bool supervisorWatchdogReset() {
+    return watchdogReset;
+}
+
+// "Sampler: timeout 314 ms, longest gap 33 ms, overruns 0" per task
+void supervisorReportWrite() {
+    pcSerialComStringWrite(watchdogReset ? "Last reset by the watchdog\r\n"
+                                         : "Last reset not by the watchdog\r\n");
+    for (int i = 0; i < SUPERVISOR_TASK_COUNT; ++i) {
+        char str[100] = "";
+        char* cursor = numberFormatAppendString(str, supervisorTaskNames[i]);
+        uint32_t timeoutMs = tasks[i].timeoutMs;
+        if (timeoutMs == 0) {
+            cursor = numberFormatAppendString(cursor, ": not watched");
+        } else {
+            cursor = numberFormatAppendString(cursor, ": timeout ");
+            cursor = numberFormatAppendUnsigned(cursor, timeoutMs);
+            cursor = numberFormatAppendString(cursor, " ms, longest gap ");
+            cursor = numberFormatAppendUnsigned(cursor, tasks[i].longestGapMs);
+            cursor = numberFormatAppendString(cursor, " ms");
+        }
+        cursor = numberFormatAppendString(cursor, ", overruns ");
+        cursor = numberFormatAppendUnsigned(cursor, tasks[i].overruns);
+        numberFormatAppendString(cursor, "\r\n");
+        pcSerialComStringWrite(str);
+    }
+}
+
+//=====[Implementations of private functions]==================================
+
+// Kicks the watchdog only while every watched task has checked in within its
+// timeout; otherwise the watchdog runs out and resets the board
+static void supervisorCheck() {
+    bool healthy = true;
+    for (int i = 0; i < SUPERVISOR_TASK_COUNT; ++i) {
+        uint32_t checkIns = tasks[i].checkIns;
+        if (checkIns != lastCheckIns[i]) {
+            lastCheckIns[i] = checkIns;
+            silentMs[i] = 0;
+        } else if (silentMs[i] < UINT32_MAX - SUPERVISOR_CHECK_PERIOD_MS) {
+            silentMs[i] += SUPERVISOR_CHECK_PERIOD_MS;
+        }
+        uint32_t timeoutMs = tasks[i].timeoutMs;
+        if (timeoutMs != 0 && silentMs[i] > timeoutMs) {
+            healthy = false;
+        }
+    }
+    if (healthy) {
+        Watchdog::get_instance().kick();
+    }
+}
@@ -0,0 +1,47 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _SUPERVISOR_H_
+#define _SUPERVISOR_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+//=====[Declaration of public defines]=========================================
+
+#define SUPERVISOR_WATCHDOG_TIMEOUT_MS  1000  // Independent watchdog reload
+#define SUPERVISOR_CHECK_PERIOD_MS      250   // Heartbeat checks and kicks
+
+// A watched task that stops checking in resets the board within its timeout
+// plus SUPERVISOR_CHECK_PERIOD_MS plus SUPERVISOR_WATCHDOG_TIMEOUT_MS
+#define SUPERVISOR_PIPELINE_SLACK_MS    250   // Sampler and alarm, over two
+                                              // snapshot periods
+#define SUPERVISOR_CONSOLE_TIMEOUT_MS   5000  // Covers a flash erase behind a
+                                              // command; dumps check in per frame
+
+//=====[Declaration of public data types]======================================
+
+typedef enum {
+    SUPERVISOR_TASK_SAMPLER,    // Checks in per half-buffer
+    SUPERVISOR_TASK_ALARM,      // Checks in per snapshot
+    SUPERVISOR_TASK_CONSOLE,    // Checks in per console cycle
+    SUPERVISOR_TASK_TELEMETRY,  // Deadlines only: waits up to a status period
+    SUPERVISOR_TASK_DATA_LOG,   // Deadlines only: flash erases take seconds
+    SUPERVISOR_TASK_COUNT,
+} supervisorTask_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void supervisorInit();
+void supervisorCheckIn(supervisorTask_t task);
+void supervisorTimeoutSet(supervisorTask_t task, uint32_t timeoutMs);
+bool supervisorDeadlineNext(supervisorTask_t task, uint64_t* deadlineMs,
+                            uint32_t periodMs, uint64_t nowMs);
+void supervisorPeriodWait(supervisorTask_t task, uint64_t* deadlineMs,
+                          uint32_t periodMs);
+bool supervisorWatchdogReset();
+void supervisorReportWrite();
+
+//=====[#include guards - end]=================================================
+
+#endif // _SUPERVISOR_H_
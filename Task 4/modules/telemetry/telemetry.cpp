@@ -0,0 +1,526 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "telemetry.h"
+#include "telemetry_frames.h"
+#include "alarm.h"
+#include "capture.h"
+#include "config.h"
+#include "data_log.h"
+#include "diagnostics.h"
+#include "frame_codec.h"
+#include "instrumentation.h"
+#include "memory_plan.h"
+#include "number_format.h"
+#include "pc_serial_com.h"
+#include "power.h"
+#include "sampler.h"
+#include "sensor_channels.h"
+#include "supervisor.h"
+#include "wall_clock.h"
+
+//=====[Declaration of private defines]========================================
+
+
+#define TELEMETRY_FRAME_CRC_SIZE    2
+
+#define TELEMETRY_DUMP_WAIT         10ms  // Polls for TX space during a dump
+
+// Status pace while a low-power mode samples at full rate, unless the
+// configured one is faster
+#define TELEMETRY_RAISED_PERIOD_MS  250
+
+#define TELEMETRY_SAMPLES_PAYLOAD   (SAMPLER_SCANS_PER_HALF * SENSOR_SCAN_CHANNEL_COUNT * \
+                                     sizeof(uint16_t))
+#define TELEMETRY_LOG_PAGE_PAYLOAD  (sizeof(telemetryFrameLogPage_t) + \
+                                     DATA_LOG_RECORDS_PER_PAGE * sizeof(dataLogRecord_t))
+
+// Header, payload and CRC of the largest frame, a SAMPLES or LOG_PAGE frame
+#define TELEMETRY_FRAME_SIZE_MAX    (sizeof(telemetryFrameHeader_t) + \
+                                     (TELEMETRY_SAMPLES_PAYLOAD > TELEMETRY_LOG_PAGE_PAYLOAD ? \
+                                      TELEMETRY_SAMPLES_PAYLOAD : TELEMETRY_LOG_PAGE_PAYLOAD) + \
+                                     TELEMETRY_FRAME_CRC_SIZE)
+
+//=====[Declaration and initialization of private global variables]============
+
+// Lowest application priority: formatting never delays sampling or alarms
+static Thread telemetryThread(osPriorityBelowNormal,
+                              memoryPlanStackSize(MEMORY_PLAN_STACK_TELEMETRY),
+                              memoryPlanStackMemory(MEMORY_PLAN_STACK_TELEMETRY),
+                              memoryPlanStackName(MEMORY_PLAN_STACK_TELEMETRY));
+
+static volatile telemetryFormat_t telemetryFormat = TELEMETRY_FORMAT_TEXT;
+
+// SAMPLES frames are built in the sampler thread, the others in the telemetry
+// thread, so each has its own buffers
+static uint8_t samplesFrame[TELEMETRY_FRAME_SIZE_MAX];
+static uint8_t samplesEncoded[FRAME_CODEC_ENCODED_SIZE(TELEMETRY_FRAME_SIZE_MAX)];
+static uint8_t eventFrame[TELEMETRY_FRAME_SIZE_MAX];
+static uint8_t eventEncoded[FRAME_CODEC_ENCODED_SIZE(TELEMETRY_FRAME_SIZE_MAX)];
+
+static uint32_t alarmEventSequence = 0;
+static uint32_t timeFrameSequence = 0;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void telemetryTask();
+static void telemetryAlarmEventPrint(const alarmEvent_t* event);
+static void telemetryRateEventPrint(const alarmEvent_t* event);
+static void telemetryStatusPrint();
+static void telemetryAlarmEventFrameSend(const alarmEvent_t* event);
+static void telemetryRateFrameSend(const alarmEvent_t* event);
+static void telemetryStatusFrameSend();
+static void telemetryTimeFrameSend();
+static void telemetryHealthFrameSend();
+static void telemetryRawBlockSend(const samplerRawBlock_t* block);
+static size_t telemetryFrameHeaderWrite(uint8_t* frame, telemetryFrameType_t type,
+                                        uint8_t count, uint32_t sequence,
+                                        uint32_t timestampUs);
+static void telemetryFrameSend(uint8_t* frame, size_t length, uint8_t* encoded);
+static void telemetryFrameSendPaced(uint8_t* frame, size_t length, uint8_t* encoded);
+
+//=====[Implementations of public functions]===================================
+
+void telemetryInit() {
+    telemetryThread.start(telemetryTask);
+    samplerRawBlockAttach(telemetryRawBlockSend);
+}
+
+// Binary mode streams every raw scan: about 6.5 kB/s of the 11.5 kB/s that
+// 115200 baud carries, so text output should stay quiet meanwhile
+void telemetryFormatSet(telemetryFormat_t format) {
+    telemetryFormat = format;
+}
+
+telemetryFormat_t telemetryFormatGet() {
+    return telemetryFormat;
+}
+
+// Sends the frozen capture as CAPTURE_INFO and CAPTURE_SAMPLES frames, then
+// rearms it. Waits for room in the TX buffer rather than dropping frames, so
+// it blocks the caller for the whole transfer (about 2 s for a full capture);
+// sampling and alarms run at higher priorities meanwhile.
+bool telemetryCaptureDump() {
+    captureInfo_t info;
+    if (!captureInfoGet(&info)) {
+        return false;
+    }
+
+    uint8_t frame[TELEMETRY_FRAME_SIZE_MAX];
+    uint8_t encoded[FRAME_CODEC_ENCODED_SIZE(TELEMETRY_FRAME_SIZE_MAX)];
+
+    size_t length = telemetryFrameHeaderWrite(frame, TELEMETRY_FRAME_CAPTURE_INFO, 1,
+                                              0, us_ticker_read());
+    telemetryFrameCaptureInfo_t payload = { info.scanCount, info.triggerIndex,
+                                            SAMPLER_SCAN_RATE_HZ, info.triggerTimeMs };
+    memcpy(&frame[length], &payload, sizeof(payload));
+    length += sizeof(payload);
+    telemetryFrameSendPaced(frame, length, encoded);
+
+    uint32_t index = 0;
+    while (index < info.scanCount) {
+        uint16_t scans[SAMPLER_SCANS_PER_HALF * SENSOR_SCAN_CHANNEL_COUNT];
+        uint32_t count = captureScansRead(index, SAMPLER_SCANS_PER_HALF, scans);
+        length = telemetryFrameHeaderWrite(frame, TELEMETRY_FRAME_CAPTURE_SAMPLES,
+                                           (uint8_t)count, index, us_ticker_read());
+        memcpy(&frame[length], scans, count * SENSOR_SCAN_CHANNEL_COUNT * sizeof(uint16_t));
+        length += count * SENSOR_SCAN_CHANNEL_COUNT * sizeof(uint16_t);
+        telemetryFrameSendPaced(frame, length, encoded);
+        index += count;
+    }
+
+    captureRearm();
+    return true;
+}
+
+// Flushes the data log and sends every valid page, oldest first, as LOG_PAGE
+// frames. Paced like the capture dump; a full log takes about 25 s at
+// 115200 baud. Returns the number of pages sent.
+uint32_t telemetryLogDump() {
+    dataLogFlush();
+
+    uint32_t first;
+    uint32_t last;
+    if (!dataLogSequenceRange(&first, &last)) {
+        return 0;
+    }
+
+    uint8_t frame[TELEMETRY_FRAME_SIZE_MAX];
+    uint8_t encoded[FRAME_CODEC_ENCODED_SIZE(TELEMETRY_FRAME_SIZE_MAX)];
+    dataLogPage_t page;
+    uint32_t pagesSent = 0;
+
+    for (uint32_t sequence = first; sequence - first <= last - first; ++sequence) {
+        if (!dataLogPageRead(sequence, &page)) {
+            continue;
+        }
+        size_t length = telemetryFrameHeaderWrite(frame, TELEMETRY_FRAME_LOG_PAGE,
+                                                  page.header.recordCount, sequence,
+                                                  us_ticker_read());
+        telemetryFrameLogPage_t payload = { page.header.bootId, 0 };
+        memcpy(&frame[length], &payload, sizeof(payload));
+        length += sizeof(payload);
+        memcpy(&frame[length], page.records,
+               page.header.recordCount * sizeof(dataLogRecord_t));
+        length += page.header.recordCount * sizeof(dataLogRecord_t);
+        telemetryFrameSendPaced(frame, length, encoded);
+        pagesSent++;
+    }
+    return pagesSent;
+}
+
+//=====[Implementations of private functions]==================================
+
+// Prints alarm state changes as they happen and all readings every period,
+// which may be reconfigured at run time. While a low-power mode samples at
+// full rate, readings stream at the raised pace, starting at the switch.
+static void telemetryTask() {
+    uint32_t printPeriodMs = TELEMETRY_PRINT_PERIOD_MS;
+    uint32_t configApplied = 0;
+    uint64_t nextPrintMs = Kernel::get_ms_count() + printPeriodMs;
+
+    while (true) {
+        uint64_t nowMs = Kernel::get_ms_count();
+        if (nowMs < nextPrintMs) {
+            alarmEvent_t event;
+            if (alarmEventGet(&event, nextPrintMs - nowMs)) {
+                if (telemetryFormat == TELEMETRY_FORMAT_BINARY) {
+                    telemetryAlarmEventFrameSend(&event);
+                } else {
+                    telemetryAlarmEventPrint(&event);
+                }
+                if (event.type == ALARM_EVENT_RATE_FULL) {
+                    nextPrintMs = Kernel::get_ms_count();
+                }
+            }
+            continue;
+        }
+
+        INSTRUMENTATION_BEGIN(INSTRUMENTATION_STAGE_STATUS);
+        if (telemetryFormat == TELEMETRY_FORMAT_BINARY) {
+            telemetryStatusFrameSend();
+            telemetryTimeFrameSend();
+            telemetryHealthFrameSend();
+        } else {
+            telemetryStatusPrint();
+        }
+        INSTRUMENTATION_END(INSTRUMENTATION_STAGE_STATUS);
+
+        if (configGeneration() != configApplied) {
+            configSettings_t settings;
+            configApplied = configGeneration();
+            configGet(&settings);
+            printPeriodMs = settings.statusPeriodMs;
+        }
+        uint32_t periodMs = printPeriodMs;
+        if (powerRateRaised() && periodMs > TELEMETRY_RAISED_PERIOD_MS) {
+            periodMs = TELEMETRY_RAISED_PERIOD_MS;
+        }
+        // A late report is not followed by a burst of catch-up ones
+        supervisorDeadlineNext(SUPERVISOR_TASK_TELEMETRY, &nextPrintMs, periodMs,
+                               Kernel::get_ms_count());
+    }
+}
+
+// Temperature messages name the channel; gas messages only do when there
+// are several gas heads
+static void telemetryAlarmEventPrint(const alarmEvent_t* event) {
+    char str[80] = "";
+    char* cursor = str;
+    if (event->channel >= SENSOR_CHANNEL_COUNT) {
+        return;
+    }
+    if (event->type == ALARM_EVENT_RATE_FULL || event->type == ALARM_EVENT_RATE_REDUCED) {
+        telemetryRateEventPrint(event);
+        return;
+    }
+    const sensorChannelDescriptor_t* channel = &sensorChannels[event->channel];
+    configSettings_t settings;
+    configGet(&settings);
+    int32_t threshold = settings.channels[event->channel].tripThreshold;
+
+    const char* gasHead = "";
+    const char* gasHeadEnd = "";
+    if (sensorKindChannelCount(SENSOR_KIND_GAS) > 1) {
+        gasHead = channel->name;
+        gasHeadEnd = ": ";
+    }
+
+    switch (event->type) {
+    case ALARM_EVENT_GAS_DETECTED:
+        cursor = numberFormatAppendString(cursor, gasHead);
+        cursor = numberFormatAppendString(cursor, gasHeadEnd);
+        numberFormatAppendString(cursor, "Gas detected!\r\n");
+        break;
+    case ALARM_EVENT_GAS_CLEARED:
+        cursor = numberFormatAppendString(cursor, gasHead);
+        cursor = numberFormatAppendString(cursor, gasHeadEnd);
+        numberFormatAppendString(cursor, "Gas no longer detected.\r\n");
+        break;
+    case ALARM_EVENT_TEMP_EXCEEDED:
+        cursor = numberFormatAppendString(cursor, "ALERT: ");
+        cursor = numberFormatAppendString(cursor, channel->name);
+        cursor = numberFormatAppendString(cursor, " temperature exceeds ");
+        cursor = numberFormatAppendHundredths(cursor, threshold);
+        numberFormatAppendString(cursor, "°C!\r\n");
+        break;
+    case ALARM_EVENT_TEMP_RISING_FAST:
+        cursor = numberFormatAppendString(cursor, "ALERT: ");
+        cursor = numberFormatAppendString(cursor, channel->name);
+        cursor = numberFormatAppendString(cursor, " temperature rising faster than ");
+        cursor = numberFormatAppendHundredths(cursor,
+                                              settings.channels[event->channel].rateTrip);
+        numberFormatAppendString(cursor, "°C/s!\r\n");
+        break;
+    case ALARM_EVENT_TEMP_CLEARED:
+        cursor = numberFormatAppendString(cursor, channel->name);
+        cursor = numberFormatAppendString(cursor, " temperature below ");
+        cursor = numberFormatAppendHundredths(cursor, threshold);
+        numberFormatAppendString(cursor, "°C.\r\n");
+        break;
+    case ALARM_EVENT_GAS_PRE_ALARM:
+        cursor = numberFormatAppendString(cursor, "Warning: ");
+        cursor = numberFormatAppendString(cursor, gasHead);
+        cursor = numberFormatAppendString(cursor, gasHeadEnd);
+        numberFormatAppendString(cursor, "gas level rising towards the alarm.\r\n");
+        break;
+    case ALARM_EVENT_GAS_PRE_ALARM_CLEARED:
+        cursor = numberFormatAppendString(cursor, gasHead);
+        cursor = numberFormatAppendString(cursor, gasHeadEnd);
+        numberFormatAppendString(cursor, "Gas level no longer rising.\r\n");
+        break;
+    case ALARM_EVENT_TEMP_PRE_ALARM:
+        cursor = numberFormatAppendString(cursor, "Warning: ");
+        cursor = numberFormatAppendString(cursor, channel->name);
+        cursor = numberFormatAppendString(cursor, " temperature rising towards ");
+        cursor = numberFormatAppendHundredths(cursor, threshold);
+        numberFormatAppendString(cursor, "°C.\r\n");
+        break;
+    case ALARM_EVENT_TEMP_PRE_ALARM_CLEARED:
+        cursor = numberFormatAppendString(cursor, channel->name);
+        numberFormatAppendString(cursor, " temperature no longer rising.\r\n");
+        break;
+    default:
+        return;
+    }
+    pcSerialComStringWrite(str);
+}
+
+// "Sampling at full rate: LM35 near its threshold", or "Sampling in bursts
+// every 1000 ms: readings quiet"
+static void telemetryRateEventPrint(const alarmEvent_t* event) {
+    char str[80] = "";
+    char* cursor = str;
+    if (event->type == ALARM_EVENT_RATE_FULL) {
+        cursor = numberFormatAppendString(cursor, "Sampling at full rate");
+    } else {
+        cursor = numberFormatAppendString(cursor, "Sampling in bursts every ");
+        cursor = numberFormatAppendUnsigned(cursor, samplerSnapshotPeriodMs());
+        cursor = numberFormatAppendString(cursor, " ms");
+    }
+
+    const char* name = sensorChannels[event->channel].name;
+    switch (event->reason) {
+    case ALARM_RATE_REASON_QUIET:
+        cursor = numberFormatAppendString(cursor, ": readings quiet");
+        break;
+    case ALARM_RATE_REASON_NEAR:
+        cursor = numberFormatAppendString(cursor, ": ");
+        cursor = numberFormatAppendString(cursor, name);
+        cursor = numberFormatAppendString(cursor, " near its threshold");
+        break;
+    case ALARM_RATE_REASON_CHANGING:
+        cursor = numberFormatAppendString(cursor, ": ");
+        cursor = numberFormatAppendString(cursor, name);
+        cursor = numberFormatAppendString(cursor, " changing quickly");
+        break;
+    case ALARM_RATE_REASON_ALARM:
+        cursor = numberFormatAppendString(cursor, ": ");
+        cursor = numberFormatAppendString(cursor, name);
+        cursor = numberFormatAppendString(cursor, " alarm pending");
+        break;
+    default:
+        break;
+    }
+    numberFormatAppendString(cursor, "\r\n");
+    pcSerialComStringWrite(str);
+}
+
+// Print all sensor readings and the active alarm source(s)
+static void telemetryStatusPrint() {
+    char str[40 + SENSOR_CHANNEL_COUNT * 24] = "";
+    char* cursor = str;
+
+    samplerSnapshot_t snapshot;
+    samplerSnapshotRead(&snapshot);
+
+    // "Gas: 0.12, LM35: 23.40 C, Potentiometer: 0.50", from the channel table
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; ++i) {
+        if (i > 0) {
+            cursor = numberFormatAppendString(cursor, ", ");
+        }
+        cursor = numberFormatAppendString(cursor, sensorChannels[i].name);
+        cursor = numberFormatAppendString(cursor, ": ");
+        cursor = numberFormatAppendHundredths(cursor,
+            sensorChannelValue((sensorChannel_t)i, snapshot.average[i]));
+        if (sensorChannels[i].unit[0] != '\0') {
+            cursor = numberFormatAppendString(cursor, " ");
+            cursor = numberFormatAppendString(cursor, sensorChannels[i].unit);
+        }
+    }
+    numberFormatAppendString(cursor, "\r\n");
+    pcSerialComStringWrite(str);
+
+    if (alarmGasDetected()) {
+        pcSerialComRepeatedLineWrite("Gas Alarm\r\n");
+    }
+    if (alarmTempExceeded()) {
+        pcSerialComRepeatedLineWrite("Temperature Alarm\r\n");
+    }
+
+    // "Sensor fault: LM35 rail low" while the diagnostics flag one
+    if (diagnosticsFaultActive()) {
+        diagnosticsHealth_t health;
+        diagnosticsHealthGet(&health);
+        for (int i = 0; i < SENSOR_CHANNEL_COUNT; ++i) {
+            uint8_t faults = health.flags[i] & FAULT_DETECT_FAULTS;
+            if (faults != 0) {
+                str[0] = '\0';
+                cursor = numberFormatAppendString(str, "Sensor fault: ");
+                cursor = numberFormatAppendString(cursor, sensorChannels[i].name);
+                cursor = numberFormatAppendString(cursor, " ");
+                cursor = diagnosticsFlagsAppend(cursor, faults);
+                numberFormatAppendString(cursor, "\r\n");
+                pcSerialComRepeatedLineWrite(str);
+            }
+        }
+    }
+}
+
+static void telemetryAlarmEventFrameSend(const alarmEvent_t* event) {
+    if (event->type == ALARM_EVENT_RATE_FULL || event->type == ALARM_EVENT_RATE_REDUCED) {
+        telemetryRateFrameSend(event);
+        return;
+    }
+    size_t length = telemetryFrameHeaderWrite(eventFrame, TELEMETRY_FRAME_ALARM_EVENT,
+                                              1, alarmEventSequence++,
+                                              us_ticker_read());
+    telemetryFrameAlarmEvent_t payload = { (uint8_t)event->type, event->channel,
+                                           { 0, 0 } };
+    memcpy(&eventFrame[length], &payload, sizeof(payload));
+    length += sizeof(payload);
+    telemetryFrameSend(eventFrame, length, eventEncoded);
+}
+
+static void telemetryRateFrameSend(const alarmEvent_t* event) {
+    size_t length = telemetryFrameHeaderWrite(eventFrame, TELEMETRY_FRAME_RATE, 1,
+                                              alarmEventSequence++, us_ticker_read());
+    telemetryFrameRate_t payload = {
+        (uint8_t)(event->type == ALARM_EVENT_RATE_FULL ? SAMPLER_MODE_CONTINUOUS
+                                                       : SAMPLER_MODE_BURST),
+        event->reason, event->channel, 0 };
+    memcpy(&eventFrame[length], &payload, sizeof(payload));
+    length += sizeof(payload);
+    telemetryFrameSend(eventFrame, length, eventEncoded);
+}
+
+static void telemetryStatusFrameSend() {
+    samplerSnapshot_t snapshot;
+    samplerSnapshotRead(&snapshot);
+
+    size_t length = telemetryFrameHeaderWrite(eventFrame, TELEMETRY_FRAME_STATUS, 1,
+                                              snapshot.sequence, us_ticker_read());
+    telemetryFrameStatus_t status = { 0, 0 };
+    if (alarmGasDetected()) {
+        status.alarms |= 1U << 0;
+    }
+    if (alarmTempExceeded()) {
+        status.alarms |= 1U << 1;
+    }
+    if (alarmPreAlarmActive()) {
+        status.alarms |= 1U << 2;
+    }
+    if (diagnosticsFaultActive()) {
+        status.alarms |= 1U << 3;
+    }
+    memcpy(&eventFrame[length], &status, sizeof(status));
+    length += sizeof(status);
+    memcpy(&eventFrame[length], snapshot.average, sizeof(snapshot.average));
+    length += sizeof(snapshot.average);
+    telemetryFrameSend(eventFrame, length, eventEncoded);
+}
+
+// Lets the host put wall-clock times on the header timestamps
+static void telemetryTimeFrameSend() {
+    wallClockState_t state;
+    wallClockGet(&state);
+
+    uint64_t localUs = wallClockLocalUs();
+    size_t length = telemetryFrameHeaderWrite(eventFrame, TELEMETRY_FRAME_TIME, 1,
+                                              timeFrameSequence++, (uint32_t)localUs);
+    telemetryFrameTime_t payload = { state.mapping.localUs, state.mapping.wallUs,
+                                     state.mapping.driftPpb, (uint8_t)state.source,
+                                     { 0, 0, 0 } };
+    memcpy(&eventFrame[length], &payload, sizeof(payload));
+    length += sizeof(payload);
+    telemetryFrameSend(eventFrame, length, eventEncoded);
+}
+
+static void telemetryHealthFrameSend() {
+    diagnosticsHealth_t health;
+    diagnosticsHealthGet(&health);
+
+    size_t length = telemetryFrameHeaderWrite(eventFrame, TELEMETRY_FRAME_HEALTH, 1,
+                                              health.sequence, us_ticker_read());
+    memcpy(&eventFrame[length], health.flags, sizeof(health.flags));
+    length += sizeof(health.flags);
+    telemetryFrameSend(eventFrame, length, eventEncoded);
+}
+
+// Runs in the sampler thread for every half-buffer
+static void telemetryRawBlockSend(const samplerRawBlock_t* block) {
+    if (telemetryFormat != TELEMETRY_FORMAT_BINARY) {
+        return;
+    }
+
+    size_t length = telemetryFrameHeaderWrite(samplesFrame, TELEMETRY_FRAME_SAMPLES,
+                                              (uint8_t)block->scanCount,
+                                              block->sequence, block->timestampUs);
+    size_t samplesSize = block->scanCount * SENSOR_SCAN_CHANNEL_COUNT * sizeof(uint16_t);
+    memcpy(&samplesFrame[length], block->samples, samplesSize);
+    length += samplesSize;
+    telemetryFrameSend(samplesFrame, length, samplesEncoded);
+}
+
+static size_t telemetryFrameHeaderWrite(uint8_t* frame, telemetryFrameType_t type,
+                                        uint8_t count, uint32_t sequence,
+                                        uint32_t timestampUs) {
+    telemetryFrameHeader_t header;
+    header.type = (uint8_t)type;
+    header.version = TELEMETRY_FRAME_VERSION;
+    header.channelCount = telemetryFrameChannelCount(type);
+    header.count = count;
+    header.sequence = sequence;
+    header.timestampUs = timestampUs;
+    memcpy(frame, &header, sizeof(header));
+    return sizeof(header);
+}
+
+// Appends the CRC, encodes and queues a frame; frame needs room for the CRC
+static void telemetryFrameSend(uint8_t* frame, size_t length, uint8_t* encoded) {
+    uint16_t crc = frameCodecCrc16(FRAME_CODEC_CRC16_INIT, frame, length);
+    frame[length++] = (uint8_t)(crc & 0xFF);
+    frame[length++] = (uint8_t)(crc >> 8);
+    pcSerialComFrameWrite(encoded, frameCodecEncode(frame, length, encoded));
+}
+
+// Dumps run from console commands, so the console checks in as they progress
+static void telemetryFrameSendPaced(uint8_t* frame, size_t length, uint8_t* encoded) {
+    while (pcSerialComTxSpace() < FRAME_CODEC_ENCODED_SIZE(length + TELEMETRY_FRAME_CRC_SIZE)) {
+        ThisThread::sleep_for(TELEMETRY_DUMP_WAIT);
+    }
+    supervisorCheckIn(SUPERVISOR_TASK_CONSOLE);
+    telemetryFrameSend(frame, length, encoded);
+}
@@ -0,0 +1,32 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+//=====[Declaration of public defines]=========================================
+
+#define TELEMETRY_PRINT_PERIOD_MS   1000  // Default, see config.h
+
+//=====[Declaration of public data types]======================================
+
+typedef enum {
+    TELEMETRY_FORMAT_TEXT,    // Status lines and alarm messages
+    TELEMETRY_FORMAT_BINARY,  // Framed raw samples, status and alarm events
+                              // (see telemetry_frames.h)
+} telemetryFormat_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void telemetryInit();
+void telemetryFormatSet(telemetryFormat_t format);
+telemetryFormat_t telemetryFormatGet();
+bool telemetryCaptureDump();
+uint32_t telemetryLogDump();
+
+//=====[#include guards - end]=================================================
+
+#endif // _TELEMETRY_H_
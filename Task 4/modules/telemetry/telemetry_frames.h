@@ -0,0 +1,174 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _TELEMETRY_FRAMES_H_
+#define _TELEMETRY_FRAMES_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+#include "sensor_channels.h"
+
+//=====[Declaration of public defines]=========================================
+
+#define TELEMETRY_FRAME_VERSION     1
+
+//=====[Declaration of public data types]======================================
+
+// Binary telemetry, shared with host collectors. Each frame is a header and
+// a payload followed by their CRC-16/CCITT-FALSE, all little-endian, then
+// COBS-encoded and terminated by a zero byte (see frame_codec.h). Over UDP
+// each datagram carries one frame as is, without COBS, and a SAMPLES frame
+// batches several consecutive blocks (see net_telemetry.h).
+typedef enum {
+    TELEMETRY_FRAME_SAMPLES = 1,     // Raw readings of one DMA half-buffer
+    TELEMETRY_FRAME_STATUS = 2,      // Filtered snapshot and alarm states
+    TELEMETRY_FRAME_ALARM_EVENT = 3, // One alarm state change
+    TELEMETRY_FRAME_CAPTURE_INFO = 4,    // Starts a capture dump
+    TELEMETRY_FRAME_CAPTURE_SAMPLES = 5, // Raw readings of a capture dump
+    TELEMETRY_FRAME_LOG_PAGE = 6,    // One page of the flash data log
+    TELEMETRY_FRAME_TIME = 7,        // Board clock to wall clock mapping
+    TELEMETRY_FRAME_TIME_REQUEST = 8,    // Clock exchange, board to collector
+    TELEMETRY_FRAME_TIME_RESPONSE = 9,   // Clock exchange, collector to board
+    TELEMETRY_FRAME_HEALTH = 10,     // Sensor diagnostics flags
+    TELEMETRY_FRAME_UPDATE = 11,     // Firmware update step, collector to board
+    TELEMETRY_FRAME_UPDATE_STATUS = 12,  // Its outcome, board to collector
+    TELEMETRY_FRAME_RATE = 13,       // Sampler switched between full rate and bursts
+} telemetryFrameType_t;
+
+typedef struct {
+    uint8_t type;
+    uint8_t version;
+    uint8_t channelCount;   // See telemetryFrameChannelCount()
+    uint8_t count;          // Scans in a SAMPLES frame, records in a
+                            // LOG_PAGE frame, 1 otherwise
+    uint32_t sequence;      // Sampler block (the first, if batched) for
+                            // SAMPLES and STATUS, checked
+                            // snapshot for HEALTH, event
+                            // counter for ALARM_EVENT and RATE, index of the first
+                            // scan for CAPTURE_SAMPLES, page sequence for
+                            // LOG_PAGE, step counter of the collector for
+                            // UPDATE and UPDATE_STATUS; gaps mean lost frames
+    uint32_t timestampUs;   // Board clock, the low 32 bits of the microsecond
+                            // count TIME frames map to the wall clock
+} telemetryFrameHeader_t;
+
+// SAMPLES payload: uint16_t reading[count][channelCount], read_u16() scale
+
+// STATUS payload
+typedef struct {
+    uint8_t alarms;         // Bit 0 gas detected, bit 1 temperature exceeded,
+                            // bit 2 some pre-alarm active, bit 3 some sensor
+                            // fault (see HEALTH)
+    uint8_t reserved;
+    // Followed by uint16_t average[channelCount]
+} telemetryFrameStatus_t;
+
+// ALARM_EVENT payload
+typedef struct {
+    uint8_t eventType;      // alarmEventType_t
+    uint8_t channel;        // Channel table index of the alarm
+    uint8_t reserved[2];
+} telemetryFrameAlarmEvent_t;
+
+// CAPTURE_INFO payload, followed by CAPTURE_SAMPLES frames laid out like
+// SAMPLES frames until scanCount scans have been sent
+typedef struct {
+    uint32_t scanCount;
+    uint32_t triggerIndex;  // First scan after the alarm tripped
+    uint32_t scanRateHz;
+    uint32_t triggerTimeMs; // Board uptime at the trigger
+} telemetryFrameCaptureInfo_t;
+
+// LOG_PAGE payload, followed by count dataLogRecord_t (see data_log.h)
+typedef struct {
+    uint16_t bootId;        // Boot the records' uptimes count from
+    uint16_t reserved;
+} telemetryFrameLogPage_t;
+
+// TIME payload, with every STATUS frame and after each clock exchange. The
+// wall clock at a header timestamp t is wallUs + d + d * driftPpb / 10^9,
+// where d is t less the low 32 bits of localUs as a signed 32-bit number.
+typedef struct {
+    uint64_t localUs;       // Board clock, 64 bits
+    int64_t wallUs;         // Unix microseconds at localUs
+    int32_t driftPpb;       // Wall clock gain per board clock second
+    uint8_t source;         // 0 not set, 1 RTC or console, 2 clock exchanges
+    uint8_t reserved[3];
+} telemetryFrameTime_t;
+
+// TIME_REQUEST payload. The collector answers at once with a TIME_RESPONSE
+// datagram of the same header sequence, stamping its wall clock on arrival
+// and just before sending.
+typedef struct {
+    uint64_t requestLocalUs;    // Board clock as the request left
+} telemetryFrameTimeRequest_t;
+
+// TIME_RESPONSE payload
+typedef struct {
+    uint64_t requestLocalUs;    // Copied from the request
+    int64_t receiveWallUs;      // Unix microseconds
+    int64_t transmitWallUs;
+} telemetryFrameTimeResponse_t;
+
+// HEALTH payload, with every STATUS frame and every clock exchange:
+// uint8_t flags[channelCount], FAULT_DETECT_* bits (see fault_detect.h)
+
+// UPDATE payload, over UDP only. The board answers every one with an
+// UPDATE_STATUS datagram of the same header sequence; the collector sends
+// the next step once it has the answer, and repeats a step without one.
+typedef struct {
+    uint8_t step;           // 0 begin, 1 data, 2 finish, 3 apply, 4 status only
+    uint8_t reserved;
+    uint16_t length;        // Data bytes following this payload, data only
+    uint32_t offset;        // Image offset of the data, data only
+    uint32_t imageSize;     // Begin only, like the two below
+    uint32_t imageCrc32;    // zlib CRC-32 of the image
+    uint32_t version;
+} telemetryFrameUpdate_t;
+
+// UPDATE_STATUS payload
+typedef struct {
+    uint8_t state;          // firmwareUpdateState_t (see firmware_update.h)
+    uint8_t error;          // firmwareUpdateError_t of this step, or of the
+                            // last failure for a status-only step
+    uint16_t reserved;
+    uint32_t nextOffset;    // Image bytes accepted so far; data resumes here
+    uint32_t imageSize;
+} telemetryFrameUpdateStatus_t;
+
+// RATE payload, sent once the first snapshot at the new rate is in. Full
+// rate is a snapshot every SAMPLER_SNAPSHOT_PERIOD_MS; bursts come once per
+// burst period (see config.h).
+typedef struct {
+    uint8_t mode;           // samplerMode_t, 0 continuous, 1 burst
+    uint8_t reason;         // alarmRateReason_t (see alarm.h)
+    uint8_t channel;        // Channel table index behind a near, changing or
+                            // alarm reason, 0 otherwise
+    uint8_t reserved;
+} telemetryFrameRate_t;
+
+static_assert(sizeof(telemetryFrameHeader_t) == 12, "Header must not be padded");
+static_assert(sizeof(telemetryFrameStatus_t) == 2, "Status must not be padded");
+static_assert(sizeof(telemetryFrameAlarmEvent_t) == 4, "Event must not be padded");
+static_assert(sizeof(telemetryFrameCaptureInfo_t) == 16, "Info must not be padded");
+static_assert(sizeof(telemetryFrameLogPage_t) == 4, "Log page must not be padded");
+static_assert(sizeof(telemetryFrameTime_t) == 24, "Time must not be padded");
+static_assert(sizeof(telemetryFrameTimeRequest_t) == 8, "Request must not be padded");
+static_assert(sizeof(telemetryFrameTimeResponse_t) == 24, "Response must not be padded");
+static_assert(sizeof(telemetryFrameUpdate_t) == 20, "Update must not be padded");
+static_assert(sizeof(telemetryFrameUpdateStatus_t) == 12, "Update status must not be padded");
+static_assert(sizeof(telemetryFrameRate_t) == 4, "Rate must not be padded");
+
+//=====[Implementations of public functions]===================================
+
+// Raw scans (SAMPLES, CAPTURE_SAMPLES) hold the ADC3 scan channels; every
+// other frame counts all channels of the table, SPI ADC ones included
+inline uint8_t telemetryFrameChannelCount(telemetryFrameType_t type) {
+    return (type == TELEMETRY_FRAME_SAMPLES || type == TELEMETRY_FRAME_CAPTURE_SAMPLES)
+           ? SENSOR_SCAN_CHANNEL_COUNT : SENSOR_CHANNEL_COUNT;
+}
+
+//=====[#include guards - end]=================================================
+
+#endif // _TELEMETRY_FRAMES_H_
@@ -0,0 +1,170 @@
+//=====[Libraries]=============================================================
+
+#include "time_sync.h"
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static const timeSyncSample_t* timeSyncBestSample(const timeSyncState_t* state);
+static void timeSyncRestart(timeSyncState_t* state, const timeSyncSample_t* sample);
+static void timeSyncDriftUpdate(timeSyncState_t* state);
+
+//=====[Implementations of public functions]===================================
+
+void timeSyncInit(timeSyncState_t* state) {
+    state->sampleCount = 0;
+    state->nextSample = 0;
+    state->reference = { 0, 0, UINT32_MAX };
+    state->driftAnchor = state->reference;
+    state->driftPpb = 0;
+    state->valid = false;
+    state->synced = false;
+    state->driftValid = false;
+    state->exchanges = 0;
+    state->rejected = 0;
+    state->steps = 0;
+}
+
+// Maps localUs to wallUs until exchanges improve on it, such as from the RTC
+// at boot or a time typed at the console; keeps the drift
+void timeSyncSet(timeSyncState_t* state, uint64_t localUs, int64_t wallUs) {
+    timeSyncSample_t sample = { localUs, wallUs - (int64_t)localUs, UINT32_MAX };
+    timeSyncRestart(state, &sample);
+    state->sampleCount = 0;
+    state->synced = false;
+}
+
+// A drift kept from an earlier run; exchanges refine it
+void timeSyncDriftSet(timeSyncState_t* state, int32_t driftPpb) {
+    if (driftPpb >= -TIME_SYNC_DRIFT_MAX_PPB && driftPpb <= TIME_SYNC_DRIFT_MAX_PPB) {
+        state->driftPpb = driftPpb;
+        state->driftValid = true;
+    }
+}
+
+// Adds an exchange. Errors within TIME_SYNC_STEP_US move the mapping to the
+// best recent exchange and refine the drift; larger ones, after a missed
+// deep sleep or a host clock jump, start over from this exchange.
+timeSyncResult_t timeSyncExchangeAdd(timeSyncState_t* state,
+                                     const timeSyncExchange_t* exchange) {
+    if (exchange->responseLocalUs < exchange->requestLocalUs ||
+        exchange->transmitWallUs < exchange->receiveWallUs) {
+        state->rejected++;
+        return TIME_SYNC_REJECTED;
+    }
+    uint64_t roundTripUs = exchange->responseLocalUs - exchange->requestLocalUs;
+    uint64_t turnaroundUs = (uint64_t)(exchange->transmitWallUs - exchange->receiveWallUs);
+    if (turnaroundUs > roundTripUs || roundTripUs - turnaroundUs > TIME_SYNC_DELAY_MAX_US) {
+        state->rejected++;
+        return TIME_SYNC_REJECTED;
+    }
+
+    // Assumes equal delays both ways; the shortest round trip bounds the
+    // error of that assumption best
+    timeSyncSample_t sample;
+    sample.localUs = exchange->requestLocalUs + roundTripUs / 2;
+    sample.offsetUs = ((exchange->receiveWallUs - (int64_t)exchange->requestLocalUs) +
+                       (exchange->transmitWallUs - (int64_t)exchange->responseLocalUs)) / 2;
+    sample.delayUs = (uint32_t)(roundTripUs - turnaroundUs);
+    state->exchanges++;
+
+    if (!state->synced) {
+        bool wasValid = state->valid;
+        int64_t errorUs = wasValid ? timeSyncWallUs(state, sample.localUs) -
+                                     ((int64_t)sample.localUs + sample.offsetUs) : 0;
+        timeSyncRestart(state, &sample);
+        if (wasValid && (errorUs > TIME_SYNC_STEP_US || errorUs < -TIME_SYNC_STEP_US)) {
+            state->steps++;
+            return TIME_SYNC_STEPPED;
+        }
+        return TIME_SYNC_ACCEPTED;
+    }
+
+    int64_t errorUs = timeSyncWallUs(state, sample.localUs) -
+                      ((int64_t)sample.localUs + sample.offsetUs);
+    if (errorUs > TIME_SYNC_STEP_US || errorUs < -TIME_SYNC_STEP_US) {
+        timeSyncRestart(state, &sample);
+        state->steps++;
+        return TIME_SYNC_STEPPED;
+    }
+
+    state->samples[state->nextSample] = sample;
+    state->nextSample = (state->nextSample + 1) % TIME_SYNC_SAMPLES;
+    if (state->sampleCount < TIME_SYNC_SAMPLES) {
+        state->sampleCount++;
+    }
+    state->reference = *timeSyncBestSample(state);
+    timeSyncDriftUpdate(state);
+    return TIME_SYNC_ACCEPTED;
+}
+
+// Wall clock (Unix microseconds) at a board clock reading, extrapolated from
+// the reference with the drift
+int64_t timeSyncWallUs(const timeSyncState_t* state, uint64_t localUs) {
+    timeSyncMapping_t mapping;
+    timeSyncMappingGet(state, &mapping);
+    return timeSyncMappingWallUs(&mapping, localUs);
+}
+
+void timeSyncMappingGet(const timeSyncState_t* state, timeSyncMapping_t* mapping) {
+    mapping->localUs = state->reference.localUs;
+    mapping->wallUs = (int64_t)state->reference.localUs + state->reference.offsetUs;
+    mapping->driftPpb = state->driftPpb;
+}
+
+// Works either side of the mapping's reading; the drift term is computed in
+// milliseconds so it cannot overflow for centuries
+int64_t timeSyncMappingWallUs(const timeSyncMapping_t* mapping, uint64_t localUs) {
+    int64_t sinceUs = (int64_t)(localUs - mapping->localUs);
+    return mapping->wallUs + sinceUs + sinceUs / 1000 * mapping->driftPpb / 1000000;
+}
+
+//=====[Implementations of private functions]==================================
+
+// Shortest round trip; the newest of equals, so the reference never goes
+// back past the drift anchor
+static const timeSyncSample_t* timeSyncBestSample(const timeSyncState_t* state) {
+    const timeSyncSample_t* best = &state->samples[0];
+    for (uint32_t i = 1; i < state->sampleCount; ++i) {
+        const timeSyncSample_t* sample = &state->samples[i];
+        if (sample->delayUs < best->delayUs ||
+            (sample->delayUs == best->delayUs && sample->localUs > best->localUs)) {
+            best = sample;
+        }
+    }
+    return best;
+}
+
+static void timeSyncRestart(timeSyncState_t* state, const timeSyncSample_t* sample) {
+    state->samples[0] = *sample;
+    state->sampleCount = 1;
+    state->nextSample = 1;
+    state->reference = *sample;
+    state->driftAnchor = *sample;
+    state->valid = true;
+    state->synced = true;
+}
+
+// Offset change over at least TIME_SYNC_DRIFT_SPAN_US between references,
+// smoothed, as the crystal only wanders slowly with temperature
+static void timeSyncDriftUpdate(timeSyncState_t* state) {
+    const timeSyncSample_t* reference = &state->reference;
+    const timeSyncSample_t* anchor = &state->driftAnchor;
+    if (reference->localUs < anchor->localUs + TIME_SYNC_DRIFT_SPAN_US) {
+        return;
+    }
+
+    int64_t spanUs = (int64_t)(reference->localUs - anchor->localUs);
+    int64_t measuredPpb = (reference->offsetUs - anchor->offsetUs) * 1000000000LL / spanUs;
+    if (state->driftValid) {
+        measuredPpb = state->driftPpb +
+                      (measuredPpb - state->driftPpb) / TIME_SYNC_DRIFT_SMOOTHING;
+    }
+    if (measuredPpb > TIME_SYNC_DRIFT_MAX_PPB) {
+        measuredPpb = TIME_SYNC_DRIFT_MAX_PPB;
+    } else if (measuredPpb < -TIME_SYNC_DRIFT_MAX_PPB) {
+        measuredPpb = -TIME_SYNC_DRIFT_MAX_PPB;
+    }
+    state->driftPpb = (int32_t)measuredPpb;
+    state->driftValid = true;
+    state->driftAnchor = *reference;
+}
@@ -0,0 +1,82 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _TIME_SYNC_H_
+#define _TIME_SYNC_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+//=====[Declaration of public defines]=========================================
+
+#define TIME_SYNC_SAMPLES           8         // Exchanges the best is picked from
+#define TIME_SYNC_DELAY_MAX_US      100000    // Longer round trips are discarded
+#define TIME_SYNC_STEP_US           128000    // Larger errors restart the estimate
+#define TIME_SYNC_DRIFT_SPAN_US     300000000 // Least time a drift estimate spans
+#define TIME_SYNC_DRIFT_MAX_PPB     500000    // Far beyond any crystal
+#define TIME_SYNC_DRIFT_SMOOTHING   4         // New drift estimates weigh 1/4
+
+//=====[Declaration of public data types]======================================
+
+// One NTP-like exchange: the board stamps its request and the response on
+// its own microsecond clock, the host both ends of its turnaround on the wall
+// clock (Unix microseconds)
+typedef struct {
+    uint64_t requestLocalUs;    // t1
+    int64_t receiveWallUs;      // t2
+    int64_t transmitWallUs;     // t3
+    uint64_t responseLocalUs;   // t4
+} timeSyncExchange_t;
+
+typedef struct {
+    uint64_t localUs;           // Midpoint of the exchange on the board clock
+    int64_t offsetUs;           // Wall clock minus board clock there
+    uint32_t delayUs;           // Round trip less the host's turnaround
+} timeSyncSample_t;
+
+// Maps the board clock to the wall clock from the exchange with the shortest
+// round trip among the latest ones, which has the least queueing error, and
+// the board clock's drift measured between such exchanges
+typedef struct {
+    timeSyncSample_t samples[TIME_SYNC_SAMPLES];
+    uint32_t sampleCount;
+    uint32_t nextSample;
+    timeSyncSample_t reference;     // Origin of the mapping
+    timeSyncSample_t driftAnchor;   // Earlier reference the drift spans from
+    int32_t driftPpb;               // Wall clock gain per board clock second
+    bool valid;                     // The mapping can be used
+    bool synced;                    // It comes from exchanges, not a rough set
+    bool driftValid;
+    uint32_t exchanges;             // Accepted
+    uint32_t rejected;              // Inconsistent or too slow
+    uint32_t steps;                 // Restarts after a large error
+} timeSyncState_t;
+
+// Wall clock at one board clock reading, and how fast it runs against it;
+// small enough to publish to other threads
+typedef struct {
+    uint64_t localUs;
+    int64_t wallUs;
+    int32_t driftPpb;
+} timeSyncMapping_t;
+
+typedef enum {
+    TIME_SYNC_REJECTED,
+    TIME_SYNC_ACCEPTED,
+    TIME_SYNC_STEPPED,          // Accepted, and the mapping jumped
+} timeSyncResult_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void timeSyncInit(timeSyncState_t* state);
+void timeSyncSet(timeSyncState_t* state, uint64_t localUs, int64_t wallUs);
+void timeSyncDriftSet(timeSyncState_t* state, int32_t driftPpb);
+timeSyncResult_t timeSyncExchangeAdd(timeSyncState_t* state,
+                                     const timeSyncExchange_t* exchange);
+int64_t timeSyncWallUs(const timeSyncState_t* state, uint64_t localUs);
+void timeSyncMappingGet(const timeSyncState_t* state, timeSyncMapping_t* mapping);
+int64_t timeSyncMappingWallUs(const timeSyncMapping_t* mapping, uint64_t localUs);
+
+//=====[#include guards - end]=================================================
+
+#endif // _TIME_SYNC_H_
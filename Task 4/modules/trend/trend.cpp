@@ -0,0 +1,155 @@
+//=====[Libraries]=============================================================
+
+#include <math.h>
+
+#include "trend.h"
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void trendReadingAdd(trendState_t* state, uint16_t windowLength,
+                            uint32_t periodMs, uint16_t reading, uint32_t elapsedMs);
+static void trendSamplePush(trendState_t* state, uint16_t windowLength,
+                            uint16_t reading);
+static uint32_t trendTimeToReach(float remaining, float slope, uint32_t periodMs);
+
+//=====[Implementations of public functions]===================================
+
+void trendInit(trendState_t* state) {
+    state->next = 0;
+    state->fill = 0;
+    state->elapsedMs = 0;
+    state->sum = 0;
+    state->sumSquares = 0;
+    state->sumWeighted = 0;
+    state->preAlarm = false;
+}
+
+// Adds one reading taken elapsedMs after the previous one; a longer gap than
+// the configured period (low-power bursts) is filled in, so the window keeps
+// its span and history across a change of rate. Fills estimate and reports a
+// pre-alarm change.
+trendEvent_t trendUpdate(trendState_t* state, const trendConfig_t* config,
+                         uint16_t reading, uint32_t elapsedMs,
+                         trendEstimate_t* estimate) {
+    uint16_t windowLength = config->windowLength > TREND_WINDOW_MAX
+                            ? TREND_WINDOW_MAX : config->windowLength;
+    uint32_t periodMs = config->periodMs;
+
+    estimate->valid = false;
+    estimate->rising = false;
+    estimate->mean = reading;
+    estimate->deviation = 0;
+    estimate->slopePerMinute = 0;
+    estimate->timeToTripMs = TREND_TIME_NEVER;
+
+    uint32_t projectedMs = TREND_TIME_NEVER;
+    if (windowLength >= 3 && periodMs > 0) {
+        trendReadingAdd(state, windowLength, periodMs, reading, elapsedMs);
+    }
+    if (windowLength >= 3 && periodMs > 0 && state->fill == windowLength) {
+        // The sums are exact integers, so nothing drifts however long this
+        // runs; only the derived figures, once per sample, use the FPU.
+        // x is the age rank 0..n-1 and every product below is n times the
+        // centred sum of squares or products.
+        int64_t n = windowLength;
+        int64_t sumX = n * (n - 1) / 2;
+        int64_t sumXX = (n - 1) * n * (2 * n - 1) / 6;
+        int64_t sxxN = n * sumXX - sumX * sumX;
+        int64_t sxyN = n * (int64_t)state->sumWeighted - sumX * (int64_t)state->sum;
+        int64_t syyN = n * (int64_t)state->sumSquares -
+                       (int64_t)state->sum * (int64_t)state->sum;
+
+        float slope = (float)sxyN / (float)sxxN;  // Readings per sample
+        float mean = (float)state->sum / (float)n;
+        float sxy2 = (float)sxyN * (float)sxyN;
+
+        // t^2 = slope^2 / var(slope) = sxy^2 (n - 2) / (sxx syy - sxy^2)
+        float unexplained = (float)sxxN * (float)syyN - sxy2;
+        bool significant = sxy2 * (float)(n - 2) >=
+                           (float)(TREND_SIGNIFICANCE_T * TREND_SIGNIFICANCE_T) *
+                           unexplained;
+
+        estimate->valid = true;
+        estimate->rising = slope > 0 && significant;
+        estimate->mean = (uint16_t)((state->sum + windowLength / 2) / windowLength);
+        estimate->deviation = (uint16_t)(sqrtf((float)syyN) / (float)n + 0.5f);
+        estimate->slopePerMinute = (int32_t)(slope * 60000.0f / (float)periodMs);
+
+        // From the fitted value at the newest sample
+        if (slope > 0) {
+            float fitted = mean + slope * (float)(n - 1) / 2.0f;
+            projectedMs = trendTimeToReach((float)config->tripReading - fitted, slope,
+                                           periodMs);
+        }
+        if (estimate->rising) {
+            estimate->timeToTripMs = projectedMs;
+        }
+    }
+
+    // Only ahead of the threshold: above it the alarm itself takes over
+    if (!state->preAlarm && estimate->rising && estimate->timeToTripMs > 0 &&
+        estimate->timeToTripMs <= config->horizonMs) {
+        state->preAlarm = true;
+        return TREND_PRE_ALARM;
+    }
+    if (state->preAlarm && (!estimate->valid || projectedMs == TREND_TIME_NEVER ||
+                            projectedMs > 2 * config->horizonMs)) {
+        state->preAlarm = false;
+        return TREND_PRE_ALARM_CLEAR;
+    }
+    return TREND_NO_CHANGE;
+}
+
+//=====[Implementations of private functions]==================================
+
+// Samples the reading at the fixed period: one sample per period elapsed,
+// those in a gap interpolated from the newest sample, the last one the
+// reading itself. More than a window of them only repeats the reading.
+static void trendReadingAdd(trendState_t* state, uint16_t windowLength,
+                            uint32_t periodMs, uint16_t reading, uint32_t elapsedMs) {
+    state->elapsedMs += elapsedMs;
+    uint32_t steps = state->elapsedMs / periodMs;
+    state->elapsedMs -= steps * periodMs;
+    if (state->fill == 0 || steps > windowLength) {
+        steps = steps > windowLength ? windowLength : steps;
+        for (uint32_t i = 0; i < steps; ++i) {
+            trendSamplePush(state, windowLength, reading);
+        }
+        return;
+    }
+
+    int32_t newest = state->window[(state->next + windowLength - 1) % windowLength];
+    for (uint32_t i = 1; i <= steps; ++i) {
+        int32_t step = ((int32_t)reading - newest) * (int32_t)i / (int32_t)steps;
+        trendSamplePush(state, windowLength, (uint16_t)(newest + step));
+    }
+}
+
+// Slides the window by one sample, updating the sums without a pass over it.
+// Once full, every rank drops by one as the oldest sample leaves, which takes
+// the sum of the remaining samples off the weighted sum.
+static void trendSamplePush(trendState_t* state, uint16_t windowLength,
+                            uint16_t reading) {
+    if (state->fill < windowLength) {
+        state->sumWeighted += (uint64_t)state->fill * reading;
+        state->fill++;
+    } else {
+        uint16_t oldest = state->window[state->next];
+        state->sumWeighted += (uint64_t)(windowLength - 1) * reading;
+        state->sumWeighted -= state->sum - oldest;
+        state->sum -= oldest;
+        state->sumSquares -= (uint32_t)oldest * oldest;
+    }
+    state->sum += reading;
+    state->sumSquares += (uint32_t)reading * reading;
+    state->window[state->next] = reading;
+    state->next = (state->next + 1) % windowLength;
+}
+
+static uint32_t trendTimeToReach(float remaining, float slope, uint32_t periodMs) {
+    if (remaining <= 0) {
+        return 0;
+    }
+    float timeMs = remaining / slope * (float)periodMs;
+    return timeMs < 4.0e9f ? (uint32_t)timeMs : TREND_TIME_NEVER;
+}
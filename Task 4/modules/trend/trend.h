@@ -0,0 +1,69 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _TREND_H_
+#define _TREND_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+//=====[Declaration of public defines]=========================================
+
+#define TREND_WINDOW_MAX            256  // Samples kept per channel
+
+#define TREND_SIGNIFICANCE_T        5    // Slope t-statistic accepted as a trend,
+                                         // high as smoothed snapshots correlate
+
+#define TREND_TIME_NEVER            UINT32_MAX
+
+//=====[Declaration of public data types]======================================
+
+// A least-squares line over the last windowLength samples of one channel,
+// one every periodMs, kept as exact running sums so every sample costs the
+// same whatever the window length. A pre-alarm is raised when the line is significantly rising,
+// still below tripReading and reaching it within horizonMs; it is dropped
+// when the line stops rising or would take more than twice the horizon.
+typedef struct {
+    uint16_t windowLength;      // 3 up to TREND_WINDOW_MAX, 0 disables
+    uint16_t tripReading;
+    uint32_t periodMs;          // Between the samples fitted
+    uint32_t horizonMs;
+} trendConfig_t;
+
+typedef enum {
+    TREND_NO_CHANGE,
+    TREND_PRE_ALARM,
+    TREND_PRE_ALARM_CLEAR,
+} trendEvent_t;
+
+typedef struct {
+    uint16_t window[TREND_WINDOW_MAX];
+    uint16_t next;              // Where the next sample goes
+    uint16_t fill;
+    uint32_t elapsedMs;         // Since the newest sample, short of a period
+    uint32_t sum;               // Of the samples
+    uint64_t sumSquares;
+    uint64_t sumWeighted;       // Of each sample times its age rank, 0 oldest
+    bool preAlarm;
+} trendState_t;
+
+// Readings use the 0 to 65535 scale of the sampler snapshot
+typedef struct {
+    bool valid;                 // False until the window has filled
+    bool rising;                // Slope positive and significant
+    uint16_t mean;
+    uint16_t deviation;         // Standard deviation of the samples
+    int32_t slopePerMinute;     // Of the fitted line, in readings
+    uint32_t timeToTripMs;      // Along the line, TREND_TIME_NEVER unless rising
+} trendEstimate_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void trendInit(trendState_t* state);
+trendEvent_t trendUpdate(trendState_t* state, const trendConfig_t* config,
+                         uint16_t reading, uint32_t elapsedMs,
+                         trendEstimate_t* estimate);
+
+//=====[#include guards - end]=================================================
+
+#endif // _TREND_H_
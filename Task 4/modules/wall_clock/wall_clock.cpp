@@ -0,0 +1,191 @@
+//=====[Libraries]=============================================================
+
+#include <time.h>
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "wall_clock.h"
+#include "command_line.h"
+#include "number_format.h"
+#include "pc_serial_com.h"
+
+//=====[Declaration of private defines]========================================
+
+// The RTC keeps the wall clock, to a second, through resets; two of its
+// backup registers keep the drift, so it applies from boot on
+#define WALL_CLOCK_BACKUP_MAGIC     0x31465244UL  // "DRF1" in memory order
+#define WALL_CLOCK_DRIFT_SAVE_PPB   100   // Least change worth a backup write
+#define WALL_CLOCK_RTC_ERROR_S      2     // Larger RTC errors are corrected
+
+//=====[Declaration and initialization of private global variables]============
+
+// Only updated with the mutex held, by the network thread and the console
+static timeSyncState_t syncState;
+static Mutex wallClockMutex;
+static int32_t savedDriftPpb = 0;
+
+// Published like the settings: readers copy the buffer generation selects
+static wallClockState_t stateBuffers[2];
+static volatile uint32_t generation = 0;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void wallClockPublish();
+static void wallClockRtcUpdate(int64_t wallUs);
+static void wallClockDriftSave();
+static void wallClockShow();
+
+//=====[Implementations of public functions]===================================
+
+// Starts from the RTC and the saved drift, if the RTC was ever set
+void wallClockInit() {
+    timeSyncInit(&syncState);
+
+    HAL_PWR_EnableBkUpAccess();
+    if (RTC->BKP18R == WALL_CLOCK_BACKUP_MAGIC) {
+        savedDriftPpb = (int32_t)RTC->BKP19R;
+        timeSyncDriftSet(&syncState, savedDriftPpb);
+    }
+
+    time_t rtcSeconds = time(NULL);
+    if (rtcSeconds >= WALL_CLOCK_UNIX_MIN) {
+        timeSyncSet(&syncState, wallClockLocalUs(), (int64_t)rtcSeconds * 1000000);
+    }
+    wallClockPublish();
+}
+
+// Microseconds since boot on the us ticker, extended to 64 bits; its low 32
+// bits are us_ticker_read(), which stamps the sample blocks
+uint64_t wallClockLocalUs() {
+    return ticker_read_us(get_us_ticker_data());
+}
+
+// Copies the current mapping; safe from any thread
+void wallClockGet(wallClockState_t* state) {
+    uint32_t current;
+    do {
+        current = core_util_atomic_load_u32(&generation);
+        *state = stateBuffers[current & 1];
+    } while (current != core_util_atomic_load_u32(&generation));
+}
+
+// Unix microseconds now, or 0 while the wall clock is unknown
+int64_t wallClockNowUs() {
+    wallClockState_t state;
+    wallClockGet(&state);
+    if (state.source == WALL_CLOCK_SOURCE_NONE) {
+        return 0;
+    }
+    return timeSyncMappingWallUs(&state.mapping, wallClockLocalUs());
+}
+
+// Adds an exchange with the collector and keeps the RTC and saved drift in
+// step with the result
+timeSyncResult_t wallClockExchangeAdd(const timeSyncExchange_t* exchange) {
+    wallClockMutex.lock();
+    timeSyncResult_t result = timeSyncExchangeAdd(&syncState, exchange);
+    if (result != TIME_SYNC_REJECTED) {
+        wallClockPublish();
+        wallClockRtcUpdate(timeSyncWallUs(&syncState, exchange->responseLocalUs));
+        wallClockDriftSave();
+    }
+    wallClockMutex.unlock();
+    return result;
+}
+
+// "time" shows the wall clock and exchanges, "time set 1791998138" sets it
+// to a Unix time in seconds where there is no collector to exchange with
+bool wallClockCommand(int argc, char** argv) {
+    uint32_t seconds;
+    if (argc == 1) {
+        wallClockShow();
+    } else if (argc == 3 && commandLineMatch(argv[1], "set") &&
+               numberFormatParseUnsigned(argv[2], &seconds) &&
+               seconds >= WALL_CLOCK_UNIX_MIN) {
+        wallClockMutex.lock();
+        timeSyncSet(&syncState, wallClockLocalUs(), (int64_t)seconds * 1000000);
+        wallClockPublish();
+        set_time((time_t)seconds);
+        wallClockMutex.unlock();
+        wallClockShow();
+    } else {
+        return false;
+    }
+    return true;
+}
+
+//=====[Implementations of private functions]==================================
+
+// Called with the mutex held, or before other threads start
+static void wallClockPublish() {
+    uint32_t next = generation + 1;
+    wallClockState_t* state = &stateBuffers[next & 1];
+    timeSyncMappingGet(&syncState, &state->mapping);
+    state->source = syncState.synced ? WALL_CLOCK_SOURCE_SYNCED
+                    : syncState.valid ? WALL_CLOCK_SOURCE_SET
+                                      : WALL_CLOCK_SOURCE_NONE;
+    core_util_atomic_store_u32(&generation, next);
+}
+
+// Setting the RTC restarts its second, so it is only done when it is off by
+// more than the rounding of a set
+static void wallClockRtcUpdate(int64_t wallUs) {
+    time_t wallSeconds = (time_t)(wallUs / 1000000);
+    time_t rtcSeconds = time(NULL);
+    if (rtcSeconds > wallSeconds + WALL_CLOCK_RTC_ERROR_S ||
+        rtcSeconds < wallSeconds - WALL_CLOCK_RTC_ERROR_S) {
+        set_time(wallSeconds);
+    }
+}
+
+static void wallClockDriftSave() {
+    if (!syncState.driftValid ||
+        (syncState.driftPpb < savedDriftPpb + WALL_CLOCK_DRIFT_SAVE_PPB &&
+         syncState.driftPpb > savedDriftPpb - WALL_CLOCK_DRIFT_SAVE_PPB &&
+         RTC->BKP18R == WALL_CLOCK_BACKUP_MAGIC)) {
+        return;
+    }
+    savedDriftPpb = syncState.driftPpb;
+    RTC->BKP19R = (uint32_t)savedDriftPpb;
+    RTC->BKP18R = WALL_CLOCK_BACKUP_MAGIC;
+}
+
+// "Wall clock: 2026-10-14 17:35:38 UTC from clock exchanges, drift -25.00 ppm"
+// and "Exchanges: 40 accepted, 0 rejected, 1 steps"
+static void wallClockShow() {
+    wallClockMutex.lock();
+    timeSyncState_t state = syncState;
+    wallClockMutex.unlock();
+
+    char str[100] = "";
+    char* cursor = numberFormatAppendString(str, "Wall clock: ");
+    if (!state.valid) {
+        cursor = numberFormatAppendString(cursor, "not set");
+    } else {
+        time_t seconds = (time_t)(timeSyncWallUs(&state, wallClockLocalUs()) / 1000000);
+        struct tm calendar;
+        gmtime_r(&seconds, &calendar);
+        cursor += strftime(cursor, sizeof(str) - (cursor - str), "%Y-%m-%d %H:%M:%S UTC",
+                           &calendar);
+        cursor = numberFormatAppendString(cursor, state.synced ? " from clock exchanges"
+                                                               : " from the RTC or console");
+    }
+    if (state.driftValid) {
+        cursor = numberFormatAppendString(cursor, ", drift ");
+        cursor = numberFormatAppendHundredths(cursor, state.driftPpb / 10);
+        cursor = numberFormatAppendString(cursor, " ppm");
+    }
+    numberFormatAppendString(cursor, "\r\n");
+    pcSerialComStringWrite(str);
+
+    str[0] = '\0';
+    cursor = numberFormatAppendString(str, "Exchanges: ");
+    cursor = numberFormatAppendUnsigned(cursor, state.exchanges);
+    cursor = numberFormatAppendString(cursor, " accepted, ");
+    cursor = numberFormatAppendUnsigned(cursor, state.rejected);
+    cursor = numberFormatAppendString(cursor, " rejected, ");
+    cursor = numberFormatAppendUnsigned(cursor, state.steps);
+    numberFormatAppendString(cursor, " steps\r\n");
+    pcSerialComStringWrite(str);
+}
@@ -0,0 +1,42 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _WALL_CLOCK_H_
+#define _WALL_CLOCK_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+
+#include "time_sync.h"
+
+//=====[Declaration of public defines]=========================================
+
+#define WALL_CLOCK_UNIX_MIN         1577836800  // 2020-01-01; older RTC times
+                                                // mean it was never set
+
+//=====[Declaration of public data types]======================================
+
+// Where the mapping comes from, as TIME frames report it
+typedef enum {
+    WALL_CLOCK_SOURCE_NONE,     // Wall clock unknown
+    WALL_CLOCK_SOURCE_SET,      // From the RTC at boot or the console, to a second
+    WALL_CLOCK_SOURCE_SYNCED,   // From clock exchanges with the collector
+} wallClockSource_t;
+
+typedef struct {
+    timeSyncMapping_t mapping;
+    wallClockSource_t source;
+} wallClockState_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void wallClockInit();
+uint64_t wallClockLocalUs();
+void wallClockGet(wallClockState_t* state);
+int64_t wallClockNowUs();
+timeSyncResult_t wallClockExchangeAdd(const timeSyncExchange_t* exchange);
+bool wallClockCommand(int argc, char** argv);
+
+//=====[#include guards - end]=================================================
+
+#endif // _WALL_CLOCK_H_